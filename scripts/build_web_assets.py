@@ -0,0 +1,101 @@
+"""Сборка ресурсов веб-интерфейса в src/web_assets.h.
+
+Каждый файл из web/ минифицируется (пробелы, пустые строки, комментарии),
+сжимается gzip и записывается массивом в PROGMEM вместе с сильным ETag
+(хеш сжатых байт). Сервер отдаёт массив как есть с Content-Encoding: gzip.
+
+Подключается в platformio.ini как pre-скрипт и выполняется перед каждой
+сборкой; заголовок перезаписывается только при изменении содержимого.
+Можно запустить и вручную: python scripts/build_web_assets.py
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+ASSETS = [
+    # (файл в web/, имя массива, MIME-тип)
+    ("index.html", "INDEX_HTML", "text/html"),
+]
+
+
+def minify(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        # Строка целиком из комментария JS; хвостовые // не трогаем -
+        # они встречаются внутри строк ('ws://')
+        if not line or line.startswith("//"):
+            continue
+        lines.append(line)
+    # Переводы строк оставлены: JS полагается на автоматическую ';'
+    return "\n".join(lines)
+
+
+def render_header(entries):
+    out = [
+        "// Сгенерировано scripts/build_web_assets.py из каталога web/ - не редактировать",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "#ifdef ARDUINO",
+        "#include <pgmspace.h>",
+        "#else",
+        "#define PROGMEM",
+        "#endif",
+        "",
+    ]
+    for name, mime, source, raw_size, data, etag in entries:
+        out.append("// %s: %u -> %u байт" % (source, raw_size, len(data)))
+        out.append("static const char %s_TYPE[] = \"%s\";" % (name, mime))
+        out.append("static const char %s_ETAG[] = \"\\\"%s\\\"\";" % (name, etag))
+        out.append("static const size_t %s_GZ_LENGTH = %u;" % (name, len(data)))
+        out.append("static const uint8_t %s_GZ[] PROGMEM = {" % name)
+        for offset in range(0, len(data), 16):
+            chunk = data[offset:offset + 16]
+            out.append("  " + ", ".join("0x%02x" % b for b in chunk) + ",")
+        out.append("};")
+        out.append("")
+    out.append("#endif")
+    out.append("")
+    return "\n".join(out)
+
+
+def build(project_dir, verbose=True):
+    entries = []
+    for source, name, mime in ASSETS:
+        with open(os.path.join(project_dir, "web", source), encoding="utf-8") as f:
+            raw = f.read().encode("utf-8")
+        small = minify(raw.decode("utf-8")).encode("utf-8")
+        # mtime=0: одинаковый вход даёт одинаковые байты и ETag
+        data = gzip.compress(small, compresslevel=9, mtime=0)
+        etag = hashlib.sha256(data).hexdigest()[:16]
+        entries.append((name, mime, source, len(raw), data, etag))
+        if verbose:
+            print("web assets: %s %u B -> minified %u B -> gzip %u B (%.0f%%), etag %s"
+                  % (source, len(raw), len(small), len(data), 100.0 * len(data) / len(raw), etag))
+
+    header = render_header(entries)
+    target = os.path.join(project_dir, "src", "web_assets.h")
+    current = None
+    if os.path.exists(target):
+        with open(target, encoding="utf-8") as f:
+            current = f.read()
+    if current != header:
+        with open(target, "w", encoding="utf-8") as f:
+            f.write(header)
+
+
+try:
+    Import("env")  # noqa: F821 - определён PlatformIO
+    build(env["PROJECT_DIR"])  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        build(os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0]))))
@@ -0,0 +1,249 @@
+"""Замер TLS на хосте: закреплённые корни против setInsecure() и keep-alive.
+
+1. Корни из SUPABASE_ROOT_CA (src/config.h) разбираются так же, как их
+   получит mbedTLS: скрипт падает, если PEM битый, пустой или корень
+   истекает в ближайший год.
+2. Локальный TLS сервер изображает Supabase: цепочка как у Cloudflare
+   (корень ECDSA P-384 -> промежуточный P-256 -> сертификат сервера),
+   TLS 1.2 без session tickets - как у WiFiClientSecure. На каждый режим
+   клиента идёт POST с телом строки workouts:
+     pinned    - новое соединение, цепочка проверяется по закреплённому корню
+     insecure  - новое соединение без проверки (SUPABASE_ROOT_CA = nullptr)
+     keepalive - запросы по одному открытому соединению (SupabaseClient)
+   Соединение с чужим корнем обязано не установиться.
+
+Абсолютные числа - хостовый OpenSSL, а не mbedTLS на ESP32 (там handshake
+стоит секунды); смысл в соотношениях режимов. Нужен openssl в PATH.
+  python scripts/tls_bench.py [-n 200]
+"""
+
+import argparse
+import os
+import re
+import socket
+import ssl
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+# Тело POST размером со строку workouts (workout_row.cpp)
+BODY = b'{"device_name":"ESP32_S3_Treadmill_Logger","start_time":"2026-05-01T10:00:00Z",' \
+       b'"end_time":"2026-05-01T10:45:00Z","duration":2700,"distance":7420,"avg_speed":9.89,' \
+       b'"max_speed":14.02,"calories":512,"avg_heart_rate":148,"max_heart_rate":176}'
+
+
+def read_root_ca(config_path):
+    with open(config_path, encoding="utf-8") as f:
+        text = f.read()
+    match = re.search(r"SUPABASE_ROOT_CA\s*=(.*?);", text, flags=re.S)
+    if match is None:
+        sys.exit("SUPABASE_ROOT_CA not found in %s" % config_path)
+    if match.group(1).strip() == "nullptr":
+        return None
+    # Склейка строковых литералов C; в PEM из экранирований только \n
+    literals = re.findall(r'"((?:[^"\\]|\\.)*)"', match.group(1))
+    return "".join(literals).replace("\\n", "\n")
+
+
+def check_root_ca(pem):
+    context = ssl.create_default_context(ssl.Purpose.SERVER_AUTH, cadata=pem)
+    roots = context.get_ca_certs()
+    if not roots:
+        sys.exit("SUPABASE_ROOT_CA holds no certificates")
+    soon = time.time() + 365 * 86400
+    for cert in roots:
+        subject = dict(item[0] for item in cert["subject"])
+        expires = ssl.cert_time_to_seconds(cert["notAfter"])
+        print("pinned root: %s, expires %s" % (subject.get("commonName"), cert["notAfter"]))
+        if expires < soon:
+            sys.exit("root %s expires within a year" % subject.get("commonName"))
+    print("pinned roots: %u, %u B of PEM in flash" % (len(roots), len(pem)))
+
+
+def openssl(*args):
+    subprocess.run(("openssl",) + args, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+
+def make_pki(folder):
+    def path(name):
+        return os.path.join(folder, name)
+
+    with open(path("ext.cnf"), "w") as f:
+        f.write("[ca]\nbasicConstraints=critical,CA:true\nkeyUsage=critical,keyCertSign,cRLSign\n"
+                "[leaf]\nbasicConstraints=CA:false\nsubjectAltName=DNS:localhost,IP:127.0.0.1\n"
+                "extendedKeyUsage=serverAuth\n")
+
+    # Корень и его двойник с тем же именем, но другим ключом
+    for root in ("root", "foreign"):
+        openssl("req", "-x509", "-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:P-384", "-nodes",
+                "-keyout", path(root + ".key"), "-out", path(root + ".pem"), "-days", "30",
+                "-subj", "/CN=Stand-in Root", "-addext", "basicConstraints=critical,CA:true",
+                "-addext", "keyUsage=critical,keyCertSign,cRLSign")
+
+    for name, issuer, subject, section in (("inter", "root", "/CN=Stand-in WE1", "ca"),
+                                           ("leaf", "inter", "/CN=localhost", "leaf")):
+        openssl("req", "-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:P-256", "-nodes",
+                "-keyout", path(name + ".key"), "-out", path(name + ".csr"), "-subj", subject)
+        openssl("x509", "-req", "-in", path(name + ".csr"), "-CA", path(issuer + ".pem"),
+                "-CAkey", path(issuer + ".key"), "-CAcreateserial", "-days", "30",
+                "-extfile", path("ext.cnf"), "-extensions", section, "-out", path(name + ".pem"))
+
+    with open(path("chain.pem"), "w") as chain:
+        for name in ("leaf", "inter"):
+            with open(path(name + ".pem")) as f:
+                chain.write(f.read())
+    return path
+
+
+def read_request(stream):
+    head = b""
+    while b"\r\n\r\n" not in head:
+        chunk = stream.recv(4096)
+        if not chunk:
+            return False
+        head += chunk
+    header, _, body = head.partition(b"\r\n\r\n")
+    length = 0
+    for line in header.split(b"\r\n")[1:]:
+        name, _, value = line.partition(b":")
+        if name.strip().lower() == b"content-length":
+            length = int(value)
+    while len(body) < length:
+        chunk = stream.recv(4096)
+        if not chunk:
+            return False
+        body += chunk
+    return True
+
+
+def serve(listener, context):
+    while True:
+        try:
+            raw, _ = listener.accept()
+        except OSError:
+            return
+        threading.Thread(target=serve_connection, args=(raw, context), daemon=True).start()
+
+
+def serve_connection(raw, context):
+    try:
+        with context.wrap_socket(raw, server_side=True) as stream:
+            # Keep-alive, как PostgREST за Cloudflare
+            while read_request(stream):
+                stream.sendall(b"HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n")
+    except (ssl.SSLError, OSError):
+        pass
+
+
+def client_context(root_pem):
+    if root_pem is None:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+        context.check_hostname = False
+        context.verify_mode = ssl.CERT_NONE
+    else:
+        context = ssl.create_default_context(ssl.Purpose.SERVER_AUTH, cafile=root_pem)
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.options |= ssl.OP_NO_TICKET
+    return context
+
+
+def post(stream):
+    stream.sendall(b"POST /rest/v1/workouts HTTP/1.1\r\nHost: localhost\r\n"
+                   b"Content-Type: application/json\r\nContent-Length: %d\r\n\r\n" % len(BODY) + BODY)
+    response = b""
+    while b"\r\n\r\n" not in response:
+        chunk = stream.recv(4096)
+        if not chunk:
+            raise ConnectionError("server closed the connection")
+        response += chunk
+    if not response.startswith(b"HTTP/1.1 201"):
+        raise ConnectionError("unexpected response %r" % response[:40])
+
+
+def connect(context, port):
+    raw = socket.create_connection(("127.0.0.1", port))
+    return context.wrap_socket(raw, server_hostname="localhost")
+
+
+def measure_new_connections(context, port, count):
+    samples = []
+    for _ in range(count):
+        started = time.perf_counter()
+        with connect(context, port) as stream:
+            post(stream)
+        samples.append((time.perf_counter() - started) * 1000)
+    return samples
+
+
+def measure_keepalive(context, port, count):
+    samples = []
+    with connect(context, port) as stream:
+        for _ in range(count):
+            started = time.perf_counter()
+            post(stream)
+            samples.append((time.perf_counter() - started) * 1000)
+    return samples
+
+
+def report(mode, samples, baseline):
+    samples = sorted(samples)
+    median = statistics.median(samples)
+    p90 = samples[int(len(samples) * 0.9) - 1]
+    print("%-9s %4u requests: median %.3f ms, p90 %.3f ms (x%.2f of insecure)"
+          % (mode, len(samples), median, p90, median / baseline))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="TLS cost of the Supabase client on the host")
+    parser.add_argument("-n", type=int, default=200, help="requests per mode")
+    args = parser.parse_args()
+
+    project_dir = os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0])))
+    pem = read_root_ca(os.path.join(project_dir, "src", "config.h"))
+    if pem is None:
+        print("WARNING: SUPABASE_ROOT_CA is nullptr - firmware calls setInsecure()")
+    else:
+        check_root_ca(pem)
+
+    with tempfile.TemporaryDirectory() as folder:
+        path = make_pki(folder)
+        server = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        server.load_cert_chain(path("chain.pem"), path("leaf.key"))
+        server.maximum_version = ssl.TLSVersion.TLSv1_2
+        server.options |= ssl.OP_NO_TICKET
+
+        listener = socket.socket()
+        listener.bind(("127.0.0.1", 0))
+        listener.listen(16)
+        port = listener.getsockname()[1]
+        threading.Thread(target=serve, args=(listener, server), daemon=True).start()
+
+        # Закрепление действительно отсекает сервер с чужим корнем
+        try:
+            connect(client_context(path("foreign.pem")), port).close()
+            sys.exit("connection with a foreign root was accepted")
+        except ssl.SSLCertVerificationError:
+            print("foreign root: rejected")
+
+        pinned = client_context(path("root.pem"))
+        insecure = client_context(None)
+        # Прогрев: первые соединения платят за импорт и кэши OpenSSL
+        measure_new_connections(pinned, port, 5)
+        measure_new_connections(insecure, port, 5)
+
+        insecure_ms = measure_new_connections(insecure, port, args.n)
+        pinned_ms = measure_new_connections(pinned, port, args.n)
+        keepalive_ms = measure_keepalive(pinned, port, args.n)
+        listener.close()
+
+    baseline = statistics.median(insecure_ms)
+    report("insecure", insecure_ms, baseline)
+    report("pinned", pinned_ms, baseline)
+    report("keepalive", keepalive_ms, baseline)
+
+
+if __name__ == "__main__":
+    main()
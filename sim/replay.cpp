@@ -0,0 +1,791 @@
+// Симулятор конвейера записи тренировок на хосте (pio run -e native).
+//
+// Проигрывает журналы кадров FTMS 0x2ACD через тот же код, что и прошивка:
+// TreadmillSession (WorkoutTracker -> SessionStore + WorkoutJournal) ->
+// строка workouts -> UploadOutbox -> архив WorkoutHistory. BLE, WiFi и HTTP заменены
+// подделками, время - виртуальное, поэтому час тренировки проходит за
+// миллисекунды. Флеш - каталог на диске (PosixFlash).
+//
+// Форматы строк журнала (прочие строки пропускаются):
+//   RAW DATA: 0C 04 ...                 - вывод прошивки с RAW = true
+//   12:34:56.789 > RAW DATA: 0C 04 ...  - то же через pio device monitor -f time
+//   @12345 0C 04 ...                    - миллисекунды от начала записи
+//   0C 04 ...                           - просто байты кадра
+// Без метки времени кадры идут через --interval мс. Прошивка печатает
+// RAW DATA только при изменении кадра, поэтому в паузах между метками
+// предыдущий кадр повторяется каждые --interval мс, как его слала дорожка.
+//
+// Файл .pcap из /api/capture.pcap (FrameCapture) проигрывается как есть:
+// в нём все кадры с временем уведомления, паузы не заполняются повторами.
+// Скачок времени назад (кольцо пережило перезагрузку) - продолжение записи.
+//
+//   .pio/build/native/program [опции] log1.txt log2.txt ...
+//     --interval MS     шаг кадров без меток (1000)
+//     --tail MS         сколько повторять последний кадр в конце (30000)
+//     --speed X         темп относительно реального времени, 0 - максимум (0)
+//     --epoch UNIX      unix-время начала записи (1714557600)
+//     --wifi-delay MS   подключение WiFi после старта (2000)
+//     --wifi-drop MS    обрыв WiFi каждые MS, 0 - никогда (0)
+//     --ble-drop MS     обрыв BLE каждые MS, 0 - никогда (0)
+//     --ble-off MS      сколько дорожка недоступна после обрыва (10000)
+//     --http-fail PCT   доля неудачных POST, % (0)
+//     --devices N       журналы идут группами по N одновременно, каждый -
+//                       своя дорожка с общими флешем и очередью отправки (1)
+//     --hr-jitter MS    у каждой дорожки ремень: отсчёт пульса раз в секунду
+//                       со сдвигом и задержкой доставки до MS (без ремня)
+//     --fs DIR          каталог флеша (/tmp/treadmill-sim)
+//     --rows            печатать строки workouts
+//     --trace FILE      последние события трассировки (Chrome trace JSON)
+//
+// Стоимость трассировки: сравнить frames/s сборок с -DTRACE_ENABLED=0 и без.
+//
+// Тесты (pio test -e native) собираются вместе с src/ и этим каталогом,
+// но main у каждого теста свой, поэтому симулятор в них выключен.
+
+#ifndef PIO_UNIT_TESTING
+
+#include <chrono>
+#include <ftw.h>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+#include <memory>
+
+#include "ble_central.h"
+#include "flash_budget.h"
+#include "flash_fs.h"
+#include "frame_queue.h"
+#include "retry_backoff.h"
+#include "session_store.h"
+#include "treadmill_session.h"
+#include "outbox_drain.h"
+#include "upload_outbox.h"
+#include "wifi_manager.h"
+#include "workout_history.h"
+#include "workout_row.h"
+#include "workout_stats.h"
+#include "calories.h"
+#include "heart_rate.h"
+#include "tracer.h"
+
+static const size_t MAX_FRAME = FTMS_MAX_FRAME;
+static const size_t SESSION_CAPACITY = 4096;
+static const size_t UPLOAD_BATCH = 8;
+static const uint32_t BEAT_INTERVAL_MS = 1000;
+static const UserProfile SIM_USER = { 80.0f, 35, true };
+
+struct Options {
+  uint32_t interval = 1000;
+  uint32_t tail = 30000;
+  double speed = 0.0;
+  time_t epoch = 1714557600;
+  uint32_t wifiDelay = 2000;
+  uint32_t wifiDrop = 0;
+  uint32_t bleDrop = 0;
+  uint32_t bleOff = 10000;
+  uint32_t httpFail = 0;
+  uint32_t devices = 1;
+  bool strap = false;
+  uint32_t hrJitter = 0;
+  const char* fsDir = "/tmp/treadmill-sim";
+  bool rows = false;
+  const char* trace = nullptr;
+};
+
+struct Frame {
+  bool timed;
+  uint32_t timeMs;
+  uint8_t length;
+  uint8_t data[MAX_FRAME];
+};
+
+// Детерминированный генератор: одинаковый прогон - одинаковый результат
+static uint32_t nextRandom(uint32_t& state) {
+  state = state * 1664525u + 1013904223u;
+  return state;
+}
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// pcap от FrameCapture: заголовок 24 байта, little-endian, микросекунды
+static const uint32_t PCAP_MAGIC = 0xA1B2C3D4;
+
+static uint32_t getU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool isPcap(FILE* file) {
+  uint8_t header[24];
+  if (fread(header, 1, sizeof(header), file) == sizeof(header) && getU32(header) == PCAP_MAGIC) {
+    return true;
+  }
+  rewind(file);
+  return false;
+}
+
+// Следующий кадр pcap; кадры длиннее MAX_FRAME пропускаются
+static bool readPcapFrame(FILE* file, Frame& frame) {
+  uint8_t header[16];
+  uint8_t data[256];
+  while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+    uint32_t length = getU32(header + 8);
+    if (length > sizeof(data) || fread(data, 1, length, file) != length) return false;
+    if (length == 0 || length > MAX_FRAME) continue;
+
+    uint64_t timeUs = (uint64_t)getU32(header) * 1000000 + getU32(header + 4);
+    frame.timed = true;
+    frame.timeMs = (uint32_t)(timeUs / 1000);
+    frame.length = (uint8_t)length;
+    memcpy(frame.data, data, length);
+    return true;
+  }
+  return false;
+}
+
+// Байты "0C 04 ..." до конца строки; false - в строке не только байты
+static bool parseHex(const char* text, Frame& frame) {
+  frame.length = 0;
+  const char* p = text;
+  while (*p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    if (*p == '\0') break;
+    int high = hexDigit(p[0]);
+    int low = high < 0 ? -1 : hexDigit(p[1]);
+    if (low < 0 || (p[2] != '\0' && p[2] != ' ' && p[2] != '\t' && p[2] != '\r' && p[2] != '\n')) {
+      return false;
+    }
+    if (frame.length == MAX_FRAME) return false;
+    frame.data[frame.length++] = (uint8_t)(high << 4 | low);
+    p += 2;
+  }
+  return frame.length > 0;
+}
+
+static bool parseLine(const char* line, Frame& frame) {
+  frame.timed = false;
+  while (*line == ' ' || *line == '\t') line++;
+
+  int hours, minutes, seconds, millis, consumed = 0;
+  if (line[0] == '@') {
+    char* end;
+    frame.timeMs = (uint32_t)strtoul(line + 1, &end, 10);
+    frame.timed = true;
+    line = end;
+  } else if (sscanf(line, "%2d:%2d:%2d.%3d%n", &hours, &minutes, &seconds, &millis, &consumed) == 4) {
+    frame.timeMs = (uint32_t)(((hours * 60 + minutes) * 60 + seconds) * 1000 + millis);
+    frame.timed = true;
+    line += consumed;
+  }
+
+  const char* raw = strstr(line, "RAW DATA:");
+  if (raw != nullptr) return parseHex(raw + strlen("RAW DATA:"), frame);
+  while (*line == ' ' || *line == '>' || *line == '-') line++;
+  return parseHex(line, frame);
+}
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+struct Totals {
+  uint64_t frames = 0;
+  uint64_t records = 0;
+  uint64_t virtualMs = 0;
+  uint32_t workouts = 0;
+  uint32_t discarded = 0;
+  uint32_t uploaded = 0;
+  uint32_t duplicates = 0;
+  uint32_t failedPosts = 0;
+  uint32_t wifiAttempts = 0;
+  uint32_t malformed = 0;
+  uint32_t invalidTime = 0;
+  uint32_t bleAttempts = 0;
+  uint32_t bleDrops = 0;
+  uint64_t bleLost = 0;
+  uint32_t firstSamples = 0;
+  uint64_t firstSampleSum = 0;
+  uint32_t firstSampleMax = 0;
+  uint64_t outageSum = 0;
+  uint32_t beats = 0;
+  uint32_t hrMatched = 0;
+  uint32_t hrUnmatched = 0;
+  uint32_t hrOverflows = 0;
+  uint32_t hrMaxLatency = 0;
+  uint32_t hrMaxPending = 0;
+};
+
+// Следующий кадр журнала: строки лога или записи pcap
+static bool readFrame(FILE* file, bool pcap, Frame& frame) {
+  if (pcap) return readPcapFrame(file, frame);
+  char line[512];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (parseLine(line, frame)) return true;
+  }
+  return false;
+}
+
+// Кадры одного журнала по порядку с моментом отправки дорожкой (мс от
+// начала записи): записанные кадры, повторы в паузах лога и хвост
+class FrameSource {
+public:
+  FrameSource(const Options& options) : options(options) {}
+  ~FrameSource() { if (file != nullptr) fclose(file); }
+
+  bool open(const char* path) {
+    file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    pcap = isPcap(file);
+    return true;
+  }
+
+  bool next(Frame& frame, uint32_t& when) {
+    while (true) {
+      if (haveRead) {
+        // Кадры, которые лог не записал (без изменений), дорожка слала дальше
+        if (!pcap && havePrevious && at + options.interval < target) {
+          at += options.interval;
+        } else {
+          at = target;
+          previous = read;
+          havePrevious = true;
+          haveRead = false;
+        }
+        frame = previous;
+        when = at;
+        return true;
+      }
+
+      if (file != nullptr) {
+        if (readFrame(file, pcap, read)) {
+          schedule();
+          continue;
+        }
+        fclose(file);
+        file = nullptr;
+        tailEnd = at + options.tail;
+      }
+
+      if (!havePrevious || at + options.interval > tailEnd) return false;
+      at += options.interval;
+      frame = previous;
+      when = at;
+      return true;
+    }
+  }
+
+private:
+  // Момент отправки прочитанного кадра
+  void schedule() {
+    haveRead = true;
+    if (!read.timed) {
+      target = havePrevious ? at + options.interval : options.interval;
+      return;
+    }
+    if (!sawTimed) {
+      firstTimed = read.timeMs;
+      lastTimed = read.timeMs;
+      sawTimed = true;
+    }
+    if (read.timeMs < lastTimed) {
+      if (pcap) {
+        // Время с загрузки: новая загрузка продолжает запись
+        firstTimed = read.timeMs - at;
+      } else {
+        // Время суток из монитора: переход через полночь
+        firstTimed -= 24u * 3600 * 1000;
+      }
+    }
+    lastTimed = read.timeMs;
+    target = read.timeMs - firstTimed + options.interval;
+    if (target < at) target = at;
+  }
+
+  const Options& options;
+  FILE* file = nullptr;
+  bool pcap = false;
+  Frame read;
+  bool haveRead = false;
+  uint32_t target = 0;
+  Frame previous;
+  bool havePrevious = false;
+  uint32_t at = 0;
+  uint32_t firstTimed = 0;
+  uint32_t lastTimed = 0;
+  bool sawTimed = false;
+  uint32_t tailEnd = 0;
+};
+
+class Simulation;
+
+// Дорожка прогона: подделка стека BLE, сессия как в прошивке, журнал кадров
+struct Lane {
+  Lane(Simulation& owner, const Options& options, uint8_t index, const char* path,
+       FlashFs& flash, SessionListener& listener)
+    : owner(owner), session(index, "00:00:00:00:00:00", path, ble, flash, listener),
+      source(options), bleDropAt(options.bleDrop) {}
+
+  Simulation& owner;
+  FakeBleCentral ble;
+  FakeBleCentral strapBle;
+  TreadmillSession session;
+  FrameSource source;
+  Frame next;
+  uint32_t nextAt = 0;
+  bool pending = false;
+  uint32_t bleDropAt;
+  uint32_t bleBackAt = 0;
+  // Ремень: отсчёт, снятый в beatAt, доходит до задачи обработки в beatDelivery
+  uint32_t beatIndex = 0;
+  uint32_t beatAt = 0;
+  uint32_t beatDelivery = 0;
+};
+
+// Подделка POST /rest/v1/workouts: доля --http-fail запросов не доходит,
+// остальные принимаются, повторы сервер отбрасывает по client_id
+class FakeSupabase : public UploadPoster {
+public:
+  FakeSupabase(const Options& options, Totals& totals, uint32_t& seed)
+    : options(options), totals(totals), seed(seed) {}
+
+  int postBatch(const char* body, size_t, size_t, char* response, size_t responseSize) override {
+    if (responseSize > 0) response[0] = '\0';
+    if (options.httpFail > 0 && nextRandom(seed) % 100 < options.httpFail) {
+      totals.failedPosts++;
+      return -1;
+    }
+    static const char KEY[] = "\"client_id\":\"";
+    for (const char* at = strstr(body, KEY); at != nullptr; at = strstr(at, KEY)) {
+      at += sizeof(KEY) - 1;
+      const char* end = strchr(at, '"');
+      if (end == nullptr) break;
+      if (rows.insert(std::string(at, end - at)).second) {
+        totals.uploaded++;
+      } else {
+        totals.duplicates++;
+      }
+    }
+    return 201;
+  }
+
+private:
+  const Options& options;
+  Totals& totals;
+  uint32_t& seed;
+  std::set<std::string> rows;
+};
+
+// Один прогон группы журналов: каждый журнал - своя дорожка (сессия,
+// трекер, очередь кадров); флеш, очередь отправки, архив и WiFi общие,
+// как в прошивке
+class Simulation : public SessionListener {
+public:
+  Simulation(const Options& options, Totals& totals)
+    : options(options), totals(totals), flash(options.fsDir),
+      outbox(flash, "/outbox"), history(flash, "/history"),
+      supabase(options, totals, seed), drain(outbox, supabase, UPLOAD_BATCH),
+      wifiDriver(now, options.wifiDelay, options.wifiDrop), wifi(wifiDriver, 2000, 60000),
+      uploadBackoff(5000, 15 * 60 * 1000UL) {
+    // Свой поток случайностей у каждого прогона, но повторяемый
+    seed = (uint32_t)totals.frames + 1;
+    history.begin();
+    wifiDriver.attach(wifi);
+    wifi.start(0);
+  }
+
+  // Дорожка с журналом path; false - журнал не открыть
+  bool addLane(const char* path) {
+    uint8_t index = (uint8_t)lanes.size();
+    lanes.emplace_back(new Lane(*this, options, index, path, flash, *this));
+    Lane& lane = *lanes.back();
+    if (!lane.source.open(path)) return false;
+
+    lane.session.begin(SESSION_CAPACITY);
+    lane.session.journal().setMaxBytes(flashJournalLimit(options.devices));
+    lane.session.tracker().reset(0);
+    // Путь кадра как в прошивке: callback стека -> FrameQueue -> трекер,
+    // подключение и переподключение - BleLink поверх подделки стека
+    lane.ble.begin();
+    lane.session.link().start(lane.session.address(), 0x1826, 0x2ACD, onNotify, &lane, 0);
+    lane.session.link().poll(0);
+    if (options.strap) {
+      lane.session.attachStrap(lane.strapBle, "00:00:00:00:00:01");
+      lane.strapBle.begin();
+      lane.session.strap()->start(lane.session.strapAddress(), HEART_RATE_SERVICE_UUID,
+                                  HEART_RATE_MEASUREMENT_UUID, onHeartRateNotify, &lane, 0);
+      lane.session.strap()->poll(0);
+      scheduleBeat(lane);
+    }
+    lane.pending = lane.source.next(lane.next, lane.nextAt);
+    return true;
+  }
+
+  // Кадры всех дорожек в порядке времени отправки
+  void run() {
+    while (true) {
+      Lane* earliest = nullptr;
+      for (auto& lane : lanes) {
+        if (lane->pending && (earliest == nullptr || lane->nextAt < earliest->nextAt)) {
+          earliest = lane.get();
+        }
+      }
+      if (earliest == nullptr) break;
+      if (options.strap) {
+        // Отсчёты ремня, дошедшие раньше следующего кадра
+        Lane* beating = nullptr;
+        for (auto& lane : lanes) {
+          if (lane->pending && lane->beatDelivery < earliest->nextAt &&
+              (beating == nullptr || lane->beatDelivery < beating->beatDelivery)) {
+            beating = lane.get();
+          }
+        }
+        if (beating != nullptr) {
+          deliverBeat(*beating);
+          continue;
+        }
+      }
+      deliver(*earliest, earliest->next, earliest->nextAt);
+      earliest->pending = earliest->source.next(earliest->next, earliest->nextAt);
+    }
+  }
+
+  // Кадр от дорожки lane в момент at (мс от начала записи)
+  void deliver(Lane& lane, const Frame& frame, uint32_t at) {
+    advanceTo(at);
+    totals.frames++;
+    if (!lane.ble.isConnected()) totals.bleLost++;
+    lane.ble.notify(frame.data, frame.length);
+
+    RawFrame raw;
+    WorkoutTracker& tracker = lane.session.tracker();
+    while (lane.session.heartRateFrames().pop(raw)) lane.session.onHeartRate(raw);
+    while (lane.session.frames().pop(raw)) {
+      uint32_t frameMs = (uint32_t)(raw.timestampUs / 1000);
+      if (tracker.onFrame(raw.data, raw.length, frameMs, options.epoch + frameMs / 1000)) totals.records++;
+    }
+    step();
+  }
+
+  // Отсчёт ремня: пульс растёт со скоростью дорожки, кадр 0x2A37 с uint8
+  void deliverBeat(Lane& lane) {
+    advanceTo(lane.beatDelivery);
+    float speed = lane.session.tracker().record().speed;
+    uint8_t bpm = (uint8_t)(65.0f + speed * 8.0f + nextRandom(seed) % 5);
+    uint8_t frame[2] = { 0x00, bpm };
+    lane.strapBle.notify(frame, sizeof(frame));
+    totals.beats++;
+
+    RawFrame raw;
+    while (lane.session.heartRateFrames().pop(raw)) lane.session.onHeartRate(raw);
+    scheduleBeat(lane);
+    step();
+  }
+
+  // Следующий отсчёт: сетка раз в секунду со сдвигом до hrJitter,
+  // доставка - ещё через 0..hrJitter мс
+  void scheduleBeat(Lane& lane) {
+    uint32_t jitter = options.hrJitter + 1;
+    lane.beatIndex++;
+    lane.beatAt = lane.beatIndex * BEAT_INTERVAL_MS + nextRandom(seed) % jitter;
+    lane.beatDelivery = lane.beatAt + nextRandom(seed) % jitter;
+    if (lane.beatDelivery < now) lane.beatDelivery = now;
+  }
+
+  // Время идёт без кадров (пропавшая дорожка, выгрузка очереди)
+  void idle(uint32_t until) {
+    while (now < until) {
+      advanceTo(now + 1000 < until ? now + 1000 : until);
+      step();
+    }
+  }
+
+  void finish() {
+    // Остаток очереди уходит, пока есть сеть; не дольше часа
+    uint32_t limit = now + 3600 * 1000;
+    while (outbox.count() > 0 && now < limit) idle(now + 1000);
+    totals.virtualMs += now;
+    totals.wifiAttempts += wifi.attempts();
+    for (auto& lane : lanes) {
+      totals.malformed += lane->session.tracker().malformedFrames();
+      totals.invalidTime += lane->session.tracker().invalidTimestamps();
+      totals.bleAttempts += lane->session.link().attempts();
+      totals.bleDrops += lane->session.link().drops();
+      const HeartRateMerger& merger = lane->session.heartRate();
+      totals.hrMatched += merger.matched();
+      totals.hrUnmatched += merger.unmatched();
+      totals.hrOverflows += merger.overflows();
+      if (merger.maxLatencyMs() > totals.hrMaxLatency) totals.hrMaxLatency = merger.maxLatencyMs();
+      if (merger.maxPending() > totals.hrMaxPending) totals.hrMaxPending = (uint32_t)merger.maxPending();
+    }
+    if (outbox.count() > 0) {
+      printf("%s: %u row(s) left in outbox\n", lanes.front()->session.name(), (unsigned)outbox.count());
+    }
+  }
+
+  void onWorkoutStart(TreadmillSession&, time_t) override {}
+
+  void onWorkoutEnd(TreadmillSession& session, time_t startTime, time_t endTime,
+                    const char* journalPath) override {
+    const SessionStore& buffer = session.buffer();
+    char key[40];
+    if (session.index() == 0) {
+      snprintf(key, sizeof(key), "%ld-sim", (long)startTime);
+    } else {
+      snprintf(key, sizeof(key), "%ld-sim-%u", (long)startTime, (unsigned)session.index());
+    }
+    char row[UploadOutbox::MAX_ROW];
+    size_t length = writeWorkoutRow(buffer, startTime, endTime, key, session.name(), SIM_USER,
+                                    3 * 3600, row, sizeof(row));
+    if (length > 0) outbox.enqueue(key, row, length);
+
+    const WorkoutStats& stats = buffer.stats();
+    WorkoutHistory::Entry entry = {};
+    entry.id = (uint32_t)startTime;
+    entry.duration = (uint32_t)(endTime - startTime);
+    entry.distance = buffer.empty() ? 0 : buffer.last().distance;
+    entry.maxSpeed = (uint16_t)(stats.maxSpeed() * 100.0f + 0.5f);
+    entry.avgSpeed = (uint16_t)(stats.avgSpeed() * 100.0f + 0.5f);
+    entry.samples = (uint32_t)buffer.sampleCount();
+    entry.device = session.index();
+    // Архив забирает журнал переименованием; не принятый журнал не нужен
+    if (journalPath[0] != '\0' && !history.append(journalPath, entry)) flash.remove(journalPath);
+
+    totals.workouts++;
+    printf("%s: workout %ld +%lds, %u m, %u samples (%u points), max %.1f avg %.1f km/h\n",
+           session.name(), (long)startTime, (long)(endTime - startTime), (unsigned)entry.distance,
+           (unsigned)buffer.sampleCount(), (unsigned)buffer.size(), stats.maxSpeed(), stats.avgSpeed());
+    printf("  moving %us, %.0f kcal, climb %.1f m, %u km split(s)",
+           (unsigned)stats.movingSeconds(), stats.calories(SIM_USER), stats.elevationGain(),
+           (unsigned)stats.splitCount(WorkoutStats::KILOMETER));
+    if (stats.splitCount(WorkoutStats::KILOMETER) > 0) {
+      printf(", first %.0fs", stats.split(WorkoutStats::KILOMETER, 0));
+    }
+    if (stats.avgHeartRate() != 0) printf(", avg heart rate %u", (unsigned)stats.avgHeartRate());
+    printf("\n");
+    if (session.journal().sessionDroppedSamples() > 0) {
+      printf("  journal full: last %u sample(s) kept only in RAM\n",
+             (unsigned)session.journal().sessionDroppedSamples());
+    }
+    if (options.rows && length > 0) printf("  %s\n", row);
+  }
+
+  void onWorkoutDiscard(TreadmillSession& session, const char* reason) override {
+    totals.discarded++;
+    printf("%s: workout discarded at +%us: %s\n", session.name(), (unsigned)(now / 1000), reason);
+  }
+
+private:
+  // NotifyHandler: метка времени - виртуальное время симуляции
+  static void onNotify(const uint8_t* data, size_t length, void* context) {
+    Lane* lane = (Lane*)context;
+    Simulation& self = lane->owner;
+    BleLink& link = lane->session.link();
+    lane->session.frames().push(data, length, (int64_t)self.now * 1000);
+    if (link.onNotify(self.now)) {
+      Totals& totals = self.totals;
+      totals.firstSamples++;
+      totals.firstSampleSum += link.firstSampleMs();
+      totals.outageSum += link.outageMs();
+      if (link.firstSampleMs() > totals.firstSampleMax) totals.firstSampleMax = link.firstSampleMs();
+    }
+  }
+
+  // NotifyHandler ремня: метка - момент снятия отсчёта, а не доставки
+  static void onHeartRateNotify(const uint8_t* data, size_t length, void* context) {
+    Lane* lane = (Lane*)context;
+    lane->session.heartRateFrames().push(data, length, (int64_t)lane->beatAt * 1000);
+    lane->session.strap()->onNotify(lane->owner.now);
+  }
+
+  // Дорожка пропадает каждые bleDrop мс на bleOff мс
+  void stepBle(Lane& lane) {
+    if (options.bleDrop > 0) {
+      if (lane.bleBackAt == 0 && now >= lane.bleDropAt) {
+        lane.ble.setReachable(false);
+        lane.bleBackAt = now + options.bleOff;
+        if (lane.bleBackAt == 0) lane.bleBackAt = 1;
+      } else if (lane.bleBackAt != 0 && now >= lane.bleBackAt) {
+        lane.ble.setReachable(true);
+        lane.bleBackAt = 0;
+        lane.bleDropAt = now + options.bleDrop;
+      }
+    }
+    lane.session.link().poll(now);
+    if (lane.session.strap() != nullptr) lane.session.strap()->poll(now);
+  }
+
+  void advanceTo(uint32_t at) {
+    if (at > now) now = at;
+    if (options.speed > 0.0) {
+      // Темп: виртуальные миллисекунды делятся на speed
+      auto target = started + std::chrono::microseconds((uint64_t)(now * 1000.0 / options.speed));
+      std::this_thread::sleep_until(target);
+    }
+  }
+
+  void step() {
+    for (auto& lane : lanes) {
+      lane->session.poll(now);
+      stepBle(*lane);
+    }
+    wifiDriver.step();
+    wifi.poll(now);
+    if (wifi.isUp() && outbox.count() > 0 && now >= nextUpload) upload();
+  }
+
+  // Очередь разбирается тем же OutboxDrain, что и в прошивке
+  void upload() {
+    OutboxDrain::Result result = drain.step();
+    if (result == OutboxDrain::FAILED || result == OutboxDrain::SCHEMA_ERROR) {
+      nextUpload = now + uploadBackoff.nextDelay(nextRandom(seed));
+    } else if (result == OutboxDrain::SENT) {
+      uploadBackoff.reset();
+    }
+  }
+
+  const Options& options;
+  Totals& totals;
+  uint32_t now = 0;
+  std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+  PosixFlash flash;
+  UploadOutbox outbox;
+  WorkoutHistory history;
+  FakeSupabase supabase;
+  OutboxDrain drain;
+  std::vector<std::unique_ptr<Lane>> lanes;
+  FakeWifiDriver wifiDriver;
+  WifiManager wifi;
+  RetryBackoff uploadBackoff;
+  uint32_t nextUpload = 0;
+  uint32_t seed = 1;
+};
+
+static bool replayGroup(const Options& options, const std::vector<const char*>& paths, Totals& totals) {
+  nftw(options.fsDir, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  Simulation sim(options, totals);
+  for (const char* path : paths) {
+    if (!sim.addLane(path)) {
+      fprintf(stderr, "%s: cannot open\n", path);
+      return false;
+    }
+  }
+  sim.run();
+  sim.finish();
+  return true;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  std::vector<const char*> files;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(arg, "--interval") == 0 && hasValue) {
+      options.interval = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--tail") == 0 && hasValue) {
+      options.tail = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--speed") == 0 && hasValue) {
+      options.speed = atof(argv[++i]);
+    } else if (strcmp(arg, "--epoch") == 0 && hasValue) {
+      options.epoch = (time_t)strtoll(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--wifi-delay") == 0 && hasValue) {
+      options.wifiDelay = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--wifi-drop") == 0 && hasValue) {
+      options.wifiDrop = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--ble-drop") == 0 && hasValue) {
+      options.bleDrop = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--ble-off") == 0 && hasValue) {
+      options.bleOff = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--http-fail") == 0 && hasValue) {
+      options.httpFail = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--devices") == 0 && hasValue) {
+      options.devices = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--hr-jitter") == 0 && hasValue) {
+      options.strap = true;
+      options.hrJitter = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(arg, "--fs") == 0 && hasValue) {
+      options.fsDir = argv[++i];
+    } else if (strcmp(arg, "--trace") == 0 && hasValue) {
+      options.trace = argv[++i];
+    } else if (strcmp(arg, "--rows") == 0) {
+      options.rows = true;
+    } else if (arg[0] == '-') {
+      fprintf(stderr, "unknown option %s\n", arg);
+      return 2;
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.empty()) {
+    fprintf(stderr, "usage: %s [options] frames.log|capture.pcap ...\n", argv[0]);
+    return 2;
+  }
+  if (options.interval == 0) options.interval = 1000;
+  if (options.devices == 0) options.devices = 1;
+  if (options.devices > 8) options.devices = 8;
+
+  Totals totals;
+  auto started = std::chrono::steady_clock::now();
+  for (size_t first = 0; first < files.size(); first += options.devices) {
+    size_t count = files.size() - first < options.devices ? files.size() - first : options.devices;
+    std::vector<const char*> group(files.begin() + first, files.begin() + first + count);
+    if (!replayGroup(options, group, totals)) return 1;
+  }
+
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  printf("total: %d file(s), %llu frames, %llu records, %u workouts, %u discarded, "
+         "%u malformed, %u invalid time\n",
+         (int)files.size(), (unsigned long long)totals.frames, (unsigned long long)totals.records,
+         totals.workouts, totals.discarded, totals.malformed, totals.invalidTime);
+  printf("upload: %u row(s) accepted, %u duplicate(s), %u failed POST(s), %u WiFi attempt(s)\n",
+         totals.uploaded, totals.duplicates, totals.failedPosts, totals.wifiAttempts);
+  printf("ble: %u connect attempt(s), %u drop(s), %llu frame(s) lost offline, "
+         "first sample avg %.0f ms (max %u) after the connect attempt, %.0f ms after the loss\n",
+         totals.bleAttempts, totals.bleDrops, (unsigned long long)totals.bleLost,
+         totals.firstSamples > 0 ? (double)totals.firstSampleSum / totals.firstSamples : 0.0,
+         totals.firstSampleMax,
+         totals.firstSamples > 0 ? (double)totals.outageSum / totals.firstSamples : 0.0);
+  if (options.strap) {
+    printf("hr: %u beat(s), %u record(s) matched, %u without strap pulse, max latency %u ms, "
+           "max %u pending, %u overflow(s)\n",
+           totals.beats, totals.hrMatched, totals.hrUnmatched, totals.hrMaxLatency,
+           totals.hrMaxPending, totals.hrOverflows);
+  }
+  printf("time: %.1f h simulated in %.3f s (x%.0f), %.0f frames/s\n",
+         totals.virtualMs / 3600000.0, wallSeconds,
+         wallSeconds > 0 ? totals.virtualMs / 1000.0 / wallSeconds : 0.0,
+         wallSeconds > 0 ? totals.frames / wallSeconds : 0.0);
+
+  if (options.trace != nullptr) {
+#if TRACE_ENABLED
+    FILE* out = fopen(options.trace, "w");
+    if (out == nullptr) {
+      fprintf(stderr, "%s: cannot create\n", options.trace);
+      return 1;
+    }
+    TraceStream stream(tracer);
+    uint8_t chunk[512];
+    size_t length;
+    while ((length = stream.fill(chunk, sizeof(chunk))) > 0) fwrite(chunk, 1, length, out);
+    fclose(out);
+#else
+    fprintf(stderr, "--trace: built with TRACE_ENABLED=0\n");
+#endif
+  }
+  return 0;
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,148 @@
+#ifndef BLE_CENTRAL_H
+#define BLE_CENTRAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Всё, что логгеру нужно от стека BLE: подключиться к дорожке по адресу
+// и получать уведомления одной характеристики. Логика вокруг (метка
+// времени, очередь кадров, трекер) не зависит от стека и работает на
+// хосте с FakeBleCentral (sim/).
+class BleCentral {
+public:
+  // Вызывается из задачи стека BLE: только копия данных и передача дальше
+  typedef void (*NotifyHandler)(const uint8_t* data, size_t length, void* context);
+
+  virtual ~BleCentral() {}
+
+  virtual bool begin() = 0;
+  // Подключение, поиск service/characteristic (16-бит UUID) и подписка
+  // на уведомления. Блокирует до результата
+  virtual bool connect(const char* address, uint16_t service, uint16_t characteristic,
+                       NotifyHandler handler, void* context) = 0;
+  virtual bool isConnected() = 0;
+  virtual void disconnect() = 0;
+  // Для джиттера пауз между попытками
+  virtual uint32_t random32() = 0;
+};
+
+// Подделка для хоста: "дорожка" отправляет кадры через notify()
+class FakeBleCentral : public BleCentral {
+public:
+  FakeBleCentral() : reachable(true), linked(false), handler(nullptr), context(nullptr),
+                     connectCount(0), seed(12345) {}
+
+  bool begin() override { return true; }
+
+  // Адрес и UUID не проверяются: у подделки одна дорожка
+  bool connect(const char*, uint16_t, uint16_t,
+               NotifyHandler notifyHandler, void* notifyContext) override {
+    connectCount++;
+    if (!reachable) return false;
+    handler = notifyHandler;
+    context = notifyContext;
+    linked = true;
+    return true;
+  }
+
+  bool isConnected() override { return linked; }
+  void disconnect() override { linked = false; }
+
+  uint32_t random32() override {
+    // xorshift32: повторяемые паузы между прогонами
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  // Дорожка выключена или вне досягаемости: connect() не удаётся
+  void setReachable(bool on) {
+    reachable = on;
+    if (!on) linked = false;
+  }
+
+  // Уведомление от дорожки; без соединения теряется, как в эфире
+  void notify(const uint8_t* data, size_t length) {
+    if (linked && handler != nullptr) handler(data, length, context);
+  }
+
+  uint32_t connects() const { return connectCount; }
+
+private:
+  bool reachable;
+  bool linked;
+  NotifyHandler handler;
+  void* context;
+  uint32_t connectCount;
+  uint32_t seed;
+};
+
+#ifdef ARDUINO
+class NimBLEClient;
+struct ble_gap_event;
+struct ble_gap_event_listener;
+struct ble_gatt_error;
+struct ble_gatt_attr;
+
+// NimBLE-Arduino: только роль central, меньше кучи и быстрее подключение,
+// чем у Bluedroid. Один объект - одно соединение (свой NimBLEClient);
+// стек общий, соединений до CONFIG_BT_NIMBLE_MAX_CONNECTIONS.
+//
+// Хэндлы значения характеристики и её CCCD после первого поиска сервисов
+// хранятся в NVS: следующие подключения (и после перезагрузки) пишут
+// CCCD по хэндлу без обнаружения сервисов. Уведомления принимаются по
+// хэндлу слушателем GAP. Не удалось подписаться по кэшу (прошивка дорожки
+// сменила таблицу GATT) - кэш сбрасывается, поиск выполняется заново.
+// slot - номер записи кэша в NVS (номер дорожки).
+class NimBleCentral : public BleCentral {
+public:
+  explicit NimBleCentral(uint8_t slot = 0);
+
+  bool begin() override;
+  bool connect(const char* address, uint16_t service, uint16_t characteristic,
+               NotifyHandler handler, void* context) override;
+  bool isConnected() override;
+  void disconnect() override;
+  uint32_t random32() override;
+
+  // Последнее удачное подключение: длительность и был ли поиск сервисов
+  uint32_t lastConnectMs() const { return connectMs; }
+  bool lastUsedCache() const { return usedCache; }
+  uint16_t mtu() const;
+
+private:
+  struct GattCache {
+    char address[18];
+    uint16_t service;
+    uint16_t characteristic;
+    uint16_t valueHandle;
+    uint16_t cccdHandle;
+  };
+
+  bool discover(uint16_t service, uint16_t characteristic);
+  bool subscribe();
+  void loadCache();
+  void saveCache();
+  void clearCache();
+
+  static int onGapEvent(ble_gap_event* event, void* arg);
+  static int onWritten(uint16_t connHandle, const ble_gatt_error* error,
+                       ble_gatt_attr* attr, void* arg);
+
+  uint8_t slot;
+  NimBLEClient* client;
+  ble_gap_event_listener* listener;
+  NotifyHandler handler;
+  void* context;
+  GattCache cache;
+  bool cacheValid;
+  volatile uint16_t valueHandle;   // 0 - уведомления не принимаются
+  volatile int writeStatus;
+  void* waitingTask;
+  uint32_t connectMs;
+  bool usedCache;
+};
+#endif
+
+#endif
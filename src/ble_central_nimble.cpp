@@ -0,0 +1,204 @@
+#ifdef ARDUINO
+
+#include "ble_central.h"
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <Preferences.h>
+
+#include "frame_queue.h"
+
+// Таймаут установления соединения, с. Пока он идёт, контроллер ждёт
+// рекламу дорожки, поэтому включённая в это время дорожка подключается
+// сразу. Подключения дорожек идут по очереди (в стеке одно за раз), так
+// что таймаут короткий: выключенные дорожки задерживают остальные не
+// больше чем на 3 с каждая. Реклама включённой приходит чаще раза в секунду
+static const uint32_t CONNECT_TIMEOUT_S = 3;
+// Ответ на запись CCCD
+static const uint32_t SUBSCRIBE_TIMEOUT_MS = 3000;
+
+// Уведомление целиком в одном пакете ATT (0x2ACD бывает длиннее 20 байт):
+// самый длинный кадр плюс 3 байта заголовка ATT
+static const uint16_t PREFERRED_MTU = FTMS_MAX_FRAME + 3;
+
+// Интервал 15-30 мс (единицы 1.25 мс) без пропуска событий: задержка
+// уведомления не больше интервала. Супервизия 2 с (единицы 10 мс) -
+// выключение дорожки замечается быстро
+static const uint16_t CONN_INTERVAL_MIN = 12;
+static const uint16_t CONN_INTERVAL_MAX = 24;
+static const uint16_t CONN_LATENCY = 0;
+static const uint16_t SUPERVISION_TIMEOUT = 200;
+
+static const uint16_t CCCD_UUID = 0x2902;
+static const char* NVS_NAMESPACE = "ble";
+
+NimBleCentral::NimBleCentral(uint8_t slot)
+  : slot(slot), client(nullptr), listener(nullptr), handler(nullptr), context(nullptr),
+    cacheValid(false), valueHandle(0), writeStatus(0), waitingTask(nullptr), connectMs(0),
+    usedCache(false) {}
+
+bool NimBleCentral::begin() {
+  // Стек один на все дорожки
+  if (!NimBLEDevice::getInitialized()) {
+    NimBLEDevice::init("");
+    NimBLEDevice::setMTU(PREFERRED_MTU);
+  }
+  client = NimBLEDevice::createClient();
+  if (client == nullptr) return false;
+  client->setConnectTimeout(CONNECT_TIMEOUT_S);
+  client->setConnectionParams(CONN_INTERVAL_MIN, CONN_INTERVAL_MAX, CONN_LATENCY, SUPERVISION_TIMEOUT);
+
+  // Уведомления по хэндлу: слушатель видит их до обработчика клиента,
+  // которому без поиска сервисов не с чем их сопоставить
+  listener = new ble_gap_event_listener();
+  ble_gap_event_listener_register(listener, onGapEvent, this);
+  loadCache();
+  return true;
+}
+
+static void cacheKey(uint8_t slot, char* out, size_t size) {
+  snprintf(out, size, "gatt%u", (unsigned)slot);
+}
+
+bool NimBleCentral::connect(const char* address, uint16_t service, uint16_t characteristic,
+                            NotifyHandler notifyHandler, void* notifyContext) {
+  if (client == nullptr) return false;
+  handler = notifyHandler;
+  context = notifyContext;
+  valueHandle = 0;
+
+  uint32_t started = millis();
+  if (!client->connect(NimBLEAddress(std::string(address)))) return false;
+
+  bool cached = cacheValid && strcmp(cache.address, address) == 0 &&
+                cache.service == service && cache.characteristic == characteristic;
+  if (cached && !subscribe()) {
+    clearCache();
+    cached = false;
+  }
+  if (!cached) {
+    strncpy(cache.address, address, sizeof(cache.address) - 1);
+    cache.address[sizeof(cache.address) - 1] = '\0';
+    if (!discover(service, characteristic) || !subscribe()) {
+      client->disconnect();
+      return false;
+    }
+    saveCache();
+  }
+
+  connectMs = millis() - started;
+  usedCache = cached;
+  return true;
+}
+
+// Полный поиск сервиса и характеристики; хэндлы - в cache
+bool NimBleCentral::discover(uint16_t service, uint16_t characteristic) {
+  NimBLERemoteService* remoteService = client->getService(NimBLEUUID(service));
+  NimBLERemoteCharacteristic* remote = remoteService != nullptr
+    ? remoteService->getCharacteristic(NimBLEUUID(characteristic)) : nullptr;
+  if (remote == nullptr || !remote->canNotify()) return false;
+
+  NimBLERemoteDescriptor* cccd = remote->getDescriptor(NimBLEUUID(CCCD_UUID));
+  if (cccd == nullptr) return false;
+
+  cache.service = service;
+  cache.characteristic = characteristic;
+  cache.valueHandle = remote->getHandle();
+  cache.cccdHandle = cccd->getHandle();
+  return true;
+}
+
+// Запись 0x0001 в CCCD по хэндлу с ожиданием ответа дорожки
+bool NimBleCentral::subscribe() {
+  static const uint8_t ENABLE_NOTIFY[2] = { 0x01, 0x00 };
+
+  valueHandle = cache.valueHandle;
+  waitingTask = xTaskGetCurrentTaskHandle();
+  writeStatus = -1;
+  ulTaskNotifyTake(pdTRUE, 0);
+
+  int rc = ble_gattc_write_flat(client->getConnId(), cache.cccdHandle, ENABLE_NOTIFY,
+                                sizeof(ENABLE_NOTIFY), onWritten, this);
+  bool answered = rc == 0 && ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SUBSCRIBE_TIMEOUT_MS)) > 0;
+  waitingTask = nullptr;
+
+  if (!answered || writeStatus != 0) {
+    valueHandle = 0;
+    return false;
+  }
+  return true;
+}
+
+int NimBleCentral::onWritten(uint16_t connHandle, const ble_gatt_error* error,
+                             ble_gatt_attr* attr, void* arg) {
+  NimBleCentral* self = (NimBleCentral*)arg;
+  self->writeStatus = error->status;
+  TaskHandle_t task = (TaskHandle_t)self->waitingTask;
+  if (task != nullptr) xTaskNotifyGive(task);
+  return 0;
+}
+
+// Задача хоста NimBLE: только передача кадра дальше
+int NimBleCentral::onGapEvent(ble_gap_event* event, void* arg) {
+  NimBleCentral* self = (NimBleCentral*)arg;
+  if (event->type != BLE_GAP_EVENT_NOTIFY_RX || event->notify_rx.indication) return 0;
+  if (self->valueHandle == 0 || event->notify_rx.attr_handle != self->valueHandle) return 0;
+  if (self->client == nullptr || event->notify_rx.conn_handle != self->client->getConnId()) return 0;
+
+  uint8_t data[FTMS_MAX_FRAME];
+  uint16_t length = OS_MBUF_PKTLEN(event->notify_rx.om);
+  if (length > sizeof(data)) length = sizeof(data);
+  if (os_mbuf_copydata(event->notify_rx.om, 0, length, data) != 0) return 0;
+
+  if (self->handler != nullptr) self->handler(data, length, self->context);
+  return 0;
+}
+
+void NimBleCentral::loadCache() {
+  Preferences preferences;
+  char key[12];
+  cacheKey(slot, key, sizeof(key));
+  if (!preferences.begin(NVS_NAMESPACE, true)) return;
+  cacheValid = preferences.getBytes(key, &cache, sizeof(cache)) == sizeof(cache) &&
+               cache.valueHandle != 0 && cache.cccdHandle != 0;
+  preferences.end();
+}
+
+void NimBleCentral::saveCache() {
+  Preferences preferences;
+  char key[12];
+  cacheKey(slot, key, sizeof(key));
+  cacheValid = true;
+  if (!preferences.begin(NVS_NAMESPACE, false)) return;
+  preferences.putBytes(key, &cache, sizeof(cache));
+  preferences.end();
+}
+
+void NimBleCentral::clearCache() {
+  Preferences preferences;
+  char key[12];
+  cacheKey(slot, key, sizeof(key));
+  cacheValid = false;
+  if (!preferences.begin(NVS_NAMESPACE, false)) return;
+  preferences.remove(key);
+  preferences.end();
+}
+
+bool NimBleCentral::isConnected() {
+  return client != nullptr && client->isConnected();
+}
+
+void NimBleCentral::disconnect() {
+  valueHandle = 0;
+  if (client != nullptr && client->isConnected()) client->disconnect();
+}
+
+uint32_t NimBleCentral::random32() {
+  return esp_random();
+}
+
+uint16_t NimBleCentral::mtu() const {
+  return client != nullptr ? client->getMTU() : 0;
+}
+
+#endif
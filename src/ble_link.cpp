@@ -0,0 +1,62 @@
+#include "ble_link.h"
+
+BleLink::BleLink(BleCentral& central, uint32_t retryBaseMs, uint32_t retryCapMs)
+  : central(central), backoff(retryBaseMs, retryCapMs), current(BLE_LINK_DOWN),
+    address(nullptr), service(0), characteristic(0), handler(nullptr), context(nullptr),
+    deadline(0), attemptStarted(0), lostAt(0), awaitingSample(false), firstSample(0), outage(0),
+    attemptCount(0), dropCount(0) {}
+
+void BleLink::start(const char* deviceAddress, uint16_t serviceUuid, uint16_t characteristicUuid,
+                    BleCentral::NotifyHandler notifyHandler, void* notifyContext, uint32_t nowMs) {
+  address = deviceAddress;
+  service = serviceUuid;
+  characteristic = characteristicUuid;
+  handler = notifyHandler;
+  context = notifyContext;
+  lostAt = nowMs;
+  deadline = nowMs;
+  backoff.reset();
+  current.store(BLE_LINK_BACKOFF, std::memory_order_release);
+}
+
+void BleLink::attempt(uint32_t nowMs) {
+  attemptCount.fetch_add(1, std::memory_order_relaxed);
+  attemptStarted = nowMs;
+  current.store(BLE_LINK_CONNECTING, std::memory_order_release);
+
+  // Уведомление может прийти раньше, чем connect() вернёт управление
+  awaitingSample.store(true, std::memory_order_release);
+  if (central.connect(address, service, characteristic, handler, context)) {
+    backoff.reset();
+    current.store(BLE_LINK_UP, std::memory_order_release);
+    return;
+  }
+
+  awaitingSample.store(false, std::memory_order_relaxed);
+  deadline = nowMs + backoff.nextDelay(central.random32());
+  current.store(BLE_LINK_BACKOFF, std::memory_order_release);
+}
+
+void BleLink::poll(uint32_t nowMs) {
+  BleLinkState now = state();
+
+  if (now == BLE_LINK_UP) {
+    if (central.isConnected()) return;
+    // Обрыв: дорожка выключена или ушла из зоны. Сразу одна попытка -
+    // короткий сбой эфира проходит без паузы
+    dropCount.fetch_add(1, std::memory_order_relaxed);
+    lostAt = nowMs;
+    attempt(nowMs);
+  } else if (now == BLE_LINK_BACKOFF && (int32_t)(nowMs - deadline) >= 0) {
+    attempt(nowMs);
+  }
+}
+
+bool BleLink::onNotify(uint32_t nowMs) {
+  if (!awaitingSample.load(std::memory_order_relaxed)) return false;
+  if (!awaitingSample.exchange(false, std::memory_order_acq_rel)) return false;
+
+  firstSample.store(nowMs - attemptStarted, std::memory_order_relaxed);
+  outage.store(nowMs - lostAt, std::memory_order_relaxed);
+  return true;
+}
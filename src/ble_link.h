@@ -0,0 +1,71 @@
+#ifndef BLE_LINK_H
+#define BLE_LINK_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ble_central.h"
+#include "retry_backoff.h"
+
+enum BleLinkState : uint8_t {
+  BLE_LINK_DOWN,         // не запущен
+  BLE_LINK_CONNECTING,   // идёт connect()
+  BLE_LINK_UP,
+  BLE_LINK_BACKOFF       // пауза перед следующей попыткой
+};
+
+// Подключение к дорожке и переподключение после обрыва.
+// poll() вызывается периодически из одной задачи (BLE_Task): connect()
+// стека блокирует только её, а не loop и не обработку кадров. Обрыв
+// замечается по isConnected(); первая попытка после обрыва - сразу,
+// следующие - через паузы с джиттером (RetryBackoff).
+//
+// Время до первого кадра: firstSampleMs() - от начала удачной попытки,
+// outageMs() - от start() или обрыва. Дорожка включилась где-то в паузе
+// перед удачной попыткой, поэтому её включение - между этими двумя.
+class BleLink {
+public:
+  BleLink(BleCentral& central, uint32_t retryBaseMs, uint32_t retryCapMs);
+
+  // Первая попытка - в ближайшем poll()
+  void start(const char* address, uint16_t service, uint16_t characteristic,
+             BleCentral::NotifyHandler handler, void* context, uint32_t nowMs);
+  // Проверка связи, попытка по истечении паузы (блокирует на connect())
+  void poll(uint32_t nowMs);
+  // Из обработчика уведомлений; true - первый кадр после подключения,
+  // firstSampleMs() и outageMs() обновлены
+  bool onNotify(uint32_t nowMs);
+
+  BleLinkState state() const { return current.load(std::memory_order_acquire); }
+  bool isUp() const { return state() == BLE_LINK_UP; }
+
+  uint32_t attempts() const { return attemptCount.load(std::memory_order_relaxed); }
+  uint32_t drops() const { return dropCount.load(std::memory_order_relaxed); }
+  uint32_t firstSampleMs() const { return firstSample.load(std::memory_order_relaxed); }
+  uint32_t outageMs() const { return outage.load(std::memory_order_relaxed); }
+
+private:
+  void attempt(uint32_t nowMs);
+
+  BleCentral& central;
+  RetryBackoff backoff;
+  std::atomic<BleLinkState> current;
+
+  const char* address;
+  uint16_t service;
+  uint16_t characteristic;
+  BleCentral::NotifyHandler handler;
+  void* context;
+
+  uint32_t deadline;        // конец паузы
+  uint32_t attemptStarted;  // начало текущей попытки
+  uint32_t lostAt;          // start() или обрыв
+  std::atomic<bool> awaitingSample;
+  std::atomic<uint32_t> firstSample;
+  std::atomic<uint32_t> outage;
+  std::atomic<uint32_t> attemptCount;
+  std::atomic<uint32_t> dropCount;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef BODY_CACHE_H
+#define BODY_CACHE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Кэш готового тела ответа (например, JSON для /data).
+// Писатель сериализует тело один раз на обновление в свободный слот и
+// публикует его; читатели берут текущий слот по ссылке (acquire/release)
+// и отдают его в сокет без копии. Слот, который кто-то держит, писатель
+// не трогает; если свободных нет, обновление пропускается (stale()) и
+// читатели продолжают получать предыдущее тело. Без кучи и блокировок.
+template <size_t SLOTS, size_t SIZE>
+class BodyCache {
+  static_assert(SLOTS >= 2, "BodyCache needs at least two slots");
+
+public:
+  static const size_t CAPACITY = SIZE;
+
+  struct Body {
+    uint32_t version;
+    size_t length;
+    char data[SIZE];
+  };
+
+  BodyCache() : current(-1), writing(-1), staleCount(0) {
+    for (size_t i = 0; i < SLOTS; i++) refs[i].store(0);
+  }
+
+  // Писатель: буфер свободного слота или nullptr, если все заняты
+  char* begin() {
+    int active = current.load(std::memory_order_seq_cst);
+    for (size_t i = 0; i < SLOTS; i++) {
+      if ((int)i != active && refs[i].load(std::memory_order_seq_cst) == 0) {
+        writing = (int)i;
+        return slots[i].data;
+      }
+    }
+    writing = -1;
+    staleCount++;
+    return nullptr;
+  }
+
+  // Писатель: публикует слот, выданный begin()
+  void commit(size_t length, uint32_t version) {
+    if (writing < 0) return;
+    slots[writing].length = length < SIZE ? length : SIZE;
+    slots[writing].version = version;
+    current.store(writing, std::memory_order_seq_cst);
+    writing = -1;
+  }
+
+  // Читатель: текущее тело (nullptr, пока ничего не опубликовано).
+  // Обязательно вернуть через release()
+  const Body* acquire() {
+    while (true) {
+      int index = current.load(std::memory_order_seq_cst);
+      if (index < 0) return nullptr;
+      refs[index].fetch_add(1, std::memory_order_seq_cst);
+      // Слот мог перестать быть текущим до того, как мы его заняли:
+      // тогда писатель мог уже начать его перезапись
+      if (current.load(std::memory_order_seq_cst) == index) return &slots[index];
+      refs[index].fetch_sub(1, std::memory_order_seq_cst);
+    }
+  }
+
+  void release(const Body* body) {
+    size_t index = body - slots;
+    if (index < SLOTS) refs[index].fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  // Обновления, пропущенные из-за того, что все слоты были заняты
+  uint32_t stale() const { return staleCount; }
+
+private:
+  Body slots[SLOTS];
+  std::atomic<uint32_t> refs[SLOTS];
+  std::atomic<int> current;
+  int writing;           // слот между begin() и commit()
+  uint32_t staleCount;
+};
+
+#endif
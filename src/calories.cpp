@@ -0,0 +1,44 @@
+#include "calories.h"
+
+// Верхние границы ступеней, км/ч, и их MET
+static const float BAND_LIMITS[MET_BANDS - 1] = { 1.0f, 4.0f, 6.0f, 8.0f, 10.0f, 12.0f };
+static const float BAND_METS[MET_BANDS] = {
+  2.0f,    // очень медленная ходьба
+  3.5f,    // медленная ходьба
+  4.5f,    // обычная ходьба
+  6.0f,    // быстрая ходьба
+  8.0f,    // легкий бег
+  10.0f,   // умеренный бег
+  11.5f    // быстрый бег
+};
+
+size_t metBand(float speedKmh) {
+  size_t band = 0;
+  while (band < MET_BANDS - 1 && speedKmh >= BAND_LIMITS[band]) band++;
+  return band;
+}
+
+float bandMet(size_t band) {
+  return BAND_METS[band < MET_BANDS ? band : MET_BANDS - 1];
+}
+
+// 1 MET = 1 ккал/кг/ч
+static float metPerMinute(const UserProfile& user, float met) {
+  return met * user.weightKg / 60.0f;
+}
+
+float bandCaloriesPerMinute(const UserProfile& user, size_t band) {
+  return metPerMinute(user, bandMet(band));
+}
+
+float caloriesPerMinute(const UserProfile& user, float speedKmh, uint8_t heartRate) {
+  if (heartRate == 0) return bandCaloriesPerMinute(user, metBand(speedKmh));
+
+  // кДж/мин -> ккал/мин
+  float kj = user.male
+    ? -55.0969f + 0.6309f * heartRate + 0.1988f * user.weightKg + 0.2017f * user.age
+    : -20.4022f + 0.4472f * heartRate - 0.1263f * user.weightKg + 0.074f * user.age;
+  float kcal = kj / 4.184f;
+  float rest = metPerMinute(user, 1.0f);
+  return kcal > rest ? kcal : rest;
+}
@@ -0,0 +1,27 @@
+#ifndef CALORIES_H
+#define CALORIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Данные пользователя для оценки расхода энергии
+struct UserProfile {
+  float weightKg;
+  uint8_t age;
+  bool male;
+};
+
+// MET ходьбы и бега ступенями по скорости: band - номер ступени
+// (0..MET_BANDS-1), одинаковый для всех скоростей с одним MET
+static const size_t MET_BANDS = 7;
+size_t metBand(float speedKmh);
+float bandMet(size_t band);
+inline float speedMet(float speedKmh) { return bandMet(metBand(speedKmh)); }
+
+// Расход, ккал/мин. С пульсом - по формуле Keytel et al. (2005, без
+// VO2max), но не меньше покоя (1 MET); без пульса (0) - по MET скорости
+float caloriesPerMinute(const UserProfile& user, float speedKmh, uint8_t heartRate);
+// То же для ступени MET (без пульса)
+float bandCaloriesPerMinute(const UserProfile& user, size_t band);
+
+#endif
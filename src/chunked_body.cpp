@@ -0,0 +1,23 @@
+#include "chunked_body.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool writeChunkedBody(const ChunkProducer& producer, const ChunkSink& sink,
+                      uint8_t* chunk, size_t chunkSize, bool* produced) {
+  if (chunkSize > CHUNK_MAX) chunkSize = CHUNK_MAX;
+  // Данные с отступом под строку размера, она дописывается перед ними
+  const size_t prefix = CHUNK_FRAMING - 2;
+  for (;;) {
+    size_t length = producer(chunk + prefix, chunkSize);
+    if (produced != nullptr) *produced = true;
+    if (length == 0) break;
+    char sizeLine[8];
+    int sizeLength = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)length);
+    memcpy(chunk + prefix - sizeLength, sizeLine, sizeLength);
+    chunk[prefix + length] = '\r';
+    chunk[prefix + length + 1] = '\n';
+    if (!sink(chunk + prefix - sizeLength, sizeLength + length + 2)) return false;
+  }
+  return sink((const uint8_t*)"0\r\n\r\n", 5);
+}
@@ -0,0 +1,30 @@
+#ifndef CHUNKED_BODY_H
+#define CHUNKED_BODY_H
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+// Тело запроса с Transfer-Encoding: chunked: каждый кусок источника
+// уходит как [размер hex]\r\n[данные]\r\n, конец тела - 0\r\n\r\n.
+// Источник пишет прямо в рабочий буфер с запасом под рамку, так что
+// кусок отправляется одной записью без копирования и тело целиком в
+// памяти не появляется. Сокет - у вызывающего (SupabaseClient::postStream),
+// на хосте - любой приёмник байтов.
+
+// Заполняет buffer до size байт; 0 - конец тела
+typedef std::function<size_t(uint8_t* buffer, size_t size)> ChunkProducer;
+// Отправляет байты целиком; false - соединение оборвано
+typedef std::function<bool(const uint8_t* data, size_t length)> ChunkSink;
+
+// Запас рабочего буфера под рамку куска: до 4 hex-цифр размера и два \r\n
+const size_t CHUNK_FRAMING = 8;
+const size_t CHUNK_MAX = 0xFFFF;
+
+// chunk - рабочий буфер на chunkSize + CHUNK_FRAMING байт, chunkSize до
+// CHUNK_MAX. false - приёмник оборвал запись; produced - источник успел
+// отдать хоть что-то (повтор тела тогда возможен только с начала)
+bool writeChunkedBody(const ChunkProducer& producer, const ChunkSink& sink,
+                      uint8_t* chunk, size_t chunkSize, bool* produced = nullptr);
+
+#endif
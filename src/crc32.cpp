@@ -0,0 +1,30 @@
+#include "crc32.h"
+
+// Таблица считается при компиляции и лежит во flash (.rodata): ленивой
+// инициализации, которую могли бы начать две задачи сразу, нет.
+// constexpr в форме C++11 (одно выражение), как требует gnu++11 ядра Arduino
+static constexpr uint32_t crcStep(uint32_t c, int bits) {
+  return bits == 0 ? c : crcStep((c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1), bits - 1);
+}
+
+#define CRC_4(i) crcStep(i, 8), crcStep(i + 1, 8), crcStep(i + 2, 8), crcStep(i + 3, 8)
+#define CRC_16(i) CRC_4(i), CRC_4(i + 4), CRC_4(i + 8), CRC_4(i + 12)
+#define CRC_64(i) CRC_16(i), CRC_16(i + 16), CRC_16(i + 32), CRC_16(i + 48)
+
+static constexpr uint32_t crcTable[256] = { CRC_64(0u), CRC_64(64u), CRC_64(128u), CRC_64(192u) };
+
+#undef CRC_64
+#undef CRC_16
+#undef CRC_4
+
+static_assert(crcTable[1] == 0x77073096u && crcTable[255] == 0x2D02EF8Du,
+              "CRC-32 table does not match IEEE 802.3");
+
+uint32_t crc32Update(uint32_t crc, const void* data, size_t length) {
+  const uint8_t* p = (const uint8_t*)data;
+  crc = ~crc;
+  while (length--) {
+    crc = crcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
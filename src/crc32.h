@@ -0,0 +1,14 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3), табличная реализация; crc - результат предыдущего вызова
+uint32_t crc32Update(uint32_t crc, const void* data, size_t length);
+
+inline uint32_t crc32(const void* data, size_t length) {
+  return crc32Update(0, data, length);
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include "deferred_log.h"
+
+#include <stdio.h>
+
+DeferredLog deferredLog;
+
+static_assert((DeferredLog::SLOTS & (DeferredLog::SLOTS - 1)) == 0, "DeferredLog::SLOTS must be a power of two");
+
+DeferredLog::DeferredLog() : enqueuePos(0), dequeuePos(0), droppedCount(0), reportedDrops(0) {
+  for (size_t i = 0; i < SLOTS; i++) slots[i].sequence.store((uint32_t)i, std::memory_order_relaxed);
+}
+
+void DeferredLog::encodeArg(Message& message, const char* text) {
+  if (text == nullptr) text = "(null)";
+  size_t length = strlen(text);
+  size_t room = TEXT_SIZE - message.textUsed;
+  if (length > room) length = room;
+  memcpy(message.text + message.textUsed, text, length);
+
+  message.types[message.argCount] = ARG_STRING;
+  message.args[message.argCount].text[0] = message.textUsed;
+  message.args[message.argCount].text[1] = (uint16_t)length;
+  message.argCount++;
+  message.textUsed += (uint8_t)length;
+}
+
+void DeferredLog::push(const Message& message) {
+  uint32_t position = enqueuePos.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots[position & (SLOTS - 1)];
+    uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+    int32_t difference = (int32_t)(sequence - position);
+    if (difference == 0) {
+      // Ячейка свободна: занимаем номер, если его не взял другой писатель
+      if (enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        slot.message = message;
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return;
+      }
+    } else if (difference < 0) {
+      // Читатель ещё не освободил ячейку: очередь полна
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+size_t DeferredLog::format(char* out, size_t size) {
+  if (size == 0) return 0;
+
+  uint32_t drops = dropped();
+  if (drops != reportedDrops) {
+    int written = snprintf(out, size, "[log] %u message(s) dropped\n", (unsigned)(drops - reportedDrops));
+    reportedDrops = drops;
+    if (written < 0) return 0;
+    return (size_t)written < size ? (size_t)written : size - 1;
+  }
+
+  Slot& slot = slots[dequeuePos & (SLOTS - 1)];
+  if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) return 0;
+
+  // Копия и сразу освобождение: форматирование не держит ячейку
+  Message message = slot.message;
+  slot.sequence.store(dequeuePos + SLOTS, std::memory_order_release);
+  dequeuePos++;
+  return render(message, out, size);
+}
+
+// Разбирает формат printf и подставляет аргументы по одному: спецификация
+// копируется как есть, модификатор длины заменяется на тип из сообщения
+size_t DeferredLog::render(const Message& message, char* out, size_t size) {
+  size_t used = 0;
+  size_t arg = 0;
+  const char* p = message.format;
+
+  while (*p != '\0' && used + 1 < size) {
+    if (*p != '%') {
+      out[used++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      out[used++] = '%';
+      p += 2;
+      continue;
+    }
+
+    // %[флаги][ширина][.точность][длина]преобразование
+    char spec[24];
+    size_t specLength = 0;
+    spec[specLength++] = *p++;
+    while (*p != '\0' && strchr("-+ #0123456789.", *p) != nullptr && specLength < sizeof(spec) - 4) {
+      spec[specLength++] = *p++;
+    }
+    while (*p != '\0' && strchr("hlLzjt", *p) != nullptr) p++;
+    char conversion = *p;
+    if (conversion == '\0') break;
+    p++;
+
+    int written = 0;
+    size_t room = size - used;
+    if (arg >= message.argCount) {
+      written = snprintf(out + used, room, "?");
+    } else {
+      uint8_t type = message.types[arg];
+      const auto& value = message.args[arg];
+      arg++;
+
+      if (strchr("diouxXc", conversion) != nullptr) {
+        long long number = type == ARG_DOUBLE ? (long long)value.d : value.i;
+        if (conversion == 'c') {
+          spec[specLength++] = 'c';
+          spec[specLength] = '\0';
+          written = snprintf(out + used, room, spec, (int)number);
+        } else {
+          spec[specLength++] = 'l';
+          spec[specLength++] = 'l';
+          spec[specLength++] = conversion;
+          spec[specLength] = '\0';
+          if (conversion == 'd' || conversion == 'i') {
+            written = snprintf(out + used, room, spec, number);
+          } else {
+            written = snprintf(out + used, room, spec, (unsigned long long)number);
+          }
+        }
+      } else if (strchr("eEfFgGaA", conversion) != nullptr) {
+        double number = type == ARG_DOUBLE ? value.d
+                      : (type == ARG_INT ? (double)value.i : (double)value.u);
+        spec[specLength++] = conversion;
+        spec[specLength] = '\0';
+        written = snprintf(out + used, room, spec, number);
+      } else if (conversion == 's' && type == ARG_STRING) {
+        char text[TEXT_SIZE + 1];
+        memcpy(text, message.text + value.text[0], value.text[1]);
+        text[value.text[1]] = '\0';
+        spec[specLength++] = 's';
+        spec[specLength] = '\0';
+        written = snprintf(out + used, room, spec, text);
+      } else if (conversion == 'p') {
+        written = snprintf(out + used, room, "%p", value.p);
+      } else {
+        written = snprintf(out + used, room, "?");
+      }
+    }
+
+    if (written < 0) break;
+    used += (size_t)written < room ? (size_t)written : room - 1;
+  }
+
+  out[used] = '\0';
+  return used;
+}
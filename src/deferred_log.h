@@ -0,0 +1,161 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Отложенный лог: вызов LOG_*() кладёт в кольцо указатель на строку
+// формата и аргументы в двоичном виде, форматирует и пишет в порт
+// фоновая задача с низким приоритетом. Вызывающий не ждёт ни UART, ни
+// USB CDC. Кольцо полно - сообщение отбрасывается и учитывается.
+//
+// Уровни ниже LOG_LEVEL не компилируются вовсе (аргументы не вычисляются):
+// -DLOG_LEVEL=LOG_LEVEL_WARN оставляет только ошибки и предупреждения.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Строка формата должна жить всё время работы (литерал): в кольце только
+// указатель. Строки-аргументы %s копируются (суммарно до TEXT_SIZE байт).
+class DeferredLog {
+public:
+  static const size_t SLOTS = 32;
+  static const size_t MAX_ARGS = 8;
+  static const size_t TEXT_SIZE = 96;
+
+  DeferredLog();
+
+  template <typename... Args>
+  void write(uint8_t level, const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+    Message message;
+    message.format = format;
+    message.level = level;
+    message.argCount = 0;
+    message.textUsed = 0;
+    encode(message, args...);
+    push(message);
+  }
+
+  // Из задачи вывода (один читатель): следующая строка в out,
+  // 0 - очередь пуста. Перед строкой после потерь - строка о потерях
+  size_t format(char* out, size_t size);
+
+  uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+  enum ArgType : uint8_t { ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_STRING, ARG_POINTER };
+
+  struct Message {
+    const char* format;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t textUsed;
+    uint8_t types[MAX_ARGS];
+    union {
+      int64_t i;
+      uint64_t u;
+      double d;
+      const void* p;
+      uint16_t text[2];  // смещение и длина строки в text
+    } args[MAX_ARGS];
+    char text[TEXT_SIZE];
+  };
+
+  // Ограниченная очередь Вьюкова: писателей много (любые задачи), читатель
+  // один. Писатель занимает ячейку CAS-ом по номеру и не ждёт никого
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    Message message;
+  };
+
+  void push(const Message& message);
+
+  static void encode(Message&) {}
+
+  template <typename T, typename... Rest>
+  static void encode(Message& message, T value, Rest... rest) {
+    encodeArg(message, value);
+    encode(message, rest...);
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+  encodeArg(Message& message, T value) {
+    message.types[message.argCount] = ARG_INT;
+    message.args[message.argCount++].i = value;
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+  encodeArg(Message& message, T value) {
+    message.types[message.argCount] = ARG_UINT;
+    message.args[message.argCount++].u = value;
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_enum<T>::value>::type
+  encodeArg(Message& message, T value) {
+    message.types[message.argCount] = ARG_INT;
+    message.args[message.argCount++].i = (int64_t)value;
+  }
+
+  template <typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value>::type
+  encodeArg(Message& message, T value) {
+    message.types[message.argCount] = ARG_DOUBLE;
+    message.args[message.argCount++].d = value;
+  }
+
+  static void encodeArg(Message& message, const char* text);
+  static void encodeArg(Message& message, char* text) { encodeArg(message, (const char*)text); }
+  static void encodeArg(Message& message, const void* pointer) {
+    message.types[message.argCount] = ARG_POINTER;
+    message.args[message.argCount++].p = pointer;
+  }
+
+  static size_t render(const Message& message, char* out, size_t size);
+
+  Slot slots[SLOTS];
+  std::atomic<uint32_t> enqueuePos;
+  uint32_t dequeuePos;
+  std::atomic<uint32_t> droppedCount;
+  uint32_t reportedDrops;
+};
+
+extern DeferredLog deferredLog;
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) deferredLog.write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) deferredLog.write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) deferredLog.write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) deferredLog.write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef FLASH_BUDGET_H
+#define FLASH_BUDGET_H
+
+#include <stddef.h>
+
+// Бюджет раздела данных: все лимиты на флеше выводятся отсюда, из размера
+// раздела spiffs в partitions.csv (0x9E0000). Для другой таблицы разделов -
+// -DFLASH_PARTITION_SIZE=... в build_flags, доли пересчитаются сами.
+//
+// LittleFS распределяет место блоками по 4 КБ:
+//  - корень и каждый каталог - пара блоков метаданных;
+//  - файл до 512 байт живёт в метаданных каталога, больший занимает
+//    целые блоки;
+//  - запись идёт копированием, ей нужны свободные блоки.
+// Раздел 9.9 МБ = 2528 блоков:
+//    16 - метаданные корня и 7 каталогов: /journal, /journal/pending,
+//         /samples, /outbox, /outbox/dead, /history, /capture
+//     2 - запас для записи копированием
+//  2510 - данные:
+//         2 - очередь отправки /outbox (строки не вытесняются)
+//         2 - индекс архива и его копия при сжатии
+//         2 - кольцо записи кадров /capture
+//      1252 - журналы идущих тренировок, на все дорожки (FLASH_JOURNAL_BYTES)
+//      1252 - журналы в архиве и очереди сэмплов (FLASH_SAMPLE_BYTES)
+// Журнал - около 10.5 байт на кадр, при кадре в секунду 4.9 МБ одной
+// дорожки хватает на пять суток, при восьми дорожках - около 16 часов.
+// Сверх лимита тренировка идёт только в RAM, потерянные для журнала
+// сэмплы видны в /metrics. Журнал переходит в архив переименованием и
+// занимает там те же блоки.
+#ifndef FLASH_PARTITION_SIZE
+#define FLASH_PARTITION_SIZE 0x9E0000
+#endif
+
+const size_t FLASH_BLOCK_SIZE = 4096;
+const size_t FLASH_BLOCKS = FLASH_PARTITION_SIZE / FLASH_BLOCK_SIZE;
+const size_t FLASH_DIRECTORIES = 7;
+const size_t FLASH_METADATA_BLOCKS = 2 * (1 + FLASH_DIRECTORIES);
+const size_t FLASH_SPARE_BLOCKS = 2;
+
+const size_t FLASH_OUTBOX_BLOCKS = 2;
+const size_t FLASH_INDEX_BLOCKS = 2;
+const size_t FLASH_CAPTURE_BLOCKS = 2;
+
+const size_t FLASH_DATA_BLOCKS = FLASH_BLOCKS - FLASH_METADATA_BLOCKS - FLASH_SPARE_BLOCKS;
+const size_t FLASH_SHARED_BLOCKS = FLASH_DATA_BLOCKS - FLASH_OUTBOX_BLOCKS -
+                                   FLASH_INDEX_BLOCKS - FLASH_CAPTURE_BLOCKS;
+// Остаток поровну: идущие тренировки и архив
+const size_t FLASH_JOURNAL_BLOCKS = FLASH_SHARED_BLOCKS / 2;
+const size_t FLASH_SAMPLE_BLOCKS = FLASH_SHARED_BLOCKS - FLASH_JOURNAL_BLOCKS;
+
+const size_t FLASH_INDEX_BYTES = FLASH_INDEX_BLOCKS * FLASH_BLOCK_SIZE;
+const size_t FLASH_CAPTURE_BYTES = FLASH_CAPTURE_BLOCKS * FLASH_BLOCK_SIZE;
+const size_t FLASH_JOURNAL_BYTES = FLASH_JOURNAL_BLOCKS * FLASH_BLOCK_SIZE;
+const size_t FLASH_SAMPLE_BYTES = FLASH_SAMPLE_BLOCKS * FLASH_BLOCK_SIZE;
+
+static_assert(FLASH_BLOCKS > FLASH_METADATA_BLOCKS + FLASH_SPARE_BLOCKS + FLASH_OUTBOX_BLOCKS +
+                             FLASH_INDEX_BLOCKS + FLASH_CAPTURE_BLOCKS + 1,
+              "FLASH_PARTITION_SIZE: no room for workout journals");
+
+// Место файла на флеше: целые блоки, файл до 512 байт - в метаданных
+inline size_t flashFootprint(size_t bytes) {
+  if (bytes <= 512) return 0;
+  return (bytes + FLASH_BLOCK_SIZE - 1) / FLASH_BLOCK_SIZE * FLASH_BLOCK_SIZE;
+}
+
+// Лимит журнала одной дорожки: блоки журналов делятся между дорожками
+// поровну, но не меньше одного блока (в малом разделе журналы многих
+// дорожек выходят за FLASH_JOURNAL_BLOCKS - нужен раздел больше)
+inline size_t flashJournalLimit(size_t treadmills) {
+  size_t blocks = treadmills > 0 ? FLASH_JOURNAL_BLOCKS / treadmills : FLASH_JOURNAL_BLOCKS;
+  return (blocks > 0 ? blocks : 1) * FLASH_BLOCK_SIZE;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef FLASH_FS_H
+#define FLASH_FS_H
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+// Минимальный интерфейс файлового хранилища на флеше.
+// На устройстве - LittleFS в разделе spiffs из partitions.csv,
+// на хосте - обычные файлы в каталоге (см. flash_fs_posix.cpp).
+class FlashFs {
+public:
+  virtual ~FlashFs() {}
+
+  // Дописывает данные в конец файла, создавая его и каталоги пути
+  // при необходимости
+  virtual bool append(const char* path, const void* data, size_t length) = 0;
+  // Читает до length байт с позиции offset, возвращает прочитанное
+  virtual size_t read(const char* path, size_t offset, void* out, size_t length) = 0;
+  // Размер файла, 0 если файла нет
+  virtual size_t size(const char* path) = 0;
+  virtual bool exists(const char* path) = 0;
+  virtual bool remove(const char* path) = 0;
+  // Каталоги пути to создаются, как в append()
+  virtual bool rename(const char* from, const char* to) = 0;
+  // Перебор файлов каталога, в callback передаётся полный путь
+  virtual void list(const char* dir, const std::function<void(const char* path)>& callback) = 0;
+
+  // Всего байт записано через этот экземпляр (для оценки износа)
+  uint32_t bytesWritten() const { return written; }
+
+protected:
+  FlashFs() : written(0) {}
+  uint32_t written;
+};
+
+#ifdef ARDUINO
+// LittleFS на разделе данных; mount() монтирует и при ошибке форматирует
+class LittleFsFlash : public FlashFs {
+public:
+  bool mount();
+
+  bool append(const char* path, const void* data, size_t length) override;
+  size_t read(const char* path, size_t offset, void* out, size_t length) override;
+  size_t size(const char* path) override;
+  bool exists(const char* path) override;
+  bool remove(const char* path) override;
+  bool rename(const char* from, const char* to) override;
+  void list(const char* dir, const std::function<void(const char* path)>& callback) override;
+};
+#else
+// Эмулятор флеша на файлах хоста. Умеет имитировать отключение питания:
+// после исчерпания бюджета запись обрывается посреди блока.
+class PosixFlash : public FlashFs {
+public:
+  explicit PosixFlash(const char* rootDir);
+
+  // Сколько байт ещё можно записать; -1 - без ограничений
+  void setWriteBudget(long bytes) { writeBudget = bytes; }
+
+  bool append(const char* path, const void* data, size_t length) override;
+  size_t read(const char* path, size_t offset, void* out, size_t length) override;
+  size_t size(const char* path) override;
+  bool exists(const char* path) override;
+  bool remove(const char* path) override;
+  bool rename(const char* from, const char* to) override;
+  void list(const char* dir, const std::function<void(const char* path)>& callback) override;
+
+private:
+  void hostPath(const char* path, char* out, size_t outSize) const;
+
+  char root[128];
+  long writeBudget;
+};
+#endif
+
+#endif
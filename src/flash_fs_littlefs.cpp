@@ -0,0 +1,88 @@
+#ifdef ARDUINO
+
+#include "flash_fs.h"
+
+#include <LittleFS.h>
+#include <string.h>
+
+bool LittleFsFlash::mount() {
+  // Раздел spiffs из partitions.csv; при первом запуске форматируется
+  return LittleFS.begin(true);
+}
+
+bool LittleFsFlash::append(const char* path, const void* data, size_t length) {
+  File file = LittleFS.open(path, FILE_APPEND, true);
+  if (!file) return false;
+  size_t done = file.write((const uint8_t*)data, length);
+  file.close();
+  written += done;
+  return done == length;
+}
+
+size_t LittleFsFlash::read(const char* path, size_t offset, void* out, size_t length) {
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) return 0;
+  size_t done = 0;
+  if (file.seek(offset)) {
+    done = file.read((uint8_t*)out, length);
+  }
+  file.close();
+  return done;
+}
+
+size_t LittleFsFlash::size(const char* path) {
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) return 0;
+  size_t result = file.size();
+  file.close();
+  return result;
+}
+
+bool LittleFsFlash::exists(const char* path) {
+  return LittleFS.exists(path);
+}
+
+bool LittleFsFlash::remove(const char* path) {
+  return LittleFS.remove(path);
+}
+
+// Создаёт промежуточные каталоги, как open(..., true) в append()
+static void makeParents(const char* path) {
+  char dir[64];
+  size_t length = strlen(path);
+  if (length >= sizeof(dir)) return;
+  memcpy(dir, path, length + 1);
+  for (char* p = dir + 1; *p; p++) {
+    if (*p != '/') continue;
+    *p = '\0';
+    if (!LittleFS.exists(dir)) LittleFS.mkdir(dir);
+    *p = '/';
+  }
+}
+
+bool LittleFsFlash::rename(const char* from, const char* to) {
+  makeParents(to);
+  return LittleFS.rename(from, to);
+}
+
+void LittleFsFlash::list(const char* dir, const std::function<void(const char* path)>& callback) {
+  File root = LittleFS.open(dir);
+  if (!root || !root.isDirectory()) return;
+
+  File entry = root.openNextFile();
+  while (entry) {
+    if (!entry.isDirectory()) {
+      // Копия пути: callback может удалить или переименовать файл
+      char path[64];
+      snprintf(path, sizeof(path), "%s", entry.path());
+      entry.close();
+      callback(path);
+    } else {
+      entry.close();
+    }
+    entry = root.openNextFile();
+  }
+  root.close();
+}
+
+#endif
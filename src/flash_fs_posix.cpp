@@ -0,0 +1,118 @@
+#ifndef ARDUINO
+
+#include "flash_fs.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+PosixFlash::PosixFlash(const char* rootDir) : writeBudget(-1) {
+  snprintf(root, sizeof(root), "%s", rootDir);
+  mkdir(root, 0755);
+}
+
+void PosixFlash::hostPath(const char* path, char* out, size_t outSize) const {
+  snprintf(out, outSize, "%s%s", root, path);
+}
+
+// Создаёт промежуточные каталоги, как LittleFS при open(..., true)
+static void makeParents(char* path) {
+  for (char* p = path + 1; *p; p++) {
+    if (*p != '/') continue;
+    *p = '\0';
+    mkdir(path, 0755);
+    *p = '/';
+  }
+}
+
+bool PosixFlash::append(const char* path, const void* data, size_t length) {
+  char full[256];
+  hostPath(path, full, sizeof(full));
+  makeParents(full);
+
+  FILE* file = fopen(full, "ab");
+  if (file == nullptr) return false;
+
+  // Имитация отключения питания: пишем только то, что влезает в бюджет
+  size_t allowed = length;
+  if (writeBudget >= 0 && (long)length > writeBudget) allowed = (size_t)writeBudget;
+
+  size_t done = fwrite(data, 1, allowed, file);
+  fclose(file);
+  written += done;
+  if (writeBudget >= 0) writeBudget -= (long)done;
+  return done == length;
+}
+
+size_t PosixFlash::read(const char* path, size_t offset, void* out, size_t length) {
+  char full[256];
+  hostPath(path, full, sizeof(full));
+
+  FILE* file = fopen(full, "rb");
+  if (file == nullptr) return 0;
+  size_t done = 0;
+  if (fseek(file, (long)offset, SEEK_SET) == 0) {
+    done = fread(out, 1, length, file);
+  }
+  fclose(file);
+  return done;
+}
+
+size_t PosixFlash::size(const char* path) {
+  char full[256];
+  hostPath(path, full, sizeof(full));
+  struct stat info;
+  if (stat(full, &info) != 0) return 0;
+  return (size_t)info.st_size;
+}
+
+bool PosixFlash::exists(const char* path) {
+  char full[256];
+  hostPath(path, full, sizeof(full));
+  struct stat info;
+  return stat(full, &info) == 0;
+}
+
+bool PosixFlash::remove(const char* path) {
+  char full[256];
+  hostPath(path, full, sizeof(full));
+  return ::remove(full) == 0;
+}
+
+bool PosixFlash::rename(const char* from, const char* to) {
+  char fullFrom[256];
+  char fullTo[256];
+  hostPath(from, fullFrom, sizeof(fullFrom));
+  hostPath(to, fullTo, sizeof(fullTo));
+  makeParents(fullTo);
+  return ::rename(fullFrom, fullTo) == 0;
+}
+
+void PosixFlash::list(const char* dir, const std::function<void(const char* path)>& callback) {
+  char full[256];
+  hostPath(dir, full, sizeof(full));
+
+  DIR* handle = opendir(full);
+  if (handle == nullptr) return;
+
+  struct dirent* entry;
+  while ((entry = readdir(handle)) != nullptr) {
+    if (entry->d_name[0] == '.') continue;
+    // Имя, не влезающее в путь, не передаётся: обрезанный путь указывал
+    // бы на другой файл (у LittleFS имена тоже ограничены)
+    char path[128];
+    int length = snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+    if (length < 0 || (size_t)length >= sizeof(path)) continue;
+
+    char hostFile[256];
+    hostPath(path, hostFile, sizeof(hostFile));
+    struct stat info;
+    if (stat(hostFile, &info) == 0 && S_ISREG(info.st_mode)) {
+      callback(path);
+    }
+  }
+  closedir(handle);
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "frame_capture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void putU32(uint8_t* p, uint32_t v) {
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = v >> 24;
+}
+
+static void putU64(uint8_t* p, uint64_t v) {
+  putU32(p, (uint32_t)v);
+  putU32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint64_t getU64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+FrameCapture::FrameCapture(FlashFs& fs, const char* directory)
+  : fs(fs), active(false), buffered(0), bufferedFrames(0), bufferedSince(0),
+    haveSegments(false), firstSegment(0), lastSegment(0),
+    frameCount(0), droppedCount(0), flushCount(0) {
+  snprintf(dir, sizeof(dir), "%s", directory);
+}
+
+void FrameCapture::segmentPath(uint32_t segment, char* out, size_t size) const {
+  snprintf(out, size, "%s/cap%05u.bin", dir, (unsigned)segment);
+}
+
+void FrameCapture::begin() {
+  std::lock_guard<std::mutex> guard(lock);
+  haveSegments = false;
+  fs.list(dir, [&](const char* path) {
+    const char* name = strrchr(path, '/');
+    unsigned segment;
+    if (name == nullptr || sscanf(name, "/cap%u.bin", &segment) != 1) return;
+    if (!haveSegments || segment < firstSegment) firstSegment = segment;
+    if (!haveSegments || segment > lastSegment) lastSegment = segment;
+    haveSegments = true;
+  });
+}
+
+void FrameCapture::record(int64_t timestampUs, const uint8_t* data, size_t length, uint32_t nowMs) {
+  if (!active || length == 0 || length > MAX_FRAME) return;
+
+  std::lock_guard<std::mutex> guard(lock);
+  if (buffered + HEADER_SIZE + length > BUFFER_SIZE) flushLocked();
+
+  uint8_t* out = buffer + buffered;
+  putU64(out, (uint64_t)timestampUs);
+  out[8] = (uint8_t)length;
+  memcpy(out + HEADER_SIZE, data, length);
+
+  if (buffered == 0) bufferedSince = nowMs;
+  buffered += HEADER_SIZE + length;
+  bufferedFrames++;
+  frameCount++;
+}
+
+void FrameCapture::poll(uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (buffered > 0 && nowMs - bufferedSince >= FLUSH_INTERVAL_MS) flushLocked();
+}
+
+bool FrameCapture::flush() {
+  std::lock_guard<std::mutex> guard(lock);
+  return flushLocked();
+}
+
+bool FrameCapture::flushLocked() {
+  if (buffered == 0) return true;
+
+  char path[MAX_PATH];
+  if (!haveSegments) {
+    firstSegment = lastSegment = 1;
+    haveSegments = true;
+  }
+  segmentPath(lastSegment, path, sizeof(path));
+  size_t used = fs.size(path);
+  if (used > 0 && used + buffered > SEGMENT_SIZE) {
+    lastSegment++;
+    segmentPath(lastSegment, path, sizeof(path));
+    while (lastSegment - firstSegment >= SEGMENTS) {
+      char oldest[MAX_PATH];
+      segmentPath(firstSegment++, oldest, sizeof(oldest));
+      fs.remove(oldest);
+    }
+  }
+
+  // Буфер пишется целиком одним append; при ошибке кадры теряются,
+  // а не копятся - запись не должна тормозить обработку кадров
+  bool written = fs.append(path, buffer, buffered);
+  if (written) {
+    flushCount++;
+  } else {
+    droppedCount += bufferedFrames;
+  }
+  buffered = 0;
+  bufferedFrames = 0;
+  return written;
+}
+
+void FrameCapture::clear() {
+  std::lock_guard<std::mutex> guard(lock);
+  if (haveSegments) {
+    char path[MAX_PATH];
+    for (uint32_t segment = firstSegment; segment <= lastSegment; segment++) {
+      segmentPath(segment, path, sizeof(path));
+      fs.remove(path);
+    }
+  }
+  haveSegments = false;
+  buffered = 0;
+  bufferedFrames = 0;
+  frameCount = 0;
+  droppedCount = 0;
+}
+
+bool FrameCapture::segments(uint32_t& first, uint32_t& last) {
+  std::lock_guard<std::mutex> guard(lock);
+  first = firstSegment;
+  last = lastSegment;
+  return haveSegments;
+}
+
+// pcap: глобальный заголовок 24 байта, перед каждым кадром - 16 байт
+static const uint32_t PCAP_MAGIC = 0xA1B2C3D4;  // время в микросекундах
+static const uint32_t PCAP_LINKTYPE_USER0 = 147;
+static const size_t PCAP_HEADER_SIZE = 24;
+static const size_t PCAP_RECORD_HEADER_SIZE = 16;
+
+CapturePcapStream::CapturePcapStream(FrameCapture& capture)
+  : capture(capture), started(false), segment(0), lastSegment(0),
+    chunkOffset(0), chunkLength(0), position(0) {
+  haveSegments = capture.segments(segment, lastSegment);
+  if (haveSegments) capture.segmentPath(segment, path, sizeof(path));
+}
+
+bool CapturePcapStream::load(size_t need) {
+  if (chunkLength - position >= need) return true;
+  chunkOffset += position;
+  chunkLength = capture.fs.read(path, chunkOffset, chunk, CHUNK_SIZE);
+  position = 0;
+  return chunkLength >= need;
+}
+
+bool CapturePcapStream::nextFrame(uint64_t& timestampUs, const uint8_t*& data, size_t& length) {
+  while (haveSegments) {
+    if (load(FrameCapture::HEADER_SIZE)) {
+      const uint8_t* header = chunk + position;
+      length = header[8];
+      if (length > 0 && length <= FrameCapture::MAX_FRAME &&
+          load(FrameCapture::HEADER_SIZE + length)) {
+        timestampUs = getU64(chunk + position);
+        data = chunk + position + FrameCapture::HEADER_SIZE;
+        position += FrameCapture::HEADER_SIZE + length;
+        return true;
+      }
+    }
+
+    // Конец сегмента, оборванный хвост или сегмент уже удалён кольцом
+    if (segment == lastSegment) {
+      haveSegments = false;
+      break;
+    }
+    segment++;
+    capture.segmentPath(segment, path, sizeof(path));
+    chunkOffset = 0;
+    chunkLength = 0;
+    position = 0;
+  }
+  return false;
+}
+
+size_t CapturePcapStream::nextRow(char* out, size_t size) {
+  uint8_t* row = (uint8_t*)out;
+  size_t used = 0;
+
+  if (!started) {
+    started = true;
+    putU32(row, PCAP_MAGIC);
+    row[4] = 2;  // версия 2.4
+    row[5] = 0;
+    row[6] = 4;
+    row[7] = 0;
+    putU32(row + 8, 0);   // thiszone
+    putU32(row + 12, 0);  // sigfigs
+    putU32(row + 16, FrameCapture::MAX_FRAME);
+    putU32(row + 20, PCAP_LINKTYPE_USER0);
+    used = PCAP_HEADER_SIZE;
+  }
+
+  uint64_t timestampUs;
+  const uint8_t* data;
+  size_t length;
+  while (size - used >= PCAP_RECORD_HEADER_SIZE + FrameCapture::MAX_FRAME &&
+         nextFrame(timestampUs, data, length)) {
+    uint8_t* record = row + used;
+    putU32(record, (uint32_t)(timestampUs / 1000000));
+    putU32(record + 4, (uint32_t)(timestampUs % 1000000));
+    putU32(record + 8, (uint32_t)length);
+    putU32(record + 12, (uint32_t)length);
+    memcpy(record + PCAP_RECORD_HEADER_SIZE, data, length);
+    used += PCAP_RECORD_HEADER_SIZE + length;
+  }
+  return used;
+}
@@ -0,0 +1,109 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flash_budget.h"
+#include "flash_fs.h"
+#include "row_stream.h"
+
+// Запись сырых уведомлений BLE на флеш для разбора на хосте (sim/).
+// Кадр: [timestampUs:8][length:1][payload] - копится в RAM и дописывается
+// на флеш пачками (буфер полон или старше FLUSH_INTERVAL_MS). Файлы
+// <dir>/cap<N>.bin образуют кольцо: при переполнении сегмента начинается
+// следующий, самый старый удаляется, на флеше не больше SEGMENTS сегментов.
+// Сегмент - один блок LittleFS, кольцо - доля раздела из flash_budget.h.
+// Время - монотонное с загрузки (esp_timer), не календарное.
+class FrameCapture {
+public:
+  static const size_t SEGMENT_SIZE = FLASH_BLOCK_SIZE;
+  static const size_t SEGMENTS = FLASH_CAPTURE_BYTES / SEGMENT_SIZE;
+  static const size_t BUFFER_SIZE = 1024;
+  static const size_t MAX_FRAME = 64;
+  static const size_t HEADER_SIZE = 9;
+  static const uint32_t FLUSH_INTERVAL_MS = 10000;
+  static const size_t MAX_PATH = 48;
+
+  FrameCapture(FlashFs& fs, const char* dir);
+
+  // Находит сегменты, оставшиеся с прошлой загрузки
+  void begin();
+
+  void setEnabled(bool on) { active = on; }
+  bool enabled() const { return active; }
+
+  // Из задачи обработки кадров; на флеш пишет только при заполнении буфера
+  void record(int64_t timestampUs, const uint8_t* data, size_t length, uint32_t nowMs);
+  // Периодически: сброс буфера, пролежавшего дольше FLUSH_INTERVAL_MS
+  void poll(uint32_t nowMs);
+  bool flush();
+  // Удаляет все сегменты и буфер
+  void clear();
+
+  // Сегменты от старого к новому; false - сегментов нет
+  bool segments(uint32_t& first, uint32_t& last);
+  void segmentPath(uint32_t segment, char* out, size_t size) const;
+
+  uint32_t frames() const { return frameCount; }
+  uint32_t dropped() const { return droppedCount; }
+  uint32_t flushes() const { return flushCount; }
+
+private:
+  friend class CapturePcapStream;
+
+  bool flushLocked();
+
+  FlashFs& fs;
+  std::mutex lock;
+  char dir[24];
+  volatile bool active;
+
+  uint8_t buffer[BUFFER_SIZE];
+  size_t buffered;
+  size_t bufferedFrames;
+  uint32_t bufferedSince;  // nowMs первого кадра в буфере
+
+  bool haveSegments;
+  uint32_t firstSegment;
+  uint32_t lastSegment;
+
+  uint32_t frameCount;
+  uint32_t droppedCount;   // кадры, потерянные из-за ошибки записи
+  uint32_t flushCount;
+};
+
+// Содержимое кольца в формате pcap (LINKTYPE_USER0, микросекунды):
+// Wireshark открывает файл как есть, sim/replay читает его напрямую
+class CapturePcapStream : public RowStream<256> {
+public:
+  // Сегменты берутся на момент создания; удалённые по ходу - пропускаются
+  explicit CapturePcapStream(FrameCapture& capture);
+
+protected:
+  size_t nextRow(char* out, size_t size) override;
+
+private:
+  static const size_t CHUNK_SIZE = 512;
+
+  // Следующий кадр из сегментов; false - кадры кончились
+  bool nextFrame(uint64_t& timestampUs, const uint8_t*& data, size_t& length);
+  // Не меньше need байт сегмента от текущей позиции в chunk
+  bool load(size_t need);
+
+  FrameCapture& capture;
+  bool started;
+  bool haveSegments;
+  uint32_t segment;
+  uint32_t lastSegment;
+  char path[FrameCapture::MAX_PATH];
+
+  // Сегмент читается блоками, а не по кадру: open/close на LittleFS дорогие
+  uint8_t chunk[CHUNK_SIZE];
+  size_t chunkOffset;  // позиция chunk в сегменте
+  size_t chunkLength;
+  size_t position;     // разобрано байт chunk
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "spsc_ring.h"
+
+// Максимальная длина уведомления 0x2ACD: Flags и все поля
+// 2+2+2+3+4+4+1+1+5+1+1+2+2+4 байт. По ней же выбран MTU (ble_central_nimble.cpp),
+// так что дорожка не пришлёт кадр длиннее
+static const size_t FTMS_MAX_FRAME = 34;
+
+// Кадр BLE, переданный из callback в задачу обработки
+struct RawFrame {
+  int64_t timestampUs;   // монотонное время уведомления
+  uint8_t length;
+  uint8_t data[FTMS_MAX_FRAME];
+};
+
+// Путь кадра от callback стека BLE до задачи обработки: метка времени,
+// копия и кольцо без блокировок. Callback не ждёт ничего; слишком длинные
+// кадры и кадры при полном кольце отбрасываются и учитываются
+template <size_t N>
+class FrameQueue {
+public:
+  FrameQueue() : oversizedCount(0) {}
+
+  // Только из callback BLE (один писатель)
+  bool push(const uint8_t* data, size_t length, int64_t timestampUs) {
+    if (length > FTMS_MAX_FRAME) {
+      oversizedCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    RawFrame frame;
+    frame.timestampUs = timestampUs;
+    frame.length = (uint8_t)length;
+    memcpy(frame.data, data, length);
+    return ring.push(frame);
+  }
+
+  // Только из задачи обработки (один читатель)
+  bool pop(RawFrame& frame) { return ring.pop(frame); }
+
+  uint32_t dropped() const { return ring.dropped() + oversizedCount.load(std::memory_order_relaxed); }
+  uint32_t highWater() const { return ring.highWater(); }
+  static size_t capacity() { return N; }
+
+private:
+  SpscRing<RawFrame, N> ring;
+  std::atomic<uint32_t> oversizedCount;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "ftms_parser.h"
+
+#include <string.h>
+
+// Размеры полей в порядке их следования после Flags
+static size_t requiredLength(uint16_t flags) {
+  size_t len = 2;
+  if (!(flags & FTMS_MORE_DATA))        len += 2;
+  if (flags & FTMS_AVERAGE_SPEED)       len += 2;
+  if (flags & FTMS_TOTAL_DISTANCE)      len += 3;
+  if (flags & FTMS_INCLINATION)         len += 4;
+  if (flags & FTMS_ELEVATION_GAIN)      len += 4;
+  if (flags & FTMS_INSTANT_PACE)        len += 1;
+  if (flags & FTMS_AVERAGE_PACE)        len += 1;
+  if (flags & FTMS_EXPENDED_ENERGY)     len += 5;
+  if (flags & FTMS_HEART_RATE)          len += 1;
+  if (flags & FTMS_METABOLIC_EQUIV)     len += 1;
+  if (flags & FTMS_ELAPSED_TIME)        len += 2;
+  if (flags & FTMS_REMAINING_TIME)      len += 2;
+  if (flags & FTMS_FORCE_AND_POWER)     len += 4;
+  return len;
+}
+
+static inline uint16_t readU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t readU24(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+bool parseTreadmillData(const uint8_t* data, size_t length, TreadmillData& out) {
+  if (data == nullptr || length < 2) return false;
+
+  uint16_t flags = readU16(data);
+  if (length < requiredLength(flags)) return false;
+
+  memset(&out, 0, sizeof(out));
+  const uint8_t* p = data + 2;
+
+  // Бит More Data инвертирован: 0 означает, что скорость присутствует
+  if (!(flags & FTMS_MORE_DATA)) {
+    out.speed = readU16(p); p += 2;
+    out.present |= FTMS_FIELD_SPEED;
+  }
+  if (flags & FTMS_AVERAGE_SPEED) {
+    out.averageSpeed = readU16(p); p += 2;
+    out.present |= FTMS_FIELD_AVERAGE_SPEED;
+  }
+  if (flags & FTMS_TOTAL_DISTANCE) {
+    out.totalDistance = readU24(p); p += 3;
+    out.present |= FTMS_FIELD_TOTAL_DISTANCE;
+  }
+  if (flags & FTMS_INCLINATION) {
+    out.inclination = (int16_t)readU16(p);
+    out.rampAngle = (int16_t)readU16(p + 2);
+    p += 4;
+    out.present |= FTMS_FIELD_INCLINATION;
+  }
+  if (flags & FTMS_ELEVATION_GAIN) {
+    out.elevationGainPos = readU16(p);
+    out.elevationGainNeg = readU16(p + 2);
+    p += 4;
+    out.present |= FTMS_FIELD_ELEVATION_GAIN;
+  }
+  if (flags & FTMS_INSTANT_PACE) {
+    out.instantPace = *p++;
+    out.present |= FTMS_FIELD_INSTANT_PACE;
+  }
+  if (flags & FTMS_AVERAGE_PACE) {
+    out.averagePace = *p++;
+    out.present |= FTMS_FIELD_AVERAGE_PACE;
+  }
+  if (flags & FTMS_EXPENDED_ENERGY) {
+    out.totalEnergy = readU16(p);
+    out.energyPerHour = readU16(p + 2);
+    out.energyPerMinute = p[4];
+    p += 5;
+    out.present |= FTMS_FIELD_EXPENDED_ENERGY;
+  }
+  if (flags & FTMS_HEART_RATE) {
+    out.heartRate = *p++;
+    out.present |= FTMS_FIELD_HEART_RATE;
+  }
+  if (flags & FTMS_METABOLIC_EQUIV) {
+    out.metabolicEquiv = *p++;
+    out.present |= FTMS_FIELD_METABOLIC_EQUIV;
+  }
+  if (flags & FTMS_ELAPSED_TIME) {
+    out.elapsedTime = readU16(p); p += 2;
+    out.present |= FTMS_FIELD_ELAPSED_TIME;
+  }
+  if (flags & FTMS_REMAINING_TIME) {
+    out.remainingTime = readU16(p); p += 2;
+    out.present |= FTMS_FIELD_REMAINING_TIME;
+  }
+  if (flags & FTMS_FORCE_AND_POWER) {
+    out.forceOnBelt = (int16_t)readU16(p);
+    out.powerOutput = (int16_t)readU16(p + 2);
+    p += 4;
+    out.present |= FTMS_FIELD_FORCE_AND_POWER;
+  }
+
+  return true;
+}
+
+// Переносит в dst только те поля, что присутствуют в src
+static void mergeFields(TreadmillData& dst, const TreadmillData& src) {
+  if (src.has(FTMS_FIELD_SPEED)) dst.speed = src.speed;
+  if (src.has(FTMS_FIELD_AVERAGE_SPEED)) dst.averageSpeed = src.averageSpeed;
+  if (src.has(FTMS_FIELD_TOTAL_DISTANCE)) dst.totalDistance = src.totalDistance;
+  if (src.has(FTMS_FIELD_INCLINATION)) {
+    dst.inclination = src.inclination;
+    dst.rampAngle = src.rampAngle;
+  }
+  if (src.has(FTMS_FIELD_ELEVATION_GAIN)) {
+    dst.elevationGainPos = src.elevationGainPos;
+    dst.elevationGainNeg = src.elevationGainNeg;
+  }
+  if (src.has(FTMS_FIELD_INSTANT_PACE)) dst.instantPace = src.instantPace;
+  if (src.has(FTMS_FIELD_AVERAGE_PACE)) dst.averagePace = src.averagePace;
+  if (src.has(FTMS_FIELD_EXPENDED_ENERGY)) {
+    dst.totalEnergy = src.totalEnergy;
+    dst.energyPerHour = src.energyPerHour;
+    dst.energyPerMinute = src.energyPerMinute;
+  }
+  if (src.has(FTMS_FIELD_HEART_RATE)) dst.heartRate = src.heartRate;
+  if (src.has(FTMS_FIELD_METABOLIC_EQUIV)) dst.metabolicEquiv = src.metabolicEquiv;
+  if (src.has(FTMS_FIELD_ELAPSED_TIME)) dst.elapsedTime = src.elapsedTime;
+  if (src.has(FTMS_FIELD_REMAINING_TIME)) dst.remainingTime = src.remainingTime;
+  if (src.has(FTMS_FIELD_FORCE_AND_POWER)) {
+    dst.forceOnBelt = src.forceOnBelt;
+    dst.powerOutput = src.powerOutput;
+  }
+  dst.present |= src.present;
+}
+
+void FtmsAssembler::reset() {
+  memset(&pending, 0, sizeof(pending));
+  memset(&assembled, 0, sizeof(assembled));
+  malformed = 0;
+}
+
+bool FtmsAssembler::push(const uint8_t* data, size_t length) {
+  TreadmillData frame;
+  if (!parseTreadmillData(data, length, frame)) {
+    malformed++;
+    return false;
+  }
+
+  mergeFields(pending, frame);
+
+  // Кадр без More Data завершает запись
+  if (!frame.has(FTMS_FIELD_SPEED)) return false;
+
+  assembled = pending;
+  memset(&pending, 0, sizeof(pending));
+  return true;
+}
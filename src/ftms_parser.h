@@ -0,0 +1,96 @@
+#ifndef FTMS_PARSER_H
+#define FTMS_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Разбор характеристики FTMS Treadmill Data (0x2ACD).
+// Никаких аллокаций: всё складывается в POD-структуру фиксированного размера,
+// поэтому разбор безопасно вызывать прямо из BLE callback.
+
+// Биты поля Flags (FTMS v1.0, раздел 4.9.1)
+enum FtmsTreadmillFlags : uint16_t {
+  FTMS_MORE_DATA          = 1 << 0,   // 1 = Instantaneous Speed отсутствует, запись продолжится
+  FTMS_AVERAGE_SPEED      = 1 << 1,
+  FTMS_TOTAL_DISTANCE     = 1 << 2,
+  FTMS_INCLINATION        = 1 << 3,   // Inclination + Ramp Angle Setting
+  FTMS_ELEVATION_GAIN     = 1 << 4,   // Positive + Negative Elevation Gain
+  FTMS_INSTANT_PACE       = 1 << 5,
+  FTMS_AVERAGE_PACE       = 1 << 6,
+  FTMS_EXPENDED_ENERGY    = 1 << 7,   // Total + Per Hour + Per Minute
+  FTMS_HEART_RATE         = 1 << 8,
+  FTMS_METABOLIC_EQUIV    = 1 << 9,
+  FTMS_ELAPSED_TIME       = 1 << 10,
+  FTMS_REMAINING_TIME     = 1 << 11,
+  FTMS_FORCE_AND_POWER    = 1 << 12
+};
+
+// Маска полей, реально присутствующих в TreadmillData::present.
+// Скорость не имеет флага "present" в протоколе, поэтому для неё свой бит.
+enum FtmsField : uint16_t {
+  FTMS_FIELD_SPEED            = 1 << 0,
+  FTMS_FIELD_AVERAGE_SPEED    = 1 << 1,
+  FTMS_FIELD_TOTAL_DISTANCE   = 1 << 2,
+  FTMS_FIELD_INCLINATION      = 1 << 3,
+  FTMS_FIELD_ELEVATION_GAIN   = 1 << 4,
+  FTMS_FIELD_INSTANT_PACE     = 1 << 5,
+  FTMS_FIELD_AVERAGE_PACE     = 1 << 6,
+  FTMS_FIELD_EXPENDED_ENERGY  = 1 << 7,
+  FTMS_FIELD_HEART_RATE       = 1 << 8,
+  FTMS_FIELD_METABOLIC_EQUIV  = 1 << 9,
+  FTMS_FIELD_ELAPSED_TIME     = 1 << 10,
+  FTMS_FIELD_REMAINING_TIME   = 1 << 11,
+  FTMS_FIELD_FORCE_AND_POWER  = 1 << 12
+};
+
+// Все значения в "сырых" единицах протокола, без float
+struct TreadmillData {
+  uint16_t present;            // FtmsField
+  uint16_t speed;              // 0.01 км/ч
+  uint16_t averageSpeed;       // 0.01 км/ч
+  uint32_t totalDistance;      // м (uint24)
+  int16_t  inclination;        // 0.1 %
+  int16_t  rampAngle;          // 0.1 градуса
+  uint16_t elevationGainPos;   // 0.1 м
+  uint16_t elevationGainNeg;   // 0.1 м
+  uint8_t  instantPace;        // 0.1 км/мин
+  uint8_t  averagePace;        // 0.1 км/мин
+  uint16_t totalEnergy;        // ккал
+  uint16_t energyPerHour;      // ккал/ч
+  uint8_t  energyPerMinute;    // ккал/мин
+  uint8_t  heartRate;          // уд/мин
+  uint8_t  metabolicEquiv;     // 0.1 MET
+  uint16_t elapsedTime;        // с
+  uint16_t remainingTime;      // с
+  int16_t  forceOnBelt;        // Н
+  int16_t  powerOutput;        // Вт
+
+  bool has(uint16_t field) const { return (present & field) != 0; }
+};
+
+// Разбор одного уведомления. Возвращает false, если кадр короче,
+// чем требуют выставленные флаги; out в этом случае не трогается.
+bool parseTreadmillData(const uint8_t* data, size_t length, TreadmillData& out);
+
+// Сборка записи из нескольких уведомлений с флагом More Data.
+// Тренажёр может разбить запись на несколько кадров: все кроме последнего
+// идут с More Data = 1 (без скорости), последний - с More Data = 0.
+// Поля из кадров сливаются, запись выдаётся по завершающему кадру.
+class FtmsAssembler {
+public:
+  FtmsAssembler() { reset(); }
+
+  // true - запись собрана и доступна через record()
+  bool push(const uint8_t* data, size_t length);
+  const TreadmillData& record() const { return assembled; }
+  void reset();
+
+  uint32_t malformedFrames() const { return malformed; }
+
+private:
+  TreadmillData pending;
+  TreadmillData assembled;
+  uint32_t malformed;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "heart_rate.h"
+
+// Флаги 0x2A37
+static const uint8_t HR_FORMAT_UINT16 = 1 << 0;
+static const uint8_t HR_CONTACT_MASK = 3 << 1;
+static const uint8_t HR_CONTACT_LOST = 2 << 1;   // контакт поддерживается, но не обнаружен
+
+bool parseHeartRate(const uint8_t* data, size_t length, uint8_t& bpm) {
+  if (length < 2) return false;
+  uint8_t flags = data[0];
+  uint16_t value = data[1];
+  if (flags & HR_FORMAT_UINT16) {
+    if (length < 3) return false;
+    value |= (uint16_t)data[2] << 8;
+  }
+  if ((flags & HR_CONTACT_MASK) == HR_CONTACT_LOST) value = 0;
+  bpm = value > 255 ? 255 : (uint8_t)value;
+  return true;
+}
+
+// Разность монотонных меток с учётом переполнения
+static int32_t since(uint32_t later, uint32_t earlier) {
+  return (int32_t)(later - earlier);
+}
+
+HeartRateMerger::HeartRateMerger(Sink sink, void* context)
+  : sink(sink), context(context), recordHead(0), recordCount(0), beatCount(0), lastBpm(0), expecting(false),
+    matchedCount(0), unmatchedCount(0), overflowCount(0), maxLatency(0), maxRecords(0) {}
+
+void HeartRateMerger::pushHeartRate(uint8_t bpm, uint32_t atMs) {
+  lastBpm = bpm;
+  if (bpm == 0) return;   // нет контакта: запись возьмёт пульс дорожки
+
+  // Вставка по времени; при полном буфере уходит самый старый отсчёт
+  if (beatCount == HEART_SLOTS) {
+    if (since(atMs, beats[0].atMs) < 0) return;
+    for (size_t i = 1; i < beatCount; i++) beats[i - 1] = beats[i];
+    beatCount--;
+  }
+  size_t position = beatCount;
+  while (position > 0 && since(beats[position - 1].atMs, atMs) > 0) {
+    beats[position] = beats[position - 1];
+    position--;
+  }
+  beats[position].atMs = atMs;
+  beats[position].bpm = bpm;
+  beatCount++;
+
+  release(atMs, false);
+}
+
+void HeartRateMerger::pushRecord(const WorkoutRecord& record, uint32_t atMs) {
+  if (recordCount == RECORD_SLOTS) {
+    overflowCount++;
+    release(records[recordHead].atMs, true);
+  }
+  Pending& slot = records[(recordHead + recordCount) % RECORD_SLOTS];
+  slot.record = record;
+  slot.atMs = atMs;
+  recordCount++;
+  if (recordCount > maxRecords) maxRecords = recordCount;
+
+  release(atMs, false);
+}
+
+void HeartRateMerger::poll(uint32_t nowMs) {
+  release(nowMs, false);
+}
+
+void HeartRateMerger::flush() {
+  while (recordCount > 0) {
+    release(records[recordHead].atMs, true);
+  }
+}
+
+void HeartRateMerger::clear() {
+  recordHead = 0;
+  recordCount = 0;
+}
+
+// Выпуск с головы очереди: записи идут по времени, поэтому первая
+// неготовая задерживает и следующие. force - выпустить одну голову
+// досрочно (переполнение, конец тренировки)
+void HeartRateMerger::release(uint32_t nowMs, bool force) {
+  while (recordCount > 0) {
+    Pending& head = records[recordHead];
+    bool ready = force || caughtUp(head.atMs) || stale(head.atMs) ||
+                 since(nowMs, head.atMs) >= (int32_t)MAX_DELAY_MS;
+    if (!ready) return;
+
+    uint8_t bpm = match(head.atMs);
+    if (bpm != 0) {
+      head.record.heartRate = bpm;
+      matchedCount++;
+    } else {
+      unmatchedCount++;
+    }
+    int32_t latency = since(nowMs, head.atMs);
+    if (!force && latency > 0 && (uint32_t)latency > maxLatency) maxLatency = (uint32_t)latency;
+
+    WorkoutRecord record = head.record;
+    recordHead = (recordHead + 1) % RECORD_SLOTS;
+    recordCount--;
+    sink(record, context);
+    if (force) return;
+  }
+}
+
+uint8_t HeartRateMerger::match(uint32_t atMs) const {
+  const Beat* best = nullptr;
+  uint32_t bestDistance = HOLD_MS + 1;
+  for (size_t i = 0; i < beatCount; i++) {
+    int32_t offset = since(beats[i].atMs, atMs);
+    uint32_t distance = offset < 0 ? (uint32_t)-offset : (uint32_t)offset;
+    // Равные расстояния - в пользу более раннего отсчёта
+    if (distance < bestDistance) {
+      best = &beats[i];
+      bestDistance = distance;
+    }
+  }
+  return best != nullptr ? best->bpm : 0;
+}
+
+bool HeartRateMerger::caughtUp(uint32_t atMs) const {
+  return beatCount > 0 && since(beats[beatCount - 1].atMs, atMs) >= 0;
+}
+
+bool HeartRateMerger::stale(uint32_t atMs) const {
+  if (beatCount == 0) return !expecting;
+  return since(atMs, beats[beatCount - 1].atMs) > (int32_t)HOLD_MS;
+}
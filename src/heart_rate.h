@@ -0,0 +1,99 @@
+#ifndef HEART_RATE_H
+#define HEART_RATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "session_store.h"
+
+// Разбор Heart Rate Measurement (0x2A37, сервис 0x180D). Пульс - uint8
+// или uint16 по биту 0 флагов. Датчик, сообщающий об отсутствии контакта
+// с кожей (биты 1-2 = 10), даёт 0. false - кадр короче заявленного
+static const uint16_t HEART_RATE_SERVICE_UUID = 0x180D;
+static const uint16_t HEART_RATE_MEASUREMENT_UUID = 0x2A37;
+
+bool parseHeartRate(const uint8_t* data, size_t length, uint8_t& bpm);
+
+// Склейка записей дорожки с пульсом ремня по монотонному времени.
+//
+// Кадры дорожки и ремня приходят по разным соединениям и разбираются из
+// разных очередей, поэтому запись с временем t может оказаться у склейки
+// раньше отсчёта пульса, снятого до t. Запись ждёт в буфере, пока пульс
+// не догонит её (пришёл отсчёт не раньше t), но не дольше MAX_DELAY_MS.
+// Пульс записи - ближайший по времени отсчёт в пределах HOLD_MS; раньше
+// t, если отсчёта после t так и не пришло. Ремень молчит дольше HOLD_MS
+// (или не на связи и отсчётов не было) - записи выходят сразу с пульсом
+// дорожки (FTMS), если она его передаёт.
+//
+// Память фиксирована: RECORD_SLOTS ждущих записей и HEART_SLOTS
+// последних отсчётов. Переполнение выталкивает самую старую запись
+// досрочно. Все вызовы - из одной задачи.
+class HeartRateMerger {
+public:
+  static const size_t RECORD_SLOTS = 16;
+  static const size_t HEART_SLOTS = 8;
+  static const uint32_t MAX_DELAY_MS = 1500;  // ремень шлёт раз в ~1 с
+  static const uint32_t HOLD_MS = 3000;       // дальше отсчёт не относится к записи
+
+  // Куда уходят записи с пульсом, в порядке времени
+  typedef void (*Sink)(const WorkoutRecord& record, void* context);
+
+  HeartRateMerger(Sink sink, void* context);
+
+  // Отсчёт ремня; atMs - монотонное время уведомления
+  void pushHeartRate(uint8_t bpm, uint32_t atMs);
+  // Запись дорожки; atMs - монотонное время её кадра
+  void pushRecord(const WorkoutRecord& record, uint32_t atMs);
+  // Выпускает записи, которые дождались пульса или MAX_DELAY_MS
+  void poll(uint32_t nowMs);
+  // Все ждущие записи - сразу (конец тренировки)
+  void flush();
+  // Без выпуска (тренировка отброшена); отсчёты пульса остаются
+  void clear();
+  // Ремень на связи: записи ждут первого отсчёта, даже если его ещё не было
+  void expectHeartRate(bool expect) { expecting = expect; }
+
+  size_t pending() const { return recordCount; }
+  uint8_t heartRate() const { return lastBpm; }   // последний отсчёт ремня, 0 - нет контакта
+
+  uint32_t matched() const { return matchedCount; }      // записи с пульсом ремня
+  uint32_t unmatched() const { return unmatchedCount; }  // без него
+  uint32_t overflows() const { return overflowCount; }
+  uint32_t maxLatencyMs() const { return maxLatency; }   // от кадра до выпуска
+  size_t maxPending() const { return maxRecords; }
+
+private:
+  struct Pending {
+    WorkoutRecord record;
+    uint32_t atMs;
+  };
+  struct Beat {
+    uint32_t atMs;
+    uint8_t bpm;
+  };
+
+  void release(uint32_t nowMs, bool force);
+  uint8_t match(uint32_t atMs) const;
+  // Есть отсчёт не раньше atMs: более близкий уже не придёт
+  bool caughtUp(uint32_t atMs) const;
+  bool stale(uint32_t atMs) const;
+
+  Sink sink;
+  void* context;
+
+  Pending records[RECORD_SLOTS];   // кольцо в порядке прихода
+  size_t recordHead;
+  size_t recordCount;
+  Beat beats[HEART_SLOTS];         // по возрастанию времени
+  size_t beatCount;
+  uint8_t lastBpm;
+  bool expecting;
+
+  uint32_t matchedCount;
+  uint32_t unmatchedCount;
+  uint32_t overflowCount;
+  uint32_t maxLatency;
+  size_t maxRecords;
+};
+
+#endif
@@ -0,0 +1,257 @@
+#include "json_writer.h"
+
+#include <math.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t size)
+  : JsonWriter(buffer, size, nullptr, nullptr) {}
+
+JsonWriter::JsonWriter(char* buffer, size_t size, Sink sink, void* context)
+  : buffer(buffer), size(size), used(0), flushed(0), sink(sink), context(context),
+    failed(size == 0), depth(0), hasItems(0), afterKey(false) {}
+
+void JsonWriter::put(char c) {
+  if (failed) return;
+  // Без sink последний байт резервируется под завершающий ноль
+  size_t limit = sink != nullptr ? size : size - 1;
+  if (used >= limit) {
+    if (sink == nullptr || !flush()) {
+      failed = true;
+      return;
+    }
+  }
+  buffer[used++] = c;
+}
+
+void JsonWriter::write(const char* data, size_t length) {
+  while (length > 0 && !failed) {
+    size_t limit = sink != nullptr ? size : size - 1;
+    size_t room = limit - used;
+    if (room == 0) {
+      put(*data++);
+      length--;
+      continue;
+    }
+    size_t part = length < room ? length : room;
+    memcpy(buffer + used, data, part);
+    used += part;
+    data += part;
+    length -= part;
+  }
+}
+
+bool JsonWriter::flush() {
+  if (sink == nullptr) {
+    if (size > 0) buffer[used < size ? used : size - 1] = '\0';
+    return !failed;
+  }
+  if (used > 0) {
+    if (!sink(context, buffer, used)) {
+      failed = true;
+      return false;
+    }
+    flushed += used;
+    used = 0;
+  }
+  return !failed;
+}
+
+const char* JsonWriter::c_str() {
+  flush();
+  return buffer;
+}
+
+// Запятая перед вторым и следующими элементами текущего уровня
+void JsonWriter::separate() {
+  if (afterKey) {
+    afterKey = false;
+    return;
+  }
+  if (depth == 0) return;
+  uint32_t bit = 1u << (depth - 1);
+  if (hasItems & bit) put(',');
+  hasItems |= bit;
+}
+
+void JsonWriter::beginObject() {
+  separate();
+  put('{');
+  if (depth >= MAX_DEPTH) {
+    failed = true;
+    return;
+  }
+  depth++;
+  hasItems &= ~(1u << (depth - 1));
+}
+
+void JsonWriter::endObject() {
+  put('}');
+  if (depth > 0) depth--;
+}
+
+void JsonWriter::beginArray() {
+  separate();
+  put('[');
+  if (depth >= MAX_DEPTH) {
+    failed = true;
+    return;
+  }
+  depth++;
+  hasItems &= ~(1u << (depth - 1));
+}
+
+void JsonWriter::endArray() {
+  put(']');
+  if (depth > 0) depth--;
+}
+
+void JsonWriter::key(const char* name) {
+  value(name);
+  put(':');
+  afterKey = true;
+}
+
+void JsonWriter::value(const char* text) {
+  static const char HEX[] = "0123456789abcdef";
+
+  separate();
+  put('"');
+  // Обычные символы копируются отрезками, экранируются только " \ и управляющие
+  const char* run = text;
+  for (const char* p = text; ; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c != '\0' && c != '"' && c != '\\' && c >= 0x20) continue;
+
+    write(run, p - run);
+    if (c == '\0') break;
+    if (c == '"' || c == '\\') {
+      put('\\');
+      put((char)c);
+    } else if (c == '\n') {
+      write("\\n", 2);
+    } else if (c == '\r') {
+      write("\\r", 2);
+    } else if (c == '\t') {
+      write("\\t", 2);
+    } else {
+      write("\\u00", 4);
+      put(HEX[c >> 4]);
+      put(HEX[c & 0x0F]);
+    }
+    run = p + 1;
+  }
+  put('"');
+}
+
+void JsonWriter::writeUnsigned(uint64_t number) {
+  char digits[20];
+  size_t count = 0;
+  do {
+    digits[sizeof(digits) - 1 - count++] = (char)('0' + number % 10);
+    number /= 10;
+  } while (number > 0);
+  write(digits + sizeof(digits) - count, count);
+}
+
+void JsonWriter::writeDigits2(unsigned number) {
+  put((char)('0' + number / 10 % 10));
+  put((char)('0' + number % 10));
+}
+
+void JsonWriter::value(int32_t number) {
+  value((int64_t)number);
+}
+
+void JsonWriter::value(uint32_t number) {
+  separate();
+  writeUnsigned(number);
+}
+
+void JsonWriter::value(int64_t number) {
+  separate();
+  if (number < 0) {
+    put('-');
+    writeUnsigned(0 - (uint64_t)number);
+  } else {
+    writeUnsigned((uint64_t)number);
+  }
+}
+
+void JsonWriter::value(bool flag) {
+  separate();
+  if (flag) {
+    write("true", 4);
+  } else {
+    write("false", 5);
+  }
+}
+
+void JsonWriter::nullValue() {
+  separate();
+  write("null", 4);
+}
+
+void JsonWriter::fixed(float number, uint8_t decimals) {
+  static const uint32_t SCALE[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+  if (isnan(number) || isinf(number)) {
+    nullValue();
+    return;
+  }
+  if (decimals > 6) decimals = 6;
+
+  // Округление в целых: без printf("%f") и его стека/блокировок
+  double scaled = fabs((double)number) * SCALE[decimals] + 0.5;
+  if (scaled >= 1.8e19) {
+    nullValue();
+    return;
+  }
+  uint64_t units = (uint64_t)scaled;
+
+  separate();
+  if (number < 0 && units > 0) put('-');
+  writeUnsigned(units / SCALE[decimals]);
+  if (decimals == 0) return;
+
+  put('.');
+  char fraction[6];
+  uint32_t rest = (uint32_t)(units % SCALE[decimals]);
+  for (int i = decimals - 1; i >= 0; i--) {
+    fraction[i] = (char)('0' + rest % 10);
+    rest /= 10;
+  }
+  write(fraction, decimals);
+}
+
+void JsonWriter::timestamp(time_t utc, long offsetSeconds) {
+  time_t local = utc + offsetSeconds;
+  struct tm parts;
+  gmtime_r(&local, &parts);
+
+  separate();
+  put('"');
+  writeUnsigned((uint64_t)(parts.tm_year + 1900));
+  put('-');
+  writeDigits2(parts.tm_mon + 1);
+  put('-');
+  writeDigits2(parts.tm_mday);
+  put('T');
+  writeDigits2(parts.tm_hour);
+  put(':');
+  writeDigits2(parts.tm_min);
+  put(':');
+  writeDigits2(parts.tm_sec);
+
+  long offset = offsetSeconds;
+  put(offset < 0 ? '-' : '+');
+  if (offset < 0) offset = -offset;
+  writeDigits2((unsigned)(offset / 3600));
+  put(':');
+  writeDigits2((unsigned)(offset / 60 % 60));
+  put('"');
+}
+
+void JsonWriter::raw(const char* json, size_t length) {
+  separate();
+  write(json, length);
+}
@@ -0,0 +1,85 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Потоковая запись JSON без кучи.
+// Текст форматируется прямо в буфер вызывающего. Если задан sink, заполненный
+// буфер отдаётся ему и пишется заново - так генерируется тело любой длины
+// через буфер фиксированного размера. Без sink переполнение не портит
+// память: запись останавливается, ok() возвращает false.
+// Запятые между элементами расставляются сами, вложенность до MAX_DEPTH.
+class JsonWriter {
+public:
+  static const size_t MAX_DEPTH = 16;
+
+  // Получатель заполненного буфера; false - прервать запись
+  typedef bool (*Sink)(void* context, const char* data, size_t length);
+
+  JsonWriter(char* buffer, size_t size);
+  JsonWriter(char* buffer, size_t size, Sink sink, void* context);
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  // Имя поля внутри объекта; следующий вызов записывает значение
+  void key(const char* name);
+
+  void value(const char* text);             // строка с экранированием
+  void value(int32_t number);
+  void value(uint32_t number);
+  void value(int64_t number);
+  void value(bool flag);
+  void nullValue();
+  // Число с фиксированным количеством знаков после точки (0..6);
+  // NaN и бесконечность записываются как null
+  void fixed(float number, uint8_t decimals);
+  // ISO 8601 со смещением: 2024-05-01T18:30:00+03:00
+  void timestamp(time_t utc, long offsetSeconds);
+  // Готовый фрагмент JSON (например, строка из очереди) как один элемент
+  void raw(const char* json, size_t length);
+
+  // Поле целиком: key(name) + значение
+  void field(const char* name, const char* text) { key(name); value(text); }
+  void field(const char* name, int32_t number) { key(name); value(number); }
+  void field(const char* name, uint32_t number) { key(name); value(number); }
+  void field(const char* name, int64_t number) { key(name); value(number); }
+  void field(const char* name, bool flag) { key(name); value(flag); }
+  void fixedField(const char* name, float number, uint8_t decimals) { key(name); fixed(number, decimals); }
+  void timestampField(const char* name, time_t utc, long offsetSeconds) { key(name); timestamp(utc, offsetSeconds); }
+
+  // Отдаёт sink остаток буфера. Без sink дописывает завершающий ноль
+  bool flush();
+
+  bool ok() const { return !failed; }
+  // Байт в буфере (без sink - длина документа)
+  size_t length() const { return used; }
+  // Всего сгенерировано байт, включая уже отданные sink
+  size_t total() const { return flushed + used; }
+  const char* c_str();
+
+private:
+  void separate();
+  void put(char c);
+  void write(const char* data, size_t length);
+  void writeUnsigned(uint64_t number);
+  void writeDigits2(unsigned number);
+
+  char* buffer;
+  size_t size;
+  size_t used;
+  size_t flushed;
+  Sink sink;
+  void* context;
+  bool failed;
+
+  uint8_t depth;
+  uint32_t hasItems;     // бит на уровень: на уровне уже есть элементы
+  bool afterKey;
+};
+
+#endif
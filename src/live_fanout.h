@@ -0,0 +1,98 @@
+#ifndef LIVE_FANOUT_H
+#define LIVE_FANOUT_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Рассылка живой телеметрии подключённым клиентам (WebSocket).
+// Кадры нумеруются (seq); клиент получает только самый свежий: если он
+// ещё не забрал предыдущий (ready() == false), новый для него
+// пропускается, а не копится в очереди - медленный браузер видит
+// актуальные данные, а память на него не растёт. Догнавший клиент
+// получает последний кадр, даже если новых пока нет.
+// add()/remove() вызываются из задачи веб-сервера, publish() - из loop;
+// слоты - атомики, блокировок нет.
+class LiveFanout {
+public:
+  static const size_t MAX_CLIENTS = 16;
+
+  LiveFanout() : skippedCount(0), sentCount(0) {
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      slots[i].store(0);
+      owner[i] = 0;
+      delivered[i] = 0;
+    }
+  }
+
+  // id клиента, 0 не используется; false - все слоты заняты
+  bool add(uint32_t id) {
+    if (id == 0) return false;
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      uint32_t expected = 0;
+      if (slots[i].compare_exchange_strong(expected, id)) return true;
+    }
+    return false;
+  }
+
+  void remove(uint32_t id) {
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      uint32_t expected = id;
+      if (slots[i].compare_exchange_strong(expected, 0)) return;
+    }
+  }
+
+  size_t count() const {
+    size_t n = 0;
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      if (slots[i].load(std::memory_order_relaxed) != 0) n++;
+    }
+    return n;
+  }
+
+  // Есть клиент, ещё не получивший кадр seq
+  bool behind(uint32_t seq) {
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      uint32_t id = slots[i].load(std::memory_order_acquire);
+      if (id != 0 && (owner[i] != id || delivered[i] != seq)) return true;
+    }
+    return false;
+  }
+
+  // Отдаёт кадр seq отстающим готовым клиентам: ready(id) - клиент жив и
+  // забрал прошлый кадр, send(id) - отправка. Возвращает число получателей
+  template <typename Ready, typename Send>
+  size_t publish(uint32_t seq, Ready ready, Send send) {
+    size_t count = 0;
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      uint32_t id = slots[i].load(std::memory_order_acquire);
+      if (id == 0) continue;
+      if (owner[i] == id && delivered[i] == seq) continue;
+      if (!ready(id)) {
+        skippedCount++;
+        continue;
+      }
+      send(id);
+      owner[i] = id;
+      delivered[i] = seq;
+      count++;
+    }
+    sentCount += count;
+    return count;
+  }
+
+  // Кадры, пропущенные для не успевающих клиентов
+  uint32_t skipped() const { return skippedCount; }
+  uint32_t sent() const { return sentCount; }
+
+private:
+  std::atomic<uint32_t> slots[MAX_CLIENTS];
+  // Только для publish(): кому и какой кадр отдан. Новый клиент в слоте
+  // отличается id от owner и получает текущий кадр
+  uint32_t owner[MAX_CLIENTS];
+  uint32_t delivered[MAX_CLIENTS];
+  uint32_t skippedCount;
+  uint32_t sentCount;
+};
+
+#endif
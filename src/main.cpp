@@ -1,23 +1,48 @@
 #include <Arduino.h>
-#include <BLEDevice.h>
-#include <BLEUtils.h>
-#include <BLEScan.h>
-#include <BLEClient.h>
-#include <BLEAddress.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <time.h>
 #include <vector>
+#include <utility>
+#include <memory>
+#include <new>
 #include <Adafruit_NeoPixel.h>
 #include "config.h"
+#include "ftms_parser.h"
+#include "frame_queue.h"
+#include "heart_rate.h"
+#include "ble_central.h"
+#include "session_store.h"
+#include "calories.h"
+#include "flash_budget.h"
+#include "flash_fs.h"
+#include "workout_journal.h"
+#include "upload_outbox.h"
+#include "outbox_drain.h"
+#include "retry_backoff.h"
+#include "workout_history.h"
+#include "workout_row.h"
+#include "workout_stats.h"
+#include "workout_tracker.h"
+#include "treadmill_session.h"
+#include "workout_export.h"
+#include "supabase_client.h"
+#include "json_writer.h"
+#include "sample_batch_writer.h"
+#include "wifi_manager.h"
+#include "live_fanout.h"
+#include "seqlock.h"
+#include "body_cache.h"
+#include "web_assets.h"
+#include "row_stream.h"
+#include "frame_capture.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "deferred_log.h"
 #include <ESPAsyncWebServer.h>
 
 bool RAW = false;
 
-// Variables for workout start delay
-unsigned long workoutStartDelay = 5000; // 5 секунд задержка после старта
-unsigned long actualWorkoutStartTime = 0;
-
 // NeoPixel настройки
 #define NEOPIXEL_PIN 48     // GPIO48 для ESP32-S3
 #define NEOPIXEL_COUNT 1    // Количество светодиодов
@@ -40,43 +65,123 @@ const char* ntpServer3 = "ntp.msk-ix.ru";
 const long gmtOffset_sec = 3 * 3600;     // МСК = UTC+3
 const int daylightOffset_sec = 0;
 
-// Настройки буфера
-const size_t MAX_BUFFER_SIZE = 200;
-const unsigned long STANDBY_TIMEOUT = 10000;
+// Настройки буфера: объём фиксирован, длинные тренировки прореживаются.
+// Точки нужны только на время тренировки (итоги считает WorkoutStats по всем
+// записям, сэмплы - в журнале), поэтому буфер небольшой: ~11 байт на точку,
+// 4096 точек - 45 КБ PSRAM на дорожку. Час при 1 Гц - без прореживания,
+// дальше окна укрупняются с сохранением минимума и максимума скорости
+// (замер: test/test_session_store)
+const size_t SESSION_CAPACITY_PSRAM = 4096;
+const size_t SESSION_CAPACITY_RAM = 1024;
 const unsigned long CONNECTION_CHECK_INTERVAL = 5000;
 
-// Пороги активности
-const float MIN_ACTIVITY_SPEED = 0.8;    // 0.8 км/ч для расчета дистанции
-const float MIN_WORKOUT_SPEED = 0.5;     // 0.5 км/ч для начала тренировки
+// Дорожка: FTMS (0x1826), Treadmill Data (0x2ACD)
+const uint16_t FTMS_SERVICE_UUID = 0x1826;
+const uint16_t TREADMILL_DATA_UUID = 0x2ACD;
 
-BLEAddress treadmillAddress(TREADMILL_MAC);
-bool connected = false;
-bool wifiConnected = false;
+// WiFi подключается в фоне; задача отправки ждёт NETWORK_UP_BIT
+ArduinoWifiDriver wifiDriver(WIFI_SSID, WIFI_PASSWORD, gmtOffset_sec, daylightOffset_sec,
+                             ntpServer1, ntpServer2, ntpServer3);
+WifiManager wifiManager(wifiDriver, 2000, 60000);
+EventGroupHandle_t networkEvents = nullptr;
+const EventBits_t NETWORK_UP_BIT = BIT0;
 
 AsyncWebServer webServer(80);
-float webCurrentSpeed = 0.0;
-uint32_t webCurrentDistance = 0;
-uint16_t webCurrentTime = 0;
-String webCurrentState = "STANDBY";
-time_t webSessionDuration = 0;
-unsigned long lastWebUpdate = 0;
-const unsigned long WEB_UPDATE_INTERVAL = 2000;
+// Показатели дорожки для веб-интерфейса. Пишет только задача обработки
+// кадров, читают веб-сервер и loop - через seqlock, без разрывов между полями
+struct TelemetrySnapshot {
+  float speed;
+  uint32_t distance;
+  uint16_t time;
+  int32_t duration;
+  uint8_t heartRate;      // 0 - нет данных
+  // Итоги текущей тренировки (SessionStore::stats())
+  float avgSpeed;
+  uint32_t movingTime;
+  uint32_t calories;
+  float elevationGain;
+  uint32_t lastSplit;     // последний пройденный км, с; 0 - ещё нет
+  const char* state;      // только строковые литералы
+};
+Seqlock<TelemetrySnapshot> telemetry[TREADMILL_COUNT];
+// Растёт при любом изменении показателей или связи любой дорожки
+std::atomic<uint32_t> telemetryVersion(0);
+
+// Готовое тело /data: собирается в задаче обработки не чаще
+// DATA_REFRESH_INTERVAL и только после изменений, поэтому кадр стоит O(1)
+// при любом числе дорожек. Запросы отдают его без копии; слот занят,
+// пока ответ не ушёл клиенту
+typedef BodyCache<6, 192 + 256 * TREADMILL_COUNT> DataCache;
+DataCache dataCache;
+const unsigned long DATA_REFRESH_INTERVAL = 100;
 
-BLEClient* pClient = nullptr;
-BLERemoteCharacteristic* pTreadmillData = nullptr;
+// Живые данные для страницы: WebSocket /ws, не чаще LIVE_PUSH_INTERVAL.
+// Кадры между рассылками схлопываются в последний
+AsyncWebSocket liveSocket("/ws");
+LiveFanout liveClients;
+const unsigned long LIVE_PUSH_INTERVAL = 200;
+
+// Дорожки зала (config.h): у каждой свой клиент NimBLE и своя сессия
+// (связь, очередь кадров, трекер, буфер, журнал). Создаются в setup().
+// Подключение и переподключение - в BLE_Task, чтобы connect() не
+// останавливал loop; пауза между попытками 1-8 с
+static_assert(TREADMILL_COUNT > 0 && TREADMILL_COUNT <= 8,
+              "1-8 treadmills: CONFIG_BT_NIMBLE_MAX_CONNECTIONS in platformio.ini");
+NimBleCentral* bleCentrals[TREADMILL_COUNT];
+TreadmillSession* sessions[TREADMILL_COUNT];
+// Ремни (TreadmillConfig::strapAddress): свой клиент на каждый, nullptr -
+// ремня нет. Кэш GATT ремня - в слоте после слотов дорожек
+NimBleCentral* strapCentrals[TREADMILL_COUNT] = {};
+const uint8_t STRAP_CACHE_SLOT = 8;
+TaskHandle_t bleTaskHandle = nullptr;
+const unsigned long BLE_POLL_INTERVAL = 100;
 
 // HTTP Task components
 TaskHandle_t httpTaskHandle = nullptr;
-QueueHandle_t workoutQueue;
 
-enum WorkoutState {
-  STANDBY,
-  ACTIVE,
-  WORKOUT_ENDED
+// Вывод отложенного лога (LOG_*) и запись завершённых тренировок на
+// флеш, низкий приоритет
+TaskHandle_t logTaskHandle = nullptr;
+const unsigned long LOG_DRAIN_INTERVAL = 20;
+
+// Одно keep-alive TLS соединение с Supabase на все запросы
+SupabaseClient supabase;
+const unsigned long SUPABASE_IDLE_CLOSE = 60000;
+
+// Processing Task components
+TaskHandle_t processingTaskHandle = nullptr;
+
+// События тренировок всех дорожек: индикация, очередь отправки, архив
+class SessionEvents : public SessionListener {
+public:
+  void onWorkoutStart(TreadmillSession& session, time_t startTime) override;
+  void onSample(TreadmillSession& session, const WorkoutRecord& record) override;
+  void onWorkoutEnd(TreadmillSession& session, time_t startTime, time_t endTime,
+                    const char* journalPath) override;
+  void onWorkoutDiscard(TreadmillSession& session, const char* reason) override;
 };
+SessionEvents sessionEvents;
 
-WorkoutState currentState = STANDBY;
-WorkoutState previousState = STANDBY;
+// Завершённая тренировка ждёт задачу лога: задача обработки только
+// обменивает буфер сессии на пустой запасной из слота, а строку в очередь
+// отправки и перенос журнала в архив делает задача лога. Флеш не
+// задерживает кадры других дорожек. Слот свободен, пока ready == false;
+// заполняет его задача обработки, освобождает задача лога
+struct FinishedWorkout {
+  SessionStore buffer;
+  uint8_t device;
+  time_t startTime;
+  time_t endTime;
+  char journalPath[48];
+  std::atomic<bool> ready;
+};
+// Следующая тренировка той же дорожки кончается не раньше чем через
+// 30 с, а слот освобождается за десятки мс: одной дорожке хватает
+// одного слота, залу - двух
+const size_t FINISHED_SLOTS = TREADMILL_COUNT < 2 ? TREADMILL_COUNT : 2;
+FinishedWorkout finishedWorkouts[FINISHED_SLOTS];
+// Дорожек с идущей тренировкой: LED горит зелёным, пока есть хоть одна
+std::atomic<uint32_t> activeWorkouts(0);
 
 enum LEDState {
   LED_STANDBY,
@@ -93,47 +198,113 @@ LEDState currentLEDState = LED_STANDBY;
 unsigned long lastLEDUpdate = 0;
 bool blinkState = false;
 
-struct WorkoutRecord {
-  time_t timestamp;
-  float speed;
-  uint32_t distance;
-  uint16_t time;
-  bool isActive;
-};
+size_t sessionCapacity = SESSION_CAPACITY_RAM;
 
-struct WorkoutData {
-  std::vector<WorkoutRecord> buffer;
-  time_t startTime;
-  time_t endTime;
+// Журналы сессий на флеше: переживают перезагрузку и неудачную отправку
+LittleFsFlash flashFs;
+bool flashReady = false;
+
+// Очередь отправки на флеше: строки уходят пачками, повторы - с
+// экспоненциальной задержкой, пока сервер не подтвердит приём
+UploadOutbox outbox(flashFs, "/outbox");
+RetryBackoff uploadBackoff(5000, 15 * 60 * 1000UL);
+unsigned long nextUploadAttempt = 0;
+const size_t UPLOAD_BATCH_SIZE = 8;
+const int MIN_MEMORY_FOR_HTTP = 20000;
+// Колонки, которые пишет прошивка. Проверка при подключении выбирает их
+// все: если миграция схемы не выполнена, PostgREST отвечает 400 с именем
+// недостающей колонки
+const char* const WORKOUT_COLUMNS =
+  "client_id,workout_start,workout_end,duration_seconds,total_distance,max_speed,avg_speed,"
+  "moving_seconds,elevation_gain,records_count,device_name,calories,avg_heart_rate,"
+  "splits_km,splits_mile";
+
+// Посэмпловая выгрузка в таблицу workout_samples (опционально).
+// Очередь - SAMPLE_QUEUE_DIR: <key>.ref с путём журнала в архиве или, если
+// архив журнал не принял, сам журнал <key>.jnl. Запись очереди удаляется,
+// когда все сэмплы ушли потоковыми bulk insert по SAMPLE_UPLOAD_BATCH строк
+const bool UPLOAD_SAMPLES = true;
+const size_t SAMPLE_UPLOAD_BATCH = 500;
+const char* SAMPLE_QUEUE_DIR = "/samples";
+const char* const SAMPLE_COLUMNS =
+  "workout_client_id,sample_index,recorded_at,speed,distance,elapsed_time,is_active,heart_rate";
+// Ставит в очередь задача обработки, выгружает задача HTTP, читает /metrics
+std::atomic<size_t> pendingSampleUploads(0);
+
+// Запись очереди сэмплов снята; счётчик не уходит ниже нуля
+void countSampleUploadDone() {
+  size_t current = pendingSampleUploads.load();
+  while (current > 0 && !pendingSampleUploads.compare_exchange_weak(current, current - 1)) {
+  }
+}
+
+// Архив завершённых тренировок на флеше для /api/workouts: сводки и
+// журналы остаются после отправки, старые сэмплы вытесняются по бюджету
+WorkoutHistory history(flashFs, "/history");
+const size_t HISTORY_PAGE_MAX = 50;
+
+// Запись сырых кадров BLE на флеш (кольцо FLASH_CAPTURE_BYTES) для воспроизведения
+// в sim/: включается через /api/capture?enable=1, скачивается как pcap.
+// Пишутся кадры одной дорожки (/api/capture?device=N)
+FrameCapture capture(flashFs, "/capture");
+std::atomic<uint8_t> captureDevice(0);
+
+// Метрики для /metrics (Prometheus). Горячий путь только увеличивает
+// счётчики своего ядра; тексты собираются при запросе
+const uint32_t CALLBACK_CYCLE_BOUNDS[] = { 250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000, 128000 };
+const uint32_t NOTIFY_LATENCY_BOUNDS_US[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000 };
+const uint32_t UPLOAD_LATENCY_BOUNDS_MS[] = { 100, 250, 500, 1000, 2000, 4000, 8000, 15000, 30000 };
+const uint32_t FIRST_SAMPLE_BOUNDS_MS[] = { 250, 500, 1000, 2000, 4000, 8000, 15000, 30000, 60000 };
+Counter bleNotifications;
+Histogram bleFirstSample(FIRST_SAMPLE_BOUNDS_MS, sizeof(FIRST_SAMPLE_BOUNDS_MS) / sizeof(uint32_t));
+Histogram bleCallbackCycles(CALLBACK_CYCLE_BOUNDS, sizeof(CALLBACK_CYCLE_BOUNDS) / sizeof(uint32_t));
+Histogram notifyLatency(NOTIFY_LATENCY_BOUNDS_US, sizeof(NOTIFY_LATENCY_BOUNDS_US) / sizeof(uint32_t));
+Histogram uploadLatency(UPLOAD_LATENCY_BOUNDS_MS, sizeof(UPLOAD_LATENCY_BOUNDS_MS) / sizeof(uint32_t));
+std::atomic<uint32_t> bleLastOutage(0);     // мс, последнее восстановление связи любой дорожки
+CodeCounter uploadResults;
+std::atomic<uint32_t> notificationRate(0);  // уведомлений за последнюю секунду
+
+enum WebRoute : uint8_t {
+  ROUTE_INDEX,
+  ROUTE_DATA,
+  ROUTE_WORKOUTS,
+  ROUTE_CAPTURE,
+  ROUTE_METRICS,
+  ROUTE_LIVE,
+  ROUTE_TRACE,
+  ROUTE_NOT_FOUND,
+  ROUTE_COUNT
 };
+const char* const WEB_ROUTE_NAMES[ROUTE_COUNT] = {
+  "/", "/data", "/api/workouts", "/api/capture", "/metrics", "/ws", "/api/trace.json", "not_found"
+};
+Counter webRequests[ROUTE_COUNT];
+MetricFamily metricFamilies[22];
+size_t metricFamilyCount = 0;
 
-std::vector<WorkoutRecord> workoutBuffer;
-time_t workoutStartTime = 0;
-time_t workoutEndTime = 0;
-unsigned long lastActiveTime = 0;
+char deviceId[13] = "";   // MAC в hex, часть ключа идемпотентности
 unsigned long lastConnectionCheck = 0;
-unsigned long workoutEndTime_millis = 0;
-const unsigned long WORKOUT_COOLDOWN = 10000;
-
-// Глобальные переменные для расчета дистанции
-float totalDistance = 0.0;
-unsigned long lastTimeUpdate = 0;
-unsigned long sessionStartTime = 0;
 
-// Конфиг для расчета калорий
+// Конфиг для расчета калорий (по пульсу нужен и возраст)
 const int USER_HEIGHT = 193;
 const int USER_WEIGHT = 110;
+const int USER_AGE = 35;
 const bool USER_MALE = true;
+const UserProfile USER_PROFILE = { (float)USER_WEIGHT, (uint8_t)USER_AGE, USER_MALE };
 
 // FORWARD DECLARATIONS
-void sendWorkoutToSupabaseFromTask(WorkoutData* data);
-String createOptimizedWorkoutJson(const std::vector<WorkoutRecord>& buffer, time_t startTime, time_t endTime);
-String getISOTimestamp(time_t timeValue);
-String getReadableTime(time_t timeValue);
-void sendWorkoutToSupabase();
-void updateWorkoutState(const WorkoutRecord& record);
+bool queueWorkoutForUpload(const SessionStore& session, uint8_t device, time_t startTime,
+                           time_t endTime, char* keyOut, size_t keySize);
+struct ReadableTime { char text[25]; };
+ReadableTime getReadableTime(time_t timeValue);
+void sendWorkoutToSupabase(const SessionStore& buffer, uint8_t device, const char* journalPath,
+                           time_t startTime, time_t endTime);
+void kickUploadTask(bool resetBackoff);
+void recordUpload(int httpCode);
+void scheduleUploadRetry(const char* reason);
 void updateNeoPixel();
 void setLEDState(LEDState newState);
+LEDState restingLEDState();
 
 // Функция управления NeoPixel
 void updateNeoPixel() {
@@ -189,7 +360,7 @@ void updateNeoPixel() {
 void setLEDState(LEDState newState) {
   if (currentLEDState != newState) {
     currentLEDState = newState;
-    Serial0.printf("LED State: %s\n", 
+    LOG_INFO("LED State: %s\n",
       newState == LED_STANDBY ? "STANDBY" :
       newState == LED_ACTIVE ? "ACTIVE" :
       newState == LED_SENDING ? "SENDING" :
@@ -200,210 +371,178 @@ void setLEDState(LEDState newState) {
   }
 }
 
-const char* webPageHTML = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <meta charset="utf-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <title>Тренировочный монитор ESP32-S3</title>
-    <style>
-        body {
-            font-family: Arial, sans-serif;
-            margin: 20px;
-            background-color: #f0f0f0;
-        }
-        .container {
-            max-width: 600px;
-            margin: 0 auto;
-            background: white;
-            border-radius: 10px;
-            padding: 20px;
-            box-shadow: 0 4px 6px rgba(0,0,0,0.1);
-        }
-        .header {
-            text-align: center;
-            color: #333;
-            margin-bottom: 30px;
-        }
-        .metric {
-            display: flex;
-            justify-content: space-between;
-            align-items: center;
-            padding: 15px;
-            margin: 10px 0;
-            background: #f8f9fa;
-            border-radius: 8px;
-            border-left: 4px solid #007bff;
-        }
-        .metric.active {
-            border-left-color: #28a745;
-            background: #d4edda;
-        }
-        .metric-label {
-            font-weight: bold;
-            color: #495057;
-        }
-        .metric-value {
-            font-size: 24px;
-            font-weight: bold;
-            color: #212529;
-        }
-        .status {
-            text-align: center;
-            padding: 10px;
-            border-radius: 5px;
-            margin: 20px 0;
-            font-weight: bold;
-        }
-        .status.standby { background: #cce7ff; color: #0066cc; }
-        .status.active { background: #ccffcc; color: #006600; }
-        .status.ended { background: #ffffcc; color: #cc6600; }
-        .update-time {
-            text-align: center;
-            color: #666;
-            font-size: 14px;
-            margin-top: 20px;
-        }
-        .progress {
-            width: 100%;
-            height: 10px;
-            background: #e0e0e0;
-            border-radius: 5px;
-            overflow: hidden;
-            margin: 10px 0;
-        }
-        .progress-bar {
-            height: 100%;
-            background: linear-gradient(90deg, #007bff, #28a745);
-            width: 0%;
-            transition: width 0.3s ease;
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1 class="header">🏃 Тренировочный Монитор</h1>
-        
-        <div id="status" class="status standby">ОЖИДАНИЕ</div>
-        
-        <div id="speed-metric" class="metric">
-            <span class="metric-label">Скорость:</span>
-            <span class="metric-value"><span id="speed">0.0</span> км/ч</span>
-        </div>
-        
-        <div id="distance-metric" class="metric">
-            <span class="metric-label">Дистанция:</span>
-            <span class="metric-value"><span id="distance">0</span> м</span>
-        </div>
-        
-        <div id="time-metric" class="metric">
-            <span class="metric-label">Время тренировки:</span>
-            <span class="metric-value"><span id="duration">00:00</span></span>
-        </div>
-        
-        <div class="progress">
-            <div id="progress-bar" class="progress-bar"></div>
-        </div>
-        
-        <div class="update-time">
-            Последнее обновление: <span id="lastUpdate">-</span>
-        </div>
-    </div>
-
-    <script>
-        function updateData() {
-            fetch('/data')
-                .then(response => response.json())
-                .then(data => {
-                    document.getElementById('speed').textContent = data.speed;
-                    document.getElementById('distance').textContent = data.distance;
-                    document.getElementById('duration').textContent = formatTime(data.duration);
-                    
-                    const statusEl = document.getElementById('status');
-                    statusEl.textContent = data.state;
-                    statusEl.className = 'status ' + data.state.toLowerCase();
-                    
-                    const speedMetric = document.getElementById('speed-metric');
-                    const distanceMetric = document.getElementById('distance-metric');
-                    const timeMetric = document.getElementById('time-metric');
-                    
-                    if (data.state === 'ACTIVE') {
-                        speedMetric.classList.add('active');
-                        distanceMetric.classList.add('active');
-                        timeMetric.classList.add('active');
-                        
-                        const progress = Math.min((data.speed / 15) * 100, 100);
-                        document.getElementById('progress-bar').style.width = progress + '%';
-                    } else {
-                        speedMetric.classList.remove('active');
-                        distanceMetric.classList.remove('active');
-                        timeMetric.classList.remove('active');
-                        document.getElementById('progress-bar').style.width = '0%';
-                    }
-                    
-                    document.getElementById('lastUpdate').textContent = new Date().toLocaleTimeString('ru-RU');
-                })
-                .catch(error => {
-                    console.error('Ошибка получения данных:', error);
-                });
-        }
-        
-        function formatTime(seconds) {
-            const mins = Math.floor(seconds / 60);
-            const secs = seconds % 60;
-            return mins.toString().padStart(2, '0') + ':' + secs.toString().padStart(2, '0');
-        }
-        
-        setInterval(updateData, 3000); // Обновляем каждые 3 секунды вместо 2
-        updateData();
-    </script>
-</body>
-</html>
-)rawliteral";
-
-// Функция проверки валидности времени
-bool isTimeValid(time_t timeValue) {
-  const time_t MIN_VALID_TIME = 1577836800; // 1 января 2020
-  const time_t MAX_VALID_TIME = 1893456000; // 1 января 2030
-  
-  return (timeValue >= MIN_VALID_TIME && timeValue <= MAX_VALID_TIME);
+// Состояние LED между событиями: тренировка хоть на одной дорожке или ожидание
+LEDState restingLEDState() {
+  return activeWorkouts.load(std::memory_order_relaxed) > 0 ? LED_ACTIVE : LED_STANDBY;
 }
 
-// Попытка переподключения WiFi
-void reconnectWiFi() {
-  Serial0.println("Attempting WiFi reconnection...");
-  setLEDState(LED_CONNECTING);
-  
-  WiFi.disconnect();
-  delay(1000);
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 15) {
-    delay(1000);
-    Serial0.print(".");
-    attempts++;
+
+// Показатели для страницы: объект на каждую дорожку в "devices".
+// full - с диагностикой (для /data); живые кадры WebSocket без неё,
+// чтобы оставаться короткими
+void writeTelemetryJson(JsonWriter& json, bool full) {
+  uint32_t dropped = 0;
+  uint32_t queueHighWater = 0;
+  
+  json.beginObject();
+  json.key("devices");
+  json.beginArray();
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    TreadmillSession& session = *sessions[i];
+    TelemetrySnapshot snapshot = telemetry[i].read();
+    json.beginObject();
+    json.field("name", session.name());
+    json.field("connected", session.link().isUp());
+    json.fixedField("speed", snapshot.speed, 1);
+    json.field("distance", snapshot.distance);
+    json.field("time", (uint32_t)snapshot.time);
+    json.field("duration", snapshot.duration);
+    json.key("heart_rate");
+    if (snapshot.heartRate != 0) {
+      json.value((uint32_t)snapshot.heartRate);
+    } else {
+      json.nullValue();
+    }
+    json.fixedField("avg_speed", snapshot.avgSpeed, 1);
+    json.field("moving_time", snapshot.movingTime);
+    json.field("calories", snapshot.calories);
+    json.fixedField("elevation_gain", snapshot.elevationGain, 1);
+    json.key("split_km");
+    if (snapshot.lastSplit != 0) {
+      json.value(snapshot.lastSplit);
+    } else {
+      json.nullValue();
+    }
+    json.field("state", snapshot.state != nullptr ? snapshot.state : "STANDBY");
+    json.endObject();
+    
+    dropped += session.frames().dropped();
+    if (session.frames().highWater() > queueHighWater) queueHighWater = session.frames().highWater();
+  }
+  json.endArray();
+  if (full) {
+    json.field("free_heap", (uint32_t)ESP.getFreeHeap());
+    json.field("ble_dropped", dropped);
+    json.field("ble_queue_hw", queueHighWater);
+    json.field("live_clients", (uint32_t)liveClients.count());
+    json.field("live_skipped", liveClients.skipped());
+    json.field("data_stale", dataCache.stale());
+  }
+  json.endObject();
+}
+
+// Новые показатели дорожки. Тело /data собирает refreshDataBody()
+void publishTelemetry(uint8_t device, const TelemetrySnapshot& snapshot) {
+  telemetry[device].write(snapshot);
+  telemetryVersion.fetch_add(1, std::memory_order_release);
+}
+
+// Готовит тело /data, если показатели изменились, но не чаще
+// DATA_REFRESH_INTERVAL. Только из одного потока (задача обработки;
+// до её запуска - setup). force - без ограничения частоты
+void refreshDataBody(bool force) {
+  static uint32_t builtVersion = 0;
+  static unsigned long builtAt = 0;
+  uint32_t version = telemetryVersion.load(std::memory_order_acquire);
+  if (!force && (version == builtVersion || millis() - builtAt < DATA_REFRESH_INTERVAL)) return;
+  
+  TRACE_SCOPE("web_snapshot");
+  char* body = dataCache.begin();
+  if (body == nullptr) return;   // все слоты у медленных клиентов
+  JsonWriter json(body, DataCache::CAPACITY);
+  writeTelemetryJson(json, true);
+  json.flush();
+  dataCache.commit(json.ok() ? json.length() : 0, version);
+  builtVersion = version;
+  builtAt = millis();
+}
+
+// Рассылка последнего кадра клиентам /ws (из loop). Клиенту, который
+// ещё не забрал прошлый кадр, новый не ставится в очередь: он получит
+// последний на одной из следующих рассылок
+void pushLiveTelemetry() {
+  static unsigned long lastPush = 0;
+  static unsigned long lastCleanup = 0;
+  unsigned long now = millis();
+  
+  if (now - lastCleanup > 1000) {
+    liveSocket.cleanupClients(LiveFanout::MAX_CLIENTS);
+    lastCleanup = now;
   }
   
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial0.println("\nWiFi reconnected!");
-    wifiConnected = true;
-    setLEDState(LED_SUCCESS);
-    delay(1000);
-    
-    // Пересинхронизируем время после подключения WiFi
-    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer1, ntpServer2, ntpServer3);
+  uint32_t seq = telemetryVersion.load(std::memory_order_acquire);
+  if (now - lastPush < LIVE_PUSH_INTERVAL || !liveClients.behind(seq)) return;
+  lastPush = now;
+  
+  char frame[32 + 256 * TREADMILL_COUNT];
+  JsonWriter json(frame, sizeof(frame));
+  writeTelemetryJson(json, false);
+  json.flush();
+  if (!json.ok()) return;
+  size_t length = json.length();
+  
+  liveClients.publish(seq,
+    [](uint32_t id) {
+      AsyncWebSocketClient* client = liveSocket.client(id);
+      return client != nullptr && client->status() == WS_CONNECTED &&
+             !client->queueIsFull() && client->client()->canSend();
+    },
+    [&](uint32_t id) {
+      liveSocket.text(id, frame, length);
+    });
+}
+
+// Смена состояния WiFi (из wifiManager.poll() в loop). SNTP менеджер
+// перезапускает сам; здесь - индикация и сигнал задаче отправки
+void onWifiLinkChange(bool up) {
+  if (up) {
+    Serial0.printf("WiFi connected, IP %s (attempt %u)\n",
+                   WiFi.localIP().toString().c_str(), wifiManager.attempts());
+    xEventGroupSetBits(networkEvents, NETWORK_UP_BIT);
+    if (currentLEDState == LED_WIFI_ERROR || currentLEDState == LED_CONNECTING) {
+      setLEDState(restingLEDState());
+    }
+    // Сеть вернулась - разбираем накопленную очередь без ожидания
+    kickUploadTask(true);
   } else {
-    Serial0.println("\nWiFi reconnection failed");
-    wifiConnected = false;
+    Serial0.printf("WiFi lost (drops: %u) - reconnecting in background\n", wifiManager.drops());
+    xEventGroupClearBits(networkEvents, NETWORK_UP_BIT);
     setLEDState(LED_WIFI_ERROR);
   }
 }
 
+// Проверка структуры одной таблицы: select по всем колонкам, которые
+// пишет прошивка
+bool probeTable(const char* table, const char* columns) {
+  char path[384];
+  snprintf(path, sizeof(path), "/rest/v1/%s?select=%s&limit=1", table, columns);
+  String response = "";
+  int responseCode = supabase.get(path, &response, 1000);
+  
+  Serial0.printf("Test %s response code: %d\n", table, responseCode);
+  if (responseCode == 200) return true;
+  
+  Serial0.printf("✗ Supabase connection failed: %d\n", responseCode);
+  if (response.length() > 0 && response.length() < 200) {
+    Serial0.println("Error response: " + response);
+  }
+  
+  if (responseCode == 401) {
+    Serial0.println("401 Error: API key invalid or insufficient permissions");
+    Serial0.println("Make sure you're using service_role key for write operations");
+  } else if (responseCode == 404) {
+    Serial0.printf("404 Error: Table '%s' not found or inaccessible\n", table);
+  } else if (isSchemaError(responseCode, response.c_str())) {
+    Serial0.printf("400 Error: '%s' is missing a column - run the schema migration\n", table);
+    Serial0.printf("Expected columns: %s\n", columns);
+    Serial0.println("Uploads are kept on flash and retried until then");
+  }
+  return false;
+}
+
 // Тестирование подключения к Supabase с правильной структурой
 void testSupabaseConnection() {
-  if (!wifiConnected) {
+  if (!wifiManager.isUp()) {
     Serial0.println("No WiFi for connection test");
     setLEDState(LED_WIFI_ERROR);
     return;
@@ -412,226 +551,329 @@ void testSupabaseConnection() {
   Serial0.println("Testing Supabase connection...");
   setLEDState(LED_CONNECTING);
   
-  HTTPClient http;
-  // Тестируем структуру таблицы
-  String testUrl = String(SUPABASE_URL) + "/rest/v1/workouts?select=workout_start,workout_end,duration_seconds,total_distance,max_speed,avg_speed,records_count,device_name&limit=1";
-  
-  http.begin(testUrl);
-  http.setTimeout(10000);
-  
-http.addHeader("Content-Type", "application/json");
-http.addHeader("apikey", SUPABASE_KEY);
-http.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
-
-  
-  int responseCode = http.GET();
-  String response = "";
+  // Тестируем структуру таблиц
+  bool ok = probeTable("workouts", WORKOUT_COLUMNS);
+  if (ok && UPLOAD_SAMPLES) ok = probeTable("workout_samples", SAMPLE_COLUMNS);
   
-  if (responseCode > 0 && http.getSize() > 0 && http.getSize() < 1000) {
-    response = http.getString();
-  }
-  
-  Serial0.printf("Test response code: %d\n", responseCode);
-  
-  if (responseCode == 200) {
+  if (ok) {
     Serial0.println("✓ Supabase connection OK!");
     Serial0.println("✓ Table structure accessible");
     setLEDState(LED_SUCCESS);
     delay(2000);
-    setLEDState(LED_STANDBY);
+    setLEDState(restingLEDState());
   } else {
-    Serial0.printf("✗ Supabase connection failed: %d\n", responseCode);
     setLEDState(LED_ERROR);
-    if (response.length() > 0 && response.length() < 200) {
-      Serial0.println("Error response: " + response);
-    }
-    
-    if (responseCode == 401) {
-      Serial0.println("401 Error: API key invalid or insufficient permissions");
-      Serial0.println("Make sure you're using service_role key for write operations");
-    } else if (responseCode == 404) {
-      Serial0.println("404 Error: Table 'workouts' not found or inaccessible");
-    }
-    
     delay(3000);
-    setLEDState(LED_STANDBY);
+    setLEDState(restingLEDState());
   }
-  
-  http.end();
 }
 
-// Расчет калорий на основе MET значений
-float calculateCalories(float avgSpeed, int durationSeconds) {
-  if (durationSeconds <= 0) return 0.0;
-  
-  float hours = durationSeconds / 3600.0;
-  float met = 1.0;
-  
-  // MET значения для разных скоростей (км/ч)
-  if (avgSpeed < 1.0) {
-    met = 2.0; // очень медленная ходьба
-  } else if (avgSpeed < 4.0) {
-    met = 3.5; // медленная ходьба
-  } else if (avgSpeed < 6.0) {
-    met = 4.5; // обычная ходьба
-  } else if (avgSpeed < 8.0) {
-    met = 6.0; // быстрая ходьба
-  } else if (avgSpeed < 10.0) {
-    met = 8.0; // легкий бег
-  } else if (avgSpeed < 12.0) {
-    met = 10.0; // умеренный бег
-  } else {
-    met = 11.5; // быстрый бег
-  }
-  
-  float calories = met * USER_WEIGHT * hours;
-  return calories;
-}
-
-// Функция получения времени в формате ISO 8601
-String getISOTimestamp(time_t timeValue) {
+// Функция получения читаемого времени (для логов; на стеке, без кучи)
+ReadableTime getReadableTime(time_t timeValue) {
   struct tm timeinfo;
   localtime_r(&timeValue, &timeinfo);
   
-  char buffer[30];
-  strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S+03:00", &timeinfo);
-  return String(buffer);
+  ReadableTime result;
+  strftime(result.text, sizeof(result.text), "%d.%m.%y в %H:%M", &timeinfo);
+  return result;
 }
 
-// Функция получения читаемого времени
-String getReadableTime(time_t timeValue) {
-  struct tm timeinfo;
-  localtime_r(&timeValue, &timeinfo);
-  
-  char buffer[25];
-  strftime(buffer, sizeof(buffer), "%d.%m.%y в %H:%M", &timeinfo);
-  return String(buffer);
+// Имя дорожки по номеру; журнал дорожки, убранной из config.h, - под
+// номером в имени, чтобы не приписать тренировку чужой дорожке
+const char* treadmillName(uint8_t device, char* buffer, size_t size) {
+  if (device < TREADMILL_COUNT) return TREADMILLS[device].name;
+  snprintf(buffer, size, "treadmill-%u", (unsigned)device);
+  return buffer;
 }
 
-// Создание JSON с правильной структурой таблицы workouts
-String createOptimizedWorkoutJson(const std::vector<WorkoutRecord>& buffer, time_t startTime, time_t endTime) {
-  if (buffer.empty()) return "{}";
-  
-  WorkoutRecord finalRecord = buffer.back();
-  
-  float maxSpeed = 0.0;
-  float totalSpeed = 0.0;
-  int activeRecords = 0;
-  
-  for (const auto& record : buffer) {
-    if (record.speed > maxSpeed) maxSpeed = record.speed;
-    if (record.speed > 0.1) {
-      totalSpeed += record.speed;
-      activeRecords++;
-    }
+// Ставит тренировку в очередь отправки на флеше. Ключ идемпотентности
+// детерминирован (время старта + MAC + номер дорожки, кроме первой),
+// поэтому повторная постановка той же тренировки после сбоя не создаст
+// вторую строку в таблице, а тренировки, начатые в одну секунду на разных
+// дорожках, не сольются в одну.
+// true - тренировка обработана (в очереди или заведомо некорректна);
+// keyOut получает ключ поставленной строки или пустую строку
+bool queueWorkoutForUpload(const SessionStore& session, uint8_t device, time_t startTime,
+                           time_t endTime, char* keyOut, size_t keySize) {
+  keyOut[0] = '\0';
+  if (session.empty()) {
+    Serial0.println("No workout data to send");
+    return true;
   }
-  
-  float avgSpeed = activeRecords > 0 ? totalSpeed / activeRecords : 0.0;
+
+  if (!WorkoutTracker::isTimeValid(startTime) || !WorkoutTracker::isTimeValid(endTime)) {
+    Serial0.printf("Invalid timestamps - Start: %ld, End: %ld\n", startTime, endTime);
+    return true;
+  }
+
   long duration = endTime - startTime;
+  if (duration < 30 || duration > 86400) {
+    Serial0.printf("Invalid workout duration: %ld seconds\n", duration);
+    return true;
+  }
   
-  // JSON с полной структурой как в таблице (без id и created_at - они автогенерируются)
-  String json;
-  json.reserve(400);
+  // Ключ первой дорожки - прежнего вида: строки, поставленные до
+  // обновления прошивки, не задвоятся
+  char key[40];
+  if (device == 0) {
+    snprintf(key, sizeof(key), "%ld-%s", (long)startTime, deviceId);
+  } else {
+    snprintf(key, sizeof(key), "%ld-%s-%u", (long)startTime, deviceId, (unsigned)device);
+  }
   
-  json = "{\"workout_start\":\"" + getISOTimestamp(startTime) + 
-         "\",\"workout_end\":\"" + getISOTimestamp(endTime) + 
-         "\",\"duration_seconds\":" + String(duration) + 
-         ",\"total_distance\":" + String(finalRecord.distance) + 
-         ",\"max_speed\":" + String(maxSpeed, 1) + 
-         ",\"avg_speed\":" + String(avgSpeed, 1) + 
-         ",\"records_count\":" + String(buffer.size()) + 
-         ",\"device_name\":\"ESP32_S3_Treadmill_Logger\"}";
+  char nameBuffer[16];
+  const char* name = treadmillName(device, nameBuffer, sizeof(nameBuffer));
+  char row[UploadOutbox::MAX_ROW];
+  TRACE_BEGIN("row_json");
+  size_t rowLength = writeWorkoutRow(session, startTime, endTime, key, name, USER_PROFILE,
+                                     gmtOffset_sec, row, sizeof(row));
+  TRACE_END("row_json");
+  
+  Serial0.printf("Queueing workout from %s: %s - %s (Duration: %ld sec)\n",
+                name,
+                getReadableTime(startTime).text,
+                getReadableTime(endTime).text,
+                duration);
+  Serial0.printf("Buffer size: %u records (%u points, level %u)\n",
+                session.sampleCount(), session.size(), session.level());
+  Serial0.printf("Row: %s\n", row);
   
-  return json;
+  if (rowLength == 0 || !outbox.enqueue(key, row, rowLength)) {
+    Serial0.println("✗ Failed to write workout to outbox");
+    return false;
+  }
+  
+  Serial0.printf("✓ Workout %s queued, outbox: %u\n", key, outbox.count());
+  snprintf(keyOut, keySize, "%s", key);
+  return true;
 }
 
-void sendWorkoutToSupabaseFromTask(WorkoutData* data) {
-  if (data->buffer.empty()) {
-    Serial0.println("No workout data to send");
-    setLEDState(LED_ERROR);
-    return;
+// Сводка в архив истории, журнал переносится туда же (из retireJournal).
+// Повтор после сбоя архив только завершает перенос; false - журнал на месте
+bool archiveWorkout(const SessionStore& session, uint8_t device, time_t startTime, time_t endTime,
+                    const char* journalPath) {
+  if (!flashReady || session.empty() || journalPath == nullptr || journalPath[0] == '\0') return false;
+  
+  const WorkoutStats& stats = session.stats();
+  WorkoutHistory::Entry entry = {};
+  entry.id = (uint32_t)startTime;
+  entry.duration = (uint32_t)(endTime - startTime);
+  entry.distance = session.last().distance;
+  entry.maxSpeed = (uint16_t)(stats.maxSpeed() * 100.0f + 0.5f);
+  entry.avgSpeed = (uint16_t)(stats.avgSpeed() * 100.0f + 0.5f);
+  entry.samples = (uint32_t)session.sampleCount();
+  entry.device = device;
+  
+  if (history.append(journalPath, entry)) {
+    Serial0.printf("Workout archived, history: %u\n", history.count());
+    return true;
   }
+  Serial0.println("✗ Failed to archive workout");
+  return false;
+}
 
-  if (!wifiConnected) {
-    Serial0.println("No WiFi - attempting reconnection for workout upload");
-    reconnectWiFi();
-    if (!wifiConnected) {
-      Serial0.println("Still no WiFi - skipping workout upload");
-      setLEDState(LED_WIFI_ERROR);
-      return;
-    }
+bool hasExtension(const char* path, const char* extension) {
+  size_t length = strlen(path);
+  size_t suffix = strlen(extension);
+  return length >= suffix && strcmp(path + length - suffix, extension) == 0;
+}
+
+// Ссылка очереди сэмплов на журнал в архиве: <key>.ref с путём журнала.
+// Пишется через временный файл до переноса журнала, так что сбой между
+// ними не теряет выгрузку. refPath получает путь ссылки
+bool writeSampleReference(const char* key, const char* archivedPath, char* refPath, size_t refSize) {
+  char temp[UploadOutbox::MAX_PATH];
+  snprintf(temp, sizeof(temp), "%s/%s.tmp", SAMPLE_QUEUE_DIR, key);
+  snprintf(refPath, refSize, "%s/%s.ref", SAMPLE_QUEUE_DIR, key);
+  flashFs.remove(temp);
+  if (!flashFs.append(temp, archivedPath, strlen(archivedPath))) {
+    flashFs.remove(temp);
+    return false;
   }
+  flashFs.remove(refPath);
+  return flashFs.rename(temp, refPath);
+}
 
-  if (!isTimeValid(data->startTime) || !isTimeValid(data->endTime)) {
-    Serial0.printf("Invalid timestamps - Start: %ld, End: %ld\n", data->startTime, data->endTime);
-    setLEDState(LED_ERROR);
+// Журнал архива, на который ссылается очередь сэмплов, не вытесняется
+// по бюджету (вызывается под блокировкой архива)
+bool isJournalQueued(const char* journalPath, void* context) {
+  bool queued = false;
+  flashFs.list(SAMPLE_QUEUE_DIR, [&](const char* path) {
+    if (queued || !hasExtension(path, ".ref")) return;
+    char target[WorkoutHistory::MAX_PATH];
+    size_t length = flashFs.read(path, 0, target, sizeof(target) - 1);
+    target[length] = '\0';
+    queued = strcmp(target, journalPath) == 0;
+  });
+  return queued;
+}
+
+// Журнал тренировки, строка которой уже в очереди (key), переносится в
+// архив; сэмплы выгружаются оттуда по ссылке. Не принятый архивом журнал
+// сам ждёт выгрузки в очереди сэмплов либо больше не нужен
+void retireJournal(const SessionStore& session, uint8_t device, time_t startTime, time_t endTime,
+                   const char* journalPath, const char* key) {
+  if (journalPath == nullptr || journalPath[0] == '\0') return;
+  
+  bool samples = UPLOAD_SAMPLES && key[0] != '\0';
+  char reference[UploadOutbox::MAX_PATH] = "";
+  if (samples && flashReady) {
+    char archived[WorkoutHistory::MAX_PATH];
+    history.archivePath((uint32_t)startTime, device, archived, sizeof(archived));
+    if (!writeSampleReference(key, archived, reference, sizeof(reference))) reference[0] = '\0';
+  }
+  
+  if (key[0] != '\0' && archiveWorkout(session, device, startTime, endTime, journalPath)) {
+    if (reference[0] != '\0') {
+      pendingSampleUploads++;
+    } else if (samples) {
+      Serial0.printf("✗ Failed to queue samples of %s\n", key);
+    }
     return;
   }
+  
+  if (reference[0] != '\0') flashFs.remove(reference);
+  if (samples) {
+    char target[UploadOutbox::MAX_PATH];
+    snprintf(target, sizeof(target), "%s/%s.jnl", SAMPLE_QUEUE_DIR, key);
+    if (flashFs.rename(journalPath, target)) {
+      pendingSampleUploads++;
+      return;
+    }
+  }
+  flashFs.remove(journalPath);
+}
 
-  long duration = data->endTime - data->startTime;
-  if (duration < 30 || duration > 86400) {
-    Serial0.printf("Invalid workout duration: %ld seconds\n", duration);
-    setLEDState(LED_ERROR);
-    return;
+// Выгрузка сэмплов одной тренировки. Каждая пачка - отдельный POST с
+// chunked телом; повтор уже принятой пачки сервер проигнорирует по
+// (workout_client_id, sample_index). true - стоит сразу продолжить
+bool drainSampleUploads() {
+  // Счётчик растёт после записи в каталог: если за перебор он не
+  // изменился, пустой каталог значит пустую очередь
+  size_t counted = pendingSampleUploads.load();
+  char path[UploadOutbox::MAX_PATH] = "";
+  flashFs.list(SAMPLE_QUEUE_DIR, [&](const char* candidate) {
+    if (!hasExtension(candidate, ".ref") && !hasExtension(candidate, ".jnl")) return;
+    if (path[0] == '\0' || strcmp(candidate, path) < 0) {
+      snprintf(path, sizeof(path), "%s", candidate);
+    }
+  });
+  if (path[0] == '\0') {
+    pendingSampleUploads.compare_exchange_strong(counted, 0);
+    return false;
   }
   
+  // Ключ тренировки - имя файла без каталога и расширения
+  char key[40];
+  const char* name = strrchr(path, '/');
+  snprintf(key, sizeof(key), "%s", name != nullptr ? name + 1 : path);
+  char* dot = strrchr(key, '.');
+  if (dot != nullptr) *dot = '\0';
+  
+  // Ссылка на журнал в архиве; журнал мог быть вытеснен, если архив
+  // не вмещал даже его одного
+  char journal[WorkoutHistory::MAX_PATH];
+  bool archived = hasExtension(path, ".ref");
+  if (archived) {
+    size_t length = flashFs.read(path, 0, journal, sizeof(journal) - 1);
+    journal[length] = '\0';
+    if (length == 0 || !flashFs.exists(journal)) {
+      Serial0.printf("✗ Samples of %s are no longer on flash - dropped\n", key);
+      flashFs.remove(path);
+      countSampleUploadDone();
+      return pendingSampleUploads > 0;
+    }
+  } else {
+    snprintf(journal, sizeof(journal), "%s", path);
+  }
+  
+  JournalReader reader(flashFs, journal);
+  SampleBatchWriter writer(reader, key, gmtOffset_sec, SAMPLE_UPLOAD_BATCH);
+  uint32_t heapLow = ESP.getFreeHeap();
+  int httpResponse = 200;
+  String response = "";
+  
   setLEDState(LED_SENDING);
+  while (writer.available()) {
+    // Начало пачки: повтор на новом соединении отправляет её заново
+    writer.beginBatch();
+    
+    httpResponse = supabase.postStream(
+      "/rest/v1/workout_samples?on_conflict=workout_client_id,sample_index",
+      "return=minimal,resolution=ignore-duplicates",
+      [&](uint8_t* buffer, size_t size) {
+        size_t length = writer.produce(buffer, size);
+        uint32_t heap = ESP.getFreeHeap();
+        if (heap < heapLow) heapLow = heap;
+        return length;
+      },
+      [&]() { return writer.rewind(); },
+      &response, 512);
+    recordUpload(httpResponse);
+    
+    if (httpResponse != 200 && httpResponse != 201) break;
+    Serial0.printf("Samples %u-%u of %s sent\n", writer.batchStart(), writer.index() - 1, key);
+  }
   
-  Serial0.printf("Sending workout: %s - %s (Duration: %ld sec)\n",
-                getReadableTime(data->startTime).c_str(),
-                getReadableTime(data->endTime).c_str(),
-                duration);
-  Serial0.printf("Buffer size: %d records\n", data->buffer.size());
+  if (httpResponse == 200 || httpResponse == 201) {
+    Serial0.printf("✓ %u samples of %s sent, lowest free heap: %u\n", writer.index(), key, heapLow);
+    // Ссылка удаляется, журнал остаётся в архиве до вытеснения
+    flashFs.remove(path);
+    if (archived) history.trim();
+    countSampleUploadDone();
+    uploadBackoff.reset();
+    setLEDState(restingLEDState());
+    return pendingSampleUploads > 0;
+  }
   
-  HTTPClient http;
-  String fullUrl = String(SUPABASE_URL) + "/rest/v1/workouts";
-  http.begin(fullUrl);
-
-  http.setTimeout(10000);
-  http.setConnectTimeout(5000);
-  http.setReuse(false);
-  delay(10);
+  // Колонки нет, пока не выполнена миграция: сэмплы ждут её в очереди
+  if (isSchemaError(httpResponse, response.c_str())) {
+    Serial0.printf("✗ workout_samples is missing a column - samples of %s kept: %s\n",
+                   key, response.c_str());
+    Serial0.printf("Expected columns: %s\n", SAMPLE_COLUMNS);
+    setLEDState(LED_ERROR);
+    scheduleUploadRetry("schema migration needed");
+    delay(2000);
+    setLEDState(restingLEDState());
+    return false;
+  }
   
-  // Правильные заголовки для Supabase REST API
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("apikey", SUPABASE_KEY);  // apikey заголовок НУЖЕН
-  http.addHeader("Authorization", String("Bearer ") + SUPABASE_KEY);
-  http.addHeader("Prefer", "return=minimal");
+  if (isPermanentUploadError(httpResponse, response.c_str())) {
+    Serial0.printf("✗ Samples of %s rejected with %d - dropped\n", key, httpResponse);
+    flashFs.remove(path);
+    if (archived) history.trim();
+    countSampleUploadDone();
+    setLEDState(LED_ERROR);
+    delay(2000);
+    setLEDState(restingLEDState());
+    return pendingSampleUploads > 0;
+  }
   
-  // Создаем JSON с правильной структурой
-  String jsonPayload = createOptimizedWorkoutJson(data->buffer, data->startTime, data->endTime);
+  Serial0.printf("✗ Sample upload failed. Code: %d\n", httpResponse);
+  setLEDState(LED_ERROR);
+  scheduleUploadRetry("sample upload error");
+  delay(2000);
+  setLEDState(restingLEDState());
+  return false;
+}
+
+// Отправка пачки строк одним запросом PostgREST (массив = bulk insert).
+// on_conflict + ignore-duplicates делают повтор уже принятой строки безвредным.
+// Возвращает HTTP код или ошибку HTTPClient (<= 0); response - тело ответа
+int postWorkoutBatch(const char* body, size_t length, size_t rows, String& response) {
+  const char* path = "/rest/v1/workouts?on_conflict=client_id";
   
   Serial0.println("=== SUPABASE REQUEST DEBUG ===");
-  Serial0.println("URL: " + fullUrl);
-  Serial0.printf("Using API key: %.30s...\n", SUPABASE_KEY);
-  Serial0.printf("JSON size: %d bytes\n", jsonPayload.length());
-  Serial0.println("JSON payload: " + jsonPayload);
-  Serial0.println("Expected fields: workout_start, workout_end, duration_seconds, total_distance, max_speed, avg_speed, records_count, device_name");
+  Serial0.printf("URL: %s%s\n", SUPABASE_URL, path);
+  Serial0.printf("Rows: %u, JSON size: %u bytes\n", rows, length);
   Serial0.println("===============================");
 
-  int httpResponse = -1;
-  int attempts = 0;
-  const int maxAttempts = 3;
-
-  while (httpResponse <= 0 && attempts < maxAttempts) {
-    attempts++;
-    Serial0.printf("Attempt %d/%d...\n", attempts, maxAttempts);
-    
-    httpResponse = http.POST(jsonPayload);
-    
-    if (httpResponse <= 0) {
-      Serial0.printf("HTTP error on attempt %d: %d\n", attempts, httpResponse);
-      if (attempts < maxAttempts) {
-        delay(2000 * attempts);
-      }
-    }
-  }
+  response = "";
+  int httpResponse = supabase.post(path, "return=minimal,resolution=ignore-duplicates",
+                                   body, length, &response, 2000);
+  recordUpload(httpResponse);
   
-  String response = "";
   if (httpResponse > 0) {
-    if (http.getSize() > 0 && http.getSize() < 2000) {
-      response = http.getString();
-    }
     
     Serial0.printf("=== SUPABASE RESPONSE ===\n");
     Serial0.printf("Response code: %d\n", httpResponse);
@@ -641,44 +883,28 @@ void sendWorkoutToSupabaseFromTask(WorkoutData* data) {
     }
     Serial0.println("========================\n");
     
-    if (httpResponse == 200 || httpResponse == 201) {
-      Serial0.println("✓ Workout sent successfully!");
-      setLEDState(LED_SUCCESS);
-      delay(1000);
-      setLEDState(LED_STANDBY);
-    } else {
-      Serial0.printf("✗ HTTP error. Code: %d\n", httpResponse);
-      setLEDState(LED_ERROR);
+    // Детальная диагностика для 400 ошибки
+    if (httpResponse == 400) {
+      Serial0.println("400 Bad Request analysis:");
+      Serial0.printf("- Required fields: %s\n", WORKOUT_COLUMNS);
+      Serial0.println("- client_id needs a UNIQUE constraint for on_conflict");
       
-      // Детальная диагностика для 400 ошибки
-      if (httpResponse == 400) {
-        Serial0.println("400 Bad Request analysis:");
-        Serial0.println("- Checking JSON structure matches table schema");
-        Serial0.println("- Required fields: workout_start, workout_end, duration_seconds, total_distance, max_speed, avg_speed, records_count, device_name");
-        Serial0.println("- Auto fields (excluded): id, created_at");
-        
-        if (response.indexOf("duplicate") >= 0) {
-          Serial0.println("- Possible duplicate key violation");
-        }
-        if (response.indexOf("constraint") >= 0) {
-          Serial0.println("- Database constraint violation");
-        }
-        if (response.indexOf("permission") >= 0 || response.indexOf("policy") >= 0) {
-          Serial0.println("- Permission/RLS policy issue - check service_role key");
-        }
-      } else if (httpResponse == 401) {
-        Serial0.println("401 Unauthorized - Check API key permissions");
-      } else if (httpResponse == 403) {
-        Serial0.println("403 Forbidden - Check RLS policies for INSERT operation");
+      if (isSchemaError(httpResponse, response.c_str())) {
+        Serial0.println("- Missing column: run the schema migration, rows stay queued until then");
       }
       
-      delay(2000);
-      setLEDState(LED_STANDBY);
+      if (response.indexOf("constraint") >= 0) {
+        Serial0.println("- Database constraint violation");
+      }
+      if (response.indexOf("permission") >= 0 || response.indexOf("policy") >= 0) {
+        Serial0.println("- Permission/RLS policy issue - check service_role key");
+      }
+    } else if (httpResponse == 401) {
+      Serial0.println("401 Unauthorized - Check API key permissions");
+    } else if (httpResponse == 403) {
+      Serial0.println("403 Forbidden - Check RLS policies for INSERT operation");
     }
   } else {
-    Serial0.printf("✗ Connection failed. Error code: %d\n", httpResponse);
-    setLEDState(LED_ERROR);
-    
     // Диагностика сетевых ошибок
     switch (httpResponse) {
       case HTTPC_ERROR_CONNECTION_REFUSED:
@@ -702,294 +928,946 @@ void sendWorkoutToSupabaseFromTask(WorkoutData* data) {
       default:
         Serial0.printf("Error: Network error code %d\n", httpResponse);
     }
-    
-    delay(2000);
-    setLEDState(LED_STANDBY);
   }
 
-  http.end();
+  SupabaseClient::Stats stats = supabase.stats();
+  Serial0.printf("HTTPS stats: %u requests, %u TLS handshakes, %u reused, avg %u ms, max %u ms\n",
+                 stats.requests, stats.handshakes, stats.reused,
+                 stats.requests > 0 ? stats.totalLatencyMs / stats.requests : 0,
+                 stats.maxLatencyMs);
+  return httpResponse;
 }
 
-// HTTP задача
-void httpTask(void* parameter) {
-  WorkoutData* data = nullptr;
-  
-  Serial0.println("HTTP Task started");
+// Итог запроса к Supabase для /metrics: код ответа и время запроса
+void recordUpload(int httpCode) {
+  uploadResults.add(httpCode);
+  uploadLatency.observe(supabase.stats().lastLatencyMs);
+}
+
+void scheduleUploadRetry(const char* reason) {
+  uint32_t wait = uploadBackoff.nextDelay(esp_random());
+  nextUploadAttempt = millis() + wait;
+  Serial0.printf("Upload deferred (%s): retry #%u in %u s, outbox: %u\n",
+                 reason, uploadBackoff.failures(), wait / 1000, outbox.count());
+}
+
+// Пачки очереди уходят через SupabaseClient
+class SupabasePoster : public UploadPoster {
+public:
+  int postBatch(const char* body, size_t length, size_t rows,
+                char* response, size_t responseSize) override {
+    String text;
+    int httpResponse = postWorkoutBatch(body, length, rows, text);
+    snprintf(response, responseSize, "%s", text.c_str());
+    return httpResponse;
+  }
+};
+SupabasePoster supabasePoster;
+OutboxDrain outboxDrain(outbox, supabasePoster, UPLOAD_BATCH_SIZE);
+
+// Одна попытка отправки из очереди. true - стоит сразу продолжить
+bool drainOutbox() {
+  size_t quarantined = outboxDrain.quarantined();
+  setLEDState(LED_SENDING);
+  OutboxDrain::Result result = outboxDrain.step();
+  if (outboxDrain.quarantined() > quarantined && result != OutboxDrain::REJECTED) {
+    Serial0.printf("Unreadable outbox entries moved aside: %u\n",
+                   (unsigned)(outboxDrain.quarantined() - quarantined));
+  }
   
-  while (true) {
-    if (xQueueReceive(workoutQueue, &data, pdMS_TO_TICKS(30000))) {
-      Serial0.println("Processing workout data...");
+  switch (result) {
+    case OutboxDrain::EMPTY:
+      setLEDState(restingLEDState());
+      return false;
+      
+    case OutboxDrain::SENT:
+      Serial0.printf("✓ %u workout(s) sent, outbox: %u\n", outboxDrain.rows(), outbox.count());
+      uploadBackoff.reset();
+      setLEDState(LED_SUCCESS);
+      delay(1000);
+      setLEDState(restingLEDState());
+      return outbox.count() > 0;
       
-      Serial0.printf("Free heap before HTTP: %d bytes\n", ESP.getFreeHeap());
+    case OutboxDrain::SPLIT:
+      Serial0.println("Batch rejected - retrying rows one by one");
+      return true;
       
-      sendWorkoutToSupabaseFromTask(data);
+    case OutboxDrain::REJECTED:
+      Serial0.printf("✗ Row rejected with %d - moved aside\n", outboxDrain.code());
+      setLEDState(LED_ERROR);
+      delay(2000);
+      setLEDState(restingLEDState());
+      return outbox.count() > 0;
       
-      delete data;
-      data = nullptr;
+    case OutboxDrain::SCHEMA_ERROR:
+      // Колонки нет, пока не выполнена миграция: строки ждут её в очереди
+      Serial0.printf("✗ workouts is missing a column - %u row(s) kept, outbox: %u\n",
+                     outboxDrain.rows(), outbox.count());
+      setLEDState(LED_ERROR);
+      scheduleUploadRetry("schema migration needed");
+      delay(2000);
+      setLEDState(restingLEDState());
+      return false;
       
-      Serial0.printf("Free heap after HTTP: %d bytes\n", ESP.getFreeHeap());
-    } else {
-      // Queue timeout - check if LED is stuck in SENDING state
+    case OutboxDrain::FAILED:
+      break;
+  }
+  
+  Serial0.printf("✗ Upload failed. Code: %d\n", outboxDrain.code());
+  setLEDState(LED_ERROR);
+  scheduleUploadRetry("server or network error");
+  delay(2000);
+  setLEDState(restingLEDState());
+  return false;
+}
+
+// HTTP задача: разбирает очередь на флеше, пока она не опустеет
+void httpTask(void* parameter) {
+  Serial0.println("HTTP Task started");
+  TickType_t wait = pdMS_TO_TICKS(30000);
+  
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, wait);
+    wait = pdMS_TO_TICKS(30000);
+    
+    // Проверка Supabase при первом подключении к сети
+    static bool connectionTested = false;
+    if (!connectionTested && wifiManager.isUp()) {
+      connectionTested = true;
+      testSupabaseConnection();
+    }
+    
+    if (outbox.count() == 0 && pendingSampleUploads == 0) {
+      // Очередь пуста: TLS буферы не держим дольше минуты
+      supabase.closeIfIdle(SUPABASE_IDLE_CLOSE);
+      
+      // Check if LED is stuck in SENDING state
       if (currentLEDState == LED_SENDING) {
-        Serial0.println(">>> Queue timeout detected - resetting LED to STANDBY");
-        setLEDState(LED_STANDBY);
+        Serial0.println(">>> Outbox empty - resetting LED to STANDBY");
+        setLEDState(restingLEDState());
       }
+      continue;
+    }
+    
+    long remaining = (long)(nextUploadAttempt - millis());
+    if (remaining > 0) {
+      wait = pdMS_TO_TICKS(remaining);
+      continue;
+    }
+    
+    if (!wifiManager.isUp()) {
+      // Переподключается wifiManager; здесь только ждём сеть
+      Serial0.println("No WiFi - upload waits for connection");
+      xEventGroupWaitBits(networkEvents, NETWORK_UP_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(60000));
+      continue;
     }
     
-    vTaskDelay(pdMS_TO_TICKS(100));
+    if (ESP.getFreeHeap() < MIN_MEMORY_FOR_HTTP) {
+      Serial0.printf("Low memory for HTTP. Free: %d, Required: %d\n",
+                    ESP.getFreeHeap(), MIN_MEMORY_FOR_HTTP);
+      scheduleUploadRetry("low memory");
+      continue;
+    }
+    
+    Serial0.printf("Free heap before HTTP: %d bytes\n", ESP.getFreeHeap());
+    // Сначала строки workouts, на которые ссылаются сэмплы
+    bool more = outbox.count() > 0 ? drainOutbox() : drainSampleUploads();
+    if (!more && outbox.count() == 0 && pendingSampleUploads > 0 &&
+        (long)(nextUploadAttempt - millis()) <= 0) {
+      more = true;
+    }
+    Serial0.printf("Free heap after HTTP: %d bytes\n", ESP.getFreeHeap());
+    
+    if (more) wait = pdMS_TO_TICKS(100);
   }
 }
 
-// Безопасная отправка в Supabase через очередь
-void sendWorkoutToSupabase() {
-  if (workoutBuffer.empty()) {
-    Serial0.println("No workout data to send");
-    return;
+// Разбудить задачу отправки немедленно (новая строка, вернулась сеть)
+void kickUploadTask(bool resetBackoff) {
+  if (resetBackoff) {
+    uploadBackoff.reset();
+    nextUploadAttempt = millis();
   }
-  
-  const int MIN_MEMORY_FOR_HTTP = 20000;
-  if (ESP.getFreeHeap() < MIN_MEMORY_FOR_HTTP) {
-    Serial0.printf("Low memory for HTTP - skipping. Free: %d, Required: %d\n",
-                  ESP.getFreeHeap(), MIN_MEMORY_FOR_HTTP);
-    setLEDState(LED_ERROR);
-    delay(3000);
-    setLEDState(LED_STANDBY);
+  if (httpTaskHandle != nullptr) {
+    xTaskNotifyGive(httpTaskHandle);
+  }
+}
+
+// Завершённая тренировка: строка в очередь на флеше, журнал - в очередь
+// сэмплов (или удаляется). Из задачи лога (persistFinishedWorkouts)
+void sendWorkoutToSupabase(const SessionStore& buffer, uint8_t device, const char* journalPath,
+                           time_t startTime, time_t endTime) {
+  if (buffer.empty()) {
+    Serial0.println("No workout data to send");
     return;
   }
 
-  Serial0.printf("Memory check OK: %d bytes free\n", ESP.getFreeHeap());
   Serial0.println(">>> PREPARING TO SEND TO SUPABASE!");
   setLEDState(LED_SENDING);
   
-  WorkoutData* data = new WorkoutData();
-  data->buffer = workoutBuffer;
-  data->startTime = workoutStartTime;
-  data->endTime = workoutEndTime;
-  
-  if (xQueueSend(workoutQueue, &data, pdMS_TO_TICKS(100)) == pdTRUE) {
-    workoutBuffer.clear();
+  char key[40];
+  if (queueWorkoutForUpload(buffer, device, startTime, endTime, key, sizeof(key))) {
+    retireJournal(buffer, device, startTime, endTime, journalPath, key);
     Serial0.println(">>> Workout queued for sending");
+    kickUploadTask(false);
   } else {
-    delete data;
-    Serial0.println(">>> Failed to queue workout - queue full");
+    // Журнал остаётся в /journal/pending и подхватится при загрузке;
+    // красный горит до следующей смены состояния
+    Serial0.println(">>> Failed to queue workout - kept in journal");
     setLEDState(LED_ERROR);
-    delay(2000);
-    setLEDState(LED_STANDBY);
   }
 }
 
-void updateWorkoutState(const WorkoutRecord& record) {
-  previousState = currentState;
-  
-  // Понижены пороги активности для обнаружения медленной ходьбы
-  bool isCurrentlyActive = (record.speed >= MIN_WORKOUT_SPEED && record.time > 0);
+// Слоты, отданные задачей обработки: запись на флеш и освобождение слота
+void persistFinishedWorkouts() {
+  for (size_t i = 0; i < FINISHED_SLOTS; i++) {
+    FinishedWorkout& finished = finishedWorkouts[i];
+    if (!finished.ready.load(std::memory_order_acquire)) continue;
+    sendWorkoutToSupabase(finished.buffer, finished.device, finished.journalPath,
+                          finished.startTime, finished.endTime);
+    finished.buffer.clear();
+    finished.ready.store(false, std::memory_order_release);
+  }
+}
 
-  if (isCurrentlyActive) {
-    lastActiveTime = millis();
-    if (currentState == STANDBY && (millis() - workoutEndTime_millis > WORKOUT_COOLDOWN)) {
-      currentState = ACTIVE;
-      setLEDState(LED_ACTIVE);
-      
-      time_t currentTime = time(nullptr);
-      
-      if (isTimeValid(currentTime)) {
-        workoutStartTime = currentTime;
-        actualWorkoutStartTime = millis();
-        Serial0.println(">>> WORKOUT START DELAY: 5 seconds before counting");
-        Serial0.printf(">>> WORKOUT STARTED at %s! Speed: %.1f km/h\n",
-                       getReadableTime(workoutStartTime).c_str(), record.speed);
-      } else {
-        Serial0.printf(">>> WARNING: Invalid time detected (%ld), waiting for sync...\n", currentTime);
-        currentState = STANDBY;
-        setLEDState(LED_STANDBY);
-        return;
-      }
-      
-      totalDistance = 0.0;
-      sessionStartTime = millis();
-      lastTimeUpdate = millis();
-    }
-  } else {
-    unsigned long inactiveTime = millis() - lastActiveTime;
-    
-    if (currentState == ACTIVE && record.speed < 0.1 && inactiveTime > 15000) {
-      Serial0.printf(">>> Ending workout due to zero speed for 15+ seconds\n");
-      
-      time_t currentTime = time(nullptr);
-      
-      if (isTimeValid(currentTime) && isTimeValid(workoutStartTime)) {
-        workoutEndTime = currentTime;
-        
-        long duration = workoutEndTime - workoutStartTime;
-        if (duration < 30 || duration > 86400) {
-          Serial0.printf(">>> WARNING: Invalid workout duration (%ld sec), skipping save\n", duration);
-          currentState = STANDBY;
-          setLEDState(LED_STANDBY);
-          workoutBuffer.clear();
-          totalDistance = 0.0;
-          return;
-        }
-        
-        currentState = WORKOUT_ENDED;
-        workoutEndTime_millis = millis();
-        Serial0.printf(">>> WORKOUT ENDED at %s! Duration: %ld seconds\n",
-                       getReadableTime(workoutEndTime).c_str(), duration);
-      } else {
-        Serial0.printf(">>> WARNING: Invalid time for workout end, discarding workout\n");
-        currentState = STANDBY;
-        setLEDState(LED_STANDBY);
-        workoutBuffer.clear();
-        totalDistance = 0.0;
-        return;
-      }
-    }
+void SessionEvents::onWorkoutStart(TreadmillSession& session, time_t startTime) {
+  activeWorkouts.fetch_add(1, std::memory_order_relaxed);
+  setLEDState(LED_ACTIVE);
+  LOG_INFO(">>> WORKOUT START DELAY: 5 seconds before counting\n");
+  LOG_INFO(">>> WORKOUT STARTED on %s at %s! Speed: %.1f km/h\n",
+           session.name(), getReadableTime(startTime).text, session.tracker().record().speed);
+}
+
+void SessionEvents::onSample(TreadmillSession& session, const WorkoutRecord& record) {
+  const SessionStore& buffer = session.buffer();
+  LOG_DEBUG("Buffer %u: %u (%u points, level %u), Free RAM: %d\n",
+            (unsigned)session.index(), buffer.sampleCount(), buffer.size(), buffer.level(),
+            ESP.getFreeHeap());
+}
+
+void SessionEvents::onWorkoutEnd(TreadmillSession& session, time_t startTime, time_t endTime,
+                                 const char* journalPath) {
+  activeWorkouts.fetch_sub(1, std::memory_order_relaxed);
+  LOG_INFO(">>> WORKOUT ENDED on %s at %s! Duration: %ld seconds\n",
+           session.name(), getReadableTime(endTime).text, (long)(endTime - startTime));
+  LOG_INFO(">>> Starting workout upload process...\n");
+  setLEDState(LED_SENDING);
+  
+  if (flashReady && journalPath[0] == '\0') {
+    LOG_WARN(">>> WARNING: Failed to close workout journal\n");
+  }
+  uint32_t dropped = session.journal().sessionDroppedSamples();
+  if (dropped > 0) {
+    LOG_WARN(">>> WARNING: Journal full, last %u samples kept only in RAM\n", (unsigned)dropped);
   }
   
-  if (previousState == ACTIVE && currentState == WORKOUT_ENDED) {
-    Serial0.println(">>> Starting workout upload process...");
-    setLEDState(LED_SENDING);
-    Serial0.println(">>> LED set to SENDING state");
-    sendWorkoutToSupabase();
-    Serial0.println(">>> sendWorkoutToSupabase() completed");
-    currentState = STANDBY;
-    Serial0.println(">>> State changed to STANDBY");
+  // Буфер уходит в свободный слот за O(1), сессия получает пустой
+  // запасной; на флеш тренировку пишет задача лога
+  for (size_t i = 0; i < FINISHED_SLOTS; i++) {
+    FinishedWorkout& finished = finishedWorkouts[i];
+    if (finished.ready.load(std::memory_order_acquire) || finished.buffer.capacity() == 0) continue;
+    std::swap(finished.buffer, session.buffer());
+    finished.device = session.index();
+    finished.startTime = startTime;
+    finished.endTime = endTime;
+    snprintf(finished.journalPath, sizeof(finished.journalPath), "%s", journalPath);
+    finished.ready.store(true, std::memory_order_release);
+    LOG_INFO(">>> Workout handed over for queueing\n");
+    return;
   }
+  
+  // Все слоты ещё заняты: журнал остаётся в /journal/pending и
+  // подхватится при загрузке
+  LOG_WARN(">>> WARNING: No free slot for finished workout on %s - kept in journal\n", session.name());
+  setLEDState(LED_ERROR);
+}
+
+void SessionEvents::onWorkoutDiscard(TreadmillSession& session, const char* reason) {
+  activeWorkouts.fetch_sub(1, std::memory_order_relaxed);
+  LOG_WARN(">>> Workout on %s discarded: %s\n", session.name(), reason);
+  setLEDState(restingLEDState());
+}
+
+const char* stateName(WorkoutState state) {
+  return state == STANDBY ? "STANDBY" : (state == ACTIVE ? "ACTIVE" : "ENDED");
 }
 
-void addToBuffer(const WorkoutRecord& record) {
-  static WorkoutRecord lastRecord = {0};
+// BLE callback: только метка времени и копия кадра в очередь дорожки
+// (context - её TreadmillSession). Вся обработка (состояние, буфер,
+// Serial) - в processingTask.
+void treadmillDataCallback(const uint8_t* data, size_t length, void* context) {
+  TRACE_SCOPE("ble_notify");
+  uint32_t startCycles = ESP.getCycleCount();
+  TreadmillSession* session = (TreadmillSession*)context;
+  bleNotifications.add();
+  
+  if (session->frames().push(data, length, esp_timer_get_time()) && processingTaskHandle != nullptr) {
+    xTaskNotifyGive(processingTaskHandle);
+  }
   
-  if (!isTimeValid(record.timestamp)) {
-    Serial0.printf("Skipping record with invalid timestamp: %ld\n", record.timestamp);
-    return;
+  BleLink& link = session->link();
+  if (link.onNotify(millis())) {
+    bleFirstSample.observe(link.firstSampleMs());
+    bleLastOutage.store(link.outageMs(), std::memory_order_relaxed);
+    // Связь восстановлена: в /data сменится "connected"
+    telemetryVersion.fetch_add(1, std::memory_order_release);
+    LOG_INFO("BLE %s: first sample %u ms after connect attempt, %u ms after link loss\n",
+             session->name(), link.firstSampleMs(), link.outageMs());
   }
   
-  bool shouldAdd = (record.distance != lastRecord.distance ||
-                   record.speed != lastRecord.speed ||
-                   record.time != lastRecord.time);
+  // Такты одного ядра: callback не переезжает между ядрами посреди вызова
+  bleCallbackCycles.observe(ESP.getCycleCount() - startCycles);
+}
+
+// BLE callback ремня (context - TreadmillSession его дорожки). Из кадра
+// нужны флаги и пульс: RR-интервалы в хвосте длинного кадра отбрасываются
+void heartRateCallback(const uint8_t* data, size_t length, void* context) {
+  TreadmillSession* session = (TreadmillSession*)context;
+  if (length > FTMS_MAX_FRAME) length = FTMS_MAX_FRAME;
+  
+  if (session->heartRateFrames().push(data, length, esp_timer_get_time()) &&
+      processingTaskHandle != nullptr) {
+    xTaskNotifyGive(processingTaskHandle);
+  }
   
-  if (shouldAdd && currentState == ACTIVE && (millis() - actualWorkoutStartTime > workoutStartDelay)) {
-    if (workoutBuffer.size() >= MAX_BUFFER_SIZE) {
-      workoutBuffer.erase(workoutBuffer.begin());
+  BleLink* strap = session->strap();
+  if (strap->onNotify(millis())) {
+    LOG_INFO("Heart rate strap of %s: first sample %u ms after connect attempt\n",
+             session->name(), strap->firstSampleMs());
+  }
+}
+
+// Кадр одной дорожки; состояние вывода - своё у каждой
+void processFrame(TreadmillSession& session, const RawFrame& frame) {
+  TRACE_SCOPE("process_frame");
+  const uint8_t* pData = frame.data;
+  size_t length = frame.length;
+  uint8_t device = session.index();
+  uint32_t frameMs = (uint32_t)(frame.timestampUs / 1000);
+  notifyLatency.observe((uint32_t)(esp_timer_get_time() - frame.timestampUs));
+  
+  // Выводим RAW DATA только при изменении данных (формат читает симулятор, sim/)
+  static uint8_t lastData[TREADMILL_COUNT][FTMS_MAX_FRAME];
+  static size_t lastLength[TREADMILL_COUNT] = {};
+  if (RAW && (length != lastLength[device] || memcmp(pData, lastData[device], length) != 0)) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    char hex[FTMS_MAX_FRAME * 3 + 1];
+    for (size_t i = 0; i < length; i++) {
+      hex[i * 3] = HEX_DIGITS[pData[i] >> 4];
+      hex[i * 3 + 1] = HEX_DIGITS[pData[i] & 0x0F];
+      hex[i * 3 + 2] = ' ';
+    }
+    hex[length * 3] = '\0';
+    if (TREADMILL_COUNT > 1) {
+      LOG_INFO("RAW DATA %u: %s\n", (unsigned)device, hex);
+    } else {
+      LOG_INFO("RAW DATA: %s\n", hex);
     }
     
-    workoutBuffer.push_back(record);
-    lastRecord = record;
+    memcpy(lastData[device], pData, length);
+    lastLength[device] = length;
+  }
+  
+  // Все кадры, не только изменившиеся: симулятору важны интервалы
+  if (device == captureDevice.load(std::memory_order_relaxed)) {
+    capture.record(frame.timestampUs, pData, length, frameMs);
+  }
+  
+  WorkoutTracker& tracker = session.tracker();
+  if (!tracker.onFrame(pData, length, frameMs, time(nullptr))) return;
+  const TreadmillData& ftms = tracker.ftms();
+  const WorkoutRecord& newRecord = tracker.record();
+  WorkoutState state = tracker.state();
+  
+  if (RAW) {
+    LOG_INFO("Analysis: Present=0x%04X, Speed=%u, Distance=%u, Incline=%d, HR=%u, Time=%u\n",
+             ftms.present, ftms.speed, ftms.totalDistance,
+             ftms.inclination, ftms.heartRate, ftms.elapsedTime);
+  }
+  
+  // Данные для веб-интерфейса - на каждом кадре; тело /data и рассылку
+  // клиентам прореживают refreshDataBody() и pushLiveTelemetry()
+  TelemetrySnapshot snapshot;
+  snapshot.speed = newRecord.speed;
+  snapshot.distance = newRecord.distance;
+  snapshot.time = newRecord.time;
+  snapshot.state = stateName(state);
+  snapshot.duration = (state == ACTIVE && tracker.startTime() > 0)
+                      ? (int32_t)(time(nullptr) - tracker.startTime()) : 0;
+  // Ремень на связи - его последний отсчёт, иначе пульс от дорожки
+  BleLink* strap = session.strap();
+  snapshot.heartRate = (strap != nullptr && strap->isUp() && session.heartRate().heartRate() != 0)
+                       ? session.heartRate().heartRate() : newRecord.heartRate;
+  const WorkoutStats& stats = session.buffer().stats();
+  size_t splits = stats.storedSplits(WorkoutStats::KILOMETER);
+  snapshot.avgSpeed = stats.avgSpeed();
+  snapshot.movingTime = stats.movingSeconds();
+  snapshot.calories = (uint32_t)(stats.calories(USER_PROFILE) + 0.5f);
+  snapshot.elevationGain = stats.elevationGain();
+  snapshot.lastSplit = splits > 0 ? (uint32_t)(stats.split(WorkoutStats::KILOMETER, splits - 1) + 0.5f) : 0;
+  publishTelemetry(device, snapshot);
+  
+  // Выводим основную информацию
+  static WorkoutRecord lastDisplayed[TREADMILL_COUNT] = {};
+  static bool wasActive[TREADMILL_COUNT] = {};
+  bool isActive = (newRecord.speed >= WorkoutTracker::MIN_ACTIVITY_SPEED);
+  
+  if ((isActive != wasActive[device]) ||
+      (isActive && (newRecord.speed != lastDisplayed[device].speed ||
+                    newRecord.distance != lastDisplayed[device].distance)) ||
+      state != tracker.previousState()) {
     
-    Serial0.printf("Buffer: %d, State: %s, Free RAM: %d\n", 
-                  workoutBuffer.size(), 
-                  currentState == STANDBY ? "STANDBY" : 
-                  currentState == ACTIVE ? "ACTIVE" : "ENDED",
-                  ESP.getFreeHeap());
+    LOG_INFO("STATE %s: %s, Speed: %.1f km/h, Total Distance: %d m, Time: %d s\n",
+             session.name(), stateName(state), newRecord.speed, newRecord.distance, newRecord.time);
+    
+    lastDisplayed[device] = newRecord;
+    wasActive[device] = isActive;
   }
 }
 
-void treadmillDataCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
-  if (length < 8) return;
+// Восстановление после перезагрузки: прерванные сессии дорожек
+// закрываются, все неотправленные тренировки из журналов переносятся в
+// очередь отправки. Дорожка тренировки - по имени журнала
+void recoverJournal() {
+  char path[48];
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    if (sessions[i]->journal().recoverActive(path, sizeof(path))) {
+      Serial0.printf("Recovered interrupted workout of %s into %s\n", sessions[i]->name(), path);
+    }
+  }
   
-  static std::vector<uint8_t> lastData;
-  std::vector<uint8_t> currentDataVec(pData, pData + length);
+  flashFs.list(WorkoutJournal::PENDING_DIR, [](const char* pendingPath) {
+    SessionStore session;
+    if (!session.begin(sessionCapacity)) return;
+    
+    uint8_t device = WorkoutJournal::deviceOf(pendingPath);
+    WorkoutJournal::Info info = WorkoutJournal::replay(flashFs, pendingPath, &session);
+    Serial0.printf("Recovering workout from %s: %u samples%s\n",
+                   pendingPath, info.samples, info.torn ? " (torn tail skipped)" : "");
+    
+    char key[40] = "";
+    if (!info.valid || info.samples == 0) {
+      flashFs.remove(pendingPath);
+    } else if (queueWorkoutForUpload(session, device, info.startTime, info.endTime, key, sizeof(key))) {
+      retireJournal(session, device, info.startTime, info.endTime, pendingPath, key);
+    }
+  });
   
-  // Выводим RAW DATA только при изменении данных
-  if (RAW && currentDataVec != lastData) {
-    Serial0.print("RAW DATA: ");
-    for (size_t i = 0; i < length; i++) {
-      Serial0.printf("%02X ", pData[i]);
+  // Повтор после сбоя переписывает ту же ссылку: считаем по каталогу
+  pendingSampleUploads = 0;
+  flashFs.list(SAMPLE_QUEUE_DIR, [](const char* samplePath) {
+    if (hasExtension(samplePath, ".ref") || hasExtension(samplePath, ".jnl")) {
+      pendingSampleUploads++;
+    } else {
+      flashFs.remove(samplePath);   // недописанная ссылка
+    }
+  });
+}
+
+// Страница /api/workouts: сводки копируются из индекса сразу (не больше
+// HISTORY_PAGE_MAX), в сокет уходят по строке
+class HistoryPageStream : public RowStream<320> {
+public:
+  HistoryPageStream() : found(0), shown(0), next(0), stage(0) {}
+  
+  WorkoutHistory::Entry entries[HISTORY_PAGE_MAX + 1];
+  size_t found;     // прочитано из индекса (лишняя - признак следующей страницы)
+  size_t shown;     // сколько отдавать
+  uint32_t next;    // курсор следующей страницы, 0 - последняя
+  
+protected:
+  size_t nextRow(char* out, size_t size) override {
+    // Скобки и запятые между записями - вручную: каждая строка
+    // пишется отдельным JsonWriter
+    if (stage == 0) {
+      stage++;
+      return snprintf(out, size, "{\"workouts\":[");
+    }
+    if (stage > shown + 1) return 0;
+    if (stage == shown + 1) {
+      stage++;
+      if (next == 0) return snprintf(out, size, "],\"next_cursor\":null}");
+      return snprintf(out, size, "],\"next_cursor\":%lu}", (unsigned long)next);
     }
-    Serial0.println();
     
-    Serial0.printf("Analysis: Flags=0x%04X, Speed=0x%04X (%d), Distance=0x%06X, Time=0x%04X (%d)\n",
-                  pData[0] | (pData[1] << 8),
-                  pData[2] | (pData[3] << 8), pData[2] | (pData[3] << 8),
-                  length >= 7 ? (pData[4] | (pData[5] << 8) | (pData[6] << 16)) : 0,
-                  length >= 18 ? (pData[16] | (pData[17] << 8)) : 0,
-                  length >= 18 ? (pData[16] | (pData[17] << 8)) : 0);
-  }
-  
-  lastData = currentDataVec;
-  
-  WorkoutRecord newRecord;
-  newRecord.timestamp = time(nullptr);
-  newRecord.speed = 0.0;
-  newRecord.distance = 0;
-  newRecord.time = 0;
-  
-  // Парсинг скорости
-  if (length >= 4) {
-    uint16_t speedRaw = pData[2] | (pData[3] << 8);
-    newRecord.speed = speedRaw / 100.0;
+    const WorkoutHistory::Entry& entry = entries[stage - 1];
+    size_t used = 0;
+    if (stage > 1) out[used++] = ',';
+    stage++;
     
-    // Убрали фильтр низких скоростей для поддержки медленной ходьбы
+    char path[WorkoutHistory::MAX_PATH];
+    JsonWriter json(out + used, size - used);
+    json.beginObject();
+    json.field("id", entry.id);
+    json.timestampField("start", (time_t)entry.id, gmtOffset_sec);
+    json.field("duration_seconds", entry.duration);
+    json.field("total_distance", entry.distance);
+    json.fixedField("max_speed", entry.maxSpeed / 100.0f, 2);
+    json.fixedField("avg_speed", entry.avgSpeed / 100.0f, 2);
+    json.field("records_count", entry.samples);
+    char name[16];
+    json.field("device_name", treadmillName(entry.device, name, sizeof(name)));
+    json.field("has_samples", history.samplesPath(entry, path, sizeof(path)));
+    json.endObject();
+    json.flush();
+    return json.ok() ? used + json.length() : 0;
   }
   
-  // Парсинг времени
-  if (length >= 18) {
-    uint16_t timeRaw = pData[16] | (pData[17] << 8);
-    newRecord.time = timeRaw;
+private:
+  size_t stage;     // 0 - заголовок, 1..shown - записи, shown + 1 - хвост
+};
+
+// Сэмплы тренировки из архива: журнал читается с флеша по мере отправки
+class HistorySamplesStream : public RowStream<256> {
+public:
+  HistorySamplesStream(const char* journal, const WorkoutHistory::Entry& entry)
+    : reader(flashFs, copyPath(journal), entry.offset, entry.length),
+      id(entry.id), index(0), opened(false), closed(false) {}
+  
+protected:
+  size_t nextRow(char* out, size_t size) override {
+    if (!opened) {
+      opened = true;
+      return snprintf(out, size, "{\"id\":%lu,\"samples\":[", (unsigned long)id);
+    }
+    if (closed) return 0;
+    
+    WorkoutRecord record;
+    if (!reader.next(record)) {
+      closed = true;
+      return snprintf(out, size, "]}");
+    }
+    
+    size_t used = 0;
+    if (index > 0) out[used++] = ',';
+    JsonWriter json(out + used, size - used);
+    json.beginObject();
+    json.field("sample_index", index);
+    writeSampleFields(json, record, gmtOffset_sec);
+    json.endObject();
+    json.flush();
+    index++;
+    return json.ok() ? used + json.length() : 0;
   }
   
-  // Вычисление дистанции на основе скорости и времени
-  if (newRecord.speed >= MIN_ACTIVITY_SPEED && lastTimeUpdate > 0 && currentState == ACTIVE && (millis() - actualWorkoutStartTime > workoutStartDelay)) {
-    unsigned long timeInterval = millis() - lastTimeUpdate;
-    if (timeInterval > 100 && timeInterval < 10000) {
-      float distanceInterval = (newRecord.speed / 3.6) * (timeInterval / 1000.0);
-      totalDistance += distanceInterval;
-      
-      Serial0.printf("CALCULATED: Interval=%.1fs, Distance+=%.2fm, Total=%.1fm\n",
-                    timeInterval / 1000.0, distanceInterval, totalDistance);
+private:
+  // JournalReader хранит указатель на путь: строка живёт в этом объекте
+  // и должна быть заполнена до конструирования reader
+  const char* copyPath(const char* journal) {
+    snprintf(path, sizeof(path), "%s", journal);
+    return path;
+  }
+  
+  char path[WorkoutHistory::MAX_PATH];
+  JournalReader reader;
+  uint32_t id;
+  uint32_t index;
+  bool opened;
+  bool closed;
+};
+
+// Отдаёт RowStream ответом: с Content-Length, если размер известен
+// заранее, иначе chunked. Объект живёт, пока его держит ответ
+template <size_t ROW_SIZE>
+AsyncWebServerResponse* beginRowStream(AsyncWebServerRequest* request, const char* contentType,
+                                       std::shared_ptr<RowStream<ROW_SIZE>> stream, size_t length = 0) {
+  auto filler = [stream](uint8_t* out, size_t maxLength, size_t index) -> size_t {
+    return stream->fill(out, maxLength);
+  };
+  AsyncWebServerResponse* response = length > 0
+    ? request->beginResponse(contentType, length, filler)
+    : request->beginChunkedResponse(contentType, filler);
+  response->addHeader("Cache-Control", "no-cache");
+  return response;
+}
+
+// GET /api/workouts?cursor=<id>&limit=<n> - от новых к старым
+void handleWorkoutList(AsyncWebServerRequest* request) {
+  uint32_t cursor = 0;
+  size_t limit = 20;
+  if (request->hasParam("cursor")) {
+    cursor = strtoul(request->getParam("cursor")->value().c_str(), nullptr, 10);
+  }
+  if (request->hasParam("limit")) {
+    limit = strtoul(request->getParam("limit")->value().c_str(), nullptr, 10);
+  }
+  if (limit == 0 || limit > HISTORY_PAGE_MAX) limit = HISTORY_PAGE_MAX;
+  
+  std::shared_ptr<HistoryPageStream> page(new (std::nothrow) HistoryPageStream());
+  if (!page) {
+    request->send(503, "application/json", "{}");
+    return;
+  }
+  // Колбэк вызывается под блокировкой архива: только копирование
+  HistoryPageStream* target = page.get();
+  history.list(cursor, limit + 1, [target](const WorkoutHistory::Entry& entry) {
+    target->entries[target->found++] = entry;
+  });
+  page->shown = page->found < limit ? page->found : limit;
+  page->next = page->found > limit ? page->entries[limit - 1].id : 0;
+  request->send(beginRowStream<320>(request, "application/json", page));
+}
+
+// GET /api/workouts/<id>/samples
+void handleWorkoutSamples(AsyncWebServerRequest* request, uint32_t id) {
+  WorkoutHistory::Entry entry;
+  if (!history.find(id, entry)) {
+    request->send(404, "application/json", "{\"error\":\"not found\"}");
+    return;
+  }
+  char path[WorkoutHistory::MAX_PATH];
+  if (!history.samplesPath(entry, path, sizeof(path))) {
+    // Сводка есть, сэмплы вытеснены по бюджету флеша
+    request->send(410, "application/json", "{\"error\":\"samples evicted\"}");
+    return;
+  }
+  
+  std::shared_ptr<HistorySamplesStream> samples(new (std::nothrow) HistorySamplesStream(path, entry));
+  if (!samples) {
+    request->send(503, "application/json", "{}");
+    return;
+  }
+  request->send(beginRowStream<256>(request, "application/json", samples));
+}
+
+// GET /api/workouts/<id>/export.<csv|tcx|fit>; id == 0 - текущая
+// тренировка первой дорожки с идущей записью, иначе последняя из архива.
+// У текущей в файл попадает то, что уже сброшено в журнал на флеше
+void handleWorkoutExport(AsyncWebServerRequest* request, uint32_t id, WorkoutExport::Format format) {
+  char path[WorkoutHistory::MAX_PATH] = "";
+  size_t offset = 0;
+  size_t length = 0;
+  WorkoutHistory::Entry entry;
+  
+  for (size_t i = 0; id == 0 && path[0] == '\0' && i < TREADMILL_COUNT; i++) {
+    const char* active = sessions[i]->journal().activePath();
+    if (flashFs.exists(active)) {
+      snprintf(path, sizeof(path), "%s", active);
+      length = flashFs.size(path);
+    }
+  }
+  if (path[0] == '\0') {
+    bool found = false;
+    if (id == 0) {
+      found = history.list(0, 1, [&entry](const WorkoutHistory::Entry& newest) {
+        entry = newest;
+      }) == 1;
+    } else {
+      found = history.find(id, entry);
+    }
+    if (!found) {
+      request->send(404, "application/json", "{\"error\":\"not found\"}");
+      return;
+    }
+    if (!history.samplesPath(entry, path, sizeof(path))) {
+      request->send(410, "application/json", "{\"error\":\"samples evicted\"}");
+      return;
     }
+    offset = entry.offset;
+    length = entry.length;
   }
   
-  if (newRecord.speed >= MIN_ACTIVITY_SPEED && currentState == ACTIVE && (millis() - actualWorkoutStartTime > workoutStartDelay)) {
-    lastTimeUpdate = millis();
+  // Конструктор один раз читает журнал (итоги и размер FIT)
+  std::shared_ptr<WorkoutExport> file(new (std::nothrow) WorkoutExport(flashFs, path, offset, length,
+                                                                       format, gmtOffset_sec));
+  if (!file) {
+    request->send(503, "application/json", "{}");
+    return;
+  }
+  if (file->empty()) {
+    request->send(404, "application/json", "{\"error\":\"no samples\"}");
+    return;
   }
   
-  newRecord.distance = (uint32_t)totalDistance;
+  char disposition[64];
+  snprintf(disposition, sizeof(disposition), "attachment; filename=\"workout-%ld.%s\"",
+           (long)file->startTime(), WorkoutExport::extension(format));
+  AsyncWebServerResponse* response = beginRowStream<512>(request, WorkoutExport::contentType(format),
+                                                         file, file->contentLength());
+  response->addHeader("Content-Disposition", disposition);
+  request->send(response);
+}
+
+// GET /api/capture[?enable=0|1][&clear=1][&device=N] - состояние записи
+// кадров; device - номер дорожки в config.h, чьи кадры пишутся
+void handleCaptureStatus(AsyncWebServerRequest* request) {
+  if (request->hasParam("clear")) {
+    capture.clear();
+  }
+  if (request->hasParam("device")) {
+    unsigned long device = strtoul(request->getParam("device")->value().c_str(), nullptr, 10);
+    if (device >= TREADMILL_COUNT) {
+      request->send(400, "application/json", "{\"error\":\"unknown device\"}");
+      return;
+    }
+    captureDevice.store((uint8_t)device, std::memory_order_relaxed);
+  }
+  if (request->hasParam("enable")) {
+    bool enable = request->getParam("enable")->value() == "1";
+    if (!enable) capture.flush();
+    capture.setEnabled(enable);
+    Serial0.printf("Frame capture %s\n", enable ? "enabled" : "disabled");
+  }
   
-  if (newRecord.speed > 25.0) {
-    newRecord.speed = 0.0;
+  char body[128];
+  JsonWriter json(body, sizeof(body));
+  json.beginObject();
+  json.field("enabled", capture.enabled());
+  json.field("device", (uint32_t)captureDevice.load(std::memory_order_relaxed));
+  json.field("frames", capture.frames());
+  json.field("dropped", capture.dropped());
+  json.field("flushes", capture.flushes());
+  json.endObject();
+  json.flush();
+  request->send(200, "application/json", body);
+}
+
+// GET /api/capture.pcap - кольцо кадров (LINKTYPE_USER0), sim/replay читает как есть
+void handleCaptureDownload(AsyncWebServerRequest* request) {
+  // Кадры из буфера RAM тоже попадают в файл
+  capture.flush();
+  
+  std::shared_ptr<CapturePcapStream> pcap(new (std::nothrow) CapturePcapStream(capture));
+  if (!pcap) {
+    request->send(503, "application/json", "{}");
+    return;
+  }
+  AsyncWebServerResponse* response = beginRowStream<256>(request, "application/vnd.tcpdump.pcap", pcap);
+  response->addHeader("Content-Disposition", "attachment; filename=\"treadmill-frames.pcap\"");
+  request->send(response);
+}
+
+double readFreeHeap() { return ESP.getFreeHeap(); }
+double readMinFreeHeap() { return ESP.getMinFreeHeap(); }
+double readLargestFreeBlock() { return ESP.getMaxAllocHeap(); }
+double readNotificationRate() { return notificationRate.load(std::memory_order_relaxed); }
+double readOutboxDepth() { return outbox.count(); }
+double readPendingSamples() { return pendingSampleUploads; }
+double readWifiAttempts() { return wifiManager.attempts(); }
+double readWifiDrops() { return wifiManager.drops(); }
+// Связь - сумма по дорожкам
+double readBleDropped() {
+  uint32_t dropped = 0;
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) dropped += sessions[i]->frames().dropped();
+  return dropped;
+}
+double readBleReconnects() {
+  uint32_t reconnects = 0;
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    uint32_t attempts = sessions[i]->link().attempts();
+    if (attempts > 0) reconnects += attempts - 1;
+  }
+  return reconnects;
+}
+double readBleDrops() {
+  uint32_t drops = 0;
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) drops += sessions[i]->link().drops();
+  return drops;
+}
+// Сэмплы сверх лимита журналов: тренировка есть в RAM, но не на флеше
+double readJournalDropped() {
+  uint32_t dropped = 0;
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) dropped += sessions[i]->journal().droppedSamples();
+  return dropped;
+}
+double readBleConnected() {
+  uint32_t connected = 0;
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    if (sessions[i]->link().isUp()) connected++;
   }
+  return connected;
+}
+double readBleOutage() { return bleLastOutage.load(std::memory_order_relaxed) / 1000.0; }
+
+// Таблица /metrics; такты callback переводятся в секунды по частоте CPU
+void initMetrics() {
+  double cycleSeconds = 1.0 / (getCpuFrequencyMhz() * 1e6);
+  MetricFamily* m = metricFamilies;
+  *m++ = MetricFamily::counterOf("treadmill_ble_notifications_total",
+                                 "FTMS notifications received", bleNotifications);
+  *m++ = MetricFamily::gauge("treadmill_ble_notifications_per_second",
+                             "FTMS notifications during the last second", readNotificationRate);
+  *m++ = MetricFamily::counterFrom("treadmill_ble_frames_dropped_total",
+                                   "Frames lost to a full ring or oversize", readBleDropped);
+  *m++ = MetricFamily::histogramOf("treadmill_ble_callback_seconds",
+                                   "BLE notification callback run time", bleCallbackCycles, cycleSeconds);
+  *m++ = MetricFamily::histogramOf("treadmill_notify_to_process_seconds",
+                                   "Delay from BLE notification to processing", notifyLatency, 1e-6);
+  *m++ = MetricFamily::gauge("treadmill_ble_connected_devices", "Treadmills with a live link",
+                             readBleConnected);
+  *m++ = MetricFamily::counterFrom("treadmill_ble_reconnect_attempts_total",
+                                   "Treadmill connect attempts after the first", readBleReconnects);
+  *m++ = MetricFamily::counterFrom("treadmill_ble_disconnects_total", "Treadmill link losses",
+                                   readBleDrops);
+  *m++ = MetricFamily::histogramOf("treadmill_ble_first_sample_seconds",
+                                   "From the successful connect attempt to the first notification",
+                                   bleFirstSample, 1e-3);
+  *m++ = MetricFamily::gauge("treadmill_ble_last_outage_seconds",
+                             "From boot or the last link loss to the first notification (latest link)",
+                             readBleOutage);
+  *m++ = MetricFamily::gauge("treadmill_heap_free_bytes", "Free heap", readFreeHeap);
+  *m++ = MetricFamily::gauge("treadmill_heap_min_free_bytes", "Lowest free heap since boot",
+                             readMinFreeHeap);
+  *m++ = MetricFamily::gauge("treadmill_heap_largest_free_block_bytes",
+                             "Largest allocatable heap block", readLargestFreeBlock);
+  *m++ = MetricFamily::gauge("treadmill_upload_queue_workouts", "Workout rows waiting in the outbox",
+                             readOutboxDepth);
+  *m++ = MetricFamily::gauge("treadmill_upload_queue_sample_journals",
+                             "Workouts whose samples wait for upload", readPendingSamples);
+  *m++ = MetricFamily::counterFrom("treadmill_journal_samples_dropped_total",
+                                   "Samples not written to a full workout journal", readJournalDropped);
+  *m++ = MetricFamily::histogramOf("treadmill_upload_seconds", "Supabase request time",
+                                   uploadLatency, 1e-3);
+  *m++ = MetricFamily::codesOf("treadmill_upload_requests_total",
+                               "Supabase requests by HTTP code (<= 0: transport error)", "code",
+                               uploadResults);
+  *m++ = MetricFamily::counterFrom("treadmill_wifi_connect_attempts_total", "WiFi connect attempts",
+                                   readWifiAttempts);
+  *m++ = MetricFamily::counterFrom("treadmill_wifi_drops_total", "WiFi link losses", readWifiDrops);
+  *m++ = MetricFamily::labeled("treadmill_web_requests_total", "Web server requests by route",
+                               "route", webRequests, WEB_ROUTE_NAMES, ROUTE_COUNT);
+  metricFamilyCount = m - metricFamilies;
+}
+
+// GET /metrics - текстовый формат Prometheus, по строкам без буфера на весь ответ
+void handleMetrics(AsyncWebServerRequest* request) {
+  std::shared_ptr<MetricsStream> metrics(new (std::nothrow) MetricsStream(metricFamilies,
+                                                                          metricFamilyCount));
+  if (!metrics) {
+    request->send(503, "text/plain", "");
+    return;
+  }
+  request->send(beginRowStream<256>(request, "text/plain; version=0.0.4", metrics));
+}
+
+// Задача вывода лога: форматирует сообщения deferredLog и пишет их в
+// Serial0 с низким приоритетом, чтобы ожидание порта не задерживало кадры.
+// Она же пишет на флеш завершённые тренировки: сети она не ждёт, в
+// отличие от задачи HTTP, поэтому слот освобождается за десятки мс
+void logTask(void* parameter) {
+  char line[256];
   
-  newRecord.isActive = (newRecord.speed >= MIN_ACTIVITY_SPEED && newRecord.time > 0);
+  while (true) {
+    size_t length;
+    while ((length = deferredLog.format(line, sizeof(line))) > 0) {
+      Serial0.write((const uint8_t*)line, length);
+    }
+    persistFinishedWorkouts();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL));
+  }
+}
 
-  // Обновляем данные для веб-интерфейса только раз в 2 секунды
-  unsigned long currentTimeMs = millis();
-  if (currentTimeMs - lastWebUpdate > WEB_UPDATE_INTERVAL) {
-    webCurrentSpeed = newRecord.speed;
-    webCurrentDistance = newRecord.distance;
-    webCurrentTime = newRecord.time;
-    webCurrentState = (currentState == STANDBY ? "STANDBY" :
-                      (currentState == ACTIVE ? "ACTIVE" : "ENDED"));
+// Задача BLE: подключение к дорожкам и переподключение после обрыва.
+// connect() блокирует только эту задачу (до таймаута стека), поэтому
+// попытки дорожек идут по очереди; подключённые дорожки при этом
+// продолжают слать кадры
+void bleTask(void* parameter) {
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    if (!bleCentrals[i]->begin() || (strapCentrals[i] != nullptr && !strapCentrals[i]->begin())) {
+      LOG_ERROR("BLE init failed!\n");
+      setLEDState(LED_ERROR);
+      vTaskDelete(nullptr);
+      return;
+    }
+  }
+  
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    sessions[i]->link().start(sessions[i]->address(), FTMS_SERVICE_UUID, TREADMILL_DATA_UUID,
+                              treadmillDataCallback, sessions[i], millis());
+    if (sessions[i]->strap() != nullptr) {
+      sessions[i]->strap()->start(sessions[i]->strapAddress(), HEART_RATE_SERVICE_UUID,
+                                  HEART_RATE_MEASUREMENT_UUID, heartRateCallback, sessions[i], millis());
+    }
+  }
+  bool wasUp[TREADMILL_COUNT] = {};
+  uint32_t drops[TREADMILL_COUNT] = {};
+  bool strapWasUp[TREADMILL_COUNT] = {};
+  bool anyWasUp = false;
+  
+  while (true) {
+    bool anyUp = false;
+    for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+      TreadmillSession& session = *sessions[i];
+      BleLink& link = session.link();
+      link.poll(millis());
+      
+      if (link.drops() != drops[i]) {
+        drops[i] = link.drops();
+        LOG_WARN("Treadmill %s disconnected (drops: %u) - reconnecting in background\n",
+                 session.name(), drops[i]);
+      }
+      bool up = link.isUp();
+      if (up && !wasUp[i]) {
+        LOG_INFO("Treadmill %s connected in %u ms (%s, MTU %u, attempt %u)\n",
+                 session.name(), bleCentrals[i]->lastConnectMs(),
+                 bleCentrals[i]->lastUsedCache() ? "cached handles" : "service discovery",
+                 bleCentrals[i]->mtu(), link.attempts());
+      }
+      if (up != wasUp[i]) telemetryVersion.fetch_add(1, std::memory_order_release);
+      wasUp[i] = up;
+      anyUp = anyUp || up;
+      
+      // Ремень не влияет на индикацию: без него пульс берётся у дорожки
+      BleLink* strap = session.strap();
+      if (strap != nullptr) {
+        strap->poll(millis());
+        bool strapUp = strap->isUp();
+        if (strapUp != strapWasUp[i]) {
+          LOG_INFO("Heart rate strap of %s %s\n", session.name(),
+                   strapUp ? "connected" : "disconnected - reconnecting in background");
+        }
+        strapWasUp[i] = strapUp;
+      }
+    }
     
-    if (currentState == ACTIVE && workoutStartTime > 0) {
-      webSessionDuration = time(nullptr) - workoutStartTime;
-    } else {
-      webSessionDuration = 0;
+    // Красный - ни одной дорожки на связи; выключенные дорожки в зале -
+    // обычное дело, пока хоть одна подключена
+    if (anyUp && !anyWasUp) {
+      if (currentLEDState == LED_ERROR || currentLEDState == LED_CONNECTING) {
+        setLEDState(restingLEDState());
+      }
+    } else if (!anyUp && anyWasUp) {
+      setLEDState(LED_ERROR);
     }
+    anyWasUp = anyUp;
     
-    lastWebUpdate = currentTimeMs;
+    vTaskDelay(pdMS_TO_TICKS(BLE_POLL_INTERVAL));
   }
+}
+
+// Задача обработки: разбирает кадры из очередей всех дорожек
+void processingTask(void* parameter) {
+  RawFrame frame;
   
-  updateWorkoutState(newRecord);
-  addToBuffer(newRecord);
+  Serial0.println("Processing Task started");
   
-  // Выводим основную информацию
-  static WorkoutRecord lastDisplayed = {0};
-  static bool wasActive = false;
-  bool isActive = (newRecord.speed >= MIN_ACTIVITY_SPEED);
-  
-  if ((isActive != wasActive) ||
-      (isActive && (newRecord.speed != lastDisplayed.speed ||
-                    newRecord.distance != lastDisplayed.distance)) ||
-      currentState != previousState) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DATA_REFRESH_INTERVAL));
     
-    Serial0.printf("STATE: %s, Speed: %.1f km/h, Total Distance: %d m, Time: %d s\n",
-                  currentState == STANDBY ? "STANDBY" :
-                  currentState == ACTIVE ? "ACTIVE" : "ENDED",
-                  newRecord.speed, newRecord.distance, newRecord.time);
+    for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+      TreadmillSession& session = *sessions[i];
+      // Пульс - раньше кадров дорожки: записи этого прохода уже застанут
+      // пришедшие вместе с ними отсчёты
+      while (session.heartRateFrames().pop(frame)) {
+        session.onHeartRate(frame);
+      }
+      while (session.frames().pop(frame)) {
+        processFrame(session, frame);
+      }
+      // Принудительный сброс при долгой неактивности, записи с пульсом
+      session.poll(millis());
+    }
+    refreshDataBody(false);
+    capture.poll(millis());
     
-    lastDisplayed = newRecord;
-    wasActive = isActive;
+    static uint32_t rateSince = 0;
+    static uint32_t rateBase = 0;
+    if (millis() - rateSince >= 1000) {
+      uint32_t total = bleNotifications.value();
+      notificationRate.store(total - rateBase, std::memory_order_relaxed);
+      rateBase = total;
+      rateSince = millis();
+    }
   }
 }
 
@@ -1004,21 +1882,93 @@ void setup() {
   setLEDState(LED_CONNECTING);
   
   Serial0.println("ESP32-S3 Treadmill Logger v3.2 - Fixed Supabase Structure");
+  // Стек с запасом под строку workouts (MAX_ROW) и LittleFS
+  xTaskCreatePinnedToCore(logTask, "Log_Task", 8192, nullptr, 1, &logTaskHandle, 0);
   RAW = false; // для включения RAW данных
   Serial0.printf("Activity thresholds: MIN_WORKOUT=%.1f km/h, MIN_ACTIVITY=%.1f km/h\n", 
-                 MIN_WORKOUT_SPEED, MIN_ACTIVITY_SPEED);
-  workoutEndTime_millis = millis();
+                 WorkoutTracker::MIN_WORKOUT_SPEED, WorkoutTracker::MIN_ACTIVITY_SPEED);
+  
+  // Сессии дорожек; буферы - в PSRAM, если она есть
+  sessionCapacity = psramFound() ? SESSION_CAPACITY_PSRAM : SESSION_CAPACITY_RAM;
+  size_t bleConnections = TREADMILL_COUNT;
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    bleCentrals[i] = new (std::nothrow) NimBleCentral(i);
+    sessions[i] = bleCentrals[i] != nullptr
+      ? new (std::nothrow) TreadmillSession(i, TREADMILLS[i].address, TREADMILLS[i].name,
+                                            *bleCentrals[i], flashFs, sessionEvents)
+      : nullptr;
+    if (sessions[i] == nullptr || !sessions[i]->begin(sessionCapacity)) {
+      Serial0.println("Failed to allocate session buffer!");
+      setLEDState(LED_ERROR);
+      return;
+    }
+    sessions[i]->tracker().reset(millis());
+    
+    if (TREADMILLS[i].strapAddress != nullptr) {
+      if (bleConnections >= CONFIG_BT_NIMBLE_MAX_CONNECTIONS) {
+        Serial0.printf("No BLE connection left for heart rate strap of %s\n", TREADMILLS[i].name);
+      } else {
+        strapCentrals[i] = new (std::nothrow) NimBleCentral(STRAP_CACHE_SLOT + i);
+        if (strapCentrals[i] == nullptr ||
+            !sessions[i]->attachStrap(*strapCentrals[i], TREADMILLS[i].strapAddress)) {
+          Serial0.printf("Failed to allocate heart rate strap of %s\n", TREADMILLS[i].name);
+          delete strapCentrals[i];
+          strapCentrals[i] = nullptr;
+        } else {
+          bleConnections++;
+        }
+      }
+    }
+    Serial0.printf("Session buffer %s: %u points, %u bytes in %s\n", TREADMILLS[i].name,
+                   sessions[i]->buffer().capacity(), sessions[i]->buffer().memoryUsage(),
+                   sessions[i]->buffer().inPsram() ? "PSRAM" : "internal RAM");
+  }
+  // Запасные буферы слотов завершённых тренировок; без них тренировка
+  // остаётся в журнале до перезагрузки
+  for (size_t i = 0; i < FINISHED_SLOTS; i++) {
+    if (!finishedWorkouts[i].buffer.begin(sessionCapacity)) {
+      Serial0.println("Failed to allocate finished workout buffer!");
+    }
+  }
+  initMetrics();
   Serial0.printf("Free heap at start: %d bytes\n", ESP.getFreeHeap());
   
-  // Создание HTTP задачи и очереди
-  Serial0.println("Creating HTTP task and queue...");
-  workoutQueue = xQueueCreate(3, sizeof(WorkoutData*));
+  flashReady = flashFs.mount();
+  if (!flashReady) {
+    Serial0.println("Failed to mount LittleFS - workouts cannot be queued for upload");
+  }
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    sessions[i]->setJournaling(flashReady);
+    sessions[i]->journal().setMaxBytes(flashJournalLimit(TREADMILL_COUNT));
+  }
   
-  if (workoutQueue == nullptr) {
-    Serial0.println("Failed to create workout queue!");
-    setLEDState(LED_ERROR);
-    return;
+  // Идентификатор устройства для ключей идемпотентности
+  uint64_t mac = ESP.getEfuseMac();
+  snprintf(deviceId, sizeof(deviceId), "%012llx", (unsigned long long)(mac & 0xFFFFFFFFFFFFULL));
+  
+  // Восстановление - до создания задач: задача HTTP сразу видит очередь,
+  // а задача обработки не начнёт новый журнал поверх прерванного
+  if (flashReady) {
+    history.setRetention(isJournalQueued, nullptr);
+    history.begin();
+    Serial0.printf("History: %u workout(s) on flash\n", history.count());
+    capture.begin();
+    recoverJournal();
+    outbox.scan();
+    Serial0.printf("Outbox: %u workout(s) waiting for upload\n", outbox.count());
+  }
+  
+  // Создание HTTP задачи и очереди
+  Serial0.println("Creating HTTP task...");
+  supabase.begin(SUPABASE_URL, SUPABASE_KEY, SUPABASE_ROOT_CA);
+  networkEvents = xEventGroupCreate();
+  
+  // Начальные показатели, пока задача обработки не опубликовала свои
+  TelemetrySnapshot idle = { 0.0f, 0, 0, 0, 0, 0.0f, 0, 0, 0.0f, 0, "STANDBY" };
+  for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+    publishTelemetry(i, idle);
   }
+  refreshDataBody(true);
   
   BaseType_t result = xTaskCreatePinnedToCore(
     httpTask,
@@ -1041,98 +1991,175 @@ void setup() {
   
   Serial0.println("HTTP task created successfully");
   
-  // Подключение к WiFi с несколькими попытками
-  Serial0.println("Connecting to WiFi...");
-  reconnectWiFi();
+  // Задача обработки BLE кадров на ядре 1, отдельно от BLE стека
+  result = xTaskCreatePinnedToCore(
+    processingTask,
+    "Processing_Task",
+    8192,
+    nullptr,
+    3,
+    &processingTaskHandle,
+    1
+  );
   
-  // Настройка NTP
-  Serial0.println("Getting time from NTP...");
-  configTime(gmtOffset_sec, daylightOffset_sec, ntpServer1, ntpServer2, ntpServer3);
-
-  int ntpAttempts = 0;
-  struct tm timeinfo;
-  while (!getLocalTime(&timeinfo) && ntpAttempts < 20) {
-    delay(1000);
-    Serial0.print(".");
-    ntpAttempts++;
-  }
-
-  if (ntpAttempts >= 20) {
-    Serial0.println("\nFailed to obtain time from NTP");
-  } else {
-    time_t currentTime = time(nullptr);
-    Serial0.printf("\nCurrent time: %s (timestamp: %ld)\n",
-                  getReadableTime(currentTime).c_str(), currentTime);
-    
-    if (!isTimeValid(currentTime)) {
-      Serial0.println("WARNING: Received invalid time from NTP!");
-    }
+  if (result != pdPASS) {
+    Serial0.println("Failed to create processing task!");
+    setLEDState(LED_ERROR);
+    return;
   }
-
-  workoutStartTime = 0;
-  workoutEndTime = 0;
-  workoutEndTime_millis = millis();
   
-  // Тестирование Supabase только если есть WiFi
-  if (wifiConnected) {
-    testSupabaseConnection();
-  } else {
-    Serial0.println("Skipping Supabase test - no WiFi");
-  }
-
+  // WiFi подключается в фоне: setup не ждёт ни сеть, ни NTP.
+  // Время синхронизируется при получении адреса, проверка Supabase -
+  // в задаче отправки при первом подключении
+  Serial0.println("Connecting to WiFi in background...");
+  setLEDState(LED_CONNECTING);
+  wifiDriver.attach(wifiManager);
+  wifiManager.onLinkChange(onWifiLinkChange);
+  wifiManager.start(millis());
+  
   Serial0.println("Starting web server...");
 
+  // Страница собрана заранее (scripts/build_web_assets.py): gzip из PROGMEM
+  // как есть, повторный заход браузера - 304 без тела
   webServer.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-    request->send_P(200, "text/html", webPageHTML);
+    webRequests[ROUTE_INDEX].add();
+    if (request->hasHeader("If-None-Match") &&
+        request->header("If-None-Match") == INDEX_HTML_ETAG) {
+      AsyncWebServerResponse* response = request->beginResponse(304);
+      response->addHeader("ETag", INDEX_HTML_ETAG);
+      response->addHeader("Cache-Control", "no-cache");
+      request->send(response);
+      return;
+    }
+    
+    AsyncWebServerResponse* response = request->beginResponse_P(200, INDEX_HTML_TYPE,
+                                                               INDEX_HTML_GZ, INDEX_HTML_GZ_LENGTH);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", INDEX_HTML_ETAG);
+    // Кэш только с проверкой: после прошивки ETag изменится
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
   });
 
   webServer.on("/data", HTTP_GET, [](AsyncWebServerRequest *request){
-    // Статический буфер для JSON
-    static char jsonBuffer[200];
-    String stateCopy = webCurrentState;
-    snprintf(jsonBuffer, sizeof(jsonBuffer),
-      "{\"speed\":%.1f,\"distance\":%u,\"time\":%u,\"duration\":%ld,\"state\":\"%s\",\"free_heap\":%u}",
-      webCurrentSpeed, webCurrentDistance, webCurrentTime, webSessionDuration,
-      stateCopy.c_str(), ESP.getFreeHeap());
-      
-    request->send(200, "application/json", jsonBuffer);
+    webRequests[ROUTE_DATA].add();
+    // Готовое тело из кэша: не сериализуем и не копируем в String.
+    // Слот возвращается, когда соединение закрыто (ответ ушёл или оборван)
+    const DataCache::Body* body = dataCache.acquire();
+    if (body == nullptr || body->length == 0) {
+      if (body != nullptr) dataCache.release(body);
+      request->send(503, "application/json", "{}");
+      return;
+    }
+    
+    AsyncWebServerResponse* response = request->beginResponse("application/json", body->length,
+      [body](uint8_t* out, size_t maxLength, size_t index) -> size_t {
+        size_t length = body->length - index;
+        if (length > maxLength) length = maxLength;
+        memcpy(out, body->data + index, length);
+        return length;
+      });
+    request->onDisconnect([body]() {
+      dataCache.release(body);
+    });
+    request->send(response);
+  });
+  
+  // Архив тренировок. Обработчик "/api/workouts" получает и вложенные
+  // пути: /api/workouts/<id>/samples и /api/workouts/<id|latest>/export.<формат>
+  webServer.on("/api/workouts", HTTP_GET, [](AsyncWebServerRequest *request){
+    webRequests[ROUTE_WORKOUTS].add();
+    if (!flashReady) {
+      request->send(503, "application/json", "{}");
+      return;
+    }
+    const char* url = request->url().c_str();
+    unsigned long id = 0;
+    int consumed = 0;
+    char extension[4] = "";
+    WorkoutExport::Format format;
+    if (strcmp(url, "/api/workouts") == 0) {
+      handleWorkoutList(request);
+    } else if (sscanf(url, "/api/workouts/%lu/samples%n", &id, &consumed) == 1 &&
+               url[consumed] == '\0') {
+      handleWorkoutSamples(request, (uint32_t)id);
+    } else if ((sscanf(url, "/api/workouts/%lu/export.%3s%n", &id, extension, &consumed) == 2 ||
+                sscanf(url, "/api/workouts/latest/export.%3s%n", extension, &consumed) == 1) &&
+               url[consumed] == '\0' && WorkoutExport::parseFormat(extension, format)) {
+      handleWorkoutExport(request, (uint32_t)id, format);
+    } else {
+      request->send(404, "text/plain", "Not found");
+    }
+  });
+  
+  // "/api/capture.pcap" не вложен в "/api/capture": обработчики не пересекаются
+  webServer.on("/api/capture.pcap", HTTP_GET, [](AsyncWebServerRequest *request){
+    webRequests[ROUTE_CAPTURE].add();
+    if (!flashReady) {
+      request->send(503, "application/json", "{}");
+      return;
+    }
+    handleCaptureDownload(request);
   });
+  
+  webServer.on("/api/capture", HTTP_GET, [](AsyncWebServerRequest *request){
+    webRequests[ROUTE_CAPTURE].add();
+    if (!flashReady) {
+      request->send(503, "application/json", "{}");
+      return;
+    }
+    handleCaptureStatus(request);
+  });
+  
+  liveSocket.onEvent([](AsyncWebSocket* server, AsyncWebSocketClient* client,
+                        AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    if (type == WS_EVT_CONNECT) {
+      webRequests[ROUTE_LIVE].add();
+      if (!liveClients.add(client->id())) {
+        client->close(1013, "Too many clients");
+        return;
+      }
+      Serial0.printf("Live client #%u connected (%u total)\n", client->id(), liveClients.count());
+    } else if (type == WS_EVT_DISCONNECT) {
+      liveClients.remove(client->id());
+    }
+  });
+  webServer.addHandler(&liveSocket);
 
   // Настройка для минимального влияния на производительность
+  webServer.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+    webRequests[ROUTE_METRICS].add();
+    handleMetrics(request);
+  });
+  
+#if TRACE_ENABLED
+  // Последние события трассировки: открыть в ui.perfetto.dev
+  webServer.on("/api/trace.json", HTTP_GET, [](AsyncWebServerRequest *request){
+    webRequests[ROUTE_TRACE].add();
+    std::shared_ptr<TraceStream> trace(new (std::nothrow) TraceStream(tracer));
+    if (!trace) {
+      request->send(503, "application/json", "{}");
+      return;
+    }
+    request->send(beginRowStream<256>(request, "application/json", trace));
+  });
+#endif
+  
   webServer.onNotFound([](AsyncWebServerRequest *request){
+    webRequests[ROUTE_NOT_FOUND].add();
     request->send(404, "text/plain", "Not found");
   });
 
   webServer.begin();
-  Serial0.println("Web server started!");
-  if (wifiConnected) {
-    Serial0.printf("Open http://%s in your browser\n", WiFi.localIP().toString().c_str());
-  }
+  Serial0.println("Web server started! Open http://<device IP> once WiFi is up");
   
-  // Подключение к беговой дорожке
-  Serial0.println("Connecting to treadmill...");
+  // Подключение к беговым дорожкам в фоне, как и WiFi
+  Serial0.printf("Connecting to %u treadmill(s) in background...\n", (unsigned)TREADMILL_COUNT);
   setLEDState(LED_CONNECTING);
   
-  BLEDevice::init("");
-  pClient = BLEDevice::createClient();
-  
-  if (pClient->connect(treadmillAddress)) {
-    Serial0.println("Treadmill connected!");
-    
-    BLERemoteService* pService = pClient->getService("00001826-0000-1000-8000-00805f9b34fb");
-    if (pService) {
-      pTreadmillData = pService->getCharacteristic("00002acd-0000-1000-8000-00805f9b34fb");
-      if (pTreadmillData && pTreadmillData->canNotify()) {
-        pTreadmillData->registerForNotify(treadmillDataCallback);
-        Serial0.println("Ready to log workouts!");
-        connected = true;
-        setLEDState(LED_SUCCESS);
-        delay(2000);
-        setLEDState(LED_STANDBY);
-      }
-    }
-  } else {
-    Serial0.println("Failed to connect to treadmill!");
+  result = xTaskCreatePinnedToCore(bleTask, "BLE_Task", 4096, nullptr, 2, &bleTaskHandle, 0);
+  if (result != pdPASS) {
+    Serial0.println("Failed to create BLE task!");
     setLEDState(LED_ERROR);
   }
   
@@ -1155,73 +2182,56 @@ void loop() {
   // Обновляем NeoPixel в каждом цикле
   updateNeoPixel();
   
-  if (connected && pClient->isConnected()) {
-    static unsigned long lastStatus = 0;
+  // События WiFi, таймауты и паузы переподключения
+  wifiManager.poll(millis());
+  pushLiveTelemetry();
+  
+  static unsigned long lastStatus = 0;
+  
+  // Проверка соединений каждые 5 секунд
+  if (millis() - lastConnectionCheck > CONNECTION_CHECK_INTERVAL) {
+    lastConnectionCheck = millis();
     
-    // Проверка соединений каждые 5 секунд
-    if (millis() - lastConnectionCheck > CONNECTION_CHECK_INTERVAL) {
-      lastConnectionCheck = millis();
-      
-      // Проверяем WiFi и пытаемся переподключиться при необходимости
-      if (WiFi.status() != WL_CONNECTED && wifiConnected) {
-        Serial0.println("WiFi lost - attempting reconnection");
-        wifiConnected = false;
-        setLEDState(LED_WIFI_ERROR);
-      } else if (WiFi.status() == WL_CONNECTED && !wifiConnected) {
-        Serial0.println("WiFi restored");
-        wifiConnected = true;
-        if (currentLEDState == LED_WIFI_ERROR) {
-          setLEDState(LED_STANDBY);
-        }
-      }
-      
-      // Проверяем системное время
-      time_t currentTime = time(nullptr);
-      if (!isTimeValid(currentTime)) {
-        Serial0.printf("WARNING: System time is invalid: %ld\n", currentTime);
-        configTime(gmtOffset_sec, daylightOffset_sec, ntpServer1, ntpServer2, ntpServer3);
-      }
-      
-      // Проверяем память
-      if (ESP.getFreeHeap() < 10000) {
-        Serial0.printf("WARNING: Low memory! Free heap: %d bytes\n", ESP.getFreeHeap());
-      }
-      
-      if (currentState == STANDBY && (millis() - workoutEndTime_millis < WORKOUT_COOLDOWN)) {
-        unsigned long remaining = (WORKOUT_COOLDOWN - (millis() - workoutEndTime_millis)) / 1000;
-        Serial0.printf("COOLDOWN: %lu seconds remaining\n", remaining);
-      }
-      
-      // Принудительный сброс при долгой неактивности
-      if (currentState == ACTIVE && (millis() - lastActiveTime > STANDBY_TIMEOUT * 2)) {
-        Serial0.println("Force reset to STANDBY - no activity detected");
-        currentState = STANDBY;
-        setLEDState(LED_STANDBY);
-        workoutBuffer.clear();
-        totalDistance = 0.0;
-      }
-      
-      // Попытка переподключения WiFi каждые 2 минуты если его нет
-      static unsigned long lastWiFiAttempt = 0;
-      if (!wifiConnected && (millis() - lastWiFiAttempt > 120000)) {
-        reconnectWiFi();
-        lastWiFiAttempt = millis();
-      }
+    // Проверяем системное время
+    time_t currentTime = time(nullptr);
+    // SNTP запускается при каждом подключении WiFi (wifiManager)
+    if (!WorkoutTracker::isTimeValid(currentTime)) {
+      Serial0.printf("WARNING: System time is invalid: %ld (WiFi: %s)\n",
+                     currentTime, wifiManager.isUp() ? "up" : "down");
     }
     
-    if (currentState == STANDBY && (millis() - lastStatus > 60000)) {
-      Serial0.printf("STANDBY (waiting) - %s, WiFi: %s, Free RAM: %d\n", 
-                     getReadableTime(time(nullptr)).c_str(),
-                     wifiConnected ? "OK" : "NO",
-                     ESP.getFreeHeap());
-      lastStatus = millis();
+    // Проверяем память
+    if (ESP.getFreeHeap() < 10000) {
+      Serial0.printf("WARNING: Low memory! Free heap: %d bytes\n", ESP.getFreeHeap());
     }
     
-    delay(100);
-  } else {
-    Serial0.println("Reconnecting to treadmill...");
-    setLEDState(LED_ERROR);
-    connected = false;
-    delay(5000);
+    for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+      uint32_t cooldown = sessions[i]->tracker().cooldownRemaining(millis());
+      if (cooldown > 0) {
+        unsigned long remaining = cooldown / 1000;
+        Serial0.printf("COOLDOWN %s: %lu seconds remaining\n", sessions[i]->name(), remaining);
+      }
+    }
   }
+  
+  // Сводка раз в минуту, пока ни на одной дорожке нет тренировки
+  if (activeWorkouts.load(std::memory_order_relaxed) == 0 && (millis() - lastStatus > 60000)) {
+    uint32_t queueHighWater = 0;
+    for (size_t i = 0; i < TREADMILL_COUNT; i++) {
+      if (sessions[i]->frames().highWater() > queueHighWater) {
+        queueHighWater = sessions[i]->frames().highWater();
+      }
+    }
+    Serial0.printf("STANDBY (waiting) - %s, WiFi: %s, Treadmills: %u/%u, Free RAM: %d, BLE queue: hw %u/%u, dropped %u\n", 
+                   getReadableTime(time(nullptr)).text,
+                   wifiManager.isUp() ? "OK" : "NO",
+                   (unsigned)readBleConnected(), (unsigned)TREADMILL_COUNT,
+                   ESP.getFreeHeap(),
+                   queueHighWater, (unsigned)TreadmillSession::QUEUE_SIZE,
+                   (unsigned)readBleDropped());
+    lastStatus = millis();
+  }
+  
+  // Переподключение к дорожкам - в BLE_Task, loop не ждёт
+  delay(100);
 }
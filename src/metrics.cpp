@@ -0,0 +1,215 @@
+#include "metrics.h"
+
+#include <stdio.h>
+
+#ifndef ARDUINO
+thread_local size_t hostMetricCore = 0;
+#endif
+
+uint32_t Counter::value() const {
+  uint32_t total = 0;
+  for (size_t i = 0; i < METRIC_CORES; i++) total += cores[i].value.load(std::memory_order_relaxed);
+  return total;
+}
+
+Histogram::Histogram(const uint32_t* bounds, size_t count)
+  : bounds(bounds), bucketCount(count < MAX_BUCKETS ? count : MAX_BUCKETS) {
+  for (size_t core = 0; core < METRIC_CORES; core++) {
+    for (size_t i = 0; i <= MAX_BUCKETS; i++) cores[core].counts[i].store(0, std::memory_order_relaxed);
+    cores[core].sumLow.store(0, std::memory_order_relaxed);
+    cores[core].sumHigh.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::observe(uint32_t value) {
+  // Корзин мало, линейный поиск дешевле двоичного
+  size_t bucket = 0;
+  while (bucket < bucketCount && value > bounds[bucket]) bucket++;
+
+  Cell& cell = cores[metricCore()];
+  cell.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  uint32_t before = cell.sumLow.fetch_add(value, std::memory_order_relaxed);
+  if ((uint32_t)(before + value) < before) cell.sumHigh.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t Histogram::cumulative(size_t index) const {
+  uint32_t total = 0;
+  for (size_t core = 0; core < METRIC_CORES; core++) {
+    for (size_t i = 0; i <= index && i <= bucketCount; i++) {
+      total += cores[core].counts[i].load(std::memory_order_relaxed);
+    }
+  }
+  return total;
+}
+
+uint64_t Histogram::sum() const {
+  uint64_t total = 0;
+  for (size_t core = 0; core < METRIC_CORES; core++) {
+    total += ((uint64_t)cores[core].sumHigh.load(std::memory_order_relaxed) << 32) |
+             cores[core].sumLow.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+CodeCounter::CodeCounter() {
+  for (size_t i = 0; i < SLOTS; i++) codes[i].store(EMPTY, std::memory_order_relaxed);
+}
+
+void CodeCounter::add(int32_t code) {
+  for (size_t i = 0; i + 1 < SLOTS; i++) {
+    int32_t current = codes[i].load(std::memory_order_acquire);
+    if (current == EMPTY) {
+      // Ячейку могли занять одновременно: тогда в current - чужой код
+      if (codes[i].compare_exchange_strong(current, code, std::memory_order_acq_rel)) current = code;
+    }
+    if (current == code) {
+      counters[i].add();
+      return;
+    }
+  }
+
+  codes[SLOTS - 1].store(0, std::memory_order_release);
+  counters[SLOTS - 1].add();
+}
+
+static MetricFamily family(const char* name, const char* help, MetricFamily::Kind kind) {
+  MetricFamily result = { name, help, kind, nullptr, nullptr, nullptr, 1.0, nullptr,
+                          nullptr, nullptr, 0, nullptr };
+  return result;
+}
+
+MetricFamily MetricFamily::counterOf(const char* name, const char* help, const Counter& counter) {
+  MetricFamily result = family(name, help, COUNTER);
+  result.counter = &counter;
+  return result;
+}
+
+MetricFamily MetricFamily::counterFrom(const char* name, const char* help, double (*read)()) {
+  MetricFamily result = family(name, help, COUNTER);
+  result.read = read;
+  return result;
+}
+
+MetricFamily MetricFamily::gauge(const char* name, const char* help, double (*read)()) {
+  MetricFamily result = family(name, help, GAUGE);
+  result.read = read;
+  return result;
+}
+
+MetricFamily MetricFamily::histogramOf(const char* name, const char* help,
+                                       const Histogram& histogram, double unitSeconds) {
+  MetricFamily result = family(name, help, HISTOGRAM);
+  result.histogram = &histogram;
+  result.unitSeconds = unitSeconds;
+  return result;
+}
+
+MetricFamily MetricFamily::codesOf(const char* name, const char* help, const char* label,
+                                   const CodeCounter& codes) {
+  MetricFamily result = family(name, help, CODES);
+  result.codes = &codes;
+  result.label = label;
+  return result;
+}
+
+MetricFamily MetricFamily::labeled(const char* name, const char* help, const char* label,
+                                   const Counter* counters, const char* const* labels, size_t count) {
+  MetricFamily result = family(name, help, LABELED);
+  result.counters = counters;
+  result.labels = labels;
+  result.count = count;
+  result.label = label;
+  return result;
+}
+
+MetricsStream::MetricsStream(const MetricFamily* families, size_t count)
+  : families(families), familyCount(count), family(0), item(0) {}
+
+static const char* typeName(MetricFamily::Kind kind) {
+  switch (kind) {
+    case MetricFamily::GAUGE: return "gauge";
+    case MetricFamily::HISTOGRAM: return "histogram";
+    default: return "counter";
+  }
+}
+
+// snprintf, обрезанный до размера буфера
+static size_t printed(int written, size_t size) {
+  if (written < 0) return 0;
+  return (size_t)written < size ? (size_t)written : size - 1;
+}
+
+bool MetricsStream::valueRow(const MetricFamily& metric, size_t& index,
+                             char* out, size_t size, size_t& length) {
+  switch (metric.kind) {
+    case MetricFamily::COUNTER:
+    case MetricFamily::GAUGE: {
+      if (index > 0) return false;
+      double value = metric.counter != nullptr ? metric.counter->value() : metric.read();
+      length = printed(snprintf(out, size, "%s %.10g\n", metric.name, value), size);
+      return true;
+    }
+
+    case MetricFamily::HISTOGRAM: {
+      const Histogram& histogram = *metric.histogram;
+      size_t buckets = histogram.buckets();
+      if (index < buckets) {
+        length = printed(snprintf(out, size, "%s_bucket{le=\"%.6g\"} %u\n", metric.name,
+                                  histogram.bound(index) * metric.unitSeconds,
+                                  (unsigned)histogram.cumulative(index)), size);
+      } else if (index == buckets) {
+        length = printed(snprintf(out, size, "%s_bucket{le=\"+Inf\"} %u\n", metric.name,
+                                  (unsigned)histogram.count()), size);
+      } else if (index == buckets + 1) {
+        length = printed(snprintf(out, size, "%s_sum %.9g\n%s_count %u\n", metric.name,
+                                  (double)histogram.sum() * metric.unitSeconds,
+                                  metric.name, (unsigned)histogram.count()), size);
+      } else {
+        return false;
+      }
+      return true;
+    }
+
+    case MetricFamily::CODES: {
+      const CodeCounter& codes = *metric.codes;
+      while (index < CodeCounter::SLOTS && !codes.used(index)) index++;
+      if (index >= CodeCounter::SLOTS) return false;
+      char code[12];
+      if (codes.other(index)) {
+        snprintf(code, sizeof(code), "other");
+      } else {
+        snprintf(code, sizeof(code), "%ld", (long)codes.code(index));
+      }
+      length = printed(snprintf(out, size, "%s{%s=\"%s\"} %u\n", metric.name, metric.label,
+                                code, (unsigned)codes.value(index)), size);
+      return true;
+    }
+
+    case MetricFamily::LABELED:
+      if (index >= metric.count) return false;
+      length = printed(snprintf(out, size, "%s{%s=\"%s\"} %u\n", metric.name, metric.label,
+                                metric.labels[index], (unsigned)metric.counters[index].value()), size);
+      return true;
+  }
+  return false;
+}
+
+size_t MetricsStream::nextRow(char* out, size_t size) {
+  while (family < familyCount) {
+    const MetricFamily& metric = families[family];
+    size_t length = 0;
+    if (item == 0) {
+      item++;
+      return printed(snprintf(out, size, "# HELP %s %s\n# TYPE %s %s\n", metric.name, metric.help,
+                              metric.name, typeName(metric.kind)), size);
+    }
+    size_t index = item - 1;
+    if (valueRow(metric, index, out, size, length)) {
+      item = index + 2;
+      return length;
+    }
+    family++;
+    item = 0;
+  }
+  return 0;
+}
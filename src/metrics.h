@@ -0,0 +1,158 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "row_stream.h"
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+// Счётчики для /metrics (формат Prometheus). Каждое ядро пишет в свою
+// ячейку relaxed-атомиком: в горячем пути (BLE callback, задача обработки)
+// нет ни блокировок, ни общих между ядрами строк кэша. Ячейки ядер
+// суммируются только при чтении. На хосте ядро потока задаёт
+// setMetricCore() (тесты), по умолчанию - ядро 0.
+static const size_t METRIC_CORES = 2;
+
+#ifndef ARDUINO
+extern thread_local size_t hostMetricCore;
+
+inline void setMetricCore(size_t core) { hostMetricCore = core < METRIC_CORES ? core : 0; }
+#endif
+
+inline size_t metricCore() {
+#ifdef ARDUINO
+  return xPortGetCoreID() < (BaseType_t)METRIC_CORES ? (size_t)xPortGetCoreID() : 0;
+#else
+  return hostMetricCore;
+#endif
+}
+
+class Counter {
+public:
+  Counter() {
+    for (size_t i = 0; i < METRIC_CORES; i++) cores[i].value.store(0, std::memory_order_relaxed);
+  }
+
+  void add(uint32_t n = 1) { cores[metricCore()].value.fetch_add(n, std::memory_order_relaxed); }
+  uint32_t value() const;
+
+private:
+  struct alignas(32) Cell {
+    std::atomic<uint32_t> value;
+  };
+  Cell cores[METRIC_CORES];
+};
+
+// Гистограмма с фиксированными верхними границами корзин (в единицах
+// наблюдения: такты, мкс, мс). Перевод в секунды - при выводе.
+// 64-битных атомиков на Xtensa нет: сумма - пара 32-битных слов с
+// переносом. Читатель может раз в 2^32 единиц увидеть сумму без переноса
+// на несколько тактов - для мониторинга это допустимо.
+class Histogram {
+public:
+  static const size_t MAX_BUCKETS = 12;
+
+  // bounds - по возрастанию, живут всё время работы (обычно static const)
+  Histogram(const uint32_t* bounds, size_t count);
+
+  void observe(uint32_t value);
+
+  size_t buckets() const { return bucketCount; }
+  uint32_t bound(size_t index) const { return bounds[index]; }
+  // Наблюдения не больше bound(index); index == buckets() - все (+Inf)
+  uint32_t cumulative(size_t index) const;
+  uint32_t count() const { return cumulative(bucketCount); }
+  uint64_t sum() const;
+
+private:
+  struct alignas(32) Cell {
+    std::atomic<uint32_t> counts[MAX_BUCKETS + 1];
+    std::atomic<uint32_t> sumLow;
+    std::atomic<uint32_t> sumHigh;
+  };
+
+  const uint32_t* bounds;
+  size_t bucketCount;
+  Cell cores[METRIC_CORES];
+};
+
+// Счётчик с меткой-числом (HTTP код). Ячейка под новый код занимается
+// CAS-ом; когда ячейки кончились, коды считаются в последней, "other"
+class CodeCounter {
+public:
+  static const size_t SLOTS = 8;
+
+  CodeCounter();
+
+  void add(int32_t code);
+
+  // Ячейка index занята: code(index) и value(index) имеют смысл
+  bool used(size_t index) const { return codes[index].load(std::memory_order_acquire) != EMPTY; }
+  // Последняя ячейка - прочие коды
+  bool other(size_t index) const { return index == SLOTS - 1; }
+  int32_t code(size_t index) const { return codes[index].load(std::memory_order_acquire); }
+  uint32_t value(size_t index) const { return counters[index].value(); }
+
+private:
+  static const int32_t EMPTY = INT32_MIN;
+
+  std::atomic<int32_t> codes[SLOTS];
+  Counter counters[SLOTS];
+};
+
+// Описание семейства метрик для вывода. Значения берутся из объекта
+// (counter/histogram/codes/counters) или из функции read() в момент запроса
+struct MetricFamily {
+  enum Kind : uint8_t { COUNTER, GAUGE, HISTOGRAM, CODES, LABELED };
+
+  const char* name;
+  const char* help;
+  Kind kind;
+  const Counter* counter;        // COUNTER; nullptr - значение из read()
+  double (*read)();              // GAUGE и COUNTER без counter
+  const Histogram* histogram;    // HISTOGRAM
+  double unitSeconds;            // HISTOGRAM: единица наблюдения в секундах
+  const CodeCounter* codes;      // CODES
+  const Counter* counters;       // LABELED: массив count счётчиков
+  const char* const* labels;     // LABELED: значения метки
+  size_t count;
+  const char* label;             // CODES, LABELED: имя метки
+
+  static MetricFamily counterOf(const char* name, const char* help, const Counter& counter);
+  static MetricFamily counterFrom(const char* name, const char* help, double (*read)());
+  static MetricFamily gauge(const char* name, const char* help, double (*read)());
+  static MetricFamily histogramOf(const char* name, const char* help,
+                                  const Histogram& histogram, double unitSeconds);
+  static MetricFamily codesOf(const char* name, const char* help, const char* label,
+                              const CodeCounter& codes);
+  static MetricFamily labeled(const char* name, const char* help, const char* label,
+                              const Counter* counters, const char* const* labels, size_t count);
+};
+
+// Текстовый формат Prometheus 0.0.4 по строкам: заголовок семейства,
+// затем по строке на значение. Память - одна строка, сколько бы ни было метрик
+class MetricsStream : public RowStream<256> {
+public:
+  MetricsStream(const MetricFamily* families, size_t count);
+
+protected:
+  size_t nextRow(char* out, size_t size) override;
+
+private:
+  // Строка значения index семейства (пустые ячейки index пропускает);
+  // false - значения кончились
+  bool valueRow(const MetricFamily& family, size_t& index, char* out, size_t size, size_t& length);
+
+  const MetricFamily* families;
+  size_t familyCount;
+  size_t family;
+  size_t item;    // 0 - заголовок, дальше значения
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "outbox_drain.h"
+
+#include <string.h>
+
+#include "json_writer.h"
+#include "tracer.h"
+
+// PGRST204 - колонка тела вставки не найдена в кэше схемы, 42703 -
+// колонка из select не существует. Исправится миграцией, поэтому строки
+// не выбрасываются
+bool isSchemaError(int httpCode, const char* response) {
+  if (httpCode != 400 || response == nullptr) return false;
+  return strstr(response, "PGRST204") != nullptr || strstr(response, "42703") != nullptr ||
+         strstr(response, "Could not find the") != nullptr ||
+         (strstr(response, "column") != nullptr && strstr(response, "does not exist") != nullptr);
+}
+
+bool isPermanentUploadError(int httpCode, const char* response) {
+  if (isSchemaError(httpCode, response)) return false;
+  return httpCode == 400 || httpCode == 404 || httpCode == 409 || httpCode == 422;
+}
+
+OutboxDrain::OutboxDrain(UploadOutbox& outbox, UploadPoster& poster, size_t batchSize)
+  : outbox(outbox), poster(poster),
+    batchSize(batchSize > 0 && batchSize <= MAX_BATCH ? batchSize : MAX_BATCH),
+    batchLimit(this->batchSize), batchRows(0), httpCode(0), quarantineCount(0) {
+  responseText[0] = '\0';
+}
+
+OutboxDrain::Result OutboxDrain::step() {
+  batchRows = 0;
+  httpCode = 0;
+  responseText[0] = '\0';
+
+  // Нечитаемые записи уходят в dead; пачка собирается из оставшихся
+  size_t count;
+  size_t length = 0;
+  do {
+    count = outbox.peek(paths, batchLimit);
+    if (count == 0) return EMPTY;
+
+    TRACE_BEGIN("batch_json");
+    JsonWriter batch(body, sizeof(body));
+    batch.beginArray();
+    for (size_t i = 0; i < count; i++) {
+      if (outbox.read(paths[i], row, sizeof(row)) == 0) {
+        outbox.quarantine(paths[i]);
+        quarantineCount++;
+        paths[i][0] = '\0';
+        continue;
+      }
+      batch.raw(row, strlen(row));
+      batchRows++;
+    }
+    batch.endArray();
+    batch.flush();
+    length = batch.length();
+    TRACE_END("batch_json");
+  } while (batchRows == 0);
+
+  httpCode = poster.postBatch(body, length, batchRows, responseText, sizeof(responseText));
+  responseText[sizeof(responseText) - 1] = '\0';
+
+  if (httpCode == 200 || httpCode == 201) {
+    for (size_t i = 0; i < count; i++) {
+      if (paths[i][0] != '\0') outbox.remove(paths[i]);
+    }
+    batchLimit = batchSize;
+    return SENT;
+  }
+
+  if (isSchemaError(httpCode, responseText)) return SCHEMA_ERROR;
+
+  if (isPermanentUploadError(httpCode, responseText)) {
+    // Ищем строку, из-за которой отвергнута пачка
+    if (batchRows > 1) {
+      batchLimit = 1;
+      return SPLIT;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (paths[i][0] != '\0' && outbox.quarantine(paths[i])) quarantineCount++;
+    }
+    return REJECTED;
+  }
+
+  return FAILED;
+}
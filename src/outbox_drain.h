@@ -0,0 +1,75 @@
+#ifndef OUTBOX_DRAIN_H
+#define OUTBOX_DRAIN_H
+
+#include <stddef.h>
+
+#include "upload_outbox.h"
+
+// Всё, что разбору очереди нужно от HTTP: POST пачки строк workouts.
+// На устройстве - SupabaseClient (main.cpp), на хосте - подделки сервера
+// (sim/, test/test_outbox).
+class UploadPoster {
+public:
+  virtual ~UploadPoster() {}
+
+  // body - JSON-массив из rows строк. Возвращает HTTP код или ошибку
+  // транспорта (<= 0); в response - начало тела ответа с '\0'
+  virtual int postBatch(const char* body, size_t length, size_t rows,
+                        char* response, size_t responseSize) = 0;
+};
+
+// 400 из-за колонки, которой нет в таблице: схема не мигрирована
+bool isSchemaError(int httpCode, const char* response);
+// Ответ, который не исправится повтором того же запроса
+bool isPermanentUploadError(int httpCode, const char* response);
+
+// Разбор очереди UploadOutbox пачками до batchSize строк.
+// Строка удаляется только после 2xx. Повтор принятой строки (ответ
+// потерян, сбой между POST и удалением) сервер отбрасывает по client_id,
+// поэтому очередь не теряет и не дублирует тренировки. Отвергнутая
+// пачка разбирается по одной строке, отвергнутая строка уходит в dead.
+// Пауз и повторов здесь нет: когда пробовать снова, решает вызывающий
+// по результату step().
+class OutboxDrain {
+public:
+  static const size_t MAX_BATCH = 8;
+  static const size_t MAX_RESPONSE = 512;
+
+  enum Result {
+    EMPTY,          // очередь пуста
+    SENT,           // пачка принята и удалена из очереди
+    SPLIT,          // пачка отвергнута: дальше по одной строке
+    REJECTED,       // строка отвергнута окончательно и убрана в dead
+    SCHEMA_ERROR,   // в таблице нет колонки: строки ждут миграции
+    FAILED          // сеть или сервер: строки остаются, повтор позже
+  };
+
+  OutboxDrain(UploadOutbox& outbox, UploadPoster& poster, size_t batchSize = MAX_BATCH);
+
+  // Одна попытка: пачка самых старых строк одним запросом
+  Result step();
+
+  // Итоги последней попытки
+  size_t rows() const { return batchRows; }
+  int code() const { return httpCode; }
+  const char* response() const { return responseText; }
+  // Строк в dead: нечитаемых и отвергнутых сервером
+  size_t quarantined() const { return quarantineCount; }
+
+private:
+  UploadOutbox& outbox;
+  UploadPoster& poster;
+  size_t batchSize;
+  size_t batchLimit;
+
+  char paths[MAX_BATCH][UploadOutbox::MAX_PATH];
+  char row[UploadOutbox::MAX_ROW + 1];
+  char body[MAX_BATCH * (UploadOutbox::MAX_ROW + 1) + 3];
+  char responseText[MAX_RESPONSE];
+
+  size_t batchRows;
+  int httpCode;
+  size_t quarantineCount;
+};
+
+#endif
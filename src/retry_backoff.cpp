@@ -0,0 +1,13 @@
+#include "retry_backoff.h"
+
+uint32_t RetryBackoff::nextDelay(uint32_t random32) {
+  uint32_t window = cap;
+  if (failureCount < 31 && (base << failureCount) >> failureCount == base) {
+    window = base << failureCount;
+    if (window > cap) window = cap;
+  }
+  failureCount++;
+
+  uint32_t half = window / 2;
+  return half + random32 % (window - half + 1);
+}
@@ -0,0 +1,23 @@
+#ifndef RETRY_BACKOFF_H
+#define RETRY_BACKOFF_H
+
+#include <stdint.h>
+
+// Экспоненциальная задержка повторов с джиттером:
+// окно растёт как base * 2^n до cap, задержка случайна в [окно/2, окно]
+class RetryBackoff {
+public:
+  RetryBackoff(uint32_t baseMs, uint32_t capMs) : base(baseMs), cap(capMs), failureCount(0) {}
+
+  // Регистрирует неудачу и возвращает задержку до следующей попытки
+  uint32_t nextDelay(uint32_t random32);
+  void reset() { failureCount = 0; }
+  uint32_t failures() const { return failureCount; }
+
+private:
+  uint32_t base;
+  uint32_t cap;
+  uint32_t failureCount;
+};
+
+#endif
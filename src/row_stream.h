@@ -0,0 +1,51 @@
+#ifndef ROW_STREAM_H
+#define ROW_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Потоковый ответ, собираемый по строкам (chunked HTTP).
+// Наследник пишет очередную строку в буфер nextRow(), fill() копирует её
+// в сокет кусками того размера, который сервер готов принять. Строку не
+// нужно подгонять под окно отправки, а весь ответ - держать в памяти
+template <size_t ROW_SIZE>
+class RowStream {
+public:
+  RowStream() : rowLength(0), rowSent(0), finished(false) {}
+  virtual ~RowStream() {}
+
+  // До size байт ответа в out; 0 - ответ закончен
+  size_t fill(uint8_t* out, size_t size) {
+    size_t used = 0;
+    while (used < size) {
+      if (rowSent == rowLength) {
+        if (finished) break;
+        rowLength = nextRow(row, ROW_SIZE);
+        rowSent = 0;
+        if (rowLength == 0) {
+          finished = true;
+          break;
+        }
+      }
+      size_t part = rowLength - rowSent;
+      if (part > size - used) part = size - used;
+      memcpy(out + used, row + rowSent, part);
+      used += part;
+      rowSent += part;
+    }
+    return used;
+  }
+
+protected:
+  // Следующая строка (не длиннее size); 0 - строк больше нет
+  virtual size_t nextRow(char* out, size_t size) = 0;
+
+private:
+  char row[ROW_SIZE];
+  size_t rowLength;
+  size_t rowSent;
+  bool finished;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "sample_batch_writer.h"
+
+void writeSampleFields(JsonWriter& json, const WorkoutRecord& record, long offsetSeconds) {
+  json.timestampField("recorded_at", record.timestamp, offsetSeconds);
+  json.fixedField("speed", record.speed, 2);
+  json.field("distance", record.distance);
+  json.field("elapsed_time", (uint32_t)record.time);
+  json.field("is_active", record.isActive);
+  json.key("heart_rate");
+  if (record.heartRate != 0) {
+    json.value((uint32_t)record.heartRate);
+  } else {
+    json.nullValue();
+  }
+}
+
+SampleBatchWriter::SampleBatchWriter(JournalReader& reader, const char* key, long offsetSeconds,
+                                     size_t batchSize)
+  : reader(reader), key(key), offsetSeconds(offsetSeconds), batchSize(batchSize) {
+  // До beginBatch() тела нет
+  state = State();
+  state.opened = true;
+  state.closed = true;
+  start = state;
+  startMark = reader.mark();
+}
+
+bool SampleBatchWriter::available() {
+  if (!state.hasPending) state.hasPending = reader.next(state.pending);
+  return state.hasPending;
+}
+
+void SampleBatchWriter::beginBatch() {
+  state.remaining = batchSize;
+  state.opened = false;
+  state.closed = false;
+  // Прочитанный заранее сэмпл сохраняется вместе с позицией журнала
+  start = state;
+  startMark = reader.mark();
+}
+
+bool SampleBatchWriter::rewind() {
+  state = start;
+  return reader.reset(startMark);
+}
+
+size_t SampleBatchWriter::produce(uint8_t* buffer, size_t size) {
+  size_t used = 0;
+
+  if (!state.opened) {
+    buffer[used++] = '[';
+    state.opened = true;
+  }
+
+  while (!state.closed && state.remaining > 0 && size - used > MAX_ROW_LENGTH + 2) {
+    if (!available()) break;
+    WorkoutRecord record = state.pending;
+    state.hasPending = false;
+
+    if (state.remaining != batchSize) buffer[used++] = ',';
+
+    JsonWriter row((char*)buffer + used, size - used);
+    row.beginObject();
+    row.field("workout_client_id", key);
+    row.field("sample_index", state.index);
+    writeSampleFields(row, record, offsetSeconds);
+    row.endObject();
+    used += row.length();
+    state.index++;
+    state.remaining--;
+  }
+
+  if (!state.closed && (state.remaining == 0 || !available()) && size - used >= 1) {
+    buffer[used++] = ']';
+    state.closed = true;
+  }
+  return used;
+}
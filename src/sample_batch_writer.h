@@ -0,0 +1,58 @@
+#ifndef SAMPLE_BATCH_WRITER_H
+#define SAMPLE_BATCH_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "json_writer.h"
+#include "workout_journal.h"
+
+// Поля сэмпла, общие для выгрузки в workout_samples и /api/workouts
+void writeSampleFields(JsonWriter& json, const WorkoutRecord& record, long offsetSeconds);
+
+// Генератор тела bulk insert для workout_samples: сэмплы читаются из
+// журнала по одному и сразу форматируются в буфер chunk'а. Тело пачки -
+// JSON-массив до batchSize строк с ключом (workout_client_id, sample_index),
+// так что повтор уже принятой пачки сервер отбросит.
+class SampleBatchWriter {
+public:
+  // Строка одного сэмпла в JSON не длиннее этого
+  static const size_t MAX_ROW_LENGTH = 224;
+
+  SampleBatchWriter(JournalReader& reader, const char* key, long offsetSeconds, size_t batchSize);
+
+  // true - в журнале есть ещё сэмплы для следующей пачки
+  bool available();
+  // Начинает следующую пачку и запоминает её начало для rewind()
+  void beginBatch();
+  // Следующий кусок тела пачки не длиннее size (больше MAX_ROW_LENGTH + 2);
+  // 0 - тело пачки закончилось
+  size_t produce(uint8_t* buffer, size_t size);
+  // Возвращает к началу пачки, чтобы отправить её заново на новом
+  // соединении; false - журнал не перечитать
+  bool rewind();
+
+  // Номер следующего сэмпла в тренировке и первого в текущей пачке
+  uint32_t index() const { return state.index; }
+  uint32_t batchStart() const { return start.index; }
+
+private:
+  struct State {
+    uint32_t index;        // номер сэмпла в тренировке (часть ключа строки)
+    size_t remaining;      // сколько строк ещё войдёт в текущую пачку
+    bool opened;
+    bool closed;
+    WorkoutRecord pending; // прочитанный, но ещё не отправленный сэмпл
+    bool hasPending;
+  };
+
+  JournalReader& reader;
+  const char* key;
+  long offsetSeconds;
+  size_t batchSize;
+  State state;
+  State start;
+  JournalReader::Mark startMark;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Seqlock для одного писателя и любого числа читателей.
+// Писатель никогда не ждёт; читатель повторяет чтение, если попал на
+// запись (нечётный счётчик) или счётчик изменился за время копирования.
+// Данные лежат в атомарных словах, поэтому гонки нет и формально:
+// читатель может увидеть смесь слов, но такая копия отбрасывается.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable type");
+
+public:
+  Seqlock() : sequence(0) {
+    T empty = T();
+    store(empty);
+  }
+
+  // Только из одного потока
+  void write(const T& value) {
+    uint32_t s = sequence.load(std::memory_order_relaxed);
+    sequence.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    store(value);
+    sequence.store(s + 2, std::memory_order_release);
+  }
+
+  T read() const {
+    T value;
+    uint32_t before;
+    uint32_t after;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      if (before & 1) continue;
+      load(value);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+      if (before == after) break;
+    } while (true);
+    return value;
+  }
+
+  // Номер опубликованной версии: растёт на 1 с каждой write()
+  uint32_t version() const { return sequence.load(std::memory_order_acquire) >> 1; }
+
+private:
+  static const size_t WORDS = (sizeof(T) + 3) / 4;
+
+  void store(const T& value) {
+    uint32_t buffer[WORDS] = {};
+    memcpy(buffer, &value, sizeof(T));
+    for (size_t i = 0; i < WORDS; i++) words[i].store(buffer[i], std::memory_order_relaxed);
+  }
+
+  void load(T& value) const {
+    uint32_t buffer[WORDS];
+    for (size_t i = 0; i < WORDS; i++) buffer[i] = words[i].load(std::memory_order_relaxed);
+    memcpy(&value, buffer, sizeof(T));
+  }
+
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> words[WORDS];
+};
+
+#endif
@@ -0,0 +1,301 @@
+#include "session_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_heap_caps.h>
+#endif
+
+// Один блок под все столбцы; на ESP32 сначала пробуем PSRAM
+static void* allocateColumns(size_t bytes, bool& inPsram) {
+  inPsram = false;
+#ifdef ESP_PLATFORM
+  void* block = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (block != nullptr) {
+    inPsram = true;
+    return block;
+  }
+#endif
+  return malloc(bytes);
+}
+
+static size_t columnBytes(size_t points) {
+  return points * (5 * sizeof(uint16_t) + 1) + (points + 7) / 8;
+}
+
+static uint16_t encodeSpeed(float speed) {
+  if (speed <= 0.0f) return 0;
+  float centi = speed * 100.0f + 0.5f;
+  return centi >= 65535.0f ? 65535 : (uint16_t)centi;
+}
+
+static uint16_t clampU16(uint32_t value) {
+  return value > 65535 ? 65535 : (uint16_t)value;
+}
+
+SessionStore::SessionStore()
+  : timeDeltas(nullptr), speeds(nullptr), distanceDeltas(nullptr), elapsed(nullptr),
+    inclines(nullptr), heartRates(nullptr), activeBits(nullptr), psram(false), maxPoints(0) {
+  clear();
+}
+
+SessionStore::~SessionStore() {
+  release();
+}
+
+SessionStore::SessionStore(SessionStore&& other)
+  : timeDeltas(nullptr), speeds(nullptr), distanceDeltas(nullptr), elapsed(nullptr),
+    inclines(nullptr), heartRates(nullptr), activeBits(nullptr), psram(false), maxPoints(0) {
+  *this = static_cast<SessionStore&&>(other);
+}
+
+SessionStore& SessionStore::operator=(SessionStore&& other) {
+  if (this == &other) return *this;
+  release();
+
+  timeDeltas = other.timeDeltas;
+  speeds = other.speeds;
+  distanceDeltas = other.distanceDeltas;
+  elapsed = other.elapsed;
+  inclines = other.inclines;
+  heartRates = other.heartRates;
+  activeBits = other.activeBits;
+  psram = other.psram;
+  count = other.count;
+  maxPoints = other.maxPoints;
+  samples = other.samples;
+  decimation = other.decimation;
+  baseTime = other.baseTime;
+  lastPointTime = other.lastPointTime;
+  lastPointDistance = other.lastPointDistance;
+  latest = other.latest;
+  totals = other.totals;
+  pendingLow = other.pendingLow;
+  pendingHigh = other.pendingHigh;
+  pendingLowIndex = other.pendingLowIndex;
+  pendingHighIndex = other.pendingHighIndex;
+  pendingCount = other.pendingCount;
+
+  other.timeDeltas = nullptr;
+  other.speeds = nullptr;
+  other.distanceDeltas = nullptr;
+  other.elapsed = nullptr;
+  other.inclines = nullptr;
+  other.heartRates = nullptr;
+  other.activeBits = nullptr;
+  other.maxPoints = 0;
+  other.clear();
+  return *this;
+}
+
+void SessionStore::release() {
+  // timeDeltas - начало общего блока
+  free(timeDeltas);
+  timeDeltas = nullptr;
+  speeds = nullptr;
+  distanceDeltas = nullptr;
+  elapsed = nullptr;
+  inclines = nullptr;
+  heartRates = nullptr;
+  activeBits = nullptr;
+  maxPoints = 0;
+}
+
+bool SessionStore::begin(size_t capacity) {
+  release();
+  clear();
+
+  size_t points = (capacity + 3) & ~(size_t)3;
+  if (points < 4) points = 4;
+
+  uint8_t* block = (uint8_t*)allocateColumns(columnBytes(points), psram);
+  if (block == nullptr) return false;
+
+  timeDeltas = (uint16_t*)block;
+  speeds = timeDeltas + points;
+  distanceDeltas = speeds + points;
+  elapsed = distanceDeltas + points;
+  inclines = (int16_t*)(elapsed + points);
+  heartRates = (uint8_t*)(inclines + points);
+  activeBits = heartRates + points;
+  maxPoints = points;
+  return true;
+}
+
+void SessionStore::clear() {
+  count = 0;
+  samples = 0;
+  decimation = 0;
+  baseTime = 0;
+  lastPointTime = 0;
+  lastPointDistance = 0;
+  pendingCount = 0;
+  pendingLowIndex = 0;
+  pendingHighIndex = 0;
+  memset(&latest, 0, sizeof(latest));
+  totals.clear();
+  memset(&pendingLow, 0, sizeof(pendingLow));
+  memset(&pendingHigh, 0, sizeof(pendingHigh));
+}
+
+size_t SessionStore::size() const {
+  if (pendingCount == 0) return count;
+  return count + (pendingLowIndex == pendingHighIndex ? 1 : 2);
+}
+
+size_t SessionStore::memoryUsage() const {
+  return maxPoints == 0 ? 0 : columnBytes(maxPoints);
+}
+
+void SessionStore::add(const WorkoutRecord& record) {
+  if (maxPoints == 0) return;
+
+  if (samples == 0) {
+    baseTime = record.timestamp;
+    lastPointTime = record.timestamp;
+  }
+  samples++;
+  latest = record;
+  totals.add(record);
+
+  if (decimation == 0) {
+    appendPoint(record);
+    return;
+  }
+
+  if (pendingCount == 0) {
+    pendingLow = record;
+    pendingHigh = record;
+    pendingLowIndex = 0;
+    pendingHighIndex = 0;
+  } else {
+    if (record.speed < pendingLow.speed) {
+      pendingLow = record;
+      pendingLowIndex = pendingCount;
+    }
+    if (record.speed >= pendingHigh.speed) {
+      pendingHigh = record;
+      pendingHighIndex = pendingCount;
+    }
+  }
+  pendingCount++;
+
+  if (pendingCount >= windowSize()) flushWindow();
+}
+
+void SessionStore::flushWindow() {
+  // В окне из 2+ записей минимум (первый) и максимум (последний)
+  // всегда разные записи, поэтому окно даёт ровно две точки
+  size_t windowCount = pendingCount;
+  pendingCount = 0;
+  if (pendingLowIndex < pendingHighIndex) {
+    appendPoint(pendingLow);
+    appendPoint(pendingHigh);
+  } else if (windowCount > 1) {
+    appendPoint(pendingHigh);
+    appendPoint(pendingLow);
+  } else {
+    appendPoint(pendingLow);
+  }
+}
+
+void SessionStore::setPoint(size_t index, const WorkoutRecord& record, time_t previousTime,
+                            uint32_t previousDistance) {
+  // Разрыв длиннее 18,2 ч между соседними точками обрезается: при пределе
+  // тренировки в сутки такая сессия - это две точки
+  time_t gap = record.timestamp > previousTime ? record.timestamp - previousTime : 0;
+  timeDeltas[index] = gap > 65535 ? 65535 : (uint16_t)gap;
+  speeds[index] = encodeSpeed(record.speed);
+  distanceDeltas[index] = clampU16(record.distance > previousDistance ? record.distance - previousDistance : 0);
+  elapsed[index] = record.time;
+  inclines[index] = record.incline;
+  heartRates[index] = record.heartRate;
+
+  uint8_t mask = (uint8_t)(1 << (index & 7));
+  if (record.isActive) {
+    activeBits[index >> 3] |= mask;
+  } else {
+    activeBits[index >> 3] &= (uint8_t)~mask;
+  }
+}
+
+void SessionStore::appendPoint(const WorkoutRecord& record) {
+  setPoint(count, record, lastPointTime, lastPointDistance);
+  lastPointTime += timeDeltas[count];
+  lastPointDistance += distanceDeltas[count];
+  count++;
+  if (count >= maxPoints) compact();
+}
+
+void SessionStore::compact() {
+  // Каждая четвёрка точек (два окна) -> минимум и максимум в порядке времени.
+  // Пишем не дальше, чем прочитали, поэтому сжатие идёт на месте
+  const_iterator it = begin();
+  size_t out = 0;
+  time_t previousTime = baseTime;
+  uint32_t previous = 0;
+  WorkoutRecord group[4];
+
+  for (size_t i = 0; i + 3 < count; i += 4) {
+    for (size_t j = 0; j < 4; j++, ++it) group[j] = *it;
+
+    size_t low = 0;
+    size_t high = 0;
+    for (size_t j = 1; j < 4; j++) {
+      if (group[j].speed < group[low].speed) low = j;
+      if (group[j].speed >= group[high].speed) high = j;
+    }
+
+    const WorkoutRecord& first = group[low < high ? low : high];
+    const WorkoutRecord& second = group[low < high ? high : low];
+    setPoint(out++, first, previousTime, previous);
+    previousTime += timeDeltas[out - 1];
+    previous += distanceDeltas[out - 1];
+    setPoint(out++, second, previousTime, previous);
+    previousTime += timeDeltas[out - 1];
+    previous += distanceDeltas[out - 1];
+  }
+
+  count = out;
+  lastPointTime = previousTime;
+  lastPointDistance = previous;
+  decimation++;
+}
+
+const WorkoutRecord& SessionStore::pendingPoint(size_t slot) const {
+  bool lowFirst = pendingLowIndex <= pendingHighIndex;
+  if (slot == 0) return lowFirst ? pendingLow : pendingHigh;
+  return lowFirst ? pendingHigh : pendingLow;
+}
+
+SessionStore::const_iterator::const_iterator(const SessionStore* store, size_t index)
+  : store(store), index(index), timestamp(store->baseTime), distance(0) {
+  if (index == 0 && store->count > 0) {
+    timestamp += store->timeDeltas[0];
+    distance = store->distanceDeltas[0];
+  }
+}
+
+WorkoutRecord SessionStore::const_iterator::operator*() const {
+  if (index >= store->count) return store->pendingPoint(index - store->count);
+
+  WorkoutRecord record;
+  record.timestamp = timestamp;
+  record.speed = store->speeds[index] / 100.0f;
+  record.distance = distance;
+  record.time = store->elapsed[index];
+  record.incline = store->inclines[index];
+  record.heartRate = store->heartRates[index];
+  record.isActive = (store->activeBits[index >> 3] >> (index & 7)) & 1;
+  return record;
+}
+
+SessionStore::const_iterator& SessionStore::const_iterator::operator++() {
+  index++;
+  if (index < store->count) {
+    timestamp += store->timeDeltas[index];
+    distance += store->distanceDeltas[index];
+  }
+  return *this;
+}
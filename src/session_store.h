@@ -0,0 +1,129 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "workout_stats.h"
+
+struct WorkoutRecord {
+  time_t timestamp;
+  float speed;
+  uint32_t distance;
+  uint16_t time;
+  int16_t incline;     // наклон полотна, 0.1 %
+  uint8_t heartRate;   // уд/мин, 0 - нет данных
+  bool isActive;
+};
+
+// Хранилище всей тренировки в фиксированном объёме памяти.
+// Пока точек меньше capacity, хранится каждая запись. При заполнении
+// соседние четвёрки точек сжимаются до двух (минимум и максимум скорости
+// в порядке времени), а новые записи дальше копятся окнами вдвое большей
+// ширины. Так сохраняется вся сессия с её пиками, вставка - O(1)
+// амортизированно: полное сжатие O(capacity) случается раз в capacity/2 окон.
+// Итоги сессии (stats()) считаются по всем записям до прореживания.
+//
+// Точки лежат по столбцам (около 11 байт на точку вместо 24 у WorkoutRecord):
+//   gap      - uint16, секунды от предыдущей точки (у первой - 0); как и
+//              дистанция, хранится приращением, поэтому сессия не
+//              ограничена 18,2 ч, которые вмещает uint16 от начала
+//   speed    - uint16, 0.01 км/ч
+//   distance - uint16, приращение в метрах от предыдущей точки
+//   elapsed  - uint16, время тренажёра в секундах
+//   incline  - int16, 0.1 %
+//   pulse    - uint8, уд/мин
+//   active   - битовая маска isActive
+// На ESP32 столбцы размещаются в PSRAM, если она есть.
+class SessionStore {
+public:
+  class const_iterator {
+  public:
+    WorkoutRecord operator*() const;
+    const_iterator& operator++();
+    bool operator!=(const const_iterator& other) const { return index != other.index; }
+    bool operator==(const const_iterator& other) const { return index == other.index; }
+
+  private:
+    friend class SessionStore;
+    const_iterator(const SessionStore* store, size_t index);
+
+    const SessionStore* store;
+    size_t index;
+    time_t timestamp;    // накопленное время для столбцовой части
+    uint32_t distance;   // накопленная дистанция для столбцовой части
+  };
+
+  SessionStore();
+  ~SessionStore();
+  SessionStore(SessionStore&& other);
+  SessionStore& operator=(SessionStore&& other);
+  SessionStore(const SessionStore&) = delete;
+  SessionStore& operator=(const SessionStore&) = delete;
+
+  // Выделяет столбцы на capacity точек (округляется вверх до кратного 4).
+  // false - не хватило памяти
+  bool begin(size_t capacity);
+  void clear();
+  void add(const WorkoutRecord& record);
+
+  bool empty() const { return samples == 0; }
+  // Количество хранимых точек, включая незавершённое окно
+  size_t size() const;
+  size_t capacity() const { return maxPoints; }
+  // Байты, занятые столбцами
+  size_t memoryUsage() const;
+  bool inPsram() const { return psram; }
+  // Сколько записей поступило всего
+  uint32_t sampleCount() const { return samples; }
+  // Последняя поступившая запись (итоговая дистанция)
+  const WorkoutRecord& last() const { return latest; }
+  // Итоги по всем поступившим записям
+  const WorkoutStats& stats() const { return totals; }
+  // Уровень прореживания: 0 - без потерь, далее окно = 2 << level записей
+  uint8_t level() const { return decimation; }
+
+  // Обход точек в порядке времени без копирования
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+  size_t windowSize() const { return decimation == 0 ? 1 : ((size_t)2 << decimation); }
+  void release();
+  void appendPoint(const WorkoutRecord& record);
+  void setPoint(size_t index, const WorkoutRecord& record, time_t previousTime, uint32_t previousDistance);
+  void flushWindow();
+  void compact();
+  // Запись из незавершённого окна по номеру (0 или 1) в порядке времени
+  const WorkoutRecord& pendingPoint(size_t slot) const;
+
+  uint16_t* timeDeltas;
+  uint16_t* speeds;
+  uint16_t* distanceDeltas;
+  uint16_t* elapsed;
+  int16_t* inclines;
+  uint8_t* heartRates;
+  uint8_t* activeBits;
+  bool psram;
+
+  size_t count;
+  size_t maxPoints;
+  uint32_t samples;
+  uint8_t decimation;
+  time_t baseTime;
+  time_t lastPointTime;
+  uint32_t lastPointDistance;
+  WorkoutRecord latest;
+  WorkoutStats totals;
+
+  // Незавершённое окно: минимум скорости (первое вхождение)
+  // и максимум (последнее вхождение) с их позициями в окне
+  WorkoutRecord pendingLow;
+  WorkoutRecord pendingHigh;
+  size_t pendingLowIndex;
+  size_t pendingHighIndex;
+  size_t pendingCount;
+};
+
+#endif
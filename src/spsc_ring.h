@@ -0,0 +1,64 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Кольцевой буфер без блокировок для одного писателя и одного читателя.
+// push() вызывается только из одного потока (BLE callback), pop() - только
+// из другого (задача обработки). При переполнении элемент отбрасывается
+// и учитывается в dropped(): писатель никогда не ждёт читателя.
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0), droppedCount(0), highWaterMark(0) {}
+
+  bool push(const T& item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t used = h - t;
+    if (used >= N) {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    slots[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+
+    // Обновляет только писатель, поэтому достаточно relaxed
+    if (used + 1 > highWaterMark.load(std::memory_order_relaxed)) {
+      highWaterMark.store((uint32_t)(used + 1), std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  bool pop(T& item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    if (t == h) return false;
+
+    item = slots[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+  uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+  uint32_t highWater() const { return highWaterMark.load(std::memory_order_relaxed); }
+
+private:
+  T slots[N];
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+  std::atomic<uint32_t> droppedCount;
+  std::atomic<uint32_t> highWaterMark;
+};
+
+#endif
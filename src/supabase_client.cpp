@@ -0,0 +1,320 @@
+#ifdef ARDUINO
+
+#include "supabase_client.h"
+#include "tracer.h"
+
+// Cloudflare перед Supabase держит простаивающее соединение около минуты;
+// закрываем своё раньше, чтобы не писать в уже закрытый сокет
+static const unsigned long SERVER_IDLE_LIMIT = 50000;
+
+// Размер одного chunk при потоковой отправке
+static const size_t STREAM_CHUNK = 1024;
+
+SupabaseClient::SupabaseClient() : lock(nullptr), port(443), lastUse(0) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void SupabaseClient::begin(const char* url, const char* key, const char* rootCa) {
+  if (lock == nullptr) lock = xSemaphoreCreateMutex();
+
+  baseUrl = url;
+  apiKey = key;
+  bearer = String("Bearer ") + key;
+
+  // https://host[:port] - для потоковых запросов в обход HTTPClient
+  host = baseUrl;
+  int scheme = host.indexOf("://");
+  if (scheme >= 0) host = host.substring(scheme + 3);
+  int slash = host.indexOf('/');
+  if (slash >= 0) host = host.substring(0, slash);
+  int colon = host.indexOf(':');
+  if (colon >= 0) {
+    port = (uint16_t)host.substring(colon + 1).toInt();
+    host = host.substring(0, colon);
+  }
+
+  if (rootCa != nullptr) {
+    // Несколько закреплённых корней вместо полного набора: проверка
+    // цепочки дешевле и не зависит от чужих CA
+    tls.setCACert(rootCa);
+  } else {
+    Serial0.println("WARNING: SUPABASE_ROOT_CA not set - TLS certificate is not verified");
+    tls.setInsecure();
+  }
+  tls.setHandshakeTimeout(10);
+
+  http.setReuse(true);
+  http.setTimeout(10000);
+  http.setConnectTimeout(5000);
+}
+
+int SupabaseClient::get(const char* path, String* response, size_t maxResponse) {
+  return request("GET", path, nullptr, nullptr, 0, response, maxResponse);
+}
+
+int SupabaseClient::post(const char* path, const char* prefer, const char* body, size_t length,
+                         String* response, size_t maxResponse) {
+  return request("POST", path, prefer, body, length, response, maxResponse);
+}
+
+int SupabaseClient::request(const char* method, const char* path, const char* prefer,
+                            const char* body, size_t length, String* response, size_t maxResponse) {
+  TRACE_SCOPE("https_request");
+  xSemaphoreTake(lock, portMAX_DELAY);
+
+  if (tls.connected() && millis() - lastUse > SERVER_IDLE_LIMIT) {
+    closeLocked();
+  }
+
+  String url = baseUrl + path;
+  int code = HTTPC_ERROR_CONNECTION_REFUSED;
+  bool reusing = false;
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    reusing = tls.connected();
+    uint32_t heapBefore = ESP.getFreeHeap();
+    unsigned long started = millis();
+
+    http.begin(tls, url);
+    http.addHeader("Content-Type", "application/json");
+    http.addHeader("apikey", apiKey);
+    http.addHeader("Authorization", bearer);
+    if (prefer != nullptr) http.addHeader("Prefer", prefer);
+
+    code = body != nullptr ? http.sendRequest(method, (uint8_t*)body, length)
+                           : http.sendRequest(method);
+
+    // Сервер закрыл соединение, пока оно простаивало: повторяем на новом
+    if (code <= 0 && reusing && attempt == 0) {
+      http.end();
+      tls.stop();
+      counters.reconnects++;
+      continue;
+    }
+
+    if (response != nullptr) {
+      *response = "";
+      int size = http.getSize();
+      if (code > 0 && size > 0 && (size_t)size <= maxResponse) {
+        *response = http.getString();
+      }
+    }
+
+    // end() оставляет соединение открытым, если сервер разрешил keep-alive
+    http.end();
+
+    uint32_t latency = millis() - started;
+    counters.requests++;
+    counters.lastLatencyMs = latency;
+    counters.totalLatencyMs += latency;
+    if (latency > counters.maxLatencyMs) counters.maxLatencyMs = latency;
+    counters.lastHeapCost = (int32_t)heapBefore - (int32_t)ESP.getFreeHeap();
+    if (reusing) {
+      counters.reused++;
+    } else {
+      counters.handshakes++;
+    }
+    break;
+  }
+
+  if (code <= 0) {
+    counters.failures++;
+    closeLocked();
+  }
+  lastUse = millis();
+
+  Serial0.printf("HTTPS %s %s -> %d in %u ms (%s), heap held: %d bytes\n",
+                 method, path, code, counters.lastLatencyMs,
+                 reusing ? "reused" : "new TLS session", counters.lastHeapCost);
+
+  xSemaphoreGive(lock);
+  return code;
+}
+
+bool SupabaseClient::ensureConnected() {
+  if (tls.connected()) return true;
+  TRACE_SCOPE("tls_connect");
+  return tls.connect(host.c_str(), port) == 1;
+}
+
+bool SupabaseClient::writeAll(const uint8_t* data, size_t length) {
+  while (length > 0) {
+    size_t done = tls.write(data, length);
+    if (done == 0) return false;
+    data += done;
+    length -= done;
+  }
+  return true;
+}
+
+// Читает ответ целиком, возвращает HTTP код. Из тела сохраняются первые
+// maxResponse байт, остальное отбрасывается. Соединение остаётся
+// открытым, если сервер не просил его закрыть
+int SupabaseClient::readResponseStatus(String* response, size_t maxResponse) {
+  tls.setTimeout(10);   // секунды для readStringUntil
+  String line = tls.readStringUntil('\n');
+  if (!line.startsWith("HTTP/1.")) return HTTPC_ERROR_READ_TIMEOUT;
+  int code = line.substring(9, 12).toInt();
+
+  long contentLength = -1;
+  bool chunked = false;
+  bool closeAfter = false;
+  while (true) {
+    line = tls.readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0) break;
+    line.toLowerCase();
+    if (line.startsWith("content-length:")) contentLength = line.substring(15).toInt();
+    if (line.startsWith("transfer-encoding:") && line.indexOf("chunked") >= 0) chunked = true;
+    if (line.startsWith("connection:") && line.indexOf("close") >= 0) closeAfter = true;
+  }
+
+  uint8_t sink[128];
+  auto keep = [&](int got) {
+    if (response == nullptr || response->length() >= maxResponse) return;
+    size_t part = maxResponse - response->length();
+    if (part > (size_t)got) part = got;
+    response->concat((const char*)sink, part);
+  };
+  if (chunked) {
+    while (true) {
+      line = tls.readStringUntil('\n');
+      long size = strtol(line.c_str(), nullptr, 16);
+      if (size <= 0) {
+        tls.readStringUntil('\n');
+        break;
+      }
+      while (size > 0) {
+        int got = tls.read(sink, size < (long)sizeof(sink) ? size : sizeof(sink));
+        if (got <= 0) break;
+        keep(got);
+        size -= got;
+      }
+      tls.readStringUntil('\n');
+    }
+  } else {
+    while (contentLength > 0) {
+      int got = tls.read(sink, contentLength < (long)sizeof(sink) ? contentLength : sizeof(sink));
+      if (got <= 0) break;
+      keep(got);
+      contentLength -= got;
+    }
+  }
+
+  if (closeAfter) tls.stop();
+  return code;
+}
+
+int SupabaseClient::postStream(const char* path, const char* prefer, const BodyProducer& producer,
+                               const BodyRewind& rewind, String* response, size_t maxResponse) {
+  TRACE_SCOPE("https_post_stream");
+  xSemaphoreTake(lock, portMAX_DELAY);
+
+  if (tls.connected() && millis() - lastUse > SERVER_IDLE_LIMIT) {
+    closeLocked();
+  }
+
+  int code = HTTPC_ERROR_CONNECTION_REFUSED;
+  bool reusing = false;
+  uint32_t latency = 0;
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    reusing = tls.connected();
+    uint32_t heapBefore = ESP.getFreeHeap();
+    unsigned long started = millis();
+    bool produced = false;
+    code = HTTPC_ERROR_CONNECTION_REFUSED;
+    if (response != nullptr) *response = "";
+
+    if (ensureConnected()) {
+      String head;
+      head.reserve(512);
+      head = String("POST ") + path + " HTTP/1.1\r\n"
+             "Host: " + host + "\r\n"
+             "Content-Type: application/json\r\n"
+             "apikey: " + apiKey + "\r\n"
+             "Authorization: " + bearer + "\r\n";
+      if (prefer != nullptr) head += String("Prefer: ") + prefer + "\r\n";
+      head += "Transfer-Encoding: chunked\r\n"
+              "Connection: keep-alive\r\n\r\n";
+
+      bool ok = writeAll((const uint8_t*)head.c_str(), head.length());
+      head = String();
+
+      // Буфер куска на стеке, а не тело в куче
+      uint8_t chunk[STREAM_CHUNK + CHUNK_FRAMING];
+      if (ok) {
+        ok = writeChunkedBody(producer, [this](const uint8_t* data, size_t length) {
+          return writeAll(data, length);
+        }, chunk, STREAM_CHUNK, &produced);
+      }
+
+      code = ok ? readResponseStatus(response, maxResponse) : HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+
+    // Сервер закрыл соединение, пока оно простаивало: повторяем на новом,
+    // если тело ещё не читалось или источник может начать его заново
+    if (code <= 0 && reusing && attempt == 0 && (!produced || (rewind && rewind()))) {
+      tls.stop();
+      counters.reconnects++;
+      continue;
+    }
+
+    latency = millis() - started;
+    counters.requests++;
+    counters.lastLatencyMs = latency;
+    counters.totalLatencyMs += latency;
+    if (latency > counters.maxLatencyMs) counters.maxLatencyMs = latency;
+    counters.lastHeapCost = (int32_t)heapBefore - (int32_t)ESP.getFreeHeap();
+    if (reusing) {
+      counters.reused++;
+    } else {
+      counters.handshakes++;
+    }
+    break;
+  }
+
+  if (code <= 0) {
+    counters.failures++;
+    closeLocked();
+  }
+  lastUse = millis();
+
+  Serial0.printf("HTTPS POST (chunked) %s -> %d in %u ms (%s), heap held: %d bytes\n",
+                 path, code, latency, reusing ? "reused" : "new TLS session",
+                 counters.lastHeapCost);
+
+  xSemaphoreGive(lock);
+  return code;
+}
+
+void SupabaseClient::closeIfIdle(unsigned long idleMs) {
+  if (lock == nullptr) return;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  if (tls.connected() && millis() - lastUse > idleMs) {
+    closeLocked();
+  }
+  xSemaphoreGive(lock);
+}
+
+void SupabaseClient::close() {
+  if (lock == nullptr) return;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  closeLocked();
+  xSemaphoreGive(lock);
+}
+
+void SupabaseClient::closeLocked() {
+  if (tls.connected()) tls.stop();
+}
+
+SupabaseClient::Stats SupabaseClient::stats() {
+  Stats copy = counters;
+  if (lock == nullptr) return copy;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  copy = counters;
+  xSemaphoreGive(lock);
+  return copy;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SUPABASE_CLIENT_H
+#define SUPABASE_CLIENT_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <functional>
+
+#include "chunked_body.h"
+
+// Долгоживущий HTTPS клиент Supabase REST API.
+// Одно TLS соединение держится открытым (keep-alive) и переиспользуется
+// между запросами: полный TLS handshake стоит секунды и десятки KB кучи.
+// Соединение, закрытое сервером по простою, переоткрывается прозрачно:
+// запрос повторяется один раз на новом соединении.
+class SupabaseClient {
+public:
+  struct Stats {
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t handshakes;     // запросы, потребовавшие нового TLS соединения
+    uint32_t reused;         // запросы по открытому соединению
+    uint32_t reconnects;     // повторы после закрытия соединения сервером
+    uint32_t lastLatencyMs;
+    uint32_t maxLatencyMs;
+    uint32_t totalLatencyMs;
+    int32_t lastHeapCost;    // сколько кучи занято после запроса (TLS буферы)
+  };
+
+  SupabaseClient();
+
+  // rootCa - PEM корневых сертификатов сервера (подряд); nullptr - без проверки
+  void begin(const char* baseUrl, const char* apiKey, const char* rootCa);
+
+  // Возвращает HTTP код или ошибку HTTPClient (<= 0).
+  // response заполняется, если ответ не длиннее maxResponse байт
+  int get(const char* path, String* response, size_t maxResponse);
+  int post(const char* path, const char* prefer, const char* body, size_t length,
+           String* response, size_t maxResponse);
+
+  // Источник тела запроса: заполняет buffer до size байт, 0 - конец тела
+  typedef ChunkProducer BodyProducer;
+
+  // Возвращает источник к началу тела; false - повторить тело нельзя
+  typedef std::function<bool()> BodyRewind;
+
+  // POST с Transfer-Encoding: chunked: тело пишется в сокет кусками по мере
+  // генерации и целиком в памяти не появляется. Тот же keep-alive канал;
+  // как и request(), повторяется на новом соединении, если сервер закрыл
+  // простаивавшее - при уже начатом теле только с rewind.
+  // response - первые maxResponse байт ответа (текст ошибки PostgREST)
+  int postStream(const char* path, const char* prefer, const BodyProducer& producer,
+                 const BodyRewind& rewind = BodyRewind(),
+                 String* response = nullptr, size_t maxResponse = 0);
+
+  // Закрывает соединение, если оно простаивает дольше idleMs
+  void closeIfIdle(unsigned long idleMs);
+  void close();
+  bool isConnected() { return tls.connected(); }
+
+  Stats stats();
+
+private:
+  int request(const char* method, const char* path, const char* prefer,
+              const char* body, size_t length, String* response, size_t maxResponse);
+  void closeLocked();
+  bool ensureConnected();
+  bool writeAll(const uint8_t* data, size_t length);
+  int readResponseStatus(String* response, size_t maxResponse);
+
+  WiFiClientSecure tls;
+  HTTPClient http;
+  SemaphoreHandle_t lock;
+  String baseUrl;
+  String apiKey;
+  String bearer;
+  String host;
+  uint16_t port;
+  unsigned long lastUse;
+  Stats counters;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+#include "tracer.h"
+
+#include <stdio.h>
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+#if TRACE_ENABLED
+Tracer tracer;
+#endif
+
+Tracer::Tracer() {
+  for (size_t core = 0; core < METRIC_CORES; core++) {
+    rings[core].head.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < RING_SIZE; i++) rings[core].slots[i].sequence.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t Tracer::nowUs() {
+#ifdef ARDUINO
+  return (uint64_t)esp_timer_get_time();
+#else
+  static const auto start = std::chrono::steady_clock::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+#endif
+}
+
+static const char* currentTask() {
+#ifdef ARDUINO
+  return pcTaskGetName(nullptr);
+#else
+  return "host";
+#endif
+}
+
+void Tracer::record(const char* name, char phase) {
+  size_t core = metricCore();
+  Ring& ring = rings[core];
+  uint32_t index = ring.head.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = ring.slots[index & (RING_SIZE - 1)];
+  uint64_t timeUs = nowUs();
+
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timeLow.store((uint32_t)timeUs, std::memory_order_relaxed);
+  slot.timeHigh.store((uint32_t)(timeUs >> 32), std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.task.store(currentTask(), std::memory_order_relaxed);
+  slot.phase.store((uint32_t)(uint8_t)phase | (uint32_t)core << 8, std::memory_order_relaxed);
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool Tracer::read(size_t core, uint32_t index, Event& event) const {
+  const Slot& slot = rings[core].slots[index & (RING_SIZE - 1)];
+  uint32_t before = slot.sequence.load(std::memory_order_acquire);
+  if (before != index + 1) return false;
+
+  event.timeUs = (uint64_t)slot.timeHigh.load(std::memory_order_relaxed) << 32 |
+                 slot.timeLow.load(std::memory_order_relaxed);
+  event.name = slot.name.load(std::memory_order_relaxed);
+  event.task = slot.task.load(std::memory_order_relaxed);
+  uint32_t phase = slot.phase.load(std::memory_order_relaxed);
+  event.phase = (char)(phase & 0xFF);
+  event.core = (uint8_t)(phase >> 8);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+
+TraceStream::TraceStream(const Tracer& source)
+  : source(source), stage(0), core(0), next(0), first(true), taskCount(0), taskNamed(0) {
+  for (size_t i = 0; i < METRIC_CORES; i++) end[i] = source.head(i);
+  next = end[0] > Tracer::RING_SIZE ? end[0] - Tracer::RING_SIZE : 0;
+}
+
+uint32_t TraceStream::taskId(const char* task) {
+  for (size_t i = 0; i < taskCount; i++) {
+    if (tasks[i] == task) return (uint32_t)i + 1;
+  }
+  if (taskCount == MAX_TASKS) return 0;
+  tasks[taskCount++] = task;
+  return (uint32_t)taskCount;
+}
+
+// snprintf, обрезанный до размера буфера
+static size_t printed(int written, size_t size) {
+  if (written < 0) return 0;
+  return (size_t)written < size ? (size_t)written : size - 1;
+}
+
+size_t TraceStream::nextRow(char* out, size_t size) {
+  // Одно событие занимает меньше 128 байт (имена - короткие литералы)
+  const size_t EVENT_ROOM = 128;
+  size_t used = 0;
+
+  if (stage == 0) {
+    stage = 1;
+    return printed(snprintf(out, size, "{\"traceEvents\":["), size);
+  }
+
+  while (stage == 1 && size - used >= EVENT_ROOM) {
+    if (next == end[core]) {
+      if (++core == METRIC_CORES) {
+        stage = 2;
+        break;
+      }
+      next = end[core] > Tracer::RING_SIZE ? end[core] - Tracer::RING_SIZE : 0;
+      continue;
+    }
+
+    Tracer::Event event;
+    if (!source.read(core, next++, event)) continue;
+    used += printed(snprintf(out + used, size - used,
+                             "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u,"
+                             "\"args\":{\"core\":%u}}",
+                             first ? "" : ",", event.name, event.phase,
+                             (unsigned long long)event.timeUs, (unsigned)taskId(event.task),
+                             (unsigned)event.core), size - used);
+    first = false;
+  }
+  if (used > 0) return used;
+
+  // Имена задач: Perfetto подписывает ими дорожки tid
+  while (stage == 2 && taskNamed < taskCount && size - used >= EVENT_ROOM) {
+    used += printed(snprintf(out + used, size - used,
+                             "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                             "\"args\":{\"name\":\"%s\"}}",
+                             first ? "" : ",", (unsigned)taskNamed + 1, tasks[taskNamed]), size - used);
+    taskNamed++;
+    first = false;
+  }
+  if (used > 0) return used;
+
+  if (stage == 2) {
+    stage = 3;
+    return printed(snprintf(out, size, "],\"displayTimeUnit\":\"ms\"}\n"), size);
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "metrics.h"
+#include "row_stream.h"
+
+// Трассировка пути одного сэмпла (BLE -> разбор -> состояние -> буфер ->
+// веб, отправка: JSON -> TLS -> POST) в формате Chrome trace_event для
+// Perfetto / chrome://tracing. Событие - метка времени, имя (строковый
+// литерал), фаза, ядро и имя задачи - пишется в кольцо своего ядра без
+// блокировок; старые события перезаписываются.
+//
+// -DTRACE_ENABLED=0 убирает макросы TRACE_* из сборки полностью.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 128   // событий на ядро, степень двойки
+#endif
+
+class Tracer {
+  static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of two");
+
+public:
+  static const size_t RING_SIZE = TRACE_RING_SIZE;
+
+  struct Event {
+    uint64_t timeUs;
+    const char* name;
+    const char* task;
+    char phase;     // 'B' - начало, 'E' - конец, 'i' - мгновенное
+    uint8_t core;
+  };
+
+  Tracer();
+
+  // name - строка со статическим временем жизни (литерал)
+  void record(const char* name, char phase);
+
+  // Номер следующего события ядра; события [head - RING_SIZE, head) в кольце
+  uint32_t head(size_t core) const { return rings[core].head.load(std::memory_order_acquire); }
+  // Событие с номером index; false - уже перезаписано или пишется сейчас
+  bool read(size_t core, uint32_t index, Event& event) const;
+
+  static uint64_t nowUs();
+
+private:
+  // Задачи одного ядра вытесняют друг друга, поэтому номер ячейки
+  // выдаёт fetch_add, а готовность - sequence (index + 1, 0 - пишется).
+  // Поля атомарные, как в Seqlock: смешанная копия отбрасывается
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> timeLow;
+    std::atomic<uint32_t> timeHigh;
+    std::atomic<const char*> name;
+    std::atomic<const char*> task;
+    std::atomic<uint32_t> phase;
+  };
+
+  struct alignas(32) Ring {
+    std::atomic<uint32_t> head;
+    Slot slots[RING_SIZE];
+  };
+
+  Ring rings[METRIC_CORES];
+};
+
+#if TRACE_ENABLED
+extern Tracer tracer;
+
+// Начало и конец участка в одной области видимости
+class TraceScope {
+public:
+  explicit TraceScope(const char* name) : name(name) { tracer.record(name, 'B'); }
+  ~TraceScope() { tracer.record(name, 'E'); }
+
+private:
+  const char* name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_BEGIN(name) tracer.record(name, 'B')
+#define TRACE_END(name) tracer.record(name, 'E')
+#define TRACE_INSTANT(name) tracer.record(name, 'i')
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_SCOPE(name) do {} while (0)
+#endif
+
+// Снимок колец в JSON {"traceEvents":[...]}. Границы колец берутся при
+// создании, события читаются по ходу отправки; перезаписанные за это
+// время пропускаются. tid - задача, ядро - в args; в конце - имена задач
+class TraceStream : public RowStream<256> {
+public:
+  explicit TraceStream(const Tracer& source);
+
+protected:
+  size_t nextRow(char* out, size_t size) override;
+
+private:
+  static const size_t MAX_TASKS = 12;
+
+  uint32_t taskId(const char* task);
+
+  const Tracer& source;
+  uint8_t stage;    // 0 - заголовок, 1 - события, 2 - имена задач, 3 - конец
+  size_t core;
+  uint32_t next;
+  uint32_t end[METRIC_CORES];
+  bool first;
+  const char* tasks[MAX_TASKS];
+  size_t taskCount;
+  size_t taskNamed;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "treadmill_session.h"
+
+#include <new>
+
+#include "tracer.h"
+
+// Пауза между попытками подключения 1-8 с
+static const uint32_t RETRY_BASE_MS = 1000;
+static const uint32_t RETRY_CAP_MS = 8000;
+
+TreadmillSession::TreadmillSession(uint8_t index, const char* address, const char* name,
+                                   BleCentral& central, FlashFs& fs, SessionListener& listener)
+  : deviceIndex(index), deviceAddress(address), deviceName(name), listener(listener),
+    journaling(true), bleLink(central, RETRY_BASE_MS, RETRY_CAP_MS), workoutTracker(*this),
+    workoutJournal(fs, index), merger(storeRecord, this), strapLink(nullptr), strapAddr(nullptr) {}
+
+TreadmillSession::~TreadmillSession() {
+  delete strapLink;
+}
+
+bool TreadmillSession::begin(size_t capacity) {
+  return store.begin(capacity);
+}
+
+bool TreadmillSession::attachStrap(BleCentral& strapCentral, const char* strapAddress) {
+  if (strapLink != nullptr) return true;
+  strapLink = new (std::nothrow) BleLink(strapCentral, RETRY_BASE_MS, RETRY_CAP_MS);
+  if (strapLink == nullptr) return false;
+  strapAddr = strapAddress;
+  return true;
+}
+
+void TreadmillSession::onHeartRate(const RawFrame& frame) {
+  uint8_t bpm;
+  if (!parseHeartRate(frame.data, frame.length, bpm)) return;
+  merger.pushHeartRate(bpm, (uint32_t)(frame.timestampUs / 1000));
+}
+
+void TreadmillSession::poll(uint32_t nowMs) {
+  workoutTracker.poll(nowMs);
+  merger.expectHeartRate(strapLink != nullptr && strapLink->isUp());
+  merger.poll(nowMs);
+}
+
+void TreadmillSession::onWorkoutStart(time_t startTime) {
+  if (journaling) workoutJournal.beginSession(startTime);
+  listener.onWorkoutStart(*this, startTime);
+}
+
+// Запись трекера ждёт пульса ремня; без ремня выходит сразу
+void TreadmillSession::onSample(const WorkoutRecord& record) {
+  merger.pushRecord(record, workoutTracker.recordMs());
+}
+
+void TreadmillSession::storeRecord(const WorkoutRecord& record, void* context) {
+  TreadmillSession* self = (TreadmillSession*)context;
+  TRACE_BEGIN("buffer_append");
+  self->store.add(record);
+  if (self->journaling) self->workoutJournal.addSample(record);
+  TRACE_END("buffer_append");
+  self->listener.onSample(*self, record);
+}
+
+void TreadmillSession::onWorkoutEnd(time_t startTime, time_t endTime) {
+  merger.flush();
+  char journalPath[48] = "";
+  if (journaling && !workoutJournal.endSession(endTime, journalPath, sizeof(journalPath))) {
+    journalPath[0] = '\0';
+  }
+  listener.onWorkoutEnd(*this, startTime, endTime, journalPath);
+  store.clear();
+}
+
+void TreadmillSession::onWorkoutDiscard(const char* reason) {
+  merger.clear();
+  store.clear();
+  workoutJournal.discardSession();
+  listener.onWorkoutDiscard(*this, reason);
+}
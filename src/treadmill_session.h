@@ -0,0 +1,106 @@
+#ifndef TREADMILL_SESSION_H
+#define TREADMILL_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ble_link.h"
+#include "flash_fs.h"
+#include "frame_queue.h"
+#include "heart_rate.h"
+#include "session_store.h"
+#include "workout_journal.h"
+#include "workout_tracker.h"
+
+class TreadmillSession;
+
+// События тренировки одной дорожки. Буфер и журнал сессия ведёт сама,
+// владельцу остаются индикация, очередь отправки и архив
+class SessionListener {
+public:
+  virtual ~SessionListener() {}
+
+  virtual void onWorkoutStart(TreadmillSession& session, time_t startTime) = 0;
+  virtual void onSample(TreadmillSession&, const WorkoutRecord&) {}
+  // journalPath - закрытый журнал в PENDING_DIR, "" - журнала нет.
+  // Буфер сессии очищается после возврата; чтобы обработать тренировку
+  // позже, слушатель обменивает его (std::swap) на пустой того же размера
+  virtual void onWorkoutEnd(TreadmillSession& session, time_t startTime, time_t endTime,
+                            const char* journalPath) = 0;
+  virtual void onWorkoutDiscard(TreadmillSession& session, const char* reason) = 0;
+};
+
+// Одна дорожка зала: связь (BleLink), очередь кадров от стека BLE,
+// трекер, буфер сессии и журнал на флеше. Дорожки не делят состояние,
+// поэтому кадр обрабатывается за O(1) при любом их числе; общие у них
+// только флеш, очередь отправки и архив владельца.
+//
+// К дорожке можно привязать нагрудный ремень (attachStrap): его кадры
+// идут своей очередью, а записи трекера проходят HeartRateMerger, прежде
+// чем попасть в буфер, журнал и слушателю.
+class TreadmillSession : private WorkoutListener {
+public:
+  static const size_t QUEUE_SIZE = 64;
+  static const size_t HEART_QUEUE_SIZE = 8;   // ремень шлёт раз в ~1 с
+
+  TreadmillSession(uint8_t index, const char* address, const char* name,
+                   BleCentral& central, FlashFs& fs, SessionListener& listener);
+  ~TreadmillSession();
+  TreadmillSession(const TreadmillSession&) = delete;
+  TreadmillSession& operator=(const TreadmillSession&) = delete;
+
+  // Буфер сессии на capacity точек; false - не хватило памяти
+  bool begin(size_t capacity);
+  // Журнал на флеше (без смонтированной ФС - только буфер в RAM)
+  void setJournaling(bool enabled) { journaling = enabled; }
+  // Ремень с сервисом 0x180D на своём соединении; false - нет памяти
+  bool attachStrap(BleCentral& strapCentral, const char* strapAddress);
+
+  // Кадр Heart Rate Measurement из heartRateFrames()
+  void onHeartRate(const RawFrame& frame);
+  // Таймаут тренировки и записи, дождавшиеся пульса; из задачи обработки
+  void poll(uint32_t nowMs);
+
+  uint8_t index() const { return deviceIndex; }
+  const char* address() const { return deviceAddress; }
+  const char* name() const { return deviceName; }
+
+  BleLink& link() { return bleLink; }
+  FrameQueue<QUEUE_SIZE>& frames() { return queue; }
+  // Ремень: nullptr - не привязан
+  BleLink* strap() { return strapLink; }
+  const char* strapAddress() const { return strapAddr; }
+  FrameQueue<HEART_QUEUE_SIZE>& heartRateFrames() { return heartQueue; }
+  const HeartRateMerger& heartRate() const { return merger; }
+  WorkoutTracker& tracker() { return workoutTracker; }
+  const WorkoutTracker& tracker() const { return workoutTracker; }
+  SessionStore& buffer() { return store; }
+  WorkoutJournal& journal() { return workoutJournal; }
+
+private:
+  void onWorkoutStart(time_t startTime) override;
+  void onSample(const WorkoutRecord& record) override;
+  void onWorkoutEnd(time_t startTime, time_t endTime) override;
+  void onWorkoutDiscard(const char* reason) override;
+  static void storeRecord(const WorkoutRecord& record, void* context);
+
+  uint8_t deviceIndex;
+  const char* deviceAddress;
+  const char* deviceName;
+  SessionListener& listener;
+  bool journaling;
+
+  BleLink bleLink;
+  FrameQueue<QUEUE_SIZE> queue;
+  WorkoutTracker workoutTracker;
+  SessionStore store;
+  WorkoutJournal workoutJournal;
+
+  HeartRateMerger merger;
+  BleLink* strapLink;
+  const char* strapAddr;
+  FrameQueue<HEART_QUEUE_SIZE> heartQueue;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "upload_outbox.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Записи в каталоге - только *.json; вложенный dead/ list() не отдаёт
+static bool isRowFile(const char* path) {
+  size_t len = strlen(path);
+  return len > 5 && strcmp(path + len - 5, ".json") == 0;
+}
+
+UploadOutbox::UploadOutbox(FlashFs& fs, const char* directory) : fs(fs), entries(0) {
+  snprintf(dir, sizeof(dir), "%s", directory);
+}
+
+void UploadOutbox::scan() {
+  size_t found = 0;
+  fs.list(dir, [&](const char* path) {
+    if (isRowFile(path)) found++;
+  });
+  entries = found;
+}
+
+bool UploadOutbox::enqueue(const char* key, const char* row, size_t length) {
+  if (length == 0 || length > MAX_ROW) return false;
+
+  char path[MAX_PATH];
+  snprintf(path, sizeof(path), "%s/%s.json", dir, key);
+
+  // Повторная постановка того же ключа (восстановление после сбоя)
+  // просто перезаписывает строку
+  bool existed = fs.exists(path);
+  if (existed) fs.remove(path);
+
+  // Пишем во временный файл и переименовываем: обрыв не оставит полстроки
+  char temp[MAX_PATH];
+  snprintf(temp, sizeof(temp), "%s/%s.tmp", dir, key);
+  fs.remove(temp);
+  if (!fs.append(temp, row, length) || !fs.rename(temp, path)) {
+    fs.remove(temp);
+    if (existed) countRemoved();
+    return false;
+  }
+
+  if (!existed) entries++;
+  return true;
+}
+
+size_t UploadOutbox::peek(char paths[][MAX_PATH], size_t max) {
+  size_t found = 0;
+  size_t total = 0;
+
+  // Вставка в отсортированный массив из max элементов: O(n * max)
+  fs.list(dir, [&](const char* path) {
+    if (!isRowFile(path)) return;
+    total++;
+
+    size_t pos = found;
+    while (pos > 0 && strcmp(path, paths[pos - 1]) < 0) pos--;
+    if (pos >= max) return;
+
+    size_t last = found < max ? found : max - 1;
+    for (size_t i = last; i > pos; i--) {
+      memcpy(paths[i], paths[i - 1], MAX_PATH);
+    }
+    snprintf(paths[pos], MAX_PATH, "%s", path);
+    if (found < max) found++;
+  });
+
+  entries = total;
+  return found;
+}
+
+size_t UploadOutbox::read(const char* path, char* out, size_t size) {
+  if (size == 0) return 0;
+  size_t length = fs.size(path);
+  if (length == 0 || length >= size) return 0;
+  if (fs.read(path, 0, out, length) != length) return 0;
+  out[length] = '\0';
+  return length;
+}
+
+bool UploadOutbox::remove(const char* path) {
+  if (!fs.remove(path)) return false;
+  countRemoved();
+  return true;
+}
+
+bool UploadOutbox::quarantine(const char* path) {
+  const char* name = strrchr(path, '/');
+  char target[MAX_PATH];
+  snprintf(target, sizeof(target), "%s/dead%s", dir, name != nullptr ? name : "/row.json");
+
+  if (!fs.rename(path, target)) return false;
+  countRemoved();
+  return true;
+}
+
+// Счётчик не уходит ниже нуля: пересчёт в peek() мог уже учесть удаление
+void UploadOutbox::countRemoved() {
+  size_t current = entries.load();
+  while (current > 0 && !entries.compare_exchange_weak(current, current - 1)) {
+  }
+}
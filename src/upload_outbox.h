@@ -0,0 +1,48 @@
+#ifndef UPLOAD_OUTBOX_H
+#define UPLOAD_OUTBOX_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flash_fs.h"
+
+// Очередь отправки на флеше (store-and-forward).
+// Каждая готовая строка таблицы workouts лежит отдельным файлом
+// <dir>/<key>.json, где key - клиентский ключ идемпотентности.
+// Файл удаляется только после подтверждения от сервера, поэтому
+// очередь переживает перезагрузку и любые сбои сети.
+class UploadOutbox {
+public:
+  static const size_t MAX_PATH = 64;
+  static const size_t MAX_ROW = 1024;   // со сплитами: 50 км и 32 мили
+
+  UploadOutbox(FlashFs& fs, const char* dir);
+
+  // Пересчитывает количество записей по содержимому каталога
+  void scan();
+
+  bool enqueue(const char* key, const char* row, size_t length);
+  size_t count() const { return entries; }
+
+  // До max самых старых записей (ключ начинается со времени старта,
+  // поэтому порядок имён совпадает с порядком тренировок)
+  size_t peek(char paths[][MAX_PATH], size_t max);
+  // Читает строку записи; 0 - ошибка
+  size_t read(const char* path, char* out, size_t size);
+
+  bool remove(const char* path);
+  // Запись, которую сервер отвергает всегда, уходит в <dir>/dead,
+  // чтобы не блокировать очередь
+  bool quarantine(const char* path);
+
+private:
+  void countRemoved();
+
+  FlashFs& fs;
+  char dir[32];
+  // Ставит в очередь задача обработки, снимает задача HTTP, читает веб
+  std::atomic<size_t> entries;
+};
+
+#endif
@@ -0,0 +1,159 @@
+// Сгенерировано scripts/build_web_assets.py из каталога web/ - не редактировать
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <pgmspace.h>
+#else
+#define PROGMEM
+#endif
+
+// index.html: 8505 -> 2196 байт
+static const char INDEX_HTML_TYPE[] = "text/html";
+static const char INDEX_HTML_ETAG[] = "\"a52e43f25d432882\"";
+static const size_t INDEX_HTML_GZ_LENGTH = 2196;
+static const uint8_t INDEX_HTML_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xb5, 0x58, 0xeb, 0x6e, 0x1b, 0xc7,
+  0x15, 0xfe, 0xcf, 0xa7, 0x18, 0xd3, 0x30, 0x76, 0xd9, 0x70, 0x97, 0x4b, 0xdd, 0x2c, 0xf3, 0x16,
+  0xb8, 0xb2, 0x02, 0x38, 0x70, 0x9d, 0x20, 0x52, 0xd2, 0x16, 0x41, 0x60, 0x0c, 0x77, 0x67, 0xc9,
+  0x8d, 0x96, 0x3b, 0xec, 0xcc, 0x90, 0x94, 0x5a, 0x18, 0x88, 0x63, 0xe4, 0x02, 0x34, 0x88, 0x8a,
+  0x20, 0x69, 0x83, 0xa2, 0x8d, 0x91, 0xbc, 0x40, 0x9d, 0x22, 0x46, 0x55, 0xdf, 0x0a, 0xf4, 0x09,
+  0x96, 0x6f, 0x92, 0x47, 0xe8, 0x39, 0xb3, 0x57, 0x4a, 0xa4, 0x1c, 0x47, 0x28, 0x08, 0x69, 0xc9,
+  0x99, 0x39, 0xe7, 0x7c, 0xe7, 0x7e, 0x66, 0x3b, 0x97, 0x6e, 0xbc, 0xb1, 0xb3, 0xff, 0xdb, 0x37,
+  0x77, 0xc9, 0x50, 0x8d, 0xc2, 0x5e, 0xa5, 0x93, 0x3d, 0x18, 0xf5, 0xe0, 0x31, 0x62, 0x8a, 0x12,
+  0x77, 0x48, 0x85, 0x64, 0xaa, 0x5b, 0x9d, 0x28, 0xdf, 0xda, 0xae, 0x66, 0xcb, 0x11, 0x1d, 0xb1,
+  0x6e, 0x75, 0x1a, 0xb0, 0xd9, 0x98, 0x0b, 0x55, 0x25, 0x2e, 0x8f, 0x14, 0x8b, 0xe0, 0xd8, 0x2c,
+  0xf0, 0xd4, 0xb0, 0xeb, 0xb1, 0x69, 0xe0, 0x32, 0x4b, 0xff, 0xa8, 0x93, 0x20, 0x0a, 0x54, 0x40,
+  0x43, 0x4b, 0xba, 0x34, 0x64, 0xdd, 0x26, 0x32, 0x51, 0x81, 0x0a, 0x59, 0x2f, 0xfe, 0x6e, 0xfe,
+  0x41, 0xfc, 0x28, 0x7e, 0x16, 0x9f, 0xc0, 0xf3, 0x79, 0xfc, 0xcf, 0xf8, 0xf9, 0xfc, 0x93, 0xf8,
+  0xd9, 0xfc, 0x8f, 0xf1, 0xbf, 0x49, 0xfc, 0x14, 0x16, 0x70, 0xe3, 0x43, 0x58, 0xfc, 0x80, 0xec,
+  0xee, 0xbd, 0xb9, 0xbe, 0x66, 0xed, 0xad, 0x77, 0x1a, 0x09, 0x65, 0xa5, 0x23, 0xd5, 0x11, 0x3e,
+  0xfb, 0xdc, 0x3b, 0x22, 0x7f, 0xa8, 0xf8, 0x20, 0xdf, 0xf2, 0xe9, 0x28, 0x08, 0x8f, 0x5a, 0xe4,
+  0xba, 0x00, 0x69, 0x75, 0x22, 0x69, 0x24, 0x2d, 0xc9, 0x44, 0xe0, 0xb7, 0x2b, 0x23, 0x2a, 0x06,
+  0x41, 0xd4, 0x22, 0x6b, 0xce, 0xf8, 0xb0, 0x5d, 0xe9, 0x53, 0xf7, 0x60, 0x20, 0xf8, 0x24, 0xf2,
+  0x2c, 0x97, 0x87, 0x5c, 0xb4, 0xc8, 0x65, 0xdf, 0xc1, 0x4f, 0xbb, 0x72, 0xb7, 0x62, 0xa3, 0x2e,
+  0x34, 0x88, 0x98, 0x00, 0xbe, 0x23, 0x7a, 0x98, 0x68, 0xd1, 0x22, 0x5b, 0x8e, 0xa6, 0xcd, 0x38,
+  0x39, 0x84, 0x4e, 0x14, 0x2f, 0xf3, 0x6a, 0x91, 0xd9, 0x30, 0x50, 0x0c, 0x96, 0xb8, 0xf0, 0x98,
+  0xb0, 0x04, 0xf5, 0x82, 0x89, 0x6c, 0x91, 0xa6, 0xa6, 0x1b, 0x53, 0xcf, 0x0b, 0xa2, 0x41, 0x0e,
+  0x81, 0x1f, 0x5a, 0x72, 0x48, 0x3d, 0x3e, 0x43, 0x56, 0x1b, 0xe3, 0x43, 0xb2, 0x05, 0x7f, 0x62,
+  0xd0, 0xa7, 0xa6, 0x53, 0xd7, 0x1f, 0xbb, 0x59, 0xd3, 0x70, 0xd0, 0x1b, 0x1a, 0x8b, 0x62, 0x87,
+  0xca, 0xa2, 0x61, 0x30, 0x00, 0xe9, 0x2e, 0x18, 0x9b, 0x89, 0x76, 0x25, 0x83, 0xbf, 0xbe, 0xbe,
+  0x9e, 0x41, 0xb3, 0xfa, 0x5c, 0x29, 0x3e, 0x6a, 0x91, 0x75, 0x2d, 0x08, 0x38, 0x80, 0xc7, 0x44,
+  0xe0, 0x02, 0x07, 0x2f, 0x90, 0xe3, 0x90, 0x82, 0x85, 0xfc, 0x90, 0xc1, 0xd6, 0xfb, 0x13, 0xa9,
+  0x02, 0xff, 0xc8, 0x4a, 0x9d, 0xd7, 0x22, 0x72, 0x4c, 0xc1, 0x6b, 0x7d, 0xa6, 0x66, 0x8c, 0x45,
+  0xed, 0x8a, 0x96, 0x65, 0x81, 0x4a, 0x23, 0x59, 0x48, 0xcc, 0xf5, 0x68, 0x6e, 0x96, 0xcd, 0x81,
+  0x4a, 0x12, 0x67, 0xd1, 0x1c, 0x97, 0xfd, 0x6d, 0xff, 0x9a, 0x4f, 0xcf, 0x18, 0x64, 0x3b, 0x31,
+  0x80, 0x5e, 0x0b, 0x99, 0x0f, 0x82, 0x51, 0x7f, 0xc9, 0xc3, 0xc0, 0x23, 0x97, 0x1d, 0xe7, 0x6a,
+  0xdf, 0xf7, 0x4b, 0xb8, 0x6d, 0xea, 0xaa, 0x60, 0xca, 0x00, 0x7e, 0x89, 0x24, 0xf7, 0xdb, 0xda,
+  0x36, 0xbd, 0xba, 0xb1, 0x79, 0x4a, 0xae, 0xb7, 0xc1, 0x3c, 0x8f, 0x96, 0x78, 0x58, 0x21, 0xed,
+  0xb3, 0x30, 0x8b, 0x93, 0x19, 0x0b, 0x06, 0x43, 0x90, 0xda, 0xe7, 0xa1, 0x57, 0x98, 0x70, 0xe3,
+  0xda, 0xa6, 0xb3, 0x79, 0xb5, 0x4c, 0x34, 0xa5, 0xe1, 0x84, 0x65, 0x44, 0x32, 0xf8, 0x3d, 0x03,
+  0xe7, 0x6d, 0x20, 0xf6, 0x73, 0xb8, 0xac, 0x35, 0xd7, 0x36, 0xd7, 0xae, 0x69, 0x2e, 0x52, 0x51,
+  0x35, 0x91, 0x2b, 0x1c, 0x57, 0x98, 0xd1, 0x29, 0x59, 0x23, 0xb3, 0xd0, 0x82, 0x69, 0xd7, 0x52,
+  0xd3, 0x2e, 0x91, 0x9a, 0x4b, 0xc1, 0x47, 0xe4, 0xf5, 0x21, 0x15, 0xc8, 0x82, 0x25, 0x5c, 0x97,
+  0x5d, 0x05, 0x6b, 0x92, 0x0c, 0x9e, 0xe3, 0x6c, 0x6d, 0xb9, 0x6e, 0x9b, 0x14, 0x84, 0x99, 0x75,
+  0x4f, 0xd3, 0xf9, 0x3e, 0x9e, 0x2b, 0xd3, 0x39, 0x4e, 0x99, 0x8e, 0x45, 0x1e, 0xf3, 0x4e, 0x93,
+  0xf9, 0xfe, 0x22, 0x99, 0xeb, 0xe6, 0x64, 0x93, 0xb1, 0x47, 0x15, 0xb3, 0x54, 0x30, 0x62, 0x2f,
+  0x88, 0xe5, 0xad, 0xad, 0xad, 0x76, 0xd9, 0xe6, 0xcd, 0x8d, 0xc2, 0x1a, 0x96, 0xe2, 0xe3, 0x2c,
+  0x85, 0x80, 0xe9, 0x58, 0xf0, 0x81, 0x60, 0x12, 0x8d, 0x9c, 0x66, 0x69, 0xd3, 0x71, 0xae, 0xb4,
+  0x2b, 0xc3, 0xd4, 0x4a, 0xcd, 0x53, 0xe9, 0x0e, 0xdc, 0x99, 0x83, 0x9f, 0xe5, 0x16, 0xe7, 0x53,
+  0x26, 0xfc, 0x10, 0x53, 0x72, 0x18, 0x78, 0x1e, 0xa6, 0xc0, 0xe9, 0xf0, 0x2e, 0xc9, 0xb4, 0xfa,
+  0x14, 0xb3, 0xb2, 0x10, 0x85, 0x82, 0xcb, 0xa2, 0x42, 0xa8, 0x21, 0x54, 0x58, 0x03, 0x14, 0x01,
+  0x2a, 0x9a, 0xd7, 0x1c, 0x8f, 0x0d, 0xea, 0x59, 0x84, 0xd7, 0xb3, 0xd8, 0x85, 0x2c, 0x4f, 0xb1,
+  0x23, 0x03, 0x25, 0xa0, 0x6a, 0x41, 0xb9, 0xe4, 0x20, 0x54, 0x2f, 0x13, 0xc7, 0x5e, 0x97, 0x84,
+  0x51, 0xc9, 0xb4, 0xf4, 0xa4, 0xb2, 0x16, 0xc9, 0xa0, 0xed, 0xd1, 0x2c, 0xd2, 0x27, 0x53, 0x2f,
+  0x8d, 0xaf, 0x74, 0xdf, 0x39, 0x6d, 0xc1, 0x66, 0x66, 0xc1, 0xb4, 0x52, 0x63, 0x3d, 0x5f, 0x8c,
+  0xf4, 0xe6, 0xf6, 0x0b, 0x22, 0x5d, 0x97, 0x9c, 0x9c, 0x83, 0xcd, 0x7d, 0x1f, 0x15, 0x86, 0x88,
+  0xe0, 0x50, 0x45, 0x02, 0x05, 0x55, 0xc6, 0xb1, 0x37, 0xd1, 0xf5, 0x9d, 0x46, 0x5a, 0xab, 0x3b,
+  0x8d, 0xb4, 0xb3, 0x60, 0xd1, 0x86, 0x87, 0x17, 0x4c, 0x89, 0x1b, 0x52, 0x29, 0xbb, 0xd5, 0xbc,
+  0xe6, 0x62, 0x73, 0x18, 0x36, 0xb3, 0xe5, 0xa4, 0xf6, 0x55, 0x7b, 0x3f, 0x3e, 0x38, 0xbe, 0x4f,
+  0xce, 0xeb, 0x16, 0x7f, 0x2b, 0x77, 0x0b, 0x90, 0xd3, 0x4c, 0xd9, 0x07, 0x5e, 0xb7, 0x9a, 0x00,
+  0x94, 0xd5, 0x5e, 0xa7, 0x01, 0x4b, 0x8b, 0x72, 0x4b, 0x51, 0x09, 0x92, 0xe3, 0x07, 0x40, 0x7e,
+  0x2f, 0x7e, 0x02, 0x52, 0x7e, 0x00, 0x76, 0x8f, 0xe2, 0x47, 0x04, 0xf8, 0x7e, 0x0f, 0x5f, 0x51,
+  0xdc, 0x93, 0x44, 0x78, 0xfc, 0xa8, 0x45, 0x3a, 0x50, 0x29, 0x23, 0xcd, 0x1c, 0xd8, 0xa8, 0xb7,
+  0x35, 0x93, 0x6a, 0xcf, 0x02, 0x4d, 0x61, 0x1d, 0x15, 0x7d, 0x91, 0xa0, 0x6f, 0xe3, 0xc7, 0xf1,
+  0x43, 0x80, 0xff, 0x70, 0xfe, 0xe1, 0xfc, 0x33, 0x12, 0xff, 0xa7, 0x2c, 0x77, 0xfe, 0xf9, 0xfc,
+  0x73, 0x02, 0xeb, 0x8b, 0xca, 0x3e, 0x9e, 0xdf, 0x6f, 0x55, 0x3a, 0x94, 0x0c, 0x05, 0xf3, 0xbb,
+  0xd5, 0x06, 0x1d, 0x07, 0x8d, 0x19, 0x17, 0x07, 0x7c, 0xa2, 0x64, 0x23, 0x04, 0xd6, 0x52, 0x35,
+  0xd8, 0x21, 0x36, 0x63, 0xdb, 0x0f, 0x54, 0xb5, 0xf7, 0xda, 0xcd, 0xfd, 0x4e, 0x83, 0xf6, 0xc8,
+  0x7f, 0xff, 0xf5, 0xd3, 0x88, 0x94, 0x7b, 0x58, 0xed, 0xed, 0xef, 0xfc, 0xe6, 0xa5, 0x88, 0x5c,
+  0x39, 0xad, 0xf6, 0x76, 0xf6, 0xde, 0x41, 0xa2, 0x5c, 0xe9, 0xf4, 0x01, 0x5d, 0x63, 0x8c, 0xa7,
+  0x4b, 0x2e, 0xb0, 0x5c, 0x2a, 0xbc, 0xea, 0xa2, 0x5d, 0x92, 0x9d, 0xa5, 0x8b, 0x3a, 0x28, 0x97,
+  0x7a, 0x2d, 0xad, 0xac, 0x69, 0xcd, 0xab, 0xf6, 0xe2, 0x6f, 0xe2, 0x3f, 0xc7, 0x5f, 0xc7, 0x5f,
+  0xc6, 0x7f, 0x8a, 0xff, 0x0e, 0xcf, 0xaf, 0x96, 0x90, 0x24, 0x25, 0x1d, 0xe5, 0x68, 0xd7, 0x2d,
+  0xac, 0x26, 0xdd, 0x01, 0xd8, 0xa0, 0x57, 0x9e, 0xa3, 0xbd, 0xe7, 0xf7, 0xd0, 0x2f, 0xad, 0xdc,
+  0x9f, 0x4b, 0x68, 0x74, 0x73, 0x00, 0x74, 0xe5, 0x2d, 0x39, 0x66, 0x0c, 0x14, 0x74, 0x6c, 0x27,
+  0xa5, 0x24, 0xc0, 0xf0, 0x69, 0x63, 0xfe, 0xc9, 0x39, 0x81, 0xf1, 0x93, 0x80, 0x7d, 0x09, 0x61,
+  0x00, 0x90, 0xe2, 0x87, 0x10, 0x1d, 0x1f, 0xc3, 0xf7, 0xe3, 0x97, 0x86, 0x06, 0xad, 0x1f, 0xac,
+  0x85, 0x96, 0x2e, 0xb0, 0x3d, 0xbd, 0x28, 0xac, 0x2f, 0x74, 0x8c, 0x3e, 0x9d, 0x1f, 0x2f, 0x09,
+  0xd7, 0xf8, 0xe4, 0xe5, 0x31, 0x4e, 0x04, 0xc5, 0xca, 0x07, 0x18, 0x9d, 0x96, 0x93, 0xe1, 0xbc,
+  0x28, 0xc8, 0x07, 0xf3, 0xfb, 0xf1, 0x93, 0xf9, 0x67, 0xf3, 0x7b, 0x2f, 0x8d, 0x07, 0xaa, 0x8f,
+  0x50, 0xd0, 0x21, 0x74, 0x6e, 0x67, 0xc9, 0x4d, 0x80, 0xdd, 0x0f, 0x0d, 0x18, 0x4f, 0x4f, 0xe2,
+  0x67, 0x17, 0x85, 0xf6, 0xad, 0x36, 0x1a, 0xa6, 0xfc, 0x31, 0xda, 0xf0, 0xde, 0x05, 0xc3, 0x8f,
+  0x4e, 0x07, 0xd6, 0xff, 0x2d, 0x04, 0xff, 0x0a, 0xc1, 0xf7, 0x44, 0xc3, 0x3b, 0xf9, 0x19, 0xae,
+  0x85, 0xc9, 0x9f, 0x8b, 0x00, 0x8b, 0x70, 0x19, 0xd7, 0x63, 0xe4, 0x79, 0x61, 0xff, 0x2e, 0xd4,
+  0xec, 0x13, 0xec, 0x06, 0xa0, 0xf1, 0xcf, 0xc8, 0xdd, 0x30, 0x50, 0xd6, 0xc1, 0xa8, 0xe4, 0xea,
+  0x73, 0x90, 0x65, 0x43, 0x40, 0x75, 0xf9, 0x32, 0xce, 0x06, 0x45, 0xe5, 0x3a, 0xf5, 0xc8, 0x2a,
+  0x23, 0x62, 0x73, 0x45, 0x30, 0x56, 0x3d, 0xe8, 0xa9, 0x91, 0x54, 0x04, 0xcb, 0xa3, 0x24, 0x5d,
+  0xf2, 0xee, 0x7b, 0xd0, 0x78, 0x27, 0x91, 0x8b, 0xb9, 0x40, 0x92, 0x5a, 0xb8, 0x03, 0x5b, 0x66,
+  0x00, 0x23, 0xd7, 0x61, 0x0d, 0xda, 0x74, 0xe0, 0x13, 0xf3, 0x92, 0x3e, 0xfd, 0xae, 0x5e, 0x7b,
+  0x0f, 0x17, 0x0b, 0x1e, 0xc0, 0xc2, 0xe3, 0xee, 0x64, 0x04, 0x43, 0x87, 0x3d, 0x60, 0x6a, 0x37,
+  0x64, 0xf8, 0xf5, 0x97, 0x47, 0x37, 0x3d, 0xd3, 0x28, 0x55, 0x62, 0xa3, 0x66, 0xa7, 0x93, 0x3f,
+  0xb4, 0x0c, 0x21, 0xb3, 0x73, 0x3b, 0xc3, 0x20, 0xf4, 0x6c, 0x37, 0xe4, 0x11, 0xbb, 0xcd, 0x3d,
+  0x66, 0x2a, 0x31, 0x61, 0x30, 0xa3, 0xbc, 0x80, 0xa3, 0x04, 0x6e, 0x74, 0x3c, 0x86, 0xa9, 0x50,
+  0xd3, 0x9b, 0x28, 0x00, 0xa8, 0xca, 0x20, 0x01, 0x16, 0xfe, 0xc4, 0xa1, 0x41, 0x30, 0x35, 0x11,
+  0x11, 0x29, 0xef, 0xe2, 0x72, 0xae, 0xb4, 0xc0, 0xe9, 0x52, 0xdc, 0xd0, 0x9c, 0x35, 0xab, 0x7a,
+  0x6a, 0x07, 0xad, 0x28, 0xfc, 0xb6, 0x7f, 0x37, 0x61, 0xe2, 0x68, 0x8f, 0x85, 0xcc, 0x55, 0x5c,
+  0x98, 0x46, 0x79, 0x8e, 0x01, 0x24, 0x38, 0x5e, 0xee, 0x24, 0xba, 0xa1, 0x31, 0x92, 0x09, 0x05,
+  0xf7, 0xda, 0xcb, 0xa9, 0x75, 0xd6, 0xac, 0xa2, 0xd3, 0x9b, 0x2b, 0x08, 0xb3, 0xb2, 0xba, 0x8a,
+  0x36, 0xdb, 0x5f, 0x45, 0x9e, 0x56, 0xbc, 0x33, 0xe4, 0x3e, 0x17, 0x23, 0xaa, 0xf6, 0x61, 0x5a,
+  0x30, 0x33, 0x4e, 0xe9, 0xd1, 0xda, 0x0a, 0x56, 0x45, 0xb1, 0x5a, 0x85, 0x45, 0x9f, 0xb8, 0x83,
+  0x27, 0xc8, 0xa5, 0x2e, 0x89, 0x26, 0x61, 0x48, 0x5e, 0x5d, 0xb2, 0xd7, 0x22, 0x86, 0x65, 0x19,
+  0x2b, 0xa4, 0xe4, 0x25, 0x66, 0x95, 0x10, 0x38, 0x70, 0xe7, 0x3c, 0x83, 0x65, 0x85, 0x60, 0x15,
+  0x7d, 0xb6, 0xbf, 0xd2, 0x51, 0x49, 0x96, 0xae, 0xf6, 0x15, 0xec, 0xdf, 0x39, 0x18, 0x95, 0x34,
+  0x3c, 0x6b, 0xca, 0xec, 0x50, 0x6d, 0x51, 0x57, 0x9d, 0xc3, 0xb7, 0xc0, 0x61, 0xb6, 0xe2, 0x83,
+  0x41, 0xc8, 0x4c, 0x23, 0x9d, 0x69, 0x8d, 0x3a, 0xb9, 0x94, 0xc1, 0xe3, 0x51, 0x04, 0x58, 0x98,
+  0x8e, 0x6d, 0x9d, 0x70, 0xc9, 0x2c, 0xb2, 0x1b, 0xa6, 0xd1, 0x7d, 0x16, 0xb1, 0xde, 0x37, 0xe0,
+  0x7c, 0x76, 0x72, 0x85, 0xe2, 0x19, 0xe7, 0xc2, 0x29, 0x48, 0xa0, 0xfd, 0x01, 0x53, 0xcd, 0x57,
+  0xf1, 0x77, 0x04, 0xe6, 0x93, 0x2f, 0xe2, 0x7f, 0xc4, 0x7f, 0x89, 0xbf, 0x36, 0x4a, 0xdc, 0x34,
+  0xec, 0xdb, 0x38, 0xbf, 0x77, 0x89, 0x91, 0x4e, 0x46, 0x06, 0x79, 0x65, 0x81, 0x09, 0x68, 0x74,
+  0x8b, 0xcf, 0x98, 0xd8, 0x81, 0x6b, 0x84, 0x99, 0x43, 0x4f, 0xaf, 0x7e, 0xdd, 0x45, 0x79, 0xdd,
+  0x2e, 0xf0, 0xb9, 0xbe, 0xb3, 0x7f, 0xf3, 0x9d, 0xdd, 0xa5, 0x51, 0x70, 0x3d, 0x0c, 0x41, 0xad,
+  0xa4, 0x92, 0x82, 0x1b, 0xc0, 0xbc, 0xbb, 0xd4, 0x1d, 0x9a, 0xe9, 0x4b, 0x86, 0x6e, 0x8f, 0xa4,
+  0xd7, 0xf6, 0xb3, 0xe6, 0x4c, 0xe4, 0x81, 0x35, 0x93, 0x2f, 0xb5, 0x1c, 0x48, 0x7e, 0x8d, 0xeb,
+  0x66, 0x98, 0x5e, 0x25, 0xbf, 0xa2, 0x6a, 0x68, 0x8f, 0x82, 0xc8, 0x34, 0xcb, 0x69, 0x48, 0x1a,
+  0xa4, 0xb9, 0x59, 0x23, 0xbf, 0xc0, 0xeb, 0x56, 0x1d, 0xff, 0xa1, 0x0f, 0x9d, 0x15, 0xc1, 0x52,
+  0xae, 0xc6, 0x80, 0x54, 0xdf, 0x42, 0xec, 0xe4, 0x52, 0xd5, 0x2d, 0x64, 0xbe, 0x42, 0x8c, 0x2b,
+  0xc6, 0x92, 0xea, 0x63, 0xc2, 0xc0, 0x4e, 0xb1, 0xde, 0xe0, 0x33, 0xad, 0x2f, 0x32, 0x57, 0x37,
+  0x45, 0x85, 0x2f, 0xb7, 0x74, 0x51, 0x06, 0xbd, 0x17, 0x8a, 0xd6, 0x99, 0xb2, 0x9d, 0x57, 0xb0,
+  0xf3, 0x6a, 0x69, 0x71, 0x9b, 0x38, 0x13, 0xe0, 0x11, 0x9b, 0x91, 0x1b, 0xb0, 0x61, 0xd6, 0xb4,
+  0x33, 0xf1, 0x55, 0x1a, 0xc6, 0xf4, 0x1e, 0xd8, 0x3a, 0x1a, 0x98, 0x86, 0x98, 0x58, 0x6f, 0xbd,
+  0x6d, 0xd4, 0x16, 0xf4, 0x48, 0xee, 0x1c, 0x40, 0x44, 0x4d, 0xd4, 0xc3, 0x67, 0x0a, 0x80, 0x1b,
+  0x0d, 0xd4, 0xc7, 0xa8, 0x55, 0x6c, 0x35, 0x64, 0x91, 0x09, 0x26, 0x18, 0x83, 0x0f, 0x58, 0xa2,
+  0x40, 0xf2, 0xdd, 0x7e, 0x5f, 0xf2, 0xc8, 0xac, 0x15, 0x47, 0x50, 0x2f, 0xf8, 0xe5, 0x52, 0x64,
+  0xc0, 0x84, 0xe0, 0x02, 0x8f, 0x27, 0x2d, 0x87, 0x83, 0x4d, 0xf5, 0x92, 0x69, 0xc4, 0xdf, 0xcc,
+  0x3f, 0x85, 0x06, 0xfc, 0x3d, 0xf6, 0x75, 0x7d, 0xa7, 0x81, 0xb9, 0xeb, 0x3e, 0x5c, 0x72, 0x92,
+  0xb9, 0xf0, 0x98, 0x40, 0x83, 0x86, 0x01, 0x16, 0xaf, 0x6c, 0xf3, 0x8f, 0x5a, 0x10, 0x06, 0x9a,
+  0x0c, 0x21, 0x2f, 0xc2, 0x2e, 0x25, 0xac, 0x64, 0x20, 0xc2, 0x93, 0x45, 0x7b, 0x83, 0x80, 0xc0,
+  0x28, 0xd1, 0xc1, 0x01, 0x37, 0x75, 0x90, 0x9a, 0x1e, 0x81, 0xc0, 0xd8, 0x72, 0x8a, 0xa4, 0x64,
+  0x2e, 0x1e, 0xcb, 0xf6, 0xae, 0xc0, 0x5e, 0x3b, 0x6b, 0x3a, 0xc8, 0x02, 0x4c, 0x98, 0x1a, 0xae,
+  0x66, 0xc3, 0x4d, 0x79, 0x4f, 0x41, 0xf5, 0x33, 0xd7, 0xea, 0xc4, 0x70, 0x8c, 0x1a, 0x06, 0x44,
+  0x0b, 0x13, 0x08, 0x99, 0x9c, 0x77, 0x10, 0x41, 0x87, 0x0c, 0xa2, 0x97, 0x87, 0x21, 0xa2, 0x15,
+  0x24, 0xa9, 0x39, 0xa5, 0xe6, 0x9d, 0x26, 0xf5, 0x2d, 0x08, 0x69, 0xb3, 0x50, 0x42, 0x72, 0xf7,
+  0x80, 0x65, 0x3e, 0xfd, 0x35, 0xeb, 0xef, 0xe9, 0xdf, 0xa6, 0x31, 0x93, 0xad, 0x46, 0x03, 0x25,
+  0x87, 0xe0, 0x5e, 0xa4, 0xb7, 0x87, 0x1c, 0x8e, 0x03, 0x9e, 0xc6, 0x2c, 0xa9, 0x20, 0xfa, 0xa0,
+  0xcd, 0x23, 0x0e, 0x8d, 0x16, 0xe8, 0xcd, 0x5a, 0xea, 0x87, 0x10, 0xca, 0xf7, 0x4d, 0x7c, 0x8b,
+  0x02, 0x93, 0x8d, 0x99, 0xe3, 0x01, 0x8a, 0xb3, 0xd8, 0xee, 0x96, 0xd8, 0x8c, 0x20, 0xfe, 0xe9,
+  0x00, 0x2b, 0x00, 0x9b, 0xea, 0x28, 0xcb, 0x82, 0xd8, 0x7c, 0x7d, 0xef, 0x8d, 0xdb, 0xa0, 0xb0,
+  0x80, 0x72, 0xa1, 0xb7, 0x6c, 0x9d, 0x0c, 0x65, 0x08, 0x30, 0x20, 0x60, 0xd4, 0xe4, 0x18, 0x70,
+  0x26, 0x29, 0x49, 0xeb, 0x26, 0xf2, 0x6a, 0x0b, 0xd6, 0x91, 0x4c, 0xe5, 0x28, 0x8b, 0xe0, 0xac,
+  0x93, 0x4d, 0xc7, 0x41, 0xdf, 0xc1, 0x36, 0x9e, 0x84, 0x8b, 0xa6, 0x59, 0x32, 0x5c, 0x9d, 0xac,
+  0x27, 0xdb, 0x77, 0xd1, 0xe0, 0xe5, 0x98, 0xd6, 0xde, 0x2e, 0xec, 0xdb, 0xc6, 0x37, 0x0d, 0xe9,
+  0x40, 0xd5, 0x69, 0xa4, 0xef, 0x18, 0x1a, 0xfa, 0x9d, 0xf6, 0xff, 0x00, 0x31, 0xe4, 0x2c, 0xa8,
+  0xea, 0x16, 0x00, 0x00,
+};
+
+#endif
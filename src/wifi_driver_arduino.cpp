@@ -0,0 +1,56 @@
+#ifdef ARDUINO
+
+#include "wifi_manager.h"
+
+#include <WiFi.h>
+#include <esp_system.h>
+
+static WifiManager* eventTarget = nullptr;
+
+ArduinoWifiDriver::ArduinoWifiDriver(const char* ssid, const char* password,
+                                     long gmtOffsetSec, int daylightOffsetSec,
+                                     const char* ntp1, const char* ntp2, const char* ntp3)
+  : ssid(ssid), password(password), gmtOffsetSec(gmtOffsetSec),
+    daylightOffsetSec(daylightOffsetSec), ntp1(ntp1), ntp2(ntp2), ntp3(ntp3) {}
+
+void ArduinoWifiDriver::attach(WifiManager& manager) {
+  eventTarget = &manager;
+
+  // Обработчик выполняется в задаче событий WiFi: только post()
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    if (eventTarget == nullptr) return;
+    switch (event) {
+      case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        eventTarget->post(LINK_GOT_IP);
+        break;
+      case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        eventTarget->post(LINK_LOST);
+        break;
+      default:
+        break;
+    }
+  });
+
+  WiFi.mode(WIFI_STA);
+  // Повторами управляет WifiManager с паузами, а не ядро в цикле
+  WiFi.setAutoReconnect(false);
+}
+
+void ArduinoWifiDriver::connect() {
+  WiFi.begin(ssid, password);
+}
+
+void ArduinoWifiDriver::disconnect() {
+  WiFi.disconnect(false, false);
+}
+
+void ArduinoWifiDriver::syncTime() {
+  configTime(gmtOffsetSec, daylightOffsetSec, ntp1, ntp2, ntp3);
+}
+
+uint32_t ArduinoWifiDriver::random32() {
+  return esp_random();
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "wifi_manager.h"
+
+WifiManager::WifiManager(WifiDriver& driver, uint32_t retryBaseMs, uint32_t retryCapMs)
+  : driver(driver), backoff(retryBaseMs, retryCapMs), current(LINK_DOWN),
+    linkCallback(nullptr), deadline(0), attemptCount(0), dropCount(0) {}
+
+void WifiManager::start(uint32_t nowMs) {
+  backoff.reset();
+  beginAttempt(nowMs);
+}
+
+void WifiManager::post(WifiLinkEvent event) {
+  // При переполнении событие теряется и учитывается в droppedEvents();
+  // из попытки без ответа машину всё равно выведет таймаут
+  events.push(event);
+}
+
+void WifiManager::retryNow(uint32_t nowMs) {
+  WifiLinkState now = state();
+  if (now == LINK_UP || now == LINK_CONNECTING) return;
+  beginAttempt(nowMs);
+}
+
+void WifiManager::beginAttempt(uint32_t nowMs) {
+  attemptCount++;
+  deadline = nowMs + CONNECT_TIMEOUT_MS;
+  setState(LINK_CONNECTING);
+  driver.connect();
+}
+
+void WifiManager::scheduleRetry(uint32_t nowMs) {
+  deadline = nowMs + backoff.nextDelay(driver.random32());
+  setState(LINK_BACKOFF);
+}
+
+void WifiManager::setState(WifiLinkState next) {
+  WifiLinkState previous = current.exchange(next, std::memory_order_acq_rel);
+  bool wasUp = previous == LINK_UP;
+  bool isUp = next == LINK_UP;
+  if (wasUp != isUp && linkCallback != nullptr) {
+    linkCallback(isUp);
+  }
+}
+
+void WifiManager::poll(uint32_t nowMs) {
+  WifiLinkEvent event;
+  while (events.pop(event)) {
+    WifiLinkState now = state();
+
+    if (event == LINK_GOT_IP) {
+      if (now == LINK_UP) continue;
+      backoff.reset();
+      setState(LINK_UP);
+      // Время могло уйти или не быть получено вовсе: SNTP заново
+      driver.syncTime();
+    } else if (event == LINK_LOST) {
+      if (now == LINK_UP) {
+        dropCount++;
+        scheduleRetry(nowMs);
+      } else if (now == LINK_CONNECTING) {
+        // Попытка отвергнута (нет точки, неверный пароль)
+        driver.disconnect();
+        scheduleRetry(nowMs);
+      }
+      // В паузе и до start() отключение ничего не меняет
+    }
+  }
+
+  WifiLinkState now = state();
+  bool expired = (int32_t)(nowMs - deadline) >= 0;
+  if (now == LINK_CONNECTING && expired) {
+    driver.disconnect();
+    scheduleRetry(nowMs);
+  } else if (now == LINK_BACKOFF && expired) {
+    beginAttempt(nowMs);
+  }
+}
@@ -0,0 +1,185 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "retry_backoff.h"
+#include "spsc_ring.h"
+
+// События канала от драйвера WiFi
+enum WifiLinkEvent : uint8_t {
+  LINK_GOT_IP = 1,      // подключены и получили адрес
+  LINK_LOST = 2         // отключение, потеря адреса, неудачная попытка
+};
+
+enum WifiLinkState : uint8_t {
+  LINK_DOWN,            // не запущен
+  LINK_CONNECTING,      // попытка идёт, ждём LINK_GOT_IP
+  LINK_UP,
+  LINK_BACKOFF          // пауза перед следующей попыткой
+};
+
+// Всё, что менеджеру нужно от стека WiFi. Вызовы не должны ждать сеть:
+// результат приходит событием через WifiManager::post()
+class WifiDriver {
+public:
+  virtual ~WifiDriver() {}
+
+  virtual void connect() = 0;
+  virtual void disconnect() = 0;
+  // Перезапуск синхронизации времени (SNTP) после появления сети
+  virtual void syncTime() = 0;
+  virtual uint32_t random32() = 0;
+};
+
+// Неблокирующее подключение к WiFi.
+// Драйвер сообщает о событиях из своей задачи через post() - это только
+// запись в очередь без блокировок. Машина состояний работает в poll(),
+// который вызывается периодически из одного контекста (loop): переходы,
+// таймаут попытки, паузы с экспоненциальным джиттером между попытками.
+// Ни один вызов не ждёт сеть.
+class WifiManager {
+public:
+  static const uint32_t CONNECT_TIMEOUT_MS = 20000;
+
+  // Вызывается из poll() при смене up/down
+  typedef void (*LinkCallback)(bool up);
+
+  WifiManager(WifiDriver& driver, uint32_t retryBaseMs, uint32_t retryCapMs);
+
+  void onLinkChange(LinkCallback callback) { linkCallback = callback; }
+
+  // Первая попытка подключения, сразу
+  void start(uint32_t nowMs);
+  // Из обработчика событий драйвера
+  void post(WifiLinkEvent event);
+  // Продвигает машину состояний
+  void poll(uint32_t nowMs);
+  // Новая попытка без ожидания паузы (например, по запросу пользователя)
+  void retryNow(uint32_t nowMs);
+
+  WifiLinkState state() const { return current.load(std::memory_order_acquire); }
+  bool isUp() const { return state() == LINK_UP; }
+
+  uint32_t attempts() const { return attemptCount; }
+  uint32_t drops() const { return dropCount; }
+  uint32_t droppedEvents() const { return events.dropped(); }
+
+private:
+  void beginAttempt(uint32_t nowMs);
+  void scheduleRetry(uint32_t nowMs);
+  void setState(WifiLinkState next);
+
+  WifiDriver& driver;
+  RetryBackoff backoff;
+  SpscRing<WifiLinkEvent, 16> events;
+  std::atomic<WifiLinkState> current;
+  LinkCallback linkCallback;
+
+  uint32_t deadline;     // конец попытки или паузы
+  uint32_t attemptCount;
+  uint32_t dropCount;
+};
+
+// Подделка для хоста (sim/, test/): адрес приходит через connectDelayMs
+// после connect(), связь рвётся через dropAfterMs (0 - не рвётся). Время -
+// внешние часы now в мс, как millis(), сравнения переживают переполнение
+class FakeWifiDriver : public WifiDriver {
+public:
+  FakeWifiDriver(const uint32_t& now, uint32_t connectDelayMs, uint32_t dropAfterMs)
+    : now(now), connectDelay(connectDelayMs), dropAfter(dropAfterMs), manager(nullptr),
+      reachable(true), rejecting(false), connecting(false), upAt(0), dropAt(0),
+      connectCount(0), disconnectCount(0), syncCount(0), seed(12345) {}
+
+  void attach(WifiManager& target) { manager = &target; }
+
+  void connect() override {
+    connectCount++;
+    upAt = now + connectDelay;
+    connecting = true;
+  }
+  void disconnect() override {
+    disconnectCount++;
+    connecting = false;
+  }
+  void syncTime() override { syncCount++; }
+
+  uint32_t random32() override {
+    // xorshift32: повторяемые паузы между прогонами
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  // Точки нет в эфире: попытка остаётся без ответа до таймаута
+  void setReachable(bool on) { reachable = on; }
+  // Точка отвергает подключение (неверный пароль): ответ LINK_LOST
+  void setRejecting(bool on) { rejecting = on; }
+  // Точка пропала посреди работы
+  void drop() {
+    if (manager != nullptr && manager->isUp()) manager->post(LINK_LOST);
+  }
+
+  // События попытки и обрыва; вызывать перед каждым WifiManager::poll()
+  void step() {
+    if (connecting && reachable && (int32_t)(now - upAt) >= 0) {
+      connecting = false;
+      dropAt = now + dropAfter;
+      manager->post(rejecting ? LINK_LOST : LINK_GOT_IP);
+    } else if (dropAfter > 0 && manager->isUp() && (int32_t)(now - dropAt) >= 0) {
+      manager->post(LINK_LOST);
+    }
+  }
+
+  uint32_t connects() const { return connectCount; }
+  uint32_t disconnects() const { return disconnectCount; }
+  uint32_t timeSyncs() const { return syncCount; }
+
+private:
+  const uint32_t& now;
+  uint32_t connectDelay;
+  uint32_t dropAfter;
+  WifiManager* manager;
+  bool reachable;
+  bool rejecting;
+  bool connecting;
+  uint32_t upAt;
+  uint32_t dropAt;
+  uint32_t connectCount;
+  uint32_t disconnectCount;
+  uint32_t syncCount;
+  uint32_t seed;
+};
+
+#ifdef ARDUINO
+// Драйвер поверх WiFi.h: автопереподключение ядра выключено, повторами
+// управляет WifiManager; события WiFi.onEvent передаются в manager.post()
+class ArduinoWifiDriver : public WifiDriver {
+public:
+  ArduinoWifiDriver(const char* ssid, const char* password,
+                    long gmtOffsetSec, int daylightOffsetSec,
+                    const char* ntp1, const char* ntp2, const char* ntp3);
+
+  // Подписка на события ядра; вызывать один раз до manager.start()
+  void attach(WifiManager& manager);
+
+  void connect() override;
+  void disconnect() override;
+  void syncTime() override;
+  uint32_t random32() override;
+
+private:
+  const char* ssid;
+  const char* password;
+  long gmtOffsetSec;
+  int daylightOffsetSec;
+  const char* ntp1;
+  const char* ntp2;
+  const char* ntp3;
+};
+#endif
+
+#endif
@@ -0,0 +1,448 @@
+#include "workout_export.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Место под один сэмпл в текстовых форматах (строка TCX ~170 байт)
+static const size_t MAX_SAMPLE_ROW = 256;
+
+// FIT: время от 1989-12-31 00:00:00 UTC
+static const uint32_t FIT_EPOCH = 631065600UL;
+static const uint8_t FIT_HEADER_SIZE = 14;
+static const uint8_t FIT_PROTOCOL = 0x10;      // 1.0
+static const uint16_t FIT_PROFILE = 2140;      // 21.40
+static const uint8_t FIT_COMPRESSED = 0x80;
+static const uint8_t FIT_DEFINITION = 0x40;
+static const uint32_t FIT_TIME_MASK = 0x1F;    // 5 бит смещения в сжатом заголовке
+
+// Базовые типы полей
+static const uint8_t FIT_ENUM = 0x00;
+static const uint8_t FIT_UINT8 = 0x02;
+static const uint8_t FIT_UINT16 = 0x84;
+static const uint8_t FIT_UINT32 = 0x86;
+
+// Глобальные номера сообщений и значения перечислений из FIT Profile
+static const uint16_t FIT_FILE_ID = 0;
+static const uint16_t FIT_SESSION = 18;
+static const uint16_t FIT_LAP = 19;
+static const uint16_t FIT_RECORD = 20;
+static const uint16_t FIT_ACTIVITY = 34;
+static const uint8_t FIT_FILE_ACTIVITY = 4;
+static const uint16_t FIT_MANUFACTURER_DEVELOPMENT = 255;
+static const uint8_t FIT_SPORT_RUNNING = 1;
+static const uint8_t FIT_SUB_SPORT_TREADMILL = 1;
+static const uint8_t FIT_EVENT_SESSION = 8;
+static const uint8_t FIT_EVENT_LAP = 9;
+static const uint8_t FIT_EVENT_ACTIVITY = 26;
+static const uint8_t FIT_EVENT_TYPE_STOP = 1;
+
+// Локальные типы: сжатый заголовок допускает только 0..3
+static const uint8_t LOCAL_SUMMARY = 0;        // file_id, затем итоговые сообщения
+static const uint8_t LOCAL_RECORD = 1;         // record без timestamp (сжатый заголовок)
+static const uint8_t LOCAL_TIMED_RECORD = 2;   // record с полной меткой
+
+struct FitField {
+  uint8_t number;
+  uint8_t size;
+  uint8_t type;
+};
+
+static const FitField FILE_ID_FIELDS[] = {
+  { 0, 1, FIT_ENUM },      // type
+  { 1, 2, FIT_UINT16 },    // manufacturer
+  { 2, 2, FIT_UINT16 },    // product
+  { 4, 4, FIT_UINT32 },    // time_created
+};
+
+static const FitField RECORD_FIELDS[] = {
+  { 5, 4, FIT_UINT32 },    // distance, 1/100 м
+  { 6, 2, FIT_UINT16 },    // speed, мм/с
+  { 3, 1, FIT_UINT8 },     // heart_rate, уд/мин
+};
+
+static const FitField TIMED_RECORD_FIELDS[] = {
+  { 253, 4, FIT_UINT32 },  // timestamp
+  { 5, 4, FIT_UINT32 },
+  { 6, 2, FIT_UINT16 },
+  { 3, 1, FIT_UINT8 },
+};
+static const uint8_t FIT_INVALID_UINT8 = 0xFF;   // пульса нет
+
+static const FitField LAP_FIELDS[] = {
+  { 253, 4, FIT_UINT32 },  // timestamp
+  { 2, 4, FIT_UINT32 },    // start_time
+  { 7, 4, FIT_UINT32 },    // total_elapsed_time, мс
+  { 8, 4, FIT_UINT32 },    // total_timer_time, мс
+  { 9, 4, FIT_UINT32 },    // total_distance, 1/100 м
+  { 13, 2, FIT_UINT16 },   // avg_speed, мм/с
+  { 14, 2, FIT_UINT16 },   // max_speed, мм/с
+  { 0, 1, FIT_ENUM },      // event
+  { 1, 1, FIT_ENUM },      // event_type
+};
+
+static const FitField SESSION_FIELDS[] = {
+  { 253, 4, FIT_UINT32 },
+  { 2, 4, FIT_UINT32 },
+  { 7, 4, FIT_UINT32 },
+  { 8, 4, FIT_UINT32 },
+  { 9, 4, FIT_UINT32 },
+  { 14, 2, FIT_UINT16 },   // avg_speed
+  { 15, 2, FIT_UINT16 },   // max_speed
+  { 25, 2, FIT_UINT16 },   // first_lap_index
+  { 26, 2, FIT_UINT16 },   // num_laps
+  { 0, 1, FIT_ENUM },
+  { 1, 1, FIT_ENUM },
+  { 5, 1, FIT_ENUM },      // sport
+  { 6, 1, FIT_ENUM },      // sub_sport
+};
+
+static const FitField ACTIVITY_FIELDS[] = {
+  { 253, 4, FIT_UINT32 },
+  { 0, 4, FIT_UINT32 },    // total_timer_time, мс
+  { 5, 4, FIT_UINT32 },    // local_timestamp
+  { 1, 2, FIT_UINT16 },    // num_sessions
+  { 2, 1, FIT_ENUM },      // type (manual)
+  { 3, 1, FIT_ENUM },      // event
+  { 4, 1, FIT_ENUM },      // event_type
+};
+
+#define FIELD_COUNT(fields) (sizeof(fields) / sizeof(fields[0]))
+
+static void putU16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void putU32(uint8_t* p, uint32_t v) { putU16(p, v & 0xFFFF); putU16(p + 2, v >> 16); }
+
+// CRC-16 из FIT SDK (полиномом 0xA001, по полубайтам)
+static uint16_t fitCrc(uint16_t crc, const uint8_t* data, size_t length) {
+  static const uint16_t TABLE[16] = {
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400,
+  };
+  for (size_t i = 0; i < length; i++) {
+    uint16_t tmp = TABLE[crc & 0xF];
+    crc = (crc >> 4) & 0x0FFF;
+    crc = crc ^ tmp ^ TABLE[data[i] & 0xF];
+    tmp = TABLE[crc & 0xF];
+    crc = (crc >> 4) & 0x0FFF;
+    crc = crc ^ tmp ^ TABLE[(data[i] >> 4) & 0xF];
+  }
+  return crc;
+}
+
+static uint32_t fitTime(time_t utc) {
+  return (uint32_t)utc - FIT_EPOCH;
+}
+
+static uint16_t fitSpeed(float kmh) {
+  float mms = kmh * 1000.0f / 3.6f;
+  if (mms < 0.0f) return 0;
+  if (mms > 65534.0f) return 65534;
+  return (uint16_t)(mms + 0.5f);
+}
+
+// Сообщение определения; возвращает его длину
+static size_t fitDefinition(uint8_t* out, uint8_t local, uint16_t global,
+                            const FitField* fields, size_t count) {
+  out[0] = FIT_DEFINITION | local;
+  out[1] = 0;
+  out[2] = 0;                      // little endian
+  putU16(out + 3, global);
+  out[5] = (uint8_t)count;
+  for (size_t i = 0; i < count; i++) {
+    out[6 + i * 3] = fields[i].number;
+    out[7 + i * 3] = fields[i].size;
+    out[8 + i * 3] = fields[i].type;
+  }
+  return 6 + count * 3;
+}
+
+// Определение плюс одно сообщение данных, байт
+static size_t fitMessageBytes(const FitField* fields, size_t count) {
+  size_t data = 1;
+  for (size_t i = 0; i < count; i++) data += fields[i].size;
+  return 6 + count * 3 + data;
+}
+
+// Последовательная запись полей сообщения данных
+struct FitWriter {
+  uint8_t* out;
+  size_t used;
+
+  void u8(uint8_t v) { out[used++] = v; }
+  void u16(uint16_t v) { putU16(out + used, v); used += 2; }
+  void u32(uint32_t v) { putU32(out + used, v); used += 4; }
+};
+
+// ISO 8601: в UTC с 'Z' (TCX) или местное время со смещением (CSV)
+static size_t formatTime(char* out, size_t size, time_t utc, long offsetSeconds, bool zulu) {
+  time_t local = zulu ? utc : utc + offsetSeconds;
+  struct tm parts;
+  gmtime_r(&local, &parts);
+  int length = snprintf(out, size, "%04d-%02d-%02dT%02d:%02d:%02d",
+                        parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday,
+                        parts.tm_hour, parts.tm_min, parts.tm_sec);
+  if (zulu) {
+    length += snprintf(out + length, size - length, "Z");
+  } else {
+    long offset = offsetSeconds < 0 ? -offsetSeconds : offsetSeconds;
+    length += snprintf(out + length, size - length, "%c%02ld:%02ld",
+                       offsetSeconds < 0 ? '-' : '+', offset / 3600, offset / 60 % 60);
+  }
+  return (size_t)length;
+}
+
+bool WorkoutExport::parseFormat(const char* extension, Format& format) {
+  if (strcmp(extension, "csv") == 0) {
+    format = CSV;
+  } else if (strcmp(extension, "tcx") == 0) {
+    format = TCX;
+  } else if (strcmp(extension, "fit") == 0) {
+    format = FIT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* WorkoutExport::extension(Format format) {
+  switch (format) {
+    case CSV: return "csv";
+    case TCX: return "tcx";
+    default: return "fit";
+  }
+}
+
+const char* WorkoutExport::contentType(Format format) {
+  switch (format) {
+    case CSV: return "text/csv";
+    case TCX: return "application/vnd.garmin.tcx+xml";
+    default: return "application/vnd.ant.fit";
+  }
+}
+
+const char* WorkoutExport::copyPath(const char* source) {
+  snprintf(path, sizeof(path), "%s", source);
+  return path;
+}
+
+WorkoutExport::WorkoutExport(FlashFs& fs, const char* journalPath, size_t offset, size_t length,
+                             Format format, long utcOffset)
+  : reader(fs, copyPath(journalPath), offset, length), format(format), utcOffset(utcOffset),
+    stage(STAGE_BEGIN), start(0), end(0), samples(0), distance(0), maxSpeed(0.0f), avgSpeed(0.0f),
+    fitDataSize(0), fitLastTime(0), fitHasTime(false), crc(0) {
+  // Первый проход: итоги и размер FIT. Второй читатель того же диапазона,
+  // чтобы основной остался в начале журнала
+  JournalReader scan(fs, path, offset, length);
+  WorkoutRecord record;
+  float speedSum = 0.0f;
+  uint32_t activeSamples = 0;
+  uint32_t recordBytes = 0;
+  uint8_t scratch[16];
+
+  while (scan.next(record)) {
+    if (record.speed > maxSpeed) maxSpeed = record.speed;
+    if (record.speed > 0.1f) {
+      speedSum += record.speed;
+      activeSamples++;
+    }
+    distance = record.distance;
+    samples++;
+    if (format == FIT) recordBytes += fitSample(record, scratch);
+  }
+  avgSpeed = activeSamples > 0 ? speedSum / activeSamples : 0.0f;
+  start = scan.info().startTime;
+  end = scan.info().endTime;
+  fitHasTime = false;
+
+  fitDataSize = fitMessageBytes(FILE_ID_FIELDS, FIELD_COUNT(FILE_ID_FIELDS)) +
+                6 + FIELD_COUNT(RECORD_FIELDS) * 3 +
+                6 + FIELD_COUNT(TIMED_RECORD_FIELDS) * 3 +
+                recordBytes +
+                fitMessageBytes(LAP_FIELDS, FIELD_COUNT(LAP_FIELDS)) +
+                fitMessageBytes(SESSION_FIELDS, FIELD_COUNT(SESSION_FIELDS)) +
+                fitMessageBytes(ACTIVITY_FIELDS, FIELD_COUNT(ACTIVITY_FIELDS));
+}
+
+size_t WorkoutExport::contentLength() const {
+  return format == FIT ? FIT_HEADER_SIZE + fitDataSize + 2 : 0;
+}
+
+size_t WorkoutExport::csvSample(const WorkoutRecord& record, char* out, size_t size) {
+  char time[32];
+  formatTime(time, sizeof(time), record.timestamp, utcOffset, false);
+  char heartRate[4] = "";
+  if (record.heartRate != 0) snprintf(heartRate, sizeof(heartRate), "%u", (unsigned)record.heartRate);
+  return snprintf(out, size, "%s,%u,%.2f,%lu,%d,%s\n", time, (unsigned)record.time,
+                  record.speed, (unsigned long)record.distance, record.isActive ? 1 : 0, heartRate);
+}
+
+size_t WorkoutExport::tcxSample(const WorkoutRecord& record, char* out, size_t size) {
+  char time[32];
+  formatTime(time, sizeof(time), record.timestamp, 0, true);
+  // HeartRateBpm по схеме - между DistanceMeters и Extensions
+  char heartRate[48] = "";
+  if (record.heartRate != 0) {
+    snprintf(heartRate, sizeof(heartRate), "<HeartRateBpm><Value>%u</Value></HeartRateBpm>",
+             (unsigned)record.heartRate);
+  }
+  return snprintf(out, size,
+                  "<Trackpoint><Time>%s</Time><DistanceMeters>%lu</DistanceMeters>%s"
+                  "<Extensions><ax:TPX><ax:Speed>%.2f</ax:Speed></ax:TPX></Extensions></Trackpoint>\n",
+                  time, (unsigned long)record.distance, heartRate, record.speed / 3.6f);
+}
+
+size_t WorkoutExport::fitSample(const WorkoutRecord& record, uint8_t* out) {
+  FitWriter writer = { out, 0 };
+  uint32_t time = fitTime(record.timestamp);
+  // Сжатая метка восстанавливается декодером как ближайшее время после
+  // предыдущей с теми же младшими 5 битами
+  if (fitHasTime && time >= fitLastTime && time - fitLastTime <= FIT_TIME_MASK) {
+    writer.u8(FIT_COMPRESSED | (LOCAL_RECORD << 5) | (time & FIT_TIME_MASK));
+  } else {
+    writer.u8(LOCAL_TIMED_RECORD);
+    writer.u32(time);
+  }
+  fitLastTime = time;
+  fitHasTime = true;
+  writer.u32(record.distance * 100);
+  writer.u16(fitSpeed(record.speed));
+  writer.u8(record.heartRate != 0 ? record.heartRate : FIT_INVALID_UINT8);
+  return writer.used;
+}
+
+size_t WorkoutExport::fitBegin(uint8_t* out) {
+  FitWriter writer = { out, 0 };
+  writer.u8(FIT_HEADER_SIZE);
+  writer.u8(FIT_PROTOCOL);
+  writer.u16(FIT_PROFILE);
+  writer.u32(fitDataSize);
+  memcpy(out + writer.used, ".FIT", 4);
+  writer.used += 4;
+  writer.u16(fitCrc(0, out, writer.used));
+
+  writer.used += fitDefinition(out + writer.used, LOCAL_SUMMARY, FIT_FILE_ID,
+                               FILE_ID_FIELDS, FIELD_COUNT(FILE_ID_FIELDS));
+  writer.u8(LOCAL_SUMMARY);
+  writer.u8(FIT_FILE_ACTIVITY);
+  writer.u16(FIT_MANUFACTURER_DEVELOPMENT);
+  writer.u16(0);
+  writer.u32(fitTime(start));
+
+  writer.used += fitDefinition(out + writer.used, LOCAL_RECORD, FIT_RECORD,
+                               RECORD_FIELDS, FIELD_COUNT(RECORD_FIELDS));
+  writer.used += fitDefinition(out + writer.used, LOCAL_TIMED_RECORD, FIT_RECORD,
+                               TIMED_RECORD_FIELDS, FIELD_COUNT(TIMED_RECORD_FIELDS));
+  return writer.used;
+}
+
+size_t WorkoutExport::fitEnd(uint8_t* out) {
+  FitWriter writer = { out, 0 };
+  uint32_t elapsed = (uint32_t)(end - start) * 1000;
+  uint16_t avg = fitSpeed(avgSpeed);
+  uint16_t max = fitSpeed(maxSpeed);
+
+  writer.used += fitDefinition(out + writer.used, LOCAL_SUMMARY, FIT_LAP,
+                               LAP_FIELDS, FIELD_COUNT(LAP_FIELDS));
+  writer.u8(LOCAL_SUMMARY);
+  writer.u32(fitTime(end));
+  writer.u32(fitTime(start));
+  writer.u32(elapsed);
+  writer.u32(elapsed);
+  writer.u32(distance * 100);
+  writer.u16(avg);
+  writer.u16(max);
+  writer.u8(FIT_EVENT_LAP);
+  writer.u8(FIT_EVENT_TYPE_STOP);
+
+  writer.used += fitDefinition(out + writer.used, LOCAL_SUMMARY, FIT_SESSION,
+                               SESSION_FIELDS, FIELD_COUNT(SESSION_FIELDS));
+  writer.u8(LOCAL_SUMMARY);
+  writer.u32(fitTime(end));
+  writer.u32(fitTime(start));
+  writer.u32(elapsed);
+  writer.u32(elapsed);
+  writer.u32(distance * 100);
+  writer.u16(avg);
+  writer.u16(max);
+  writer.u16(0);
+  writer.u16(1);
+  writer.u8(FIT_EVENT_SESSION);
+  writer.u8(FIT_EVENT_TYPE_STOP);
+  writer.u8(FIT_SPORT_RUNNING);
+  writer.u8(FIT_SUB_SPORT_TREADMILL);
+
+  writer.used += fitDefinition(out + writer.used, LOCAL_SUMMARY, FIT_ACTIVITY,
+                               ACTIVITY_FIELDS, FIELD_COUNT(ACTIVITY_FIELDS));
+  writer.u8(LOCAL_SUMMARY);
+  writer.u32(fitTime(end));
+  writer.u32(elapsed);
+  writer.u32(fitTime(end) + (uint32_t)utcOffset);
+  writer.u16(1);
+  writer.u8(0);
+  writer.u8(FIT_EVENT_ACTIVITY);
+  writer.u8(FIT_EVENT_TYPE_STOP);
+  return writer.used;
+}
+
+size_t WorkoutExport::nextRow(char* out, size_t size) {
+  uint8_t* bytes = (uint8_t*)out;
+  size_t used = 0;
+
+  if (stage == STAGE_BEGIN) {
+    if (format == FIT) {
+      used = fitBegin(bytes);
+    } else if (format == TCX) {
+      char time[32];
+      formatTime(time, sizeof(time), start, 0, true);
+      used = snprintf(out, size,
+                      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<TrainingCenterDatabase xmlns=\"http://www.garmin.com/xmlschemas/TrainingCenterDatabase/v2\""
+                      " xmlns:ax=\"http://www.garmin.com/xmlschemas/ActivityExtension/v2\">\n"
+                      "<Activities>\n<Activity Sport=\"Running\">\n<Id>%s</Id>\n", time);
+    } else {
+      used = snprintf(out, size, "time,elapsed_time,speed_kmh,distance_m,is_active,heart_rate\n");
+    }
+    stage = format == TCX ? STAGE_LAP : STAGE_SAMPLES;
+  } else if (stage == STAGE_LAP) {
+    char time[32];
+    formatTime(time, sizeof(time), start, 0, true);
+    used = snprintf(out, size,
+                    "<Lap StartTime=\"%s\">\n<TotalTimeSeconds>%ld</TotalTimeSeconds>\n"
+                    "<DistanceMeters>%lu</DistanceMeters>\n<MaximumSpeed>%.2f</MaximumSpeed>\n"
+                    "<Calories>0</Calories>\n<Intensity>Active</Intensity>\n"
+                    "<TriggerMethod>Manual</TriggerMethod>\n<Track>\n",
+                    time, (long)(end - start), (unsigned long)distance, maxSpeed / 3.6f);
+    stage = STAGE_SAMPLES;
+  } else if (stage == STAGE_SAMPLES) {
+    // Сэмплы пачкой, пока в строке есть место на самый длинный
+    WorkoutRecord record;
+    while (size - used >= MAX_SAMPLE_ROW && reader.next(record)) {
+      if (format == FIT) {
+        used += fitSample(record, bytes + used);
+      } else if (format == TCX) {
+        used += tcxSample(record, out + used, size - used);
+      } else {
+        used += csvSample(record, out + used, size - used);
+      }
+    }
+    if (used == 0) {
+      stage = STAGE_END;
+      return nextRow(out, size);
+    }
+  } else if (stage == STAGE_END) {
+    if (format == FIT) {
+      used = fitEnd(bytes);
+    } else if (format == TCX) {
+      used = snprintf(out, size, "</Track>\n</Lap>\n</Activity>\n</Activities>\n</TrainingCenterDatabase>\n");
+    }
+    stage = format == FIT ? STAGE_CRC : STAGE_DONE;
+    if (used == 0) return nextRow(out, size);
+  } else if (stage == STAGE_CRC) {
+    // CRC файла покрывает всё, что отдано до него, включая заголовок
+    putU16(bytes, crc);
+    stage = STAGE_DONE;
+    return 2;
+  }
+
+  if (format == FIT) crc = fitCrc(crc, bytes, used);
+  return used;
+}
@@ -0,0 +1,72 @@
+#ifndef WORKOUT_EXPORT_H
+#define WORKOUT_EXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "flash_fs.h"
+#include "row_stream.h"
+#include "workout_journal.h"
+
+// Выгрузка тренировки файлом: CSV, TCX (Garmin Training Center v2) или FIT.
+// Сэмплы читаются из журнала на флеше и кодируются по одному прямо в
+// буфер ответа - размер файла не зависит от свободной памяти.
+// Конструктор один раз пробегает журнал: итоги нужны TCX в заголовке
+// круга, а FIT - в заголовке файла вместе с точным размером данных.
+// В FIT сэмпл занимает 8 байт за счёт compressed timestamp header;
+// полная метка времени пишется для первой точки и после разрыва >= 32 с.
+class WorkoutExport : public RowStream<512> {
+public:
+  enum Format { CSV, TCX, FIT };
+
+  // "csv" / "tcx" / "fit"
+  static bool parseFormat(const char* extension, Format& format);
+  static const char* extension(Format format);
+  static const char* contentType(Format format);
+
+  // Журнал в файле path: [offset, offset + length) - целиком или
+  // внутри сегмента архива. utcOffset - смещение местного времени для CSV
+  WorkoutExport(FlashFs& fs, const char* path, size_t offset, size_t length,
+                Format format, long utcOffset);
+
+  bool empty() const { return samples == 0; }
+  time_t startTime() const { return start; }
+  // Размер файла, если известен заранее (FIT), иначе 0
+  size_t contentLength() const;
+
+protected:
+  size_t nextRow(char* out, size_t size) override;
+
+private:
+  enum Stage { STAGE_BEGIN, STAGE_LAP, STAGE_SAMPLES, STAGE_END, STAGE_CRC, STAGE_DONE };
+
+  const char* copyPath(const char* source);
+
+  size_t csvSample(const WorkoutRecord& record, char* out, size_t size);
+  size_t tcxSample(const WorkoutRecord& record, char* out, size_t size);
+  size_t fitSample(const WorkoutRecord& record, uint8_t* out);
+  size_t fitBegin(uint8_t* out);
+  size_t fitEnd(uint8_t* out);
+
+  char path[48];
+  JournalReader reader;  // хранит указатель на path
+  Format format;
+  long utcOffset;
+  Stage stage;
+
+  // Итоги, собранные конструктором
+  time_t start;
+  time_t end;
+  uint32_t samples;
+  uint32_t distance;
+  float maxSpeed;
+  float avgSpeed;
+
+  uint32_t fitDataSize;
+  uint32_t fitLastTime;  // последняя метка, от которой считаются сжатые
+  bool fitHasTime;
+  uint16_t crc;
+};
+
+#endif
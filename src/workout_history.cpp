@@ -0,0 +1,282 @@
+#include "workout_history.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const size_t COPY_CHUNK = 512;
+
+static void putU16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void putU32(uint8_t* p, uint32_t v) { putU16(p, v & 0xFFFF); putU16(p + 2, v >> 16); }
+static uint16_t getU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t getU32(const uint8_t* p) { return getU16(p) | ((uint32_t)getU16(p + 2) << 16); }
+
+WorkoutHistory::WorkoutHistory(FlashFs& fs, const char* directory, size_t maxEntries,
+                               size_t sampleBudget)
+  : fs(fs), entries(0), maxEntries(maxEntries), sampleBudget(sampleBudget),
+    retain(nullptr), retainContext(nullptr), evicted(0) {
+  snprintf(dir, sizeof(dir), "%s", directory);
+  snprintf(indexPath, sizeof(indexPath), "%s/index.bin", dir);
+}
+
+// Запись индекса: [id:4][duration:4][distance:4][max:2][avg:2][samples:4]
+//                 [segment:2][device:1][shift:1][offset:4][length:4]
+void WorkoutHistory::encode(const Entry& entry, uint8_t* out) const {
+  putU32(out, entry.id);
+  putU32(out + 4, entry.duration);
+  putU32(out + 8, entry.distance);
+  putU16(out + 12, entry.maxSpeed);
+  putU16(out + 14, entry.avgSpeed);
+  putU32(out + 16, entry.samples);
+  putU16(out + 20, entry.segment);
+  out[22] = entry.device;
+  out[23] = entry.shift;
+  putU32(out + 24, entry.offset);
+  putU32(out + 28, entry.length);
+}
+
+void WorkoutHistory::decode(const uint8_t* in, Entry& entry) const {
+  entry.id = getU32(in);
+  entry.duration = getU32(in + 4);
+  entry.distance = getU32(in + 8);
+  entry.maxSpeed = getU16(in + 12);
+  entry.avgSpeed = getU16(in + 14);
+  entry.samples = getU32(in + 16);
+  entry.segment = getU16(in + 20);
+  entry.device = in[22];
+  entry.shift = in[23];
+  entry.offset = getU32(in + 24);
+  entry.length = getU32(in + 28);
+}
+
+void WorkoutHistory::segmentPath(uint16_t segment, char* out, size_t size) const {
+  snprintf(out, size, "%s/seg%05u.log", dir, (unsigned)segment);
+}
+
+void WorkoutHistory::archivePath(uint32_t startTime, uint8_t device, char* path, size_t size) const {
+  snprintf(path, size, "%s/%lu-%u.jnl", dir, (unsigned long)startTime, (unsigned)device);
+}
+
+void WorkoutHistory::entryPath(const Entry& entry, char* out, size_t size) const {
+  if (entry.segment == 0) {
+    archivePath(entry.id - entry.shift, entry.device, out, size);
+  } else {
+    segmentPath(entry.segment, out, size);
+  }
+}
+
+// Время старта из имени журнала архива; false - не журнал
+static bool journalStart(const char* name, uint32_t& start) {
+  size_t length = strlen(name);
+  unsigned long value;
+  unsigned device;
+  if (length < 4 || strcmp(name + length - 4, ".jnl") != 0) return false;
+  if (sscanf(name, "%lu-%u", &value, &device) != 2) return false;
+  start = (uint32_t)value;
+  return true;
+}
+
+void WorkoutHistory::setRetention(RetainCallback callback, void* context) {
+  std::lock_guard<std::mutex> guard(lock);
+  retain = callback;
+  retainContext = context;
+}
+
+void WorkoutHistory::begin() {
+  std::lock_guard<std::mutex> guard(lock);
+
+  // Сбой между удалением старого индекса и переименованием нового
+  char temp[MAX_PATH];
+  snprintf(temp, sizeof(temp), "%s/index.tmp", dir);
+  if (!fs.exists(indexPath) && fs.exists(temp)) fs.rename(temp, indexPath);
+
+  size_t bytes = fs.size(indexPath);
+  entries = bytes / ENTRY_SIZE;
+  // Оборванная при отключении питания запись: переписываем индекс без неё
+  if (bytes % ENTRY_SIZE != 0) compact(entries);
+}
+
+bool WorkoutHistory::readEntry(size_t index, Entry& entry) {
+  uint8_t raw[ENTRY_SIZE];
+  if (fs.read(indexPath, index * ENTRY_SIZE, raw, ENTRY_SIZE) != ENTRY_SIZE) return false;
+  decode(raw, entry);
+  return true;
+}
+
+size_t WorkoutHistory::lowerBound(uint32_t key) {
+  size_t low = 0;
+  size_t high = entries;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    Entry entry;
+    if (!readEntry(middle, entry)) return entries;
+    if (entry.id < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+size_t WorkoutHistory::count() {
+  std::lock_guard<std::mutex> guard(lock);
+  return entries;
+}
+
+bool WorkoutHistory::find(uint32_t id, Entry& entry) {
+  std::lock_guard<std::mutex> guard(lock);
+  size_t position = lowerBound(id);
+  return position < entries && readEntry(position, entry) && entry.id == id;
+}
+
+size_t WorkoutHistory::list(uint32_t cursor, size_t limit,
+                            const std::function<void(const Entry&)>& callback) {
+  std::lock_guard<std::mutex> guard(lock);
+  size_t position = cursor == 0 ? entries : lowerBound(cursor);
+  size_t delivered = 0;
+  while (position > 0 && delivered < limit) {
+    Entry entry;
+    if (!readEntry(--position, entry)) break;
+    callback(entry);
+    delivered++;
+  }
+  return delivered;
+}
+
+bool WorkoutHistory::samplesPath(const Entry& entry, char* path, size_t size) {
+  std::lock_guard<std::mutex> guard(lock);
+  entryPath(entry, path, size);
+  return fs.size(path) >= (size_t)entry.offset + entry.length;
+}
+
+void WorkoutHistory::trim() {
+  std::lock_guard<std::mutex> guard(lock);
+  enforceBudget();
+}
+
+bool WorkoutHistory::append(const char* journalPath, const Entry& summary) {
+  std::lock_guard<std::mutex> guard(lock);
+
+  char target[MAX_PATH];
+  archivePath(summary.id, summary.device, target, sizeof(target));
+
+  uint32_t id = summary.id;
+  size_t position = lowerBound(id);
+  Entry existing;
+  while (position < entries && readEntry(position, existing) && existing.id == id) {
+    if (existing.device == summary.device && existing.id - existing.shift == summary.id) {
+      // Сбой между записью сводки и переносом журнала - переносим сейчас;
+      // журнал уже в архиве - повтор не нужен
+      if (!fs.exists(target)) return fs.rename(journalPath, target);
+      fs.remove(journalPath);
+      return true;
+    }
+    id++;
+    position++;
+  }
+  if (id - summary.id > 0xFF) return false;
+
+  size_t length = fs.size(journalPath);
+  if (length == 0) return false;
+
+  Entry entry = summary;
+  entry.id = id;
+  entry.segment = 0;
+  entry.shift = (uint8_t)(id - summary.id);
+  entry.offset = 0;
+  entry.length = (uint32_t)length;
+
+  // Сначала сводка: журнал, оставшийся в /journal/pending после сбоя,
+  // при восстановлении попадёт в ветку повтора выше и будет перенесён
+  bool written;
+  if (position == entries) {
+    uint8_t raw[ENTRY_SIZE];
+    encode(entry, raw);
+    written = fs.append(indexPath, raw, ENTRY_SIZE);
+  } else {
+    // Тренировка старше уже сохранённых (восстановлена после сбоя)
+    written = insertSorted(entry, position);
+  }
+  if (!written) return false;
+  entries++;
+  if (!fs.rename(journalPath, target)) return false;
+
+  if (entries > maxEntries) compact(maxEntries * 3 / 4);
+  enforceBudget();
+  return true;
+}
+
+// Копирует байты [start, end) файла from в конец файла to
+bool WorkoutHistory::copyRange(const char* from, const char* to, size_t start, size_t end) {
+  uint8_t chunk[COPY_CHUNK];
+  for (size_t done = start; done < end; ) {
+    size_t part = end - done < COPY_CHUNK ? end - done : COPY_CHUNK;
+    if (fs.read(from, done, chunk, part) != part || !fs.append(to, chunk, part)) return false;
+    done += part;
+  }
+  return true;
+}
+
+bool WorkoutHistory::insertSorted(const Entry& entry, size_t position) {
+  char temp[MAX_PATH];
+  snprintf(temp, sizeof(temp), "%s/index.tmp", dir);
+  fs.remove(temp);
+
+  uint8_t raw[ENTRY_SIZE];
+  encode(entry, raw);
+  size_t split = position * ENTRY_SIZE;
+  if (!copyRange(indexPath, temp, 0, split) ||
+      !fs.append(temp, raw, ENTRY_SIZE) ||
+      !copyRange(indexPath, temp, split, entries * ENTRY_SIZE)) {
+    fs.remove(temp);
+    return false;
+  }
+
+  fs.remove(indexPath);
+  return fs.rename(temp, indexPath);
+}
+
+// Оставляет keepNewest последних записей (и отбрасывает оборванный хвост)
+bool WorkoutHistory::compact(size_t keepNewest) {
+  char temp[MAX_PATH];
+  snprintf(temp, sizeof(temp), "%s/index.tmp", dir);
+  fs.remove(temp);
+
+  size_t keep = keepNewest < entries ? keepNewest : entries;
+  if (!copyRange(indexPath, temp, (entries - keep) * ENTRY_SIZE, entries * ENTRY_SIZE)) {
+    fs.remove(temp);
+    return false;
+  }
+
+  fs.remove(indexPath);
+  if (keep > 0 && !fs.rename(temp, indexPath)) return false;
+  entries = keep;
+  return true;
+}
+
+// Удаляет самые старые журналы (сначала сегменты прежних версий), пока
+// сэмплы не уложатся в бюджет (считаются занятые блоки). Журнал, нужный владельцу, пропускается
+void WorkoutHistory::enforceBudget() {
+  for (;;) {
+    size_t total = 0;
+    char oldest[MAX_PATH] = "";
+    uint32_t oldestStart = 0;
+    fs.list(dir, [&](const char* path) {
+      const char* name = strrchr(path, '/');
+      name = name != nullptr ? name + 1 : path;
+      uint32_t start = 0;
+      unsigned segment;
+      if (sscanf(name, "seg%u.log", &segment) != 1 && !journalStart(name, start)) return;
+
+      total += flashFootprint(fs.size(path));
+      if (oldest[0] != '\0' && start >= oldestStart) return;
+      if (retain != nullptr && retain(path, retainContext)) return;
+      snprintf(oldest, sizeof(oldest), "%s", path);
+      oldestStart = start;
+    });
+
+    if (total <= sampleBudget || oldest[0] == '\0') return;
+    fs.remove(oldest);
+    evicted++;
+  }
+}
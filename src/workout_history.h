@@ -0,0 +1,102 @@
+#ifndef WORKOUT_HISTORY_H
+#define WORKOUT_HISTORY_H
+
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flash_budget.h"
+#include "flash_fs.h"
+
+// Архив завершённых тренировок на флеше (переживает отправку в Supabase).
+// <dir>/index.bin - сводки по 32 байта, отсортированы по времени старта;
+//   поиск и постраничный обход - двоичным поиском, O(log n) чтений.
+// <dir>/<старт>-<дорожка>.jnl - журнал тренировки (формат WorkoutJournal),
+//   перенесённый из /journal/pending переименованием, без копирования.
+// <dir>/seg<N>.log - журналы подряд от прежних версий прошивки, только чтение.
+// Сэмплы занимают много места, поэтому самые старые журналы удаляются по
+// бюджету SAMPLE_BUDGET; сводки хранятся дольше, до MAX_ENTRIES. Журналы,
+// которые ещё нужны владельцу (setRetention), не удаляются.
+// Лимиты по умолчанию - доли раздела из flash_budget.h.
+class WorkoutHistory {
+public:
+  static const size_t ENTRY_SIZE = 32;
+  static const size_t SAMPLE_BUDGET = FLASH_SAMPLE_BYTES;
+  // Индекс и его копия при вставке или сжатии - по половине блоков индекса;
+  // перед сжатием в индексе на запись больше MAX_ENTRIES
+  static const size_t MAX_ENTRIES = FLASH_INDEX_BYTES / 2 / ENTRY_SIZE - 1;
+  static const size_t MAX_PATH = 48;
+
+  struct Entry {
+    uint32_t id;            // время старта (unix), ключ и курсор
+    uint32_t duration;      // секунды
+    uint32_t distance;      // метры
+    uint16_t maxSpeed;      // 0.01 км/ч
+    uint16_t avgSpeed;      // 0.01 км/ч
+    uint32_t samples;
+    uint16_t segment;       // 0 - свой файл журнала, иначе seg<N>.log
+    uint8_t device;         // номер дорожки (старые записи - 0)
+    uint8_t shift;          // id - время старта (старт в ту же секунду)
+    uint32_t offset;        // журнал в сегменте
+    uint32_t length;
+  };
+
+  // true - журнал ещё нужен (например, ждёт выгрузки сэмплов)
+  typedef bool (*RetainCallback)(const char* journalPath, void* context);
+
+  WorkoutHistory(FlashFs& fs, const char* dir, size_t maxEntries = MAX_ENTRIES,
+                 size_t sampleBudget = SAMPLE_BUDGET);
+
+  // Читает состояние с флеша (число записей)
+  void begin();
+  void setRetention(RetainCallback callback, void* context);
+
+  // Путь, под которым журнал тренировки окажется в архиве
+  void archivePath(uint32_t startTime, uint8_t device, char* path, size_t size) const;
+
+  // Добавляет сводку и переносит журнал в архив (archivePath()).
+  // Повтор того же id и дорожки (восстановление после сбоя) дописывает
+  // только недостающий перенос; id, занятый другой дорожкой (старт в ту
+  // же секунду), сдвигается на +1
+  bool append(const char* journalPath, const Entry& summary);
+
+  size_t count();
+  bool find(uint32_t id, Entry& entry);
+  // До limit сводок от новых к старым, строго старше cursor
+  // (cursor == 0 - с самой новой). Возвращает число выданных
+  size_t list(uint32_t cursor, size_t limit, const std::function<void(const Entry&)>& callback);
+  // Файл с сэмплами записи (offset/length - журнал в нём); false - удалён
+  bool samplesPath(const Entry& entry, char* path, size_t size);
+  // Удаляет старые журналы сверх бюджета: после append() и когда
+  // журнал перестал быть нужен владельцу
+  void trim();
+
+  uint32_t evictedJournals() const { return evicted; }
+
+private:
+  bool readEntry(size_t index, Entry& entry);
+  void encode(const Entry& entry, uint8_t* out) const;
+  void decode(const uint8_t* in, Entry& entry) const;
+  // Первая позиция с id >= key
+  size_t lowerBound(uint32_t key);
+  bool copyRange(const char* from, const char* to, size_t start, size_t end);
+  bool insertSorted(const Entry& entry, size_t position);
+  bool compact(size_t keepNewest);
+  void segmentPath(uint16_t segment, char* out, size_t size) const;
+  void entryPath(const Entry& entry, char* out, size_t size) const;
+  void enforceBudget();
+
+  FlashFs& fs;
+  std::mutex lock;
+  char dir[24];
+  char indexPath[MAX_PATH];
+  size_t entries;
+  size_t maxEntries;
+  size_t sampleBudget;
+  RetainCallback retain;
+  void* retainContext;
+  uint32_t evicted;
+};
+
+#endif
@@ -0,0 +1,314 @@
+#include "workout_journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc32.h"
+
+const char* const WorkoutJournal::ACTIVE_PATH = "/journal/active.jnl";
+const char* const WorkoutJournal::PENDING_DIR = "/journal/pending";
+
+enum JournalRecordType : uint8_t {
+  JOURNAL_BEGIN = 1,     // int64 startTime
+  JOURNAL_SAMPLES = 2,      // пачка сэмплов без пульса (журналы старых прошивок)
+  JOURNAL_END = 3,          // int64 endTime
+  JOURNAL_SAMPLES_HR = 4,   // с пульсом, без наклона
+  JOURNAL_SAMPLES_GRADE = 5 // с пульсом и наклоном, см. flush()
+};
+
+static const uint8_t JOURNAL_MAGIC = 0xA5;
+static const size_t HEADER_SIZE = 4;
+static const size_t CRC_SIZE = 4;
+
+// Пачка: [timestamp:4][distance:4] первого сэмпла, затем на каждый сэмпл
+//   [dt:1][speed|active<<15 :2][distance delta:2][time:2][pulse:1][incline:2]  - 10 байт.
+// В JOURNAL_SAMPLES_HR наклона нет - 8 байт, в JOURNAL_SAMPLES и пульса - 7
+static const size_t BATCH_HEADER = 8;
+static const size_t SAMPLE_SIZE = 10;
+static const size_t SAMPLE_SIZE_HR = 8;
+static const size_t SAMPLE_SIZE_V1 = 7;
+static const size_t MAX_PAYLOAD = BATCH_HEADER + WorkoutJournal::BATCH * SAMPLE_SIZE;
+
+static void putU16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void putU32(uint8_t* p, uint32_t v) { putU16(p, v & 0xFFFF); putU16(p + 2, v >> 16); }
+static uint16_t getU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t getU32(const uint8_t* p) { return getU16(p) | ((uint32_t)getU16(p + 2) << 16); }
+
+static void putTime(uint8_t* p, time_t t) {
+  uint64_t v = (uint64_t)(int64_t)t;
+  putU32(p, (uint32_t)v);
+  putU32(p + 4, (uint32_t)(v >> 32));
+}
+
+static time_t getTime(const uint8_t* p) {
+  uint64_t v = getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+  return (time_t)(int64_t)v;
+}
+
+WorkoutJournal::WorkoutJournal(FlashFs& fs, uint8_t device)
+  : fs(fs), deviceIndex(device), active(false), sessionStart(0), journalBytes(0),
+    maxBytes(MAX_BYTES), batchCount(0), dropped(0), sessionDropped(0), flushCount(0) {
+  if (device == 0) {
+    snprintf(activeFile, sizeof(activeFile), "%s", ACTIVE_PATH);
+  } else {
+    snprintf(activeFile, sizeof(activeFile), "/journal/active%u.jnl", (unsigned)device);
+  }
+}
+
+void WorkoutJournal::pendingPathFor(time_t startTime, char* out, size_t size) const {
+  if (deviceIndex == 0) {
+    snprintf(out, size, "%s/%ld.jnl", PENDING_DIR, (long)startTime);
+  } else {
+    snprintf(out, size, "%s/%ld-%u.jnl", PENDING_DIR, (long)startTime, (unsigned)deviceIndex);
+  }
+}
+
+uint8_t WorkoutJournal::deviceOf(const char* pendingPath) {
+  const char* name = strrchr(pendingPath, '/');
+  const char* dash = strchr(name != nullptr ? name : pendingPath, '-');
+  return dash != nullptr ? (uint8_t)atoi(dash + 1) : 0;
+}
+
+bool WorkoutJournal::writeRecord(uint8_t type, const uint8_t* payload, size_t length) {
+  uint8_t frame[HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE];
+  if (length > MAX_PAYLOAD) return false;
+
+  frame[0] = JOURNAL_MAGIC;
+  frame[1] = type;
+  putU16(frame + 2, (uint16_t)length);
+  memcpy(frame + HEADER_SIZE, payload, length);
+  putU32(frame + HEADER_SIZE + length, crc32(frame + 1, 3 + length));
+
+  // Одна запись - одна операция append, чтобы обрыв задевал только её
+  size_t total = HEADER_SIZE + length + CRC_SIZE;
+  if (!fs.append(activeFile, frame, total)) return false;
+  journalBytes += total;
+  return true;
+}
+
+bool WorkoutJournal::beginSession(time_t startTime) {
+  // Остатки предыдущей сессии к этому моменту уже восстановлены
+  fs.remove(activeFile);
+  active = true;
+  sessionStart = startTime;
+  journalBytes = 0;
+  batchCount = 0;
+  sessionDropped = 0;
+
+  uint8_t payload[8];
+  putTime(payload, startTime);
+  return writeRecord(JOURNAL_BEGIN, payload, sizeof(payload));
+}
+
+void WorkoutJournal::addSample(const WorkoutRecord& record) {
+  if (!active) return;
+
+  batch[batchCount++] = record;
+  if (batchCount >= BATCH) flush();
+}
+
+bool WorkoutJournal::flush() {
+  if (!active || batchCount == 0) return true;
+
+  size_t count = batchCount;
+  batchCount = 0;
+
+  // Журнал ограничен по размеру: дальше сессия живёт только в RAM
+  if (journalBytes + HEADER_SIZE + BATCH_HEADER + count * SAMPLE_SIZE + CRC_SIZE > maxBytes) {
+    dropped += count;
+    sessionDropped += count;
+    return false;
+  }
+
+  uint8_t payload[MAX_PAYLOAD];
+  putU32(payload, (uint32_t)batch[0].timestamp);
+  putU32(payload + 4, batch[0].distance);
+
+  uint8_t* p = payload + BATCH_HEADER;
+  time_t previousTime = batch[0].timestamp;
+  uint32_t previousDistance = batch[0].distance;
+  for (size_t i = 0; i < count; i++) {
+    const WorkoutRecord& r = batch[i];
+    time_t dt = r.timestamp > previousTime ? r.timestamp - previousTime : 0;
+    uint32_t dd = r.distance > previousDistance ? r.distance - previousDistance : 0;
+    uint32_t speed = r.speed > 0.0f ? (uint32_t)(r.speed * 100.0f + 0.5f) : 0;
+    if (speed > 0x7FFF) speed = 0x7FFF;
+
+    p[0] = dt > 255 ? 255 : (uint8_t)dt;
+    putU16(p + 1, (uint16_t)(speed | (r.isActive ? 0x8000 : 0)));
+    putU16(p + 3, dd > 65535 ? 65535 : (uint16_t)dd);
+    putU16(p + 5, r.time);
+    p[7] = r.heartRate;
+    putU16(p + 8, (uint16_t)r.incline);
+    p += SAMPLE_SIZE;
+
+    previousTime += p[-SAMPLE_SIZE];
+    previousDistance += getU16(p - SAMPLE_SIZE + 3);
+  }
+
+  flushCount++;
+  return writeRecord(JOURNAL_SAMPLES_GRADE, payload, BATCH_HEADER + count * SAMPLE_SIZE);
+}
+
+bool WorkoutJournal::endSession(time_t endTime, char* pendingPath, size_t pathSize) {
+  if (!active) return false;
+  flush();
+
+  uint8_t payload[8];
+  putTime(payload, endTime);
+  writeRecord(JOURNAL_END, payload, sizeof(payload));
+  active = false;
+
+  pendingPathFor(sessionStart, pendingPath, pathSize);
+  return fs.rename(activeFile, pendingPath);
+}
+
+void WorkoutJournal::discardSession() {
+  active = false;
+  batchCount = 0;
+  fs.remove(activeFile);
+}
+
+bool WorkoutJournal::recoverActive(char* pendingPath, size_t pathSize) {
+  if (!fs.exists(activeFile)) return false;
+
+  Info info = replay(fs, activeFile, nullptr);
+  if (!info.valid || info.samples == 0) {
+    fs.remove(activeFile);
+    return false;
+  }
+
+  // Закрываем сессию временем последнего сэмпла, дописывая END
+  // после последней целой записи (оборванный хвост replay пропустит)
+  if (!info.ended) {
+    sessionStart = info.startTime;
+    uint8_t payload[8];
+    putTime(payload, info.endTime);
+    journalBytes = fs.size(activeFile);
+    writeRecord(JOURNAL_END, payload, sizeof(payload));
+  }
+
+  pendingPathFor(info.startTime, pendingPath, pathSize);
+  return fs.rename(activeFile, pendingPath);
+}
+
+WorkoutJournal::Info WorkoutJournal::replay(FlashFs& fs, const char* path, SessionStore* store) {
+  JournalReader reader(fs, path);
+  WorkoutRecord record;
+  while (reader.next(record)) {
+    if (store != nullptr) store->add(record);
+  }
+  return reader.info();
+}
+
+JournalReader::JournalReader(FlashFs& fs, const char* path)
+  : JournalReader(fs, path, 0, fs.size(path)) {}
+
+JournalReader::JournalReader(FlashFs& fs, const char* path, size_t offset, size_t length)
+  : fs(fs), path(path), fileSize(offset + length), offset(offset), recordStart(offset),
+    sampleCount(0), sampleIndex(0), sampleSize(SAMPLE_SIZE), timestamp(0), distance(0) {
+  memset(&summary, 0, sizeof(summary));
+}
+
+bool JournalReader::loadRecord() {
+  while (offset + HEADER_SIZE + CRC_SIZE <= fileSize) {
+    if (fs.read(path, offset, frame, HEADER_SIZE) != HEADER_SIZE || frame[0] != JOURNAL_MAGIC) {
+      // Мусор после обрыва: ищем следующую целую запись
+      offset++;
+      summary.torn = true;
+      continue;
+    }
+
+    size_t length = getU16(frame + 2);
+    size_t total = HEADER_SIZE + length + CRC_SIZE;
+    if (length > MAX_PAYLOAD || offset + total > fileSize ||
+        fs.read(path, offset + HEADER_SIZE, frame + HEADER_SIZE, length + CRC_SIZE) != length + CRC_SIZE ||
+        crc32(frame + 1, 3 + length) != getU32(frame + HEADER_SIZE + length)) {
+      offset++;
+      summary.torn = true;
+      continue;
+    }
+
+    recordStart = offset;
+    offset += total;
+    const uint8_t* payload = frame + HEADER_SIZE;
+    uint8_t type = frame[1];
+
+    if (type == JOURNAL_BEGIN && length == 8) {
+      summary.valid = true;
+      summary.startTime = getTime(payload);
+      summary.endTime = summary.startTime;
+    } else if ((type == JOURNAL_SAMPLES || type == JOURNAL_SAMPLES_HR ||
+                type == JOURNAL_SAMPLES_GRADE) && length >= BATCH_HEADER && summary.valid) {
+      timestamp = (time_t)getU32(payload);
+      distance = getU32(payload + 4);
+      sampleSize = type == JOURNAL_SAMPLES_GRADE ? SAMPLE_SIZE
+                 : (type == JOURNAL_SAMPLES_HR ? SAMPLE_SIZE_HR : SAMPLE_SIZE_V1);
+      sampleCount = (length - BATCH_HEADER) / sampleSize;
+      sampleIndex = 0;
+      return true;
+    } else if (type == JOURNAL_END && length == 8 && summary.valid) {
+      summary.ended = true;
+      summary.endTime = getTime(payload);
+    }
+  }
+
+  if (offset < fileSize) summary.torn = true;
+  return false;
+}
+
+bool JournalReader::next(WorkoutRecord& record) {
+  while (sampleIndex >= sampleCount) {
+    sampleCount = 0;
+    sampleIndex = 0;
+    if (!loadRecord()) return false;
+  }
+
+  const uint8_t* p = frame + HEADER_SIZE + BATCH_HEADER + sampleIndex * sampleSize;
+  sampleIndex++;
+
+  timestamp += p[0];
+  distance += getU16(p + 3);
+  uint16_t speed = getU16(p + 1);
+
+  record.timestamp = timestamp;
+  record.speed = (speed & 0x7FFF) / 100.0f;
+  record.distance = distance;
+  record.time = getU16(p + 5);
+  record.heartRate = sampleSize >= SAMPLE_SIZE_HR ? p[7] : 0;
+  record.incline = sampleSize >= SAMPLE_SIZE ? (int16_t)getU16(p + 8) : 0;
+  record.isActive = (speed & 0x8000) != 0;
+
+  summary.samples++;
+  if (!summary.ended) summary.endTime = timestamp;
+  return true;
+}
+
+JournalReader::Mark JournalReader::mark() const {
+  Mark position;
+  position.recordStart = recordStart;
+  position.offset = offset;
+  position.sampleIndex = sampleIndex;
+  position.loaded = sampleIndex < sampleCount;
+  position.timestamp = timestamp;
+  position.distance = distance;
+  position.summary = summary;
+  return position;
+}
+
+bool JournalReader::reset(const Mark& position) {
+  sampleCount = 0;
+  sampleIndex = 0;
+  if (position.loaded) {
+    // Запись уже прошла проверку CRC, перечитывается та же
+    offset = position.recordStart;
+    if (!loadRecord() || offset != position.offset) return false;
+    sampleIndex = position.sampleIndex;
+  }
+  offset = position.offset;
+  timestamp = position.timestamp;
+  distance = position.distance;
+  summary = position.summary;
+  return true;
+}
@@ -0,0 +1,140 @@
+#ifndef WORKOUT_JOURNAL_H
+#define WORKOUT_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "flash_budget.h"
+#include "flash_fs.h"
+#include "session_store.h"
+
+// Журнал предзаписи тренировки на флеше.
+// Идущая тренировка пишется в ACTIVE_PATH записями вида
+//   [0xA5][type:1][length:2][payload][crc32:4]
+// Записи только дописываются; оборванная при отключении питания запись
+// отсекается по CRC при восстановлении. Сэмплы копятся в RAM пачками
+// по BATCH штук, чтобы не изнашивать флеш записью на каждый кадр.
+// По окончании тренировки файл переносится в PENDING_DIR и удаляется
+// только после успешной отправки.
+//
+// У каждой дорожки свой журнал: номер device входит в имена файлов
+// (active<N>.jnl, <start>-<N>.jnl); у дорожки 0 имена прежние.
+class WorkoutJournal {
+public:
+  static const size_t BATCH = 30;
+  // Лимит журнала по умолчанию - все блоки журналов (одна дорожка)
+  static const size_t MAX_BYTES = FLASH_JOURNAL_BYTES;
+
+  static const char* const ACTIVE_PATH;
+  static const char* const PENDING_DIR;
+
+  // Результат разбора файла журнала
+  struct Info {
+    bool valid;          // найдена запись начала сессии
+    bool ended;          // найдена запись окончания
+    bool torn;           // хвост файла оборван или повреждён
+    time_t startTime;
+    time_t endTime;      // окончание, либо время последнего сэмпла
+    uint32_t samples;
+  };
+
+  explicit WorkoutJournal(FlashFs& fs, uint8_t device = 0);
+
+  // Сверх лимита сэмплы не пишутся, сессия продолжается только в RAM
+  void setMaxBytes(size_t bytes) { maxBytes = bytes; }
+
+  bool beginSession(time_t startTime);
+  void addSample(const WorkoutRecord& record);
+  // Сбрасывает накопленную пачку на флеш
+  bool flush();
+  // Закрывает сессию и переносит журнал в очередь отправки
+  bool endSession(time_t endTime, char* pendingPath, size_t pathSize);
+  // Отбрасывает текущую сессию (слишком короткая, неверное время)
+  void discardSession();
+
+  // Прерванная перезагрузкой сессия: закрывается временем последнего
+  // сэмпла и переносится в очередь отправки. false - активной сессии нет
+  bool recoverActive(char* pendingPath, size_t pathSize);
+
+  // Разбирает журнал целиком; если store задан, сэмплы добавляются в него
+  static Info replay(FlashFs& fs, const char* path, SessionStore* store);
+  // Номер дорожки по имени файла из PENDING_DIR
+  static uint8_t deviceOf(const char* pendingPath);
+
+  uint8_t device() const { return deviceIndex; }
+  // Файл идущей тренировки этой дорожки
+  const char* activePath() const { return activeFile; }
+
+  // Сэмплы, не попавшие в журнал из-за лимита: всего и в текущей сессии
+  uint32_t droppedSamples() const { return dropped; }
+  uint32_t sessionDroppedSamples() const { return sessionDropped; }
+  uint32_t flushes() const { return flushCount; }
+
+private:
+  bool writeRecord(uint8_t type, const uint8_t* payload, size_t length);
+  void pendingPathFor(time_t startTime, char* out, size_t size) const;
+
+  FlashFs& fs;
+  uint8_t deviceIndex;
+  char activeFile[32];
+  bool active;
+  time_t sessionStart;
+  size_t journalBytes;
+  size_t maxBytes;
+
+  WorkoutRecord batch[BATCH];
+  size_t batchCount;
+
+  uint32_t dropped;
+  uint32_t sessionDropped;
+  uint32_t flushCount;
+};
+
+// Последовательное чтение сэмплов журнала без загрузки файла в память:
+// в RAM только одна запись (до BATCH сэмплов)
+class JournalReader {
+public:
+  JournalReader(FlashFs& fs, const char* path);
+  // Журнал, лежащий внутри другого файла с позиции offset (архив истории)
+  JournalReader(FlashFs& fs, const char* path, size_t offset, size_t length);
+
+  // Следующий сэмпл; false - журнал закончился
+  bool next(WorkoutRecord& record);
+  // Сведения о прочитанной части журнала (полные после next() == false)
+  const WorkoutJournal::Info& info() const { return summary; }
+
+  // Позиция чтения: reset() возвращает к ней, перечитав запись с флеша
+  // (повтор пачки, тело которой уже ушло в оборванное соединение)
+  struct Mark {
+    size_t recordStart;   // начало текущей записи сэмплов
+    size_t offset;
+    size_t sampleIndex;
+    bool loaded;          // запись сэмплов в frame
+    time_t timestamp;
+    uint32_t distance;
+    WorkoutJournal::Info summary;
+  };
+  Mark mark() const;
+  bool reset(const Mark& position);
+
+private:
+  // Загружает следующую целую запись; false - конец файла
+  bool loadRecord();
+
+  FlashFs& fs;
+  const char* path;
+  size_t fileSize;       // конец журнала в файле
+  size_t offset;
+  size_t recordStart;    // начало записи в frame
+  WorkoutJournal::Info summary;
+
+  uint8_t frame[4 + 8 + WorkoutJournal::BATCH * 10 + 4];
+  size_t sampleCount;     // сэмплов в текущей записи
+  size_t sampleIndex;
+  size_t sampleSize;      // байт на сэмпл в текущей записи
+  time_t timestamp;
+  uint32_t distance;
+};
+
+#endif
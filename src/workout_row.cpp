@@ -0,0 +1,52 @@
+#include "workout_row.h"
+
+#include "json_writer.h"
+
+// Сплиты - массив секунд, по одной на сохранённый сплит
+static void writeSplits(JsonWriter& json, const char* name, const WorkoutStats& stats,
+                        WorkoutStats::SplitUnit unit) {
+  json.key(name);
+  json.beginArray();
+  for (size_t i = 0; i < stats.storedSplits(unit); i++) {
+    json.value((uint32_t)(stats.split(unit, i) + 0.5f));
+  }
+  json.endArray();
+}
+
+size_t writeWorkoutRow(const SessionStore& buffer, time_t startTime, time_t endTime, const char* clientId,
+                       const char* deviceName, const UserProfile& user, long utcOffset,
+                       char* out, size_t size) {
+  if (buffer.empty()) return 0;
+
+  const WorkoutStats& stats = buffer.stats();
+  long duration = endTime - startTime;
+
+  // JSON с полной структурой как в таблице (без id и created_at - они автогенерируются).
+  // client_id - уникальный ключ, по которому сервер отбрасывает повторы
+  JsonWriter json(out, size);
+  json.beginObject();
+  json.field("client_id", clientId);
+  json.timestampField("workout_start", startTime, utcOffset);
+  json.timestampField("workout_end", endTime, utcOffset);
+  json.field("duration_seconds", (int32_t)duration);
+  json.field("total_distance", buffer.last().distance);
+  json.fixedField("max_speed", stats.maxSpeed(), 1);
+  json.fixedField("avg_speed", stats.avgSpeed(), 1);
+  json.field("moving_seconds", stats.movingSeconds());
+  json.fixedField("elevation_gain", stats.elevationGain(), 1);
+  json.field("records_count", (uint32_t)buffer.sampleCount());
+  json.field("calories", (uint32_t)(stats.calories(user) + 0.5f));
+  json.key("avg_heart_rate");
+  if (stats.avgHeartRate() != 0) {
+    json.value((uint32_t)stats.avgHeartRate());
+  } else {
+    json.nullValue();
+  }
+  writeSplits(json, "splits_km", stats, WorkoutStats::KILOMETER);
+  writeSplits(json, "splits_mile", stats, WorkoutStats::MILE);
+  json.field("device_name", deviceName);
+  json.endObject();
+  json.flush();
+
+  return json.ok() ? json.length() : 0;
+}
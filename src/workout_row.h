@@ -0,0 +1,18 @@
+#ifndef WORKOUT_ROW_H
+#define WORKOUT_ROW_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "calories.h"
+#include "session_store.h"
+
+// Строка таблицы workouts в out (JSON). Итоги - из buffer.stats(), то
+// есть по всем записям сессии. utcOffset - смещение местного времени в
+// метках, deviceName - дорожка (device_name), user - для калорий.
+// Возвращает длину; 0 - сессия пуста или не поместилась
+size_t writeWorkoutRow(const SessionStore& buffer, time_t startTime, time_t endTime, const char* clientId,
+                       const char* deviceName, const UserProfile& user, long utcOffset,
+                       char* out, size_t size);
+
+#endif
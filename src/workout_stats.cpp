@@ -0,0 +1,138 @@
+#include "workout_stats.h"
+
+#include <string.h>
+
+#include "session_store.h"
+
+static const double KILOMETER_M = 1000.0;
+static const double MILE_M = 1609.344;
+
+void WorkoutStats::clear() {
+  sampleTotal = 0;
+  lastTime = 0;
+  lastSpeed = 0.0f;
+  lastDistance = 0;
+  lastIncline = 0;
+  lastHeartRate = 0;
+  topSpeed = 0.0f;
+  topHeartRate = 0;
+  speedTime = 0.0;
+  elapsedTotal = 0;
+  movingTotal = 0;
+  climb = 0.0;
+  memset(heartSeconds, 0, sizeof(heartSeconds));
+  memset(bandSeconds, 0, sizeof(bandSeconds));
+  clock = 0.0;
+  kmCount = 0;
+  mileCount = 0;
+  kmStart = 0.0;
+  mileStart = 0.0;
+}
+
+void WorkoutStats::add(const WorkoutRecord& record) {
+  if (record.speed > topSpeed) topSpeed = record.speed;
+  if (record.heartRate > topHeartRate) topHeartRate = record.heartRate;
+
+  if (sampleTotal > 0) {
+    // Промежуток до этой записи - с показателями предыдущей
+    time_t span = record.timestamp - lastTime;
+    bool counted = span > 0 && span <= MAX_GAP_S;
+    uint32_t seconds = counted ? (uint32_t)span : 0;
+
+    elapsedTotal += seconds;
+    if (lastSpeed > MOVING_SPEED) {
+      movingTotal += seconds;
+      speedTime += (double)lastSpeed * seconds;
+    }
+    if (lastHeartRate != 0) {
+      heartSeconds[lastHeartRate] += seconds;
+    } else {
+      bandSeconds[metBand(lastSpeed)] += seconds;
+    }
+
+    // Дистанция растёт и через разрыв: подъём и сплиты - по ней,
+    // время сплита - только учтённое
+    uint32_t from = lastDistance;
+    uint32_t to = record.distance > from ? record.distance : from;
+    if (to > from && lastIncline > 0) {
+      climb += (to - from) * lastIncline / 1000.0;
+    }
+    crossSplits(KILOMETER, KILOMETER_M, from, to, clock, seconds);
+    crossSplits(MILE, MILE_M, from, to, clock, seconds);
+    clock += seconds;
+  } else if (record.distance > 0 && record.speed > MOVING_SPEED) {
+    // Первая запись приходит, когда уже пройдено record.distance метров:
+    // сплиты отсчитываются от дистанции 0, время до неё - по скорости
+    // первой записи (не больше MAX_GAP_S), иначе первый сплит короче
+    double lead = record.distance / (record.speed / 3.6);
+    if (lead > MAX_GAP_S) lead = MAX_GAP_S;
+    kmStart = -lead;
+    mileStart = -lead;
+  }
+
+  sampleTotal++;
+  lastTime = record.timestamp;
+  lastSpeed = record.speed;
+  lastDistance = record.distance;
+  lastIncline = record.incline;
+  lastHeartRate = record.heartRate;
+}
+
+// Границы сплитов на отрезке дистанции [fromDistance, toDistance],
+// пройденном за span секунд учтённого времени от fromClock
+void WorkoutStats::crossSplits(SplitUnit unit, double length, uint32_t fromDistance,
+                               uint32_t toDistance, double fromClock, double span) {
+  uint32_t& count = unit == KILOMETER ? kmCount : mileCount;
+  double& start = unit == KILOMETER ? kmStart : mileStart;
+  float* splits = unit == KILOMETER ? kmSplits : mileSplits;
+  size_t capacity = unit == KILOMETER ? MAX_KM_SPLITS : MAX_MILE_SPLITS;
+
+  while (toDistance >= (count + 1) * length) {
+    double boundary = (count + 1) * length;
+    double at = fromClock + span * (boundary - fromDistance) / (toDistance - fromDistance);
+    if (count < capacity) splits[count] = (float)(at - start);
+    start = at;
+    count++;
+  }
+}
+
+float WorkoutStats::avgSpeed() const {
+  return movingTotal > 0 ? (float)(speedTime / movingTotal) : 0.0f;
+}
+
+uint8_t WorkoutStats::avgHeartRate() const {
+  uint64_t beats = 0;
+  uint32_t seconds = 0;
+  for (size_t bpm = 1; bpm < 256; bpm++) {
+    beats += (uint64_t)bpm * heartSeconds[bpm];
+    seconds += heartSeconds[bpm];
+  }
+  return seconds > 0 ? (uint8_t)((beats + seconds / 2) / seconds) : 0;
+}
+
+float WorkoutStats::calories(const UserProfile& user) const {
+  double kcal = 0.0;
+  for (size_t bpm = 1; bpm < 256; bpm++) {
+    if (heartSeconds[bpm] != 0) {
+      kcal += (double)caloriesPerMinute(user, 0.0f, (uint8_t)bpm) * heartSeconds[bpm];
+    }
+  }
+  for (size_t band = 0; band < MET_BANDS; band++) {
+    kcal += (double)bandCaloriesPerMinute(user, band) * bandSeconds[band];
+  }
+  return (float)(kcal / 60.0);
+}
+
+uint32_t WorkoutStats::splitCount(SplitUnit unit) const {
+  return unit == KILOMETER ? kmCount : mileCount;
+}
+
+size_t WorkoutStats::storedSplits(SplitUnit unit) const {
+  size_t capacity = unit == KILOMETER ? MAX_KM_SPLITS : MAX_MILE_SPLITS;
+  uint32_t count = splitCount(unit);
+  return count < capacity ? count : capacity;
+}
+
+float WorkoutStats::split(SplitUnit unit, size_t index) const {
+  return unit == KILOMETER ? kmSplits[index] : mileSplits[index];
+}
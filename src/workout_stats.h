@@ -0,0 +1,92 @@
+#ifndef WORKOUT_STATS_H
+#define WORKOUT_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "calories.h"
+
+struct WorkoutRecord;
+
+// Итоги тренировки по всем записям, без прореживания: обновляются на
+// каждой записи за O(1), память фиксирована.
+//
+// Время взвешивается кусочно-постоянно: запись действует до следующей
+// (метки - целые секунды). Промежуток длиннее MAX_GAP_S - обрыв связи
+// или перезагрузка, он не идёт ни в одно время и ни в один интеграл.
+// Движение - скорость больше MOVING_SPEED; средняя скорость - по времени
+// движения, а не по числу записей.
+//
+// Калории считаются для любого профиля по гистограммам: секунды на
+// каждом значении пульса и на каждой ступени MET без пульса.
+// Сплиты - время прохождения каждого километра и мили по тому же
+// времени (с интерполяцией внутри промежутка), первый - от дистанции 0;
+// после MAX_*_SPLITS только считаются.
+class WorkoutStats {
+public:
+  static const time_t MAX_GAP_S = 60;
+  static constexpr float MOVING_SPEED = 0.1f;      // км/ч
+  static const size_t MAX_KM_SPLITS = 50;
+  static const size_t MAX_MILE_SPLITS = 32;
+
+  enum SplitUnit { KILOMETER, MILE };
+
+  WorkoutStats() { clear(); }
+
+  void clear();
+  void add(const WorkoutRecord& record);
+
+  uint32_t samples() const { return sampleTotal; }
+  uint32_t distance() const { return lastDistance; }
+  float maxSpeed() const { return topSpeed; }
+  // Средняя по времени движения, км/ч
+  float avgSpeed() const;
+  // Учтённое время (без разрывов) и время движения, с
+  uint32_t elapsedSeconds() const { return elapsedTotal; }
+  uint32_t movingSeconds() const { return movingTotal; }
+  // Набор высоты по наклону полотна, м
+  float elevationGain() const { return (float)climb; }
+
+  uint8_t maxHeartRate() const { return topHeartRate; }
+  // Средний по времени с пульсом; 0 - пульса не было
+  uint8_t avgHeartRate() const;
+  float calories(const UserProfile& user) const;
+
+  // Пройденные целиком сплиты (включая не сохранённые)
+  uint32_t splitCount(SplitUnit unit) const;
+  // Время сплита index, с; index < min(splitCount, MAX_*_SPLITS)
+  float split(SplitUnit unit, size_t index) const;
+  size_t storedSplits(SplitUnit unit) const;
+
+private:
+  void crossSplits(SplitUnit unit, double length, uint32_t fromDistance, uint32_t toDistance,
+                   double fromClock, double span);
+
+  uint32_t sampleTotal;
+  // Предыдущая запись: её показатели действуют до следующей
+  time_t lastTime;
+  float lastSpeed;
+  uint32_t lastDistance;
+  int16_t lastIncline;
+  uint8_t lastHeartRate;
+  float topSpeed;
+  uint8_t topHeartRate;
+  double speedTime;         // км/ч * с по времени движения
+  uint32_t elapsedTotal;
+  uint32_t movingTotal;
+  double climb;
+
+  uint32_t heartSeconds[256];       // [0] не используется
+  uint32_t bandSeconds[MET_BANDS];  // без пульса
+
+  double clock;                     // учтённое время до предыдущей записи, с
+  float kmSplits[MAX_KM_SPLITS];
+  float mileSplits[MAX_MILE_SPLITS];
+  uint32_t kmCount;
+  uint32_t mileCount;
+  double kmStart;                   // clock начала текущего сплита (первого - < 0)
+  double mileStart;
+};
+
+#endif
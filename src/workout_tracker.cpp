@@ -0,0 +1,156 @@
+#include "workout_tracker.h"
+
+#include <string.h>
+
+#include "tracer.h"
+
+constexpr float WorkoutTracker::MIN_ACTIVITY_SPEED;
+constexpr float WorkoutTracker::MIN_WORKOUT_SPEED;
+constexpr float WorkoutTracker::MAX_SPEED;
+
+WorkoutTracker::WorkoutTracker(WorkoutListener& listener)
+  : listener(listener), current(STANDBY), previous(STANDBY) {
+  reset(0);
+}
+
+void WorkoutTracker::reset(uint32_t nowMs) {
+  assembler.reset();
+  current.store(STANDBY, std::memory_order_release);
+  previous = STANDBY;
+  memset(&last, 0, sizeof(last));
+  lastFrameMs = nowMs;
+  memset(&lastSample, 0, sizeof(lastSample));
+  start = 0;
+  activeSince = nowMs;
+  lastActive = nowMs;
+  endedAt = nowMs;
+  lastDistanceAt = nowMs;
+  distance = 0.0f;
+  invalidTimes = 0;
+}
+
+bool WorkoutTracker::isTimeValid(time_t timeValue) {
+  const time_t MIN_VALID_TIME = 1577836800; // 1 января 2020
+  const time_t MAX_VALID_TIME = 1893456000; // 1 января 2030
+
+  return (timeValue >= MIN_VALID_TIME && timeValue <= MAX_VALID_TIME);
+}
+
+uint32_t WorkoutTracker::cooldownRemaining(uint32_t nowMs) const {
+  if (state() != STANDBY || nowMs - endedAt >= COOLDOWN_MS) return 0;
+  return COOLDOWN_MS - (nowMs - endedAt);
+}
+
+bool WorkoutTracker::onFrame(const uint8_t* data, size_t length, uint32_t nowMs, time_t wallTime) {
+  {
+    TRACE_SCOPE("ftms_parse");
+    if (!assembler.push(data, length)) return false;
+  }
+  const TreadmillData& ftms = assembler.record();
+
+  WorkoutRecord record;
+  record.timestamp = wallTime;
+  record.speed = ftms.speed / 100.0f;
+  record.time = ftms.has(FTMS_FIELD_ELAPSED_TIME) ? ftms.elapsedTime : 0;
+  // Пульс, который передаёт сама дорожка; ремень (HeartRateMerger) точнее
+  record.heartRate = ftms.has(FTMS_FIELD_HEART_RATE) ? ftms.heartRate : 0;
+  record.incline = ftms.has(FTMS_FIELD_INCLINATION) ? ftms.inclination : 0;
+
+  // Дистанция интегрируется по скорости: счётчик дорожки сбрасывается
+  // и идёт с шагом в десятки метров
+  bool counting = record.speed >= MIN_ACTIVITY_SPEED && state() == ACTIVE && pastStartDelay(nowMs);
+  if (counting) {
+    uint32_t interval = nowMs - lastDistanceAt;
+    if (interval > 100 && interval < 10000) {
+      distance += (record.speed / 3.6f) * (interval / 1000.0f);
+    }
+    lastDistanceAt = nowMs;
+  }
+  record.distance = (uint32_t)distance;
+
+  if (record.speed > MAX_SPEED) record.speed = 0.0f;
+  record.isActive = (record.speed >= MIN_ACTIVITY_SPEED && record.time > 0);
+  last = record;
+  lastFrameMs = nowMs;
+
+  {
+    TRACE_SCOPE("state_update");
+    updateState(record, nowMs, wallTime);
+  }
+  addSample(record, nowMs);
+  return true;
+}
+
+void WorkoutTracker::updateState(const WorkoutRecord& record, uint32_t nowMs, time_t wallTime) {
+  previous = state();
+
+  // Понижены пороги активности для обнаружения медленной ходьбы
+  bool moving = (record.speed >= MIN_WORKOUT_SPEED && record.time > 0);
+
+  if (moving) {
+    lastActive = nowMs;
+    if (state() != STANDBY || nowMs - endedAt <= COOLDOWN_MS) return;
+
+    if (!isTimeValid(wallTime)) {
+      // Время ещё не синхронизировано: тренировка начнётся со следующим кадром
+      invalidTimes++;
+      return;
+    }
+
+    start = wallTime;
+    activeSince = nowMs;
+    lastDistanceAt = nowMs;
+    distance = 0.0f;
+    current.store(ACTIVE, std::memory_order_release);
+    listener.onWorkoutStart(start);
+    return;
+  }
+
+  if (state() != ACTIVE || record.speed >= 0.1f || nowMs - lastActive <= END_IDLE_MS) return;
+
+  if (!isTimeValid(wallTime) || !isTimeValid(start)) {
+    discard("invalid time at workout end");
+    return;
+  }
+
+  long duration = wallTime - start;
+  if (duration < 30 || duration > 86400) {
+    discard("invalid workout duration");
+    return;
+  }
+
+  // WORKOUT_ENDED виден только внутри этого вызова: после передачи
+  // тренировки слушателю трекер сразу ждёт следующую
+  current.store(WORKOUT_ENDED, std::memory_order_release);
+  endedAt = nowMs;
+  listener.onWorkoutEnd(start, wallTime);
+  current.store(STANDBY, std::memory_order_release);
+}
+
+void WorkoutTracker::addSample(const WorkoutRecord& record, uint32_t nowMs) {
+  if (!isTimeValid(record.timestamp)) {
+    invalidTimes++;
+    return;
+  }
+
+  bool changed = (record.distance != lastSample.distance ||
+                  record.speed != lastSample.speed ||
+                  record.time != lastSample.time);
+
+  if (changed && state() == ACTIVE && pastStartDelay(nowMs)) {
+    lastSample = record;
+    listener.onSample(record);
+  }
+}
+
+void WorkoutTracker::poll(uint32_t nowMs) {
+  if (state() == ACTIVE && nowMs - lastActive > STALL_TIMEOUT_MS) {
+    discard("no activity detected");
+  }
+}
+
+void WorkoutTracker::discard(const char* reason) {
+  current.store(STANDBY, std::memory_order_release);
+  distance = 0.0f;
+  listener.onWorkoutDiscard(reason);
+}
@@ -0,0 +1,94 @@
+#ifndef WORKOUT_TRACKER_H
+#define WORKOUT_TRACKER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ftms_parser.h"
+#include "session_store.h"
+
+enum WorkoutState : uint8_t {
+  STANDBY,
+  ACTIVE,
+  WORKOUT_ENDED
+};
+
+// Что делать с событиями тренировки: буфер, журнал, индикация, отправка.
+// Вызывается из onFrame()/poll(), то есть из того же контекста
+class WorkoutListener {
+public:
+  virtual ~WorkoutListener() {}
+
+  virtual void onWorkoutStart(time_t startTime) = 0;
+  // Новая точка тренировки (данные изменились, задержка старта прошла)
+  virtual void onSample(const WorkoutRecord& record) = 0;
+  virtual void onWorkoutEnd(time_t startTime, time_t endTime) = 0;
+  // Начатая тренировка не будет сохранена
+  virtual void onWorkoutDiscard(const char* reason) = 0;
+};
+
+// Логика тренировки без привязки к железу: кадры FTMS -> записи,
+// интегрирование дистанции по скорости, начало и конец тренировки.
+// Время передаётся явно (nowMs - монотонное, wallTime - unix), поэтому
+// тот же код работает на устройстве и в симуляторе с виртуальными часами.
+class WorkoutTracker {
+public:
+  static constexpr float MIN_ACTIVITY_SPEED = 0.8f;  // км/ч, для дистанции
+  static constexpr float MIN_WORKOUT_SPEED = 0.5f;   // км/ч, для начала тренировки
+  static constexpr float MAX_SPEED = 25.0f;          // выше - мусор, считается нулём
+  static const uint32_t START_DELAY_MS = 5000;       // точки пишутся после задержки
+  static const uint32_t COOLDOWN_MS = 10000;         // пауза после конца тренировки
+  static const uint32_t END_IDLE_MS = 15000;         // нулевая скорость до конца тренировки
+  static const uint32_t STALL_TIMEOUT_MS = 20000;    // нет кадров - тренировка сбрасывается
+
+  explicit WorkoutTracker(WorkoutListener& listener);
+
+  // Начальное состояние; отсчёт паузы после загрузки - от nowMs
+  void reset(uint32_t nowMs);
+  // Уведомление 0x2ACD. true - собрана запись, она в record()
+  bool onFrame(const uint8_t* data, size_t length, uint32_t nowMs, time_t wallTime);
+  // Периодически, в том числе без кадров: сброс зависшей тренировки
+  void poll(uint32_t nowMs);
+
+  WorkoutState state() const { return current.load(std::memory_order_acquire); }
+  // Состояние до последнего кадра (для логов смены состояния)
+  WorkoutState previousState() const { return previous; }
+  const WorkoutRecord& record() const { return last; }
+  // nowMs кадра последней записи: время сэмпла для склейки с пульсом
+  uint32_t recordMs() const { return lastFrameMs; }
+  const TreadmillData& ftms() const { return assembler.record(); }
+  time_t startTime() const { return start; }
+  // Сколько ещё длится пауза после прошлой тренировки, 0 - закончилась
+  uint32_t cooldownRemaining(uint32_t nowMs) const;
+
+  uint32_t invalidTimestamps() const { return invalidTimes; }
+  uint32_t malformedFrames() const { return assembler.malformedFrames(); }
+
+  static bool isTimeValid(time_t timeValue);
+
+private:
+  void updateState(const WorkoutRecord& record, uint32_t nowMs, time_t wallTime);
+  void addSample(const WorkoutRecord& record, uint32_t nowMs);
+  void discard(const char* reason);
+  bool pastStartDelay(uint32_t nowMs) const { return nowMs - activeSince > START_DELAY_MS; }
+
+  WorkoutListener& listener;
+  FtmsAssembler assembler;
+  std::atomic<WorkoutState> current;
+  WorkoutState previous;
+
+  WorkoutRecord last;        // последняя собранная запись
+  uint32_t lastFrameMs;      // nowMs её кадра
+  WorkoutRecord lastSample;  // последняя записанная точка
+  time_t start;
+  uint32_t activeSince;      // nowMs начала тренировки
+  uint32_t lastActive;       // nowMs последнего кадра с движением
+  uint32_t endedAt;          // nowMs конца прошлой тренировки
+  uint32_t lastDistanceAt;   // nowMs последнего шага интегрирования
+  float distance;            // м с начала тренировки
+  uint32_t invalidTimes;
+};
+
+#endif
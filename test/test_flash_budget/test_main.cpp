@@ -0,0 +1,274 @@
+// Бюджет раздела из flash_budget.h: каждый потребитель флеша в худшем
+// случае остаётся в своей доле, а все вместе - с метаданными каталогов и
+// запасом LittleFS - помещаются в раздел. Место считается блоками, как
+// его занимает LittleFS (flashFootprint).
+//
+//   pio test -e native -f test_flash_budget
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "flash_budget.h"
+#include "flash_fs.h"
+#include "frame_capture.h"
+#include "upload_outbox.h"
+#include "workout_history.h"
+#include "workout_journal.h"
+
+static const time_t START = 1714557600;
+
+static char root[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+// Блоки под файлами и каталогами ФС (без корня)
+static size_t usedBlocks;
+static size_t directories;
+
+static int countEntry(const char*, const struct stat* info, int type, struct FTW* ftw) {
+  if (type == FTW_D) {
+    if (ftw->level > 0) directories++;
+  } else {
+    usedBlocks += flashFootprint((size_t)info->st_size) / FLASH_BLOCK_SIZE;
+  }
+  return 0;
+}
+
+static size_t footprint(const char* dir) {
+  char path[128];
+  snprintf(path, sizeof(path), "%s%s", root, dir);
+  usedBlocks = 0;
+  directories = 0;
+  nftw(path, countEntry, 16, FTW_PHYS);
+  return usedBlocks * FLASH_BLOCK_SIZE;
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/flash-budget-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Тренировка 1 Гц на seconds секунд; false - журнал не закрыт
+static bool runWorkout(WorkoutJournal& journal, time_t start, uint32_t seconds,
+                       char* pending, size_t size) {
+  TEST_ASSERT_TRUE(journal.beginSession(start));
+  for (uint32_t t = 0; t < seconds; t++) {
+    WorkoutRecord record = {};
+    record.timestamp = start + t;
+    record.speed = 10.0f;
+    record.distance = t * 3;
+    record.time = (uint16_t)t;
+    record.heartRate = 140;
+    record.isActive = true;
+    journal.addSample(record);
+  }
+  return journal.endSession(start + seconds, pending, size);
+}
+
+static void testSharesFitPartition() {
+  TEST_ASSERT_EQUAL(FLASH_PARTITION_SIZE, FLASH_BLOCKS * FLASH_BLOCK_SIZE);
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_DATA_BLOCKS * FLASH_BLOCK_SIZE,
+                            FLASH_JOURNAL_BYTES + FLASH_SAMPLE_BYTES + FLASH_INDEX_BYTES +
+                            FLASH_CAPTURE_BYTES + FLASH_OUTBOX_BLOCKS * FLASH_BLOCK_SIZE);
+  TEST_ASSERT_EQUAL(FLASH_CAPTURE_BYTES, FrameCapture::SEGMENTS * FrameCapture::SEGMENT_SIZE);
+  // Дорожки делят блоки журналов, пока каждой хватает блока
+  for (size_t treadmills = 1; treadmills * FLASH_BLOCK_SIZE <= FLASH_JOURNAL_BYTES; treadmills++) {
+    TEST_ASSERT_LESS_OR_EQUAL(FLASH_JOURNAL_BYTES, treadmills * flashJournalLimit(treadmills));
+  }
+}
+
+// Журнал сверх лимита не растёт, тренировка идёт дальше в RAM; потери
+// считаются за сессию и с начала работы
+static void testJournalStopsAtLimit() {
+  PosixFlash fs(root);
+  WorkoutJournal journal(fs);
+  journal.setMaxBytes(4 * FLASH_BLOCK_SIZE);
+  char pending[64];
+  TEST_ASSERT_TRUE(runWorkout(journal, START, 2 * 3600, pending, sizeof(pending)));
+  TEST_ASSERT_LESS_OR_EQUAL(4 * FLASH_BLOCK_SIZE, fs.size(pending));
+  TEST_ASSERT_GREATER_THAN(0, journal.sessionDroppedSamples());
+  TEST_ASSERT_EQUAL(journal.sessionDroppedSamples(), journal.droppedSamples());
+
+  WorkoutJournal::Info info = WorkoutJournal::replay(fs, pending, nullptr);
+  TEST_ASSERT_TRUE(info.valid);
+  TEST_ASSERT_EQUAL(2 * 3600, info.samples + journal.sessionDroppedSamples());
+
+  uint32_t dropped = journal.droppedSamples();
+  TEST_ASSERT_TRUE(runWorkout(journal, START + 86400, 60, pending, sizeof(pending)));
+  TEST_ASSERT_EQUAL(0, journal.sessionDroppedSamples());
+  TEST_ASSERT_EQUAL(dropped, journal.droppedSamples());
+}
+
+// Восемь дорожек с четырёхчасовой тренировкой одновременно: каждый журнал
+// целиком, все вместе - в доле журналов
+static void testLongWorkoutsFitEveryLane() {
+  const uint8_t lanes = 8;
+  const uint32_t seconds = 4 * 3600;
+  PosixFlash fs(root);
+  WorkoutJournal* journals[lanes];
+  for (uint8_t i = 0; i < lanes; i++) {
+    journals[i] = new WorkoutJournal(fs, i);
+    journals[i]->setMaxBytes(flashJournalLimit(lanes));
+    TEST_ASSERT_TRUE(journals[i]->beginSession(START));
+  }
+  for (uint32_t t = 0; t < seconds; t++) {
+    for (uint8_t i = 0; i < lanes; i++) {
+      WorkoutRecord record = {};
+      record.timestamp = START + t;
+      record.speed = 10.0f + i;
+      record.distance = t * 3;
+      record.time = (uint16_t)t;
+      record.heartRate = 140;
+      record.isActive = true;
+      journals[i]->addSample(record);
+    }
+  }
+  for (uint8_t i = 0; i < lanes; i++) journals[i]->flush();
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_JOURNAL_BYTES, footprint("/journal"));
+
+  size_t largest = 0;
+  for (uint8_t i = 0; i < lanes; i++) {
+    char pending[64];
+    TEST_ASSERT_EQUAL(0, journals[i]->sessionDroppedSamples());
+    TEST_ASSERT_TRUE(journals[i]->endSession(START + seconds, pending, sizeof(pending)));
+    WorkoutJournal::Info info = WorkoutJournal::replay(fs, pending, nullptr);
+    TEST_ASSERT_TRUE(info.valid && info.ended);
+    TEST_ASSERT_EQUAL(seconds, info.samples);
+    if (fs.size(pending) > largest) largest = fs.size(pending);
+    delete journals[i];
+  }
+
+  // Запас лимита дорожки при том же темпе записи
+  char message[96];
+  snprintf(message, sizeof(message), "%u lanes x %u KB journal: %.1f h at 1 Hz each",
+           (unsigned)lanes, (unsigned)(flashJournalLimit(lanes) / 1024),
+           seconds / 3600.0 * flashJournalLimit(lanes) / largest);
+  TEST_MESSAGE(message);
+}
+
+// Индекс и его копия при вставке - каждый в половине блоков индекса
+static void testIndexStaysInShare() {
+  PosixFlash fs(root);
+  WorkoutHistory history(fs, "/history");
+  history.begin();
+  const char* index = "/history/index.bin";
+
+  size_t largest = 0;
+  for (uint32_t i = 0; i < WorkoutHistory::MAX_ENTRIES * 2; i++) {
+    TEST_ASSERT_TRUE(fs.append("/journal/pending/next.jnl", "x", 1));
+    WorkoutHistory::Entry entry = {};
+    entry.id = START + i * 3600;
+    entry.samples = 1;
+    TEST_ASSERT_TRUE(history.append("/journal/pending/next.jnl", entry));
+    size_t bytes = flashFootprint(fs.size(index));
+    if (bytes > largest) largest = bytes;
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(WorkoutHistory::MAX_ENTRIES, history.count());
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_INDEX_BYTES / 2, largest);
+}
+
+static void testCaptureRingStaysInShare() {
+  PosixFlash fs(root);
+  FrameCapture capture(fs, "/capture");
+  capture.begin();
+  capture.setEnabled(true);
+  uint8_t frame[34] = {};
+  for (uint32_t i = 0; i < 20000; i++) {
+    capture.record((int64_t)i * 1000000, frame, sizeof(frame), i * 1000);
+  }
+  capture.flush();
+  TEST_ASSERT_EQUAL(0, capture.dropped());
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_CAPTURE_BYTES, footprint("/capture"));
+}
+
+// Худший случай сразу: архив полон, журнал прошлой тренировки ждёт
+// выгрузки сэмплов, идёт новая длинная тренировка, кольцо кадров полно
+static char queued[WorkoutHistory::MAX_PATH];
+
+static bool isQueued(const char* journalPath, void*) {
+  return strcmp(journalPath, queued) == 0;
+}
+
+static void testEverythingFitsPartition() {
+  PosixFlash fs(root);
+  WorkoutHistory history(fs, "/history");
+  history.setRetention(isQueued, nullptr);
+  history.begin();
+
+  WorkoutJournal journal(fs);
+  char pending[64];
+  // Суточные тренировки - больше, чем вмещает доля архива
+  uint32_t workouts = 0;
+  for (size_t archived = 0; archived <= FLASH_SAMPLE_BYTES; workouts++) {
+    time_t start = START + workouts * 86400;
+    TEST_ASSERT_TRUE(runWorkout(journal, start, 86400, pending, sizeof(pending)));
+    archived += flashFootprint(fs.size(pending));
+    WorkoutHistory::Entry entry = {};
+    entry.id = (uint32_t)start;
+    entry.samples = 86400;
+    // Выгрузки сэмплов ждёт только последняя
+    history.archivePath(entry.id, 0, queued, sizeof(queued));
+    TEST_ASSERT_TRUE(history.append(pending, entry));
+    history.trim();
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_SAMPLE_BYTES + FLASH_INDEX_BYTES / 2, footprint("/history"));
+
+  // Идущая тренировка - до лимита журнала
+  time_t start = START + (workouts + 1) * 86400;
+  TEST_ASSERT_TRUE(journal.beginSession(start));
+  for (uint32_t t = 0; journal.droppedSamples() == 0; t++) {
+    WorkoutRecord record = {};
+    record.timestamp = start + t;
+    record.speed = 8.0f;
+    record.isActive = true;
+    journal.addSample(record);
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_JOURNAL_BYTES, footprint("/journal"));
+
+  FrameCapture capture(fs, "/capture");
+  capture.begin();
+  capture.setEnabled(true);
+  uint8_t frame[34] = {};
+  for (uint32_t i = 0; i < 5000; i++) {
+    capture.record((int64_t)i * 1000000, frame, sizeof(frame), i * 1000);
+  }
+  capture.flush();
+
+  // Строка со сплитами занимает блок очереди отправки, ссылка очереди
+  // сэмплов живёт в метаданных каталога
+  static char row[UploadOutbox::MAX_ROW];
+  memset(row, ' ', sizeof(row));
+  TEST_ASSERT_TRUE(fs.append("/outbox/1714557600-0.json", row, sizeof(row)));
+  TEST_ASSERT_TRUE(fs.append("/samples/1714557600-0.ref", "/history/x.jnl", 14));
+
+  size_t bytes = footprint("");
+  size_t blocks = bytes / FLASH_BLOCK_SIZE + 2 * (1 + directories) + FLASH_SPARE_BLOCKS;
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_DIRECTORIES, directories);
+  TEST_ASSERT_LESS_OR_EQUAL(FLASH_BLOCKS, blocks);
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u of %u blocks: %u data, %u directories",
+           (unsigned)blocks, (unsigned)FLASH_BLOCKS, (unsigned)(bytes / FLASH_BLOCK_SIZE),
+           (unsigned)directories);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testSharesFitPartition);
+  RUN_TEST(testJournalStopsAtLimit);
+  RUN_TEST(testLongWorkoutsFitEveryLane);
+  RUN_TEST(testIndexStaysInShare);
+  RUN_TEST(testCaptureRingStaysInShare);
+  RUN_TEST(testEverythingFitsPartition);
+  return UNITY_END();
+}
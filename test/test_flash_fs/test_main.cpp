@@ -0,0 +1,100 @@
+// Контракт FlashFs, на который опираются журнал, очередь отправки и
+// очередь сэмплов: append() и rename() создают каталоги пути сами, так что
+// переносы в /journal/pending, /outbox/dead и /samples работают на только
+// что отформатированной ФС. LittleFsFlash и PosixFlash ведут себя одинаково.
+//
+//   pio test -e native -f test_flash_fs
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "flash_fs.h"
+#include "upload_outbox.h"
+#include "workout_journal.h"
+
+static char root[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/flash-fs-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static void testRenameCreatesParents() {
+  PosixFlash fs(root);
+  TEST_ASSERT_TRUE(fs.append("/a.bin", "xyz", 3));
+  TEST_ASSERT_TRUE(fs.rename("/a.bin", "/one/two/b.bin"));
+  TEST_ASSERT_FALSE(fs.exists("/a.bin"));
+  TEST_ASSERT_EQUAL(3, fs.size("/one/two/b.bin"));
+}
+
+static void testQuarantineOnFreshFs() {
+  PosixFlash fs(root);
+  UploadOutbox outbox(fs, "/outbox");
+  outbox.scan();
+  TEST_ASSERT_TRUE(outbox.enqueue("1714557600-0", "{}", 2));
+
+  char paths[1][UploadOutbox::MAX_PATH];
+  TEST_ASSERT_EQUAL(1, outbox.peek(paths, 1));
+  TEST_ASSERT_TRUE(outbox.quarantine(paths[0]));
+  TEST_ASSERT_EQUAL(0, outbox.count());
+  TEST_ASSERT_TRUE(fs.exists("/outbox/dead/1714557600-0.json"));
+}
+
+static void testJournalEndsIntoPending() {
+  PosixFlash fs(root);
+  WorkoutJournal journal(fs);
+  TEST_ASSERT_TRUE(journal.beginSession(1714557600));
+  WorkoutRecord record = {};
+  record.timestamp = 1714557601;
+  record.speed = 10.0f;
+  record.isActive = true;
+  journal.addSample(record);
+
+  char pending[64];
+  TEST_ASSERT_TRUE(journal.endSession(1714557700, pending, sizeof(pending)));
+  TEST_ASSERT_TRUE(strncmp(pending, WorkoutJournal::PENDING_DIR, strlen(WorkoutJournal::PENDING_DIR)) == 0);
+  TEST_ASSERT_TRUE(fs.exists(pending));
+
+  // Очередь сэмплов: перенос в ещё не созданный каталог
+  TEST_ASSERT_TRUE(fs.rename(pending, "/samples/1714557600-0.jnl"));
+  TEST_ASSERT_TRUE(fs.exists("/samples/1714557600-0.jnl"));
+}
+
+// Имя длиннее пути list() пропускается, а не обрезается до чужого имени
+static void testListSkipsOverlongNames() {
+  PosixFlash fs(root);
+  char name[160];
+  memset(name, 'a', sizeof(name));
+  name[0] = '/';
+  memcpy(name + 1, "dir/", 4);
+  name[sizeof(name) - 1] = '\0';
+  TEST_ASSERT_TRUE(fs.append(name, "x", 1));
+  TEST_ASSERT_TRUE(fs.append("/dir/short.bin", "x", 1));
+
+  int listed = 0;
+  fs.list("/dir", [&](const char* path) {
+    TEST_ASSERT_EQUAL_STRING("/dir/short.bin", path);
+    listed++;
+  });
+  TEST_ASSERT_EQUAL(1, listed);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testRenameCreatesParents);
+  RUN_TEST(testQuarantineOnFreshFs);
+  RUN_TEST(testJournalEndsIntoPending);
+  RUN_TEST(testListSkipsOverlongNames);
+  return UNITY_END();
+}
@@ -0,0 +1,291 @@
+// FrameCapture на PosixFlash: запись далеко за размер кольца, разбор
+// дампа CapturePcapStream обратно (заголовок pcap, записи, полезная
+// нагрузка и время каждого кадра), сегменты с прошлой загрузки, оборванный
+// хвост сегмента и сброс буфера по времени.
+//
+//   pio test -e native -f test_frame_capture
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "flash_fs.h"
+#include "frame_capture.h"
+
+static char root[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/frame-capture-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Кадр i: длина 4..MAX_FRAME, первые 4 байта - номер, дальше - от номера
+static size_t makeFrame(uint32_t i, uint8_t* out) {
+  size_t length = 4 + (i * 7u) % (FrameCapture::MAX_FRAME - 3);
+  for (size_t k = 0; k < 4; k++) out[k] = (uint8_t)(i >> (8 * k));
+  for (size_t k = 4; k < length; k++) out[k] = (uint8_t)(i * 31u + k);
+  return length;
+}
+
+static int64_t frameTime(uint32_t i) {
+  return 5000000000LL + (int64_t)i * 123457;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+struct PcapFrame {
+  uint64_t timestampUs;
+  std::vector<uint8_t> data;
+};
+
+// Весь поток pcap кусками chunk байт
+static std::vector<uint8_t> download(FrameCapture& capture, size_t chunk) {
+  CapturePcapStream stream(capture);
+  std::vector<uint8_t> out;
+  std::vector<uint8_t> buffer(chunk);
+  size_t n;
+  while ((n = stream.fill(buffer.data(), chunk)) > 0) out.insert(out.end(), buffer.begin(), buffer.begin() + n);
+  return out;
+}
+
+// Разбор pcap; false - заголовок или запись не того вида
+static bool parsePcap(const std::vector<uint8_t>& file, std::vector<PcapFrame>& frames) {
+  if (file.size() < 24) return false;
+  const uint8_t* p = file.data();
+  if (getU32(p) != 0xA1B2C3D4 || p[4] != 2 || p[5] != 0 || p[6] != 4 || p[7] != 0) return false;
+  if (getU32(p + 8) != 0 || getU32(p + 12) != 0) return false;
+  if (getU32(p + 16) != FrameCapture::MAX_FRAME || getU32(p + 20) != 147) return false;
+
+  size_t at = 24;
+  while (at < file.size()) {
+    if (file.size() - at < 16) return false;
+    uint32_t seconds = getU32(p + at);
+    uint32_t micros = getU32(p + at + 4);
+    uint32_t included = getU32(p + at + 8);
+    uint32_t original = getU32(p + at + 12);
+    if (micros >= 1000000 || included != original || included == 0 || included > FrameCapture::MAX_FRAME) return false;
+    if (file.size() - at - 16 < included) return false;
+    PcapFrame frame;
+    frame.timestampUs = (uint64_t)seconds * 1000000 + micros;
+    frame.data.assign(p + at + 16, p + at + 16 + included);
+    frames.push_back(frame);
+    at += 16 + included;
+  }
+  return true;
+}
+
+// Кадры из дампа идут подряд с номера first и совпадают с записанными
+static void checkFrames(const std::vector<PcapFrame>& frames, uint32_t first) {
+  uint8_t expected[FrameCapture::MAX_FRAME];
+  for (size_t k = 0; k < frames.size(); k++) {
+    uint32_t i = first + (uint32_t)k;
+    size_t length = makeFrame(i, expected);
+    TEST_ASSERT_EQUAL(length, frames[k].data.size());
+    TEST_ASSERT_EQUAL(0, memcmp(expected, frames[k].data.data(), length));
+    TEST_ASSERT_TRUE(frames[k].timestampUs == (uint64_t)frameTime(i));
+  }
+}
+
+static uint32_t frameNumber(const PcapFrame& frame) {
+  return getU32(frame.data.data());
+}
+
+static size_t countSegments(PosixFlash& fs, size_t& bytes) {
+  size_t count = 0;
+  bytes = 0;
+  fs.list("/capture", [&](const char* path) {
+    count++;
+    bytes += fs.size(path);
+  });
+  return count;
+}
+
+// Десять размеров кольца: на флеше остаются SEGMENTS последних сегментов,
+// дамп - непрерывный хвост записанного, кончающийся последним кадром
+static void testWritePastRing() {
+  PosixFlash fs(root);
+  FrameCapture capture(fs, "/capture");
+  capture.begin();
+  capture.setEnabled(true);
+
+  uint8_t frame[FrameCapture::MAX_FRAME];
+  size_t written = 0;
+  uint32_t total = 0;
+  while (written < 10 * FrameCapture::SEGMENTS * FrameCapture::SEGMENT_SIZE) {
+    size_t length = makeFrame(total, frame);
+    capture.record(frameTime(total), frame, length, total);
+    written += FrameCapture::HEADER_SIZE + length;
+    total++;
+  }
+  TEST_ASSERT_TRUE(capture.flush());
+  TEST_ASSERT_EQUAL(total, capture.frames());
+  TEST_ASSERT_EQUAL(0, capture.dropped());
+
+  size_t bytes;
+  TEST_ASSERT_EQUAL(FrameCapture::SEGMENTS, countSegments(fs, bytes));
+  TEST_ASSERT_LESS_OR_EQUAL(FrameCapture::SEGMENTS * FrameCapture::SEGMENT_SIZE, bytes);
+  uint32_t first, last;
+  TEST_ASSERT_TRUE(capture.segments(first, last));
+  TEST_ASSERT_EQUAL(FrameCapture::SEGMENTS - 1, last - first);
+  char path[FrameCapture::MAX_PATH];
+  for (uint32_t segment = first; segment <= last; segment++) {
+    capture.segmentPath(segment, path, sizeof(path));
+    TEST_ASSERT_LESS_OR_EQUAL(FrameCapture::SEGMENT_SIZE, fs.size(path));
+  }
+
+  std::vector<uint8_t> file = download(capture, 4096);
+  TEST_ASSERT_TRUE(download(capture, 13) == file);
+  std::vector<PcapFrame> frames;
+  TEST_ASSERT_TRUE_MESSAGE(parsePcap(file, frames), "pcap dump does not parse");
+  TEST_ASSERT_GREATER_THAN(0, frames.size());
+  TEST_ASSERT_GREATER_THAN(0, frameNumber(frames[0]));
+  TEST_ASSERT_EQUAL(total, frameNumber(frames[0]) + frames.size());
+  checkFrames(frames, frameNumber(frames[0]));
+
+  // Байты сегментов и записи pcap сходятся: ни один кадр не потерян
+  size_t payload = 0;
+  for (size_t k = 0; k < frames.size(); k++) payload += FrameCapture::HEADER_SIZE + frames[k].data.size();
+  TEST_ASSERT_EQUAL(bytes, payload);
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u frames recorded, %u kept in %u segments (%u bytes)",
+           (unsigned)total, (unsigned)frames.size(), (unsigned)FrameCapture::SEGMENTS, (unsigned)bytes);
+  TEST_MESSAGE(message);
+}
+
+// Перезагрузка: begin() находит сегменты, запись продолжает кольцо
+static void testResumesAfterReboot() {
+  PosixFlash fs(root);
+  uint8_t frame[FrameCapture::MAX_FRAME];
+  uint32_t total = 0;
+  {
+    FrameCapture capture(fs, "/capture");
+    capture.begin();
+    capture.setEnabled(true);
+    for (; total < 200; total++) capture.record(frameTime(total), frame, makeFrame(total, frame), 0);
+    TEST_ASSERT_TRUE(capture.flush());
+  }
+
+  FrameCapture capture(fs, "/capture");
+  capture.begin();
+  uint32_t first, last;
+  TEST_ASSERT_TRUE(capture.segments(first, last));
+  uint32_t lastBefore = last;
+  capture.setEnabled(true);
+  for (; total < 900; total++) capture.record(frameTime(total), frame, makeFrame(total, frame), 0);
+  TEST_ASSERT_TRUE(capture.flush());
+  TEST_ASSERT_TRUE(capture.segments(first, last));
+  TEST_ASSERT_GREATER_THAN(lastBefore, last);
+  TEST_ASSERT_EQUAL(FrameCapture::SEGMENTS - 1, last - first);
+
+  std::vector<PcapFrame> frames;
+  TEST_ASSERT_TRUE(parsePcap(download(capture, 700), frames));
+  TEST_ASSERT_EQUAL(total, frameNumber(frames[0]) + frames.size());
+  checkFrames(frames, frameNumber(frames[0]));
+}
+
+// Питание пропало посреди append: оборванный хвост последнего сегмента
+// и мусорная длина пропускаются, кадры до них целы
+static void testTornTail() {
+  PosixFlash fs(root);
+  FrameCapture capture(fs, "/capture");
+  capture.begin();
+  capture.setEnabled(true);
+  uint8_t frame[FrameCapture::MAX_FRAME];
+  for (uint32_t i = 0; i < 50; i++) capture.record(frameTime(i), frame, makeFrame(i, frame), 0);
+  TEST_ASSERT_TRUE(capture.flush());
+
+  uint32_t first, last;
+  TEST_ASSERT_TRUE(capture.segments(first, last));
+  char path[FrameCapture::MAX_PATH];
+  capture.segmentPath(last, path, sizeof(path));
+  uint8_t torn[FrameCapture::HEADER_SIZE + 3] = {1, 2, 3, 4, 5, 6, 7, 8, 40, 9, 9, 9};
+  TEST_ASSERT_TRUE(fs.append(path, torn, sizeof(torn)));
+
+  std::vector<PcapFrame> frames;
+  TEST_ASSERT_TRUE(parsePcap(download(capture, 100), frames));
+  TEST_ASSERT_EQUAL(50, frames.size());
+  checkFrames(frames, 0);
+
+  // Заголовок с длиной 0 тоже конец сегмента
+  uint8_t zero[FrameCapture::HEADER_SIZE] = {0};
+  capture.clear();
+  for (uint32_t i = 0; i < 5; i++) capture.record(frameTime(i), frame, makeFrame(i, frame), 0);
+  TEST_ASSERT_TRUE(capture.flush());
+  TEST_ASSERT_TRUE(capture.segments(first, last));
+  capture.segmentPath(last, path, sizeof(path));
+  TEST_ASSERT_TRUE(fs.append(path, zero, sizeof(zero)));
+  frames.clear();
+  TEST_ASSERT_TRUE(parsePcap(download(capture, 100), frames));
+  TEST_ASSERT_EQUAL(5, frames.size());
+}
+
+// Буфер уходит на флеш при заполнении или через FLUSH_INTERVAL_MS, в том
+// числе через переполнение millis(); лишнее не пишется вовсе
+static void testBufferingAndPoll() {
+  PosixFlash fs(root);
+  FrameCapture capture(fs, "/capture");
+  capture.begin();
+  uint8_t frame[FrameCapture::MAX_FRAME];
+  size_t bytes;
+
+  capture.record(frameTime(0), frame, makeFrame(0, frame), 0);
+  TEST_ASSERT_EQUAL(0, capture.frames());   // выключено
+  capture.setEnabled(true);
+  capture.record(frameTime(0), frame, 0, 0);
+  capture.record(frameTime(0), frame, FrameCapture::MAX_FRAME + 1, 0);
+  TEST_ASSERT_EQUAL(0, capture.frames());
+
+  uint32_t startMs = 0xFFFFFFFFu - 3000;
+  for (uint32_t i = 0; i < 3; i++) capture.record(frameTime(i), frame, makeFrame(i, frame), startMs);
+  capture.poll(startMs + FrameCapture::FLUSH_INTERVAL_MS - 1);
+  TEST_ASSERT_EQUAL(0, countSegments(fs, bytes));
+  capture.poll(startMs + FrameCapture::FLUSH_INTERVAL_MS);
+  TEST_ASSERT_EQUAL(1, countSegments(fs, bytes));
+  TEST_ASSERT_EQUAL(1, capture.flushes());
+
+  std::vector<PcapFrame> frames;
+  TEST_ASSERT_TRUE(parsePcap(download(capture, 64), frames));
+  TEST_ASSERT_EQUAL(3, frames.size());
+  checkFrames(frames, 0);
+
+  // Полный буфер сбрасывается сам, без poll
+  uint32_t flushes = capture.flushes();
+  size_t buffered = 0;
+  uint32_t i = 3;
+  while (buffered + FrameCapture::HEADER_SIZE + FrameCapture::MAX_FRAME <= FrameCapture::BUFFER_SIZE) {
+    size_t length = makeFrame(i, frame);
+    capture.record(frameTime(i++), frame, length, 0);
+    buffered += FrameCapture::HEADER_SIZE + length;
+  }
+  TEST_ASSERT_EQUAL(flushes, capture.flushes());
+  for (uint32_t k = 0; k < 20; k++, i++) capture.record(frameTime(i), frame, makeFrame(i, frame), 0);
+  TEST_ASSERT_GREATER_THAN(flushes, capture.flushes());
+
+  capture.clear();
+  TEST_ASSERT_EQUAL(0, countSegments(fs, bytes));
+  std::vector<uint8_t> empty = download(capture, 64);
+  TEST_ASSERT_EQUAL(24, empty.size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testWritePastRing);
+  RUN_TEST(testResumesAfterReboot);
+  RUN_TEST(testTornTail);
+  RUN_TEST(testBufferingAndPoll);
+  return UNITY_END();
+}
@@ -0,0 +1,120 @@
+// Путь кадра как в прошивке и симуляторе: уведомление стека BLE
+// (FakeBleCentral) -> callback -> FrameQueue сессии -> WorkoutTracker.
+// Дорожка шлёт кадры Treadmill Data со всеми полями (34 байта) - ни один
+// не должен потеряться по длине, все поля доходят до трекера.
+//
+//   pio test -e native -f test_frame_path
+
+#include <string.h>
+#include <unity.h>
+
+#include "ble_central.h"
+#include "flash_fs.h"
+#include "frame_queue.h"
+#include "treadmill_session.h"
+
+static const uint16_t ALL_FIELDS = 0x1FFE;   // все флаги, More Data = 0
+static const uint32_t EPOCH = 1714557600;
+
+struct Counts : public SessionListener {
+  uint32_t starts = 0;
+  uint32_t samples = 0;
+  uint32_t ends = 0;
+  uint32_t discards = 0;
+  int16_t incline = 0;
+
+  void onWorkoutStart(TreadmillSession&, time_t) override { starts++; }
+  void onSample(TreadmillSession&, const WorkoutRecord& record) override {
+    samples++;
+    incline = record.incline;
+  }
+  void onWorkoutEnd(TreadmillSession&, time_t, time_t, const char*) override { ends++; }
+  void onWorkoutDiscard(TreadmillSession&, const char*) override { discards++; }
+};
+
+static uint32_t nowMs = 0;
+
+static void onNotify(const uint8_t* data, size_t length, void* context) {
+  TreadmillSession* session = (TreadmillSession*)context;
+  session->frames().push(data, length, (int64_t)nowMs * 1000);
+  session->link().onNotify(nowMs);
+}
+
+// Кадр со всеми полями: скорость в 0.01 км/ч, дистанция в м, наклон 0.1 %
+static size_t fullFrame(uint8_t* out, uint16_t speed, uint32_t distance, uint16_t elapsed) {
+  uint8_t* p = out;
+  *p++ = (uint8_t)ALL_FIELDS; *p++ = (uint8_t)(ALL_FIELDS >> 8);
+  *p++ = (uint8_t)speed; *p++ = (uint8_t)(speed >> 8);                 // скорость
+  *p++ = (uint8_t)speed; *p++ = (uint8_t)(speed >> 8);                 // средняя
+  *p++ = (uint8_t)distance; *p++ = (uint8_t)(distance >> 8); *p++ = (uint8_t)(distance >> 16);
+  *p++ = 25; *p++ = 0; *p++ = 14; *p++ = 0;                            // наклон, угол
+  *p++ = 10; *p++ = 0; *p++ = 0; *p++ = 0;                             // подъём +/-
+  *p++ = 60; *p++ = 60;                                                // темп
+  *p++ = 42; *p++ = 0; *p++ = 0x58; *p++ = 0x02; *p++ = 10;            // энергия
+  *p++ = 135;                                                          // пульс
+  *p++ = 95;                                                           // MET
+  *p++ = (uint8_t)elapsed; *p++ = (uint8_t)(elapsed >> 8);             // прошло
+  *p++ = 0; *p++ = 0;                                                  // осталось
+  *p++ = 0; *p++ = 0; *p++ = 120; *p++ = 0;                            // сила, мощность
+  return (size_t)(p - out);
+}
+
+void setUp() { nowMs = 0; }
+void tearDown() {}
+
+static void testFullFramesReachTracker() {
+  PosixFlash flash("/tmp");
+  FakeBleCentral ble;
+  Counts counts;
+  TreadmillSession session(0, "00:00:00:00:00:00", "full", ble, flash, counts);
+  session.setJournaling(false);
+  TEST_ASSERT_TRUE(session.begin(256));
+  session.tracker().reset(0);
+  ble.begin();
+  session.link().start(session.address(), 0x1826, 0x2ACD, onNotify, &session, 0);
+  session.link().poll(0);
+  TEST_ASSERT_TRUE(session.link().isUp());
+
+  // 90 с ходьбы 10 км/ч, затем 30 с стоя: тренировка начинается и заканчивается
+  uint32_t frames = 0, records = 0;
+  uint32_t distance = 0;
+  for (uint32_t second = 0; second < 120; second++) {
+    nowMs = 1000 + second * 1000;
+    uint16_t speed = second < 90 ? 1000 : 0;
+    if (second < 90) distance += 3;
+    uint8_t frame[64];
+    size_t length = fullFrame(frame, speed, distance, (uint16_t)second);
+    TEST_ASSERT_EQUAL(FTMS_MAX_FRAME, length);
+    ble.notify(frame, length);
+    frames++;
+
+    RawFrame raw;
+    while (session.frames().pop(raw)) {
+      TEST_ASSERT_EQUAL(length, raw.length);
+      uint32_t frameMs = (uint32_t)(raw.timestampUs / 1000);
+      if (session.tracker().onFrame(raw.data, raw.length, frameMs, EPOCH + frameMs / 1000)) records++;
+    }
+    session.poll(nowMs);
+  }
+
+  TEST_ASSERT_EQUAL(0, session.frames().dropped());
+  TEST_ASSERT_EQUAL(frames, records);
+  TEST_ASSERT_EQUAL(0, session.tracker().malformedFrames());
+
+  const TreadmillData& ftms = session.tracker().ftms();
+  TEST_ASSERT_EQUAL_HEX16(0x1FFF, ftms.present);
+  TEST_ASSERT_EQUAL(135, ftms.heartRate);
+  TEST_ASSERT_EQUAL(120, ftms.powerOutput);
+
+  TEST_ASSERT_EQUAL(1, counts.starts);
+  TEST_ASSERT_EQUAL(1, counts.ends);
+  TEST_ASSERT_EQUAL(0, counts.discards);
+  TEST_ASSERT_GREATER_THAN(60, counts.samples);
+  TEST_ASSERT_EQUAL(25, counts.incline);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testFullFramesReachTracker);
+  return UNITY_END();
+}
@@ -0,0 +1,274 @@
+// Корпус кадров FTMS Treadmill Data для parseTreadmillData/FtmsAssembler.
+//
+// Все 8192 сочетания флагов 0-12: кадр собирается кодировщиком теста,
+// разбор должен вернуть те же значения и ту же маску present. Каждый кадр
+// проверяется и усечённым до всех длин короче требуемой - разбор обязан
+// отказать и не трогать out. Замер в конце печатает нс на кадр.
+//
+//   pio test -e native -f test_ftms_parser
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "frame_queue.h"
+#include "ftms_parser.h"
+
+static const uint16_t ALL_FLAGS = 0x1FFF;
+
+struct Encoded {
+  uint8_t data[64];
+  size_t length;
+  TreadmillData expected;
+};
+
+static void putU16(Encoded& e, uint16_t value) {
+  e.data[e.length++] = (uint8_t)value;
+  e.data[e.length++] = (uint8_t)(value >> 8);
+}
+
+static void putU8(Encoded& e, uint8_t value) {
+  e.data[e.length++] = value;
+}
+
+// Значения полей зависят от флагов и номера поля, чтобы сдвиг на байт
+// в разборе давал несовпадение, а не случайно те же числа
+static uint16_t fieldValue(uint16_t flags, unsigned field) {
+  return (uint16_t)(flags * 31u + field * 0x1111u + 0x8001u);
+}
+
+static void encode(uint16_t flags, Encoded& e) {
+  memset(&e, 0, sizeof(e));
+  TreadmillData& x = e.expected;
+  putU16(e, flags);
+  if (!(flags & FTMS_MORE_DATA)) {
+    x.speed = fieldValue(flags, 0);
+    putU16(e, x.speed);
+    x.present |= FTMS_FIELD_SPEED;
+  }
+  if (flags & FTMS_AVERAGE_SPEED) {
+    x.averageSpeed = fieldValue(flags, 1);
+    putU16(e, x.averageSpeed);
+    x.present |= FTMS_FIELD_AVERAGE_SPEED;
+  }
+  if (flags & FTMS_TOTAL_DISTANCE) {
+    x.totalDistance = ((uint32_t)fieldValue(flags, 2) << 8 | 0x5A) & 0xFFFFFF;
+    putU8(e, (uint8_t)x.totalDistance);
+    putU16(e, (uint16_t)(x.totalDistance >> 8));
+    x.present |= FTMS_FIELD_TOTAL_DISTANCE;
+  }
+  if (flags & FTMS_INCLINATION) {
+    x.inclination = (int16_t)fieldValue(flags, 3);
+    x.rampAngle = (int16_t)fieldValue(flags, 4);
+    putU16(e, (uint16_t)x.inclination);
+    putU16(e, (uint16_t)x.rampAngle);
+    x.present |= FTMS_FIELD_INCLINATION;
+  }
+  if (flags & FTMS_ELEVATION_GAIN) {
+    x.elevationGainPos = fieldValue(flags, 5);
+    x.elevationGainNeg = fieldValue(flags, 6);
+    putU16(e, x.elevationGainPos);
+    putU16(e, x.elevationGainNeg);
+    x.present |= FTMS_FIELD_ELEVATION_GAIN;
+  }
+  if (flags & FTMS_INSTANT_PACE) {
+    x.instantPace = (uint8_t)fieldValue(flags, 7);
+    putU8(e, x.instantPace);
+    x.present |= FTMS_FIELD_INSTANT_PACE;
+  }
+  if (flags & FTMS_AVERAGE_PACE) {
+    x.averagePace = (uint8_t)fieldValue(flags, 8);
+    putU8(e, x.averagePace);
+    x.present |= FTMS_FIELD_AVERAGE_PACE;
+  }
+  if (flags & FTMS_EXPENDED_ENERGY) {
+    x.totalEnergy = fieldValue(flags, 9);
+    x.energyPerHour = fieldValue(flags, 10);
+    x.energyPerMinute = (uint8_t)fieldValue(flags, 11);
+    putU16(e, x.totalEnergy);
+    putU16(e, x.energyPerHour);
+    putU8(e, x.energyPerMinute);
+    x.present |= FTMS_FIELD_EXPENDED_ENERGY;
+  }
+  if (flags & FTMS_HEART_RATE) {
+    x.heartRate = (uint8_t)fieldValue(flags, 12);
+    putU8(e, x.heartRate);
+    x.present |= FTMS_FIELD_HEART_RATE;
+  }
+  if (flags & FTMS_METABOLIC_EQUIV) {
+    x.metabolicEquiv = (uint8_t)fieldValue(flags, 13);
+    putU8(e, x.metabolicEquiv);
+    x.present |= FTMS_FIELD_METABOLIC_EQUIV;
+  }
+  if (flags & FTMS_ELAPSED_TIME) {
+    x.elapsedTime = fieldValue(flags, 14);
+    putU16(e, x.elapsedTime);
+    x.present |= FTMS_FIELD_ELAPSED_TIME;
+  }
+  if (flags & FTMS_REMAINING_TIME) {
+    x.remainingTime = fieldValue(flags, 15);
+    putU16(e, x.remainingTime);
+    x.present |= FTMS_FIELD_REMAINING_TIME;
+  }
+  if (flags & FTMS_FORCE_AND_POWER) {
+    x.forceOnBelt = (int16_t)fieldValue(flags, 16);
+    x.powerOutput = (int16_t)fieldValue(flags, 17);
+    putU16(e, (uint16_t)x.forceOnBelt);
+    putU16(e, (uint16_t)x.powerOutput);
+    x.present |= FTMS_FIELD_FORCE_AND_POWER;
+  }
+}
+
+static void assertSame(const TreadmillData& expected, const TreadmillData& actual, uint16_t flags) {
+  char message[48];
+  snprintf(message, sizeof(message), "flags 0x%04X", flags);
+  TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected.present, actual.present, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.speed, actual.speed, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.averageSpeed, actual.averageSpeed, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.totalDistance, actual.totalDistance, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.inclination, actual.inclination, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.rampAngle, actual.rampAngle, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.elevationGainPos, actual.elevationGainPos, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.elevationGainNeg, actual.elevationGainNeg, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.instantPace, actual.instantPace, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.averagePace, actual.averagePace, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.totalEnergy, actual.totalEnergy, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.energyPerHour, actual.energyPerHour, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.energyPerMinute, actual.energyPerMinute, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.heartRate, actual.heartRate, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.metabolicEquiv, actual.metabolicEquiv, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.elapsedTime, actual.elapsedTime, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.remainingTime, actual.remainingTime, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.forceOnBelt, actual.forceOnBelt, message);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.powerOutput, actual.powerOutput, message);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void testEveryFlagCombination() {
+  size_t longest = 0;
+  for (uint32_t flags = 0; flags <= ALL_FLAGS; flags++) {
+    Encoded e;
+    encode((uint16_t)flags, e);
+    TreadmillData out;
+    memset(&out, 0xA5, sizeof(out));
+    TEST_ASSERT_TRUE(parseTreadmillData(e.data, e.length, out));
+    assertSame(e.expected, out, (uint16_t)flags);
+    if (e.length > longest) longest = e.length;
+  }
+  // Самый длинный кадр проходит через FrameQueue целиком
+  TEST_ASSERT_EQUAL(FTMS_MAX_FRAME, longest);
+}
+
+static void testTruncatedFramesAreRejected() {
+  for (uint32_t flags = 0; flags <= ALL_FLAGS; flags++) {
+    Encoded e;
+    encode((uint16_t)flags, e);
+    for (size_t length = 0; length < e.length; length++) {
+      TreadmillData out, untouched;
+      memset(&out, 0xA5, sizeof(out));
+      memset(&untouched, 0xA5, sizeof(untouched));
+      TEST_ASSERT_FALSE(parseTreadmillData(e.data, length, out));
+      TEST_ASSERT_EQUAL_MEMORY(&untouched, &out, sizeof(out));
+    }
+  }
+  TreadmillData out;
+  TEST_ASSERT_FALSE(parseTreadmillData(nullptr, 10, out));
+}
+
+// Зарезервированные биты 13-15 и лишние байты в конце не мешают разбору
+static void testReservedBitsAndTrailingBytes() {
+  for (uint32_t flags = 0; flags <= ALL_FLAGS; flags += 97) {
+    Encoded e;
+    encode((uint16_t)flags, e);
+    e.data[1] |= 0xE0;
+    memset(e.data + e.length, 0xEE, 8);
+    TreadmillData out;
+    TEST_ASSERT_TRUE(parseTreadmillData(e.data, e.length + 8, out));
+    assertSame(e.expected, out, (uint16_t)flags);
+  }
+}
+
+// Кадры в том виде, как их шлёт дорожка (RAW DATA из журналов)
+static void testGoldenFrames() {
+  static const uint8_t elapsedOnly[] = { 0x00, 0x04, 0xF4, 0x01, 0x54, 0x0B };
+  TreadmillData out;
+  TEST_ASSERT_TRUE(parseTreadmillData(elapsedOnly, sizeof(elapsedOnly), out));
+  TEST_ASSERT_EQUAL_HEX16(FTMS_FIELD_SPEED | FTMS_FIELD_ELAPSED_TIME, out.present);
+  TEST_ASSERT_EQUAL(500, out.speed);
+  TEST_ASSERT_EQUAL(2900, out.elapsedTime);
+
+  // Скорость 10.00 км/ч, 1234 м, наклон 1.5 %, 42 ккал, пульс 135, 600 с
+  static const uint8_t typical[] = {
+    0x8C, 0x05, 0xE8, 0x03, 0xD2, 0x04, 0x00, 0x0F, 0x00, 0x00, 0x00,
+    0x2A, 0x00, 0x58, 0x02, 0x0A, 0x87, 0x58, 0x02
+  };
+  TEST_ASSERT_TRUE(parseTreadmillData(typical, sizeof(typical), out));
+  TEST_ASSERT_EQUAL(1000, out.speed);
+  TEST_ASSERT_EQUAL(1234, out.totalDistance);
+  TEST_ASSERT_EQUAL(15, out.inclination);
+  TEST_ASSERT_EQUAL(42, out.totalEnergy);
+  TEST_ASSERT_EQUAL(600, out.energyPerHour);
+  TEST_ASSERT_EQUAL(10, out.energyPerMinute);
+  TEST_ASSERT_EQUAL(135, out.heartRate);
+  TEST_ASSERT_EQUAL(600, out.elapsedTime);
+  TEST_ASSERT_FALSE(out.has(FTMS_FIELD_AVERAGE_SPEED));
+}
+
+// Запись из двух кадров: первый с More Data, второй завершает
+static void testAssemblerMergesMoreData() {
+  FtmsAssembler assembler;
+  Encoded first, last;
+  encode(FTMS_MORE_DATA | FTMS_TOTAL_DISTANCE | FTMS_EXPENDED_ENERGY, first);
+  encode(FTMS_ELAPSED_TIME | FTMS_HEART_RATE, last);
+
+  TEST_ASSERT_FALSE(assembler.push(first.data, first.length));
+  TEST_ASSERT_FALSE(assembler.push(first.data, 3));
+  TEST_ASSERT_EQUAL(1, assembler.malformedFrames());
+  TEST_ASSERT_TRUE(assembler.push(last.data, last.length));
+
+  const TreadmillData& record = assembler.record();
+  TEST_ASSERT_EQUAL_HEX16(first.expected.present | last.expected.present, record.present);
+  TEST_ASSERT_EQUAL(first.expected.totalDistance, record.totalDistance);
+  TEST_ASSERT_EQUAL(first.expected.totalEnergy, record.totalEnergy);
+  TEST_ASSERT_EQUAL(last.expected.speed, record.speed);
+  TEST_ASSERT_EQUAL(last.expected.heartRate, record.heartRate);
+
+  // Следующая запись начинается с чистого листа
+  TEST_ASSERT_TRUE(assembler.push(last.data, last.length));
+  TEST_ASSERT_FALSE(assembler.record().has(FTMS_FIELD_TOTAL_DISTANCE));
+}
+
+static void benchmarkParse() {
+  static Encoded corpus[ALL_FLAGS + 1];
+  for (uint32_t flags = 0; flags <= ALL_FLAGS; flags++) encode((uint16_t)flags, corpus[flags]);
+
+  const uint32_t rounds = 64;
+  uint32_t checksum = 0;
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < rounds; round++) {
+    for (uint32_t flags = 0; flags <= ALL_FLAGS; flags++) {
+      TreadmillData out;
+      if (parseTreadmillData(corpus[flags].data, corpus[flags].length, out)) checksum += out.present;
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+
+  char message[96];
+  snprintf(message, sizeof(message), "parseTreadmillData: %.1f ns/frame (checksum %08X)",
+           ns / (rounds * (ALL_FLAGS + 1.0)), checksum);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testEveryFlagCombination);
+  RUN_TEST(testTruncatedFramesAreRejected);
+  RUN_TEST(testReservedBitsAndTrailingBytes);
+  RUN_TEST(testGoldenFrames);
+  RUN_TEST(testAssemblerMergesMoreData);
+  RUN_TEST(benchmarkParse);
+  return UNITY_END();
+}
@@ -0,0 +1,205 @@
+// Пульс ремня: разбор Heart Rate Measurement и HeartRateMerger.
+//
+// Главный случай - ремень с дрожащими метками и задержкой доставки: на
+// сотнях тренировок (треть - через переполнение millis()) пульс каждой
+// записи сверяется с перебором всех отсчётов - ближайший в пределах
+// HOLD_MS, при равенстве более ранний. Расходиться вправе только записи,
+// чей ближайший отсчёт пришёл позже MAX_DELAY_MS: склейка их уже выпустила.
+//
+//   pio test -e native -f test_heart_rate
+
+#include <algorithm>
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+#include "heart_rate.h"
+
+struct Output {
+  std::vector<WorkoutRecord> records;
+};
+
+static void collect(const WorkoutRecord& record, void* context) {
+  ((Output*)context)->records.push_back(record);
+}
+
+// Повторяемый ГПСЧ (LCG): одни и те же тренировки при каждом прогоне
+static uint32_t seed = 1;
+
+static uint32_t random24() {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+static bool before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void testParseHeartRate() {
+  uint8_t bpm = 0;
+  const uint8_t uint8Frame[] = { 0x00, 142 };
+  TEST_ASSERT_TRUE(parseHeartRate(uint8Frame, sizeof(uint8Frame), bpm));
+  TEST_ASSERT_EQUAL(142, bpm);
+
+  const uint8_t uint16Frame[] = { 0x01, 0x2C, 0x01 };   // 300 - насыщается
+  TEST_ASSERT_TRUE(parseHeartRate(uint16Frame, sizeof(uint16Frame), bpm));
+  TEST_ASSERT_EQUAL(255, bpm);
+
+  const uint8_t noContact[] = { 0x04, 90 };
+  TEST_ASSERT_TRUE(parseHeartRate(noContact, sizeof(noContact), bpm));
+  TEST_ASSERT_EQUAL(0, bpm);
+
+  const uint8_t contact[] = { 0x06, 90 };
+  TEST_ASSERT_TRUE(parseHeartRate(contact, sizeof(contact), bpm));
+  TEST_ASSERT_EQUAL(90, bpm);
+
+  bpm = 77;
+  TEST_ASSERT_FALSE(parseHeartRate(uint16Frame, 2, bpm));
+  TEST_ASSERT_FALSE(parseHeartRate(uint8Frame, 1, bpm));
+  TEST_ASSERT_EQUAL(77, bpm);
+}
+
+// Без ремня записи выходят сразу и сохраняют пульс дорожки
+static void testNoStrapPassesThrough() {
+  Output output;
+  HeartRateMerger merger(collect, &output);
+  WorkoutRecord record = {};
+  record.heartRate = 131;
+  merger.pushRecord(record, 1000);
+  TEST_ASSERT_EQUAL(1, output.records.size());
+  TEST_ASSERT_EQUAL(131, output.records[0].heartRate);
+  TEST_ASSERT_EQUAL(0, merger.pending());
+}
+
+// Ремень на связи, но молчит: записи ждут MAX_DELAY_MS, переполнение
+// выталкивает самую старую
+static void testSilentStrapHoldsThenOverflows() {
+  Output output;
+  HeartRateMerger merger(collect, &output);
+  merger.expectHeartRate(true);
+  for (uint32_t i = 0; i <= HeartRateMerger::RECORD_SLOTS; i++) {
+    WorkoutRecord record = {};
+    record.timestamp = i;
+    merger.pushRecord(record, 1000 + i * 10);
+  }
+  TEST_ASSERT_EQUAL(1, merger.overflows());
+  TEST_ASSERT_EQUAL(1, output.records.size());
+  TEST_ASSERT_EQUAL(0, output.records[0].timestamp);
+
+  merger.poll(1000 + HeartRateMerger::MAX_DELAY_MS - 1);
+  TEST_ASSERT_EQUAL(1, output.records.size());
+  merger.poll(1000 + 10 * HeartRateMerger::RECORD_SLOTS + HeartRateMerger::MAX_DELAY_MS);
+  TEST_ASSERT_EQUAL(HeartRateMerger::RECORD_SLOTS + 1, output.records.size());
+  TEST_ASSERT_EQUAL(0, merger.matched());
+}
+
+struct Beat {
+  uint32_t at;          // метка отсчёта
+  uint32_t delivered;   // когда уведомление дошло до склейки
+  uint8_t bpm;
+};
+
+static void testJitteredStrapMatchesNearestBeat() {
+  seed = 1;
+  uint32_t total = 0;
+  uint32_t late = 0;
+  uint32_t mismatches = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t lost = 0;
+
+  for (int run = 0; run < 300; run++) {
+    uint32_t base = run % 3 == 0 ? 0xFFFF0000u : run * 7919u;
+    uint32_t delay = random24() % 1000;
+    uint32_t jitter = random24() % 400;
+
+    // Ремень - раз в секунду с дрожанием метки и задержкой доставки;
+    // уведомления одного соединения приходят по порядку
+    std::vector<Beat> beats;
+    for (uint32_t k = 0; k < 600; k++) {
+      uint32_t at = base + k * 1000 + random24() % (jitter + 1);
+      beats.push_back({ at, at + random24() % (delay + 1), (uint8_t)(60 + random24() % 120) });
+    }
+    for (size_t k = 1; k < beats.size(); k++) {
+      if (before(beats[k].delivered, beats[k - 1].delivered)) beats[k].delivered = beats[k - 1].delivered;
+    }
+    std::vector<Beat> arrivals = beats;
+    std::stable_sort(arrivals.begin(), arrivals.end(), [](const Beat& a, const Beat& b) {
+      return before(a.delivered, b.delivered);
+    });
+
+    // Кадры дорожки с неровным шагом 0.2-1.1 с
+    std::vector<uint32_t> frames;
+    for (uint32_t t = base + 500; before(t, base + 598000); t += 200 + random24() % 900) frames.push_back(t);
+
+    Output output;
+    HeartRateMerger merger(collect, &output);
+    merger.expectHeartRate(true);
+    size_t nextBeat = 0;
+    size_t nextFrame = 0;
+    for (uint32_t now = base; before(now, base + 600000); now += 50) {
+      while (nextBeat < arrivals.size() && !before(now, arrivals[nextBeat].delivered)) {
+        merger.pushHeartRate(arrivals[nextBeat].bpm, arrivals[nextBeat].at);
+        nextBeat++;
+      }
+      while (nextFrame < frames.size() && !before(now, frames[nextFrame])) {
+        WorkoutRecord record = {};
+        record.timestamp = nextFrame;
+        merger.pushRecord(record, frames[nextFrame]);
+        nextFrame++;
+      }
+      merger.poll(now);
+    }
+    merger.flush();
+
+    if (output.records.size() != frames.size()) lost++;
+    for (size_t i = 0; i < output.records.size(); i++) {
+      if ((size_t)output.records[i].timestamp != i) {
+        outOfOrder++;
+        break;
+      }
+      // Перебор: ближайший отсчёт, при равенстве - более ранний
+      uint32_t t = frames[i];
+      uint32_t best = HeartRateMerger::HOLD_MS + 1;
+      const Beat* nearest = nullptr;
+      for (const Beat& beat : beats) {
+        int32_t offset = (int32_t)(beat.at - t);
+        uint32_t distance = offset < 0 ? (uint32_t)-offset : (uint32_t)offset;
+        if (distance < best || (distance == best && nearest != nullptr && before(beat.at, nearest->at))) {
+          best = distance;
+          nearest = &beat;
+        }
+      }
+      uint8_t expected = nearest != nullptr ? nearest->bpm : 0;
+      total++;
+      if (expected == output.records[i].heartRate) continue;
+      if ((int32_t)(nearest->delivered - t) >= (int32_t)HeartRateMerger::MAX_DELAY_MS) {
+        late++;
+      } else {
+        mismatches++;
+      }
+    }
+  }
+
+  TEST_ASSERT_EQUAL(0, lost);
+  TEST_ASSERT_EQUAL(0, outOfOrder);
+  TEST_ASSERT_EQUAL(0, mismatches);
+  // Отсчёт позже MAX_DELAY_MS - редкость даже при задержке до секунды
+  TEST_ASSERT_LESS_THAN(total / 1000, late);
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u records, 0 mismatches, %u with nearest beat after MAX_DELAY_MS",
+           (unsigned)total, (unsigned)late);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testParseHeartRate);
+  RUN_TEST(testNoStrapPassesThrough);
+  RUN_TEST(testSilentStrapHoldsThenOverflows);
+  RUN_TEST(testJitteredStrapMatchesNearestBeat);
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+// JournalReader::mark()/reset(): повтор пачки сэмплов после оборванного
+// соединения (SupabaseClient::postStream) читает с флеша ровно те же
+// сэмплы, с какого бы места пачка ни начиналась - в начале журнала,
+// посреди записи или на её границе.
+//
+//   pio test -e native -f test_journal_reader
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+
+#include "flash_fs.h"
+#include "workout_journal.h"
+
+static const time_t START = 1714557600;
+static const uint32_t SAMPLES = 400;
+
+static char root[64];
+static char pending[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/journal-reader-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static void writeJournal(FlashFs& fs) {
+  WorkoutJournal journal(fs);
+  TEST_ASSERT_TRUE(journal.beginSession(START));
+  uint32_t distance = 0;
+  for (uint32_t t = 0; t < SAMPLES; t++) {
+    WorkoutRecord record = {};
+    record.timestamp = START + t + t / 50;   // паузы в отсчётах
+    distance += 2 + t % 3;
+    record.distance = distance;
+    record.speed = 6.0f + (t % 40) / 10.0f;
+    record.time = (uint16_t)t;
+    record.heartRate = (uint8_t)(120 + t % 30);
+    record.isActive = true;
+    journal.addSample(record);
+  }
+  TEST_ASSERT_TRUE(journal.endSession(START + SAMPLES + 10, pending, sizeof(pending)));
+}
+
+static void assertSame(const WorkoutRecord& expected, const WorkoutRecord& actual) {
+  TEST_ASSERT_EQUAL(expected.timestamp, actual.timestamp);
+  TEST_ASSERT_EQUAL(expected.distance, actual.distance);
+  TEST_ASSERT_EQUAL_FLOAT(expected.speed, actual.speed);
+  TEST_ASSERT_EQUAL(expected.time, actual.time);
+  TEST_ASSERT_EQUAL(expected.heartRate, actual.heartRate);
+}
+
+static void testResetReplaysFromAnyPosition() {
+  PosixFlash fs(root);
+  writeJournal(fs);
+
+  std::vector<WorkoutRecord> all;
+  {
+    JournalReader reader(fs, pending);
+    WorkoutRecord record;
+    while (reader.next(record)) all.push_back(record);
+    TEST_ASSERT_EQUAL(SAMPLES, all.size());
+  }
+
+  // Начало журнала, середина записи, граница записей (BATCH), конец
+  const uint32_t starts[] = { 0, 7, WorkoutJournal::BATCH, WorkoutJournal::BATCH * 3 + 1, SAMPLES };
+  for (uint32_t start : starts) {
+    JournalReader reader(fs, pending);
+    WorkoutRecord record;
+    for (uint32_t i = 0; i < start; i++) TEST_ASSERT_TRUE(reader.next(record));
+
+    JournalReader::Mark position = reader.mark();
+    // Пачка ушла частично, через несколько записей
+    for (uint32_t i = start; i < start + 75 && reader.next(record); i++) {
+    }
+    TEST_ASSERT_TRUE(reader.reset(position));
+
+    uint32_t index = start;
+    while (reader.next(record)) {
+      TEST_ASSERT_LESS_THAN(SAMPLES, index);
+      assertSame(all[index], record);
+      index++;
+    }
+    TEST_ASSERT_EQUAL(SAMPLES, index);
+    TEST_ASSERT_EQUAL(SAMPLES, reader.info().samples);
+    TEST_ASSERT_TRUE(reader.info().ended);
+  }
+}
+
+// Запись под меткой испорчена: reset() сообщает об этом, а не читает чужое
+static void testResetFailsOnChangedJournal() {
+  PosixFlash fs(root);
+  writeJournal(fs);
+
+  JournalReader reader(fs, pending);
+  WorkoutRecord record;
+  for (uint32_t i = 0; i < 5; i++) TEST_ASSERT_TRUE(reader.next(record));
+  JournalReader::Mark position = reader.mark();
+
+  char host[160];
+  snprintf(host, sizeof(host), "%s%s", root, pending);
+  FILE* file = fopen(host, "r+b");
+  TEST_ASSERT_NOT_NULL(file);
+  fseek(file, (long)position.recordStart + 20, SEEK_SET);
+  int byte = fgetc(file);
+  fseek(file, (long)position.recordStart + 20, SEEK_SET);
+  fputc(byte ^ 0xFF, file);
+  fclose(file);
+
+  TEST_ASSERT_FALSE(reader.reset(position));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testResetReplaysFromAnyPosition);
+  RUN_TEST(testResetFailsOnChangedJournal);
+  return UNITY_END();
+}
@@ -0,0 +1,310 @@
+// LiveFanout под нагрузкой: 12-16 клиентов /ws с разной скоростью.
+// Часы - переменная теста, кадр и рассылка раз в LIVE_PUSH_INTERVAL, как
+// в pushLiveTelemetry. Очередь клиента - как у AsyncWebSocket с лимитом в
+// один кадр: клиент готов, пока очередь пуста, и отдаёт кадр в сеть за
+// свой период. Проверяется, что в очереди никогда нет двух кадров, что
+// клиенту уходит только текущий кадр и seq у него только растут.
+//
+//   pio test -e native -f test_live_fanout
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#include "live_fanout.h"
+
+static const uint32_t PUSH_MS = 200;
+static const uint32_t STALLED = 0xFFFFFFFFu;
+
+struct Client {
+  uint32_t id;
+  uint32_t periodMs;      // сколько кадр уходит в сеть; STALLED - никогда
+  uint32_t queued;        // кадров в очереди
+  uint32_t busyUntil;
+  uint32_t maxQueued;
+  uint32_t stale;         // готов, но без текущего кадра
+  uint32_t backwards;     // seq не вырос
+  std::vector<uint32_t> seqs;
+};
+
+static uint32_t now;
+static uint32_t current;
+static std::vector<Client> clients;
+
+void setUp() {
+  now = 0;
+  current = 0;
+  clients.clear();
+}
+
+void tearDown() {}
+
+static Client* find(uint32_t id) {
+  for (size_t i = 0; i < clients.size(); i++) {
+    if (clients[i].id == id) return &clients[i];
+  }
+  return nullptr;
+}
+
+static Client& addClient(LiveFanout& fanout, uint32_t id, uint32_t periodMs) {
+  Client client = {id, periodMs, 0, 0, 0, 0, 0, {}};
+  clients.push_back(client);
+  TEST_ASSERT_TRUE(fanout.add(id));
+  return clients.back();
+}
+
+// Очереди клиентов отдают кадры в сеть к моменту now
+static void drain() {
+  for (size_t i = 0; i < clients.size(); i++) {
+    Client& client = clients[i];
+    if (client.queued > 0 && client.periodMs != STALLED && now >= client.busyUntil) client.queued--;
+  }
+}
+
+static size_t push(LiveFanout& fanout) {
+  drain();
+  if (!fanout.behind(current)) return 0;
+  return fanout.publish(
+    current,
+    [](uint32_t id) {
+      Client* client = find(id);
+      return client != nullptr && client->queued == 0;
+    },
+    [](uint32_t id) {
+      Client* client = find(id);
+      if (client == nullptr) return;
+      if (!client->seqs.empty() && client->seqs.back() >= current) client->backwards++;
+      client->seqs.push_back(current);
+      client->queued++;
+      if (client->queued > client->maxQueued) client->maxQueued = client->queued;
+      client->busyUntil = now + client->periodMs;
+    });
+}
+
+// Раз в PUSH_MS новый кадр и рассылка
+static void run(LiveFanout& fanout, uint32_t rounds, bool newFrames) {
+  for (uint32_t i = 0; i < rounds; i++) {
+    if (newFrames) current++;
+    push(fanout);
+    now += PUSH_MS;
+  }
+}
+
+static size_t totalSent() {
+  size_t total = 0;
+  for (size_t i = 0; i < clients.size(); i++) total += clients[i].seqs.size();
+  return total;
+}
+
+static void testSlowClientsGetOnlyLatest() {
+  LiveFanout fanout;
+  const uint32_t periods[] = {50, 100, 150, 200, 250, 300, 400, 600, 1000, 2000, 5000, STALLED};
+  const size_t count = sizeof(periods) / sizeof(periods[0]);
+  for (size_t i = 0; i < count; i++) addClient(fanout, (uint32_t)(i + 1), periods[i]);
+  TEST_ASSERT_EQUAL(count, fanout.count());
+
+  // Десять минут кадров
+  const uint32_t rounds = 600000 / PUSH_MS;
+  run(fanout, rounds, true);
+
+  for (size_t i = 0; i < count; i++) {
+    const Client& client = clients[i];
+    TEST_ASSERT_EQUAL_MESSAGE(1, client.maxQueued, "queue coalesces to one frame");
+    TEST_ASSERT_EQUAL(0, client.backwards);
+    TEST_ASSERT_EQUAL(1, client.seqs.front());
+    if (client.periodMs == STALLED) {
+      // Завис после первого кадра: больше ему ничего не кладётся
+      TEST_ASSERT_EQUAL(1, client.seqs.size());
+      continue;
+    }
+    // Клиент освобождается через ceil(period / PUSH_MS) рассылок и сразу
+    // получает тот кадр, что свежий в этот момент
+    uint32_t every = (client.periodMs + PUSH_MS - 1) / PUSH_MS;
+    TEST_ASSERT_EQUAL((rounds + every - 1) / every, client.seqs.size());
+    for (size_t k = 1; k < client.seqs.size(); k++) {
+      TEST_ASSERT_EQUAL(every, client.seqs[k] - client.seqs[k - 1]);
+    }
+  }
+  TEST_ASSERT_EQUAL(totalSent(), fanout.sent());
+  TEST_ASSERT_GREATER_THAN(0, fanout.skipped());
+
+  // Кадры кончились: освободившиеся клиенты получают последний, и
+  // ровно один раз
+  uint32_t last = current;
+  run(fanout, 5000 / PUSH_MS + 1, false);
+  for (size_t i = 0; i < count; i++) {
+    const Client& client = clients[i];
+    TEST_ASSERT_EQUAL(0, client.backwards);
+    if (client.periodMs == STALLED) continue;
+    TEST_ASSERT_EQUAL(last, client.seqs.back());
+  }
+  TEST_ASSERT_TRUE(fanout.behind(last));   // только завис
+  size_t sentBefore = fanout.sent();
+  run(fanout, 20, false);
+  TEST_ASSERT_EQUAL(sentBefore, fanout.sent());
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u clients, %u rounds: %u frames sent, %u skipped",
+           (unsigned)count, (unsigned)rounds, (unsigned)fanout.sent(), (unsigned)fanout.skipped());
+  TEST_MESSAGE(message);
+}
+
+// Кадры и рассылки неравномерны; готовый клиент всегда с текущим кадром
+static void testNoStaleFrames() {
+  LiveFanout fanout;
+  for (uint32_t id = 1; id <= 14; id++) addClient(fanout, id, 70 * id);
+
+  uint32_t seed = 12345;
+  for (uint32_t i = 0; i < 5000; i++) {
+    // Кадры приходят неравномерно: иногда два за рассылку, иногда ни одного
+    seed = seed * 1664525u + 1013904223u;
+    current += (seed >> 8) % 3;
+    push(fanout);
+    // После рассылки у каждого готового клиента текущий кадр: пропущенные
+    // им кадры выброшены, а не ждут своей очереди
+    for (size_t k = 0; k < clients.size(); k++) {
+      Client& client = clients[k];
+      if (client.queued == 0 && client.seqs.back() != current) client.stale++;
+    }
+    now += (seed >> 20) % (2 * PUSH_MS);
+  }
+  for (size_t k = 0; k < clients.size(); k++) {
+    TEST_ASSERT_EQUAL(0, clients[k].stale);
+    TEST_ASSERT_EQUAL(0, clients[k].backwards);
+    TEST_ASSERT_EQUAL(1, clients[k].maxQueued);
+  }
+  TEST_ASSERT_EQUAL(totalSent(), fanout.sent());
+}
+
+// Подключение и отключение посреди потока
+static void testJoinAndLeave() {
+  LiveFanout fanout;
+  for (uint32_t id = 1; id <= 10; id++) addClient(fanout, id, 100);
+  run(fanout, 50, true);
+
+  // Новый клиент получает текущий кадр сразу, без нового seq
+  addClient(fanout, 100, 100);
+  TEST_ASSERT_TRUE(fanout.behind(current));
+  TEST_ASSERT_EQUAL(1, push(fanout));
+  TEST_ASSERT_EQUAL(1, find(100)->seqs.size());
+  TEST_ASSERT_EQUAL(current, find(100)->seqs[0]);
+  TEST_ASSERT_FALSE(fanout.behind(current));
+
+  // Отключённый больше ничего не получает; его слот занимает другой, и
+  // новому кадр уходит, хотя прежний владелец слота этот seq уже видел
+  fanout.remove(3);
+  size_t gone = find(3)->seqs.size();
+  addClient(fanout, 200, 100);
+  now += PUSH_MS;
+  TEST_ASSERT_EQUAL(1, push(fanout));
+  TEST_ASSERT_EQUAL(current, find(200)->seqs[0]);
+  now += PUSH_MS;
+  run(fanout, 50, true);
+  TEST_ASSERT_EQUAL(gone, find(3)->seqs.size());
+  TEST_ASSERT_EQUAL(51, find(200)->seqs.size());
+  TEST_ASSERT_EQUAL(11, fanout.count());
+
+  // Занять все слоты, лишний не добавляется
+  for (uint32_t id = 300; fanout.count() < LiveFanout::MAX_CLIENTS; id++) addClient(fanout, id, 100);
+  TEST_ASSERT_FALSE(fanout.add(999));
+  TEST_ASSERT_FALSE(fanout.add(0));
+  run(fanout, 10, true);
+  for (size_t i = 0; i < clients.size(); i++) {
+    if (clients[i].id == 3) continue;
+    TEST_ASSERT_EQUAL(current, clients[i].seqs.back());
+    TEST_ASSERT_EQUAL(0, clients[i].backwards);
+  }
+  TEST_ASSERT_EQUAL(totalSent(), fanout.sent());
+}
+
+// add()/remove() из задачи веб-сервера во время publish(): постоянные
+// клиенты не теряют ни одного кадра, счётчик слотов сходится
+static void testChurnWhilePublishing() {
+  LiveFanout fanout;
+  const uint32_t STEADY = 8;
+  static std::atomic<uint32_t> received[STEADY + 1];
+  static std::atomic<uint32_t> lastSeq[STEADY + 1];
+  static std::atomic<uint32_t> backwards;
+  for (uint32_t id = 1; id <= STEADY; id++) {
+    received[id] = 0;
+    lastSeq[id] = 0;
+    TEST_ASSERT_TRUE(fanout.add(id));
+  }
+  backwards = 0;
+
+  std::atomic<bool> done(false);
+  std::atomic<uint32_t> churns(0);
+  std::thread web([&] {
+    uint32_t next = 1000;
+    std::vector<uint32_t> joined;
+    while (!done.load()) {
+      if (joined.size() < 6 && fanout.add(next)) joined.push_back(next++);
+      if (joined.size() >= 6 || (next & 3) == 0) {
+        fanout.remove(joined.front());
+        joined.erase(joined.begin());
+      }
+      churns++;
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < joined.size(); i++) fanout.remove(joined[i]);
+  });
+
+  uint32_t seq = 0;
+  auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  while (std::chrono::steady_clock::now() < until) {
+    seq++;
+    fanout.publish(
+      seq, [](uint32_t) { return true; },
+      [&](uint32_t id) {
+        if (id > STEADY) return;
+        if (lastSeq[id] >= seq) backwards++;
+        lastSeq[id] = seq;
+        received[id]++;
+      });
+  }
+  done = true;
+  web.join();
+
+  TEST_ASSERT_EQUAL(STEADY, fanout.count());
+  TEST_ASSERT_EQUAL(0, backwards.load());
+  for (uint32_t id = 1; id <= STEADY; id++) TEST_ASSERT_EQUAL(seq, received[id].load());
+  TEST_ASSERT_GREATER_THAN(0, churns.load());
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u frames, %u add/remove rounds alongside",
+           (unsigned)seq, (unsigned)churns.load());
+  TEST_MESSAGE(message);
+}
+
+// Цена рассылки на 16 клиентов, все готовы
+static void testPublishCost() {
+  LiveFanout fanout;
+  for (uint32_t id = 1; id <= LiveFanout::MAX_CLIENTS; id++) TEST_ASSERT_TRUE(fanout.add(id));
+
+  const uint32_t ROUNDS = 200000;
+  volatile uint32_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t seq = 1; seq <= ROUNDS; seq++) {
+    fanout.publish(seq, [](uint32_t) { return true; }, [&](uint32_t id) { sink = sink + id; });
+  }
+  auto spent = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  TEST_ASSERT_EQUAL(ROUNDS * LiveFanout::MAX_CLIENTS, fanout.sent());
+
+  char message[96];
+  snprintf(message, sizeof(message), "publish to %u clients: %.1f ns per round",
+           (unsigned)LiveFanout::MAX_CLIENTS, (double)spent.count() / ROUNDS);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testSlowClientsGetOnlyLatest);
+  RUN_TEST(testNoStaleFrames);
+  RUN_TEST(testJoinAndLeave);
+  RUN_TEST(testChurnWhilePublishing);
+  RUN_TEST(testPublishCost);
+  return UNITY_END();
+}
@@ -0,0 +1,348 @@
+// Метрики /metrics: текст MetricsStream - формат Prometheus 0.0.4
+// (эталонный вывод и построчная проверка синтаксиса при выдаче мелкими
+// кусками), границы корзин гистограммы (значение на границе - в ней, le
+// растут, +Inf равно _count), перенос 64-битной суммы и сложение ячеек
+// ядер: потоки теста пишут в разные ячейки через setMetricCore().
+//
+//   pio test -e native -f test_metrics
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#include "metrics.h"
+
+void setUp() {
+  setMetricCore(0);
+}
+
+void tearDown() {}
+
+static std::string render(const MetricFamily* families, size_t count, size_t chunk) {
+  MetricsStream stream(families, count);
+  std::string text;
+  std::vector<uint8_t> buffer(chunk);
+  size_t n;
+  while ((n = stream.fill(buffer.data(), chunk)) > 0) text.append((const char*)buffer.data(), n);
+  return text;
+}
+
+static std::string checkExposition(const std::string& text);
+
+static double heapBytes() {
+  return 123456;
+}
+
+static double uptimeSeconds() {
+  return 86400.5;
+}
+
+static void testGoldenExposition() {
+  static const uint32_t bounds[] = {10, 100, 1000};
+  Counter frames;
+  Histogram parse(bounds, 3);
+  CodeCounter codes;
+  Counter drops[2];
+  static const char* const reasons[] = {"full", "crc"};
+
+  frames.add(3);
+  setMetricCore(1);
+  frames.add(4);
+  setMetricCore(0);
+  parse.observe(10);
+  parse.observe(11);
+  parse.observe(100);
+  parse.observe(1001);
+  codes.add(201);
+  codes.add(503);
+  codes.add(201);
+  drops[0].add();
+
+  const MetricFamily families[] = {
+    MetricFamily::counterOf("treadmill_frames_total", "BLE frames received", frames),
+    MetricFamily::gauge("treadmill_heap_free_bytes", "Free heap", heapBytes),
+    MetricFamily::counterFrom("treadmill_uptime_seconds_total", "Uptime", uptimeSeconds),
+    MetricFamily::histogramOf("treadmill_parse_seconds", "Frame parse time", parse, 1e-6),
+    MetricFamily::codesOf("treadmill_upload_responses_total", "Upload HTTP codes", "code", codes),
+    MetricFamily::labeled("treadmill_drops_total", "Dropped frames", "reason", drops, reasons, 2),
+  };
+
+  const char* expected =
+    "# HELP treadmill_frames_total BLE frames received\n"
+    "# TYPE treadmill_frames_total counter\n"
+    "treadmill_frames_total 7\n"
+    "# HELP treadmill_heap_free_bytes Free heap\n"
+    "# TYPE treadmill_heap_free_bytes gauge\n"
+    "treadmill_heap_free_bytes 123456\n"
+    "# HELP treadmill_uptime_seconds_total Uptime\n"
+    "# TYPE treadmill_uptime_seconds_total counter\n"
+    "treadmill_uptime_seconds_total 86400.5\n"
+    "# HELP treadmill_parse_seconds Frame parse time\n"
+    "# TYPE treadmill_parse_seconds histogram\n"
+    "treadmill_parse_seconds_bucket{le=\"1e-05\"} 1\n"
+    "treadmill_parse_seconds_bucket{le=\"0.0001\"} 3\n"
+    "treadmill_parse_seconds_bucket{le=\"0.001\"} 3\n"
+    "treadmill_parse_seconds_bucket{le=\"+Inf\"} 4\n"
+    "treadmill_parse_seconds_sum 0.001122\n"
+    "treadmill_parse_seconds_count 4\n"
+    "# HELP treadmill_upload_responses_total Upload HTTP codes\n"
+    "# TYPE treadmill_upload_responses_total counter\n"
+    "treadmill_upload_responses_total{code=\"201\"} 2\n"
+    "treadmill_upload_responses_total{code=\"503\"} 1\n"
+    "# HELP treadmill_drops_total Dropped frames\n"
+    "# TYPE treadmill_drops_total counter\n"
+    "treadmill_drops_total{reason=\"full\"} 1\n"
+    "treadmill_drops_total{reason=\"crc\"} 0\n";
+
+  std::string text = render(families, sizeof(families) / sizeof(families[0]), 4096);
+  TEST_ASSERT_EQUAL_STRING(expected, text.c_str());
+  TEST_ASSERT_EQUAL_STRING("", checkExposition(text).c_str());
+  // Сервер забирает ответ кусками любого размера
+  for (size_t chunk = 1; chunk < 64; chunk += 5) {
+    TEST_ASSERT_TRUE(render(families, sizeof(families) / sizeof(families[0]), chunk) == text);
+  }
+}
+
+static bool metricName(const std::string& name) {
+  if (name.empty() || !(isalpha((unsigned char)name[0]) || name[0] == '_' || name[0] == ':')) return false;
+  for (size_t i = 1; i < name.size(); i++) {
+    if (!(isalnum((unsigned char)name[i]) || name[i] == '_' || name[i] == ':')) return false;
+  }
+  return true;
+}
+
+static bool hasSuffix(const std::string& text, const std::string& suffix) {
+  return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Построчная проверка текстового формата: HELP и TYPE перед значениями
+// семейства, имена и метки допустимы, значение - число, корзины
+// гистограммы накопительные, le по возрастанию, +Inf последняя и равна _count.
+// Возвращает описание первой ошибки или пустую строку
+static std::string checkExposition(const std::string& text) {
+  if (text.empty() || text.back() != '\n') return "no trailing newline";
+  std::string family;
+  std::string type;
+  std::vector<std::string> seen;
+  double lastLe = -1;
+  double lastBucket = -1;
+  double infBucket = -1;
+  size_t at = 0;
+  while (at < text.size()) {
+    size_t end = text.find('\n', at);
+    std::string line = text.substr(at, end - at);
+    at = end + 1;
+
+    if (line.compare(0, 7, "# HELP ") == 0) {
+      std::string name = line.substr(7, line.find(' ', 7) - 7);
+      if (!metricName(name)) return "bad HELP name: " + line;
+      for (size_t i = 0; i < seen.size(); i++) {
+        if (seen[i] == name) return "family repeated: " + name;
+      }
+      seen.push_back(name);
+      family = name;
+      type.clear();
+      continue;
+    }
+    if (line.compare(0, 7, "# TYPE ") == 0) {
+      if (line != "# TYPE " + family + " counter" && line != "# TYPE " + family + " gauge" &&
+          line != "# TYPE " + family + " histogram") {
+        return "bad TYPE: " + line;
+      }
+      type = line.substr(line.rfind(' ') + 1);
+      lastLe = -1;
+      lastBucket = -1;
+      infBucket = -1;
+      continue;
+    }
+    if (type.empty()) return "sample before TYPE: " + line;
+
+    size_t space = line.rfind(' ');
+    if (space == std::string::npos) return "no value: " + line;
+    std::string value = line.substr(space + 1);
+    char* parsedEnd;
+    double number = strtod(value.c_str(), &parsedEnd);
+    if (value.empty() || *parsedEnd != '\0') return "bad value: " + line;
+
+    std::string series = line.substr(0, space);
+    std::string name = series.substr(0, series.find('{'));
+    std::string labels = series.size() > name.size() ? series.substr(name.size()) : "";
+    if (!metricName(name)) return "bad name: " + line;
+    if (!labels.empty()) {
+      // {label="value"} с одной меткой, как выводит MetricsStream
+      size_t equals = labels.find("=\"");
+      if (labels[0] != '{' || labels.back() != '}' || equals == std::string::npos ||
+          !metricName(labels.substr(1, equals - 1)) || labels[labels.size() - 2] != '"') {
+        return "bad labels: " + line;
+      }
+    }
+
+    if (type != "histogram") {
+      if (name != family) return "sample of another family: " + line;
+      if (type == "counter" && number < 0) return "negative counter: " + line;
+      continue;
+    }
+    if (name == family + "_bucket") {
+      if (labels.compare(0, 5, "{le=\"") != 0) return "bucket without le: " + line;
+      if (infBucket >= 0) return "bucket after +Inf: " + line;
+      std::string le = labels.substr(5, labels.size() - 7);
+      if (number < lastBucket) return "buckets not cumulative: " + line;
+      lastBucket = number;
+      if (le == "+Inf") {
+        infBucket = number;
+        continue;
+      }
+      double bound = strtod(le.c_str(), &parsedEnd);
+      if (*parsedEnd != '\0' || bound <= lastLe) return "le not increasing: " + line;
+      lastLe = bound;
+    } else if (name == family + "_sum") {
+      if (infBucket < 0) return "_sum before +Inf bucket: " + line;
+    } else if (name == family + "_count") {
+      if (number != infBucket) return "_count differs from +Inf bucket: " + line;
+    } else if (!hasSuffix(name, "_bucket")) {
+      return "sample of another family: " + line;
+    }
+  }
+  return "";
+}
+
+// Значение на границе корзины - в ней (le - "меньше или равно")
+static void testBucketEdges() {
+  static const uint32_t bounds[] = {1, 2, 5, 10, 50, 100, 1000, 0xFFFFFFFEu};
+  Histogram histogram(bounds, 8);
+  TEST_ASSERT_EQUAL(8, histogram.buckets());
+  for (size_t i = 0; i < 8; i++) {
+    histogram.observe(bounds[i]);
+    if (bounds[i] > 0) histogram.observe(bounds[i] - 1);
+    histogram.observe(bounds[i] + 1);
+  }
+  histogram.observe(0);
+
+  // Наблюдения не больше границы i, посчитанные перебором
+  for (size_t i = 0; i < 8; i++) {
+    uint32_t expected = 1;   // ноль
+    for (size_t k = 0; k < 8; k++) {
+      if (bounds[k] <= bounds[i]) expected++;
+      if (bounds[k] > 0 && bounds[k] - 1 <= bounds[i]) expected++;
+      if (bounds[k] + 1 <= bounds[i]) expected++;
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(expected, histogram.cumulative(i), "cumulative count at bucket edge");
+  }
+  TEST_ASSERT_EQUAL(25, histogram.count());
+  TEST_ASSERT_EQUAL(25, histogram.cumulative(8));
+
+  // Корзин больше MAX_BUCKETS - лишние отбрасываются, +Inf остаётся
+  static const uint32_t many[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  Histogram clamped(many, 15);
+  TEST_ASSERT_EQUAL(Histogram::MAX_BUCKETS, clamped.buckets());
+  clamped.observe(14);
+  clamped.observe(12);
+  TEST_ASSERT_EQUAL(1, clamped.cumulative(Histogram::MAX_BUCKETS - 1));
+  TEST_ASSERT_EQUAL(2, clamped.count());
+
+  const MetricFamily family[] = {
+    MetricFamily::histogramOf("treadmill_edges_seconds", "Edges", histogram, 1e-3),
+    MetricFamily::histogramOf("treadmill_clamped", "Clamped", clamped, 1.0),
+  };
+  std::string text = render(family, 2, 17);
+  std::string error = checkExposition(text);
+  TEST_ASSERT_EQUAL_STRING("", error.c_str());
+}
+
+// Сумма - два 32-битных слова с переносом: 2^32 и больше не теряются
+static void testHistogramSumCarries() {
+  static const uint32_t bounds[] = {1000};
+  Histogram histogram(bounds, 1);
+  uint64_t expected = 0;
+  for (uint32_t i = 0; i < 10; i++) {
+    histogram.observe(0xF0000000u + i);
+    expected += 0xF0000000u + i;
+  }
+  setMetricCore(1);
+  histogram.observe(0xFFFFFFFFu);
+  expected += 0xFFFFFFFFu;
+  TEST_ASSERT_TRUE(histogram.sum() == expected);
+  TEST_ASSERT_EQUAL(11, histogram.count());
+  TEST_ASSERT_EQUAL(0, histogram.cumulative(0));
+}
+
+// Два потока - два ядра: каждый пишет в свою ячейку, чтение складывает
+static void testPerCoreCountersSum() {
+  static const uint32_t bounds[] = {10, 100};
+  static Counter counter;
+  static Histogram histogram(bounds, 2);
+  static CodeCounter codes;
+  static Counter labeled[3];
+  const uint32_t ROUNDS = 200000;
+
+  auto work = [&](size_t core) {
+    setMetricCore(core);
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+      counter.add();
+      histogram.observe(core == 0 ? 5 : 50 + i % 100);
+      codes.add(core == 0 ? 200 : (i & 1 ? 200 : 503));
+      labeled[i % 3].add(2);
+    }
+  };
+  std::thread second(work, 1);
+  work(0);
+  second.join();
+
+  TEST_ASSERT_EQUAL(2 * ROUNDS, counter.value());
+  TEST_ASSERT_EQUAL(2 * ROUNDS, histogram.count());
+  TEST_ASSERT_EQUAL(ROUNDS, histogram.cumulative(0));
+  // Второе ядро: 50..149 поровну, 51 значение из 100 не больше 100
+  TEST_ASSERT_EQUAL(ROUNDS + ROUNDS / 100 * 51, histogram.cumulative(1));
+  uint64_t sum = (uint64_t)ROUNDS * 5 + (uint64_t)(ROUNDS / 100) * (50 + 149) * 100 / 2;
+  TEST_ASSERT_TRUE(histogram.sum() == sum);
+
+  uint32_t ok = 0, unavailable = 0;
+  for (size_t i = 0; i < CodeCounter::SLOTS; i++) {
+    if (!codes.used(i)) continue;
+    if (codes.code(i) == 200) ok += codes.value(i);
+    if (codes.code(i) == 503) unavailable += codes.value(i);
+  }
+  TEST_ASSERT_EQUAL(ROUNDS + ROUNDS / 2, ok);
+  TEST_ASSERT_EQUAL(ROUNDS / 2, unavailable);
+  uint32_t labeledTotal = labeled[0].value() + labeled[1].value() + labeled[2].value();
+  TEST_ASSERT_EQUAL(4 * ROUNDS, labeledTotal);
+}
+
+// Кодов больше, чем ячеек: лишние - в "other", вывод остаётся корректным
+static void testCodeOverflow() {
+  CodeCounter codes;
+  for (int32_t code = 200; code < 220; code++) codes.add(code);
+  codes.add(-1);   // ошибка транспорта
+  codes.add(200);
+
+  uint32_t total = 0;
+  for (size_t i = 0; i < CodeCounter::SLOTS; i++) {
+    TEST_ASSERT_TRUE(codes.used(i));
+    total += codes.value(i);
+  }
+  TEST_ASSERT_EQUAL(22, total);
+  TEST_ASSERT_EQUAL(2, codes.value(0));
+  TEST_ASSERT_EQUAL(21 - (CodeCounter::SLOTS - 1), codes.value(CodeCounter::SLOTS - 1));
+
+  const MetricFamily family[] = {
+    MetricFamily::codesOf("treadmill_codes_total", "Codes", "code", codes),
+  };
+  std::string text = render(family, 1, 4096);
+  TEST_ASSERT_EQUAL_STRING("", checkExposition(text).c_str());
+  TEST_ASSERT_NOT_NULL(strstr(text.c_str(), "treadmill_codes_total{code=\"other\"} 14\n"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testGoldenExposition);
+  RUN_TEST(testBucketEdges);
+  RUN_TEST(testHistogramSumCarries);
+  RUN_TEST(testPerCoreCountersSum);
+  RUN_TEST(testCodeOverflow);
+  return UNITY_END();
+}
@@ -0,0 +1,340 @@
+// OutboxDrain против сервера с отказами: таймауты до и после записи в
+// таблицу, 5xx, 409 на отравленной строке и сбой питания между POST и
+// удалением строки из очереди. После каждого сбоя - перезагрузка: новая
+// очередь по тому же каталогу. В итоге каждая строка в таблице ровно
+// один раз либо в dead (только отравленные), повтор доставки - только
+// у строк, чей ответ потерян.
+//
+//   pio test -e native -f test_outbox
+
+#include <ftw.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#include "flash_fs.h"
+#include "outbox_drain.h"
+#include "upload_outbox.h"
+
+static const time_t START = 1714557600;
+
+static char root[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/outbox-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Повторяемый ГПСЧ (LCG)
+static uint32_t seed = 3;
+
+static uint32_t random24() {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// Флеш, который "теряет питание": после down() ни одна операция не
+// выполняется, пока тест не перезагрузит устройство
+class CrashingFlash : public FlashFs {
+public:
+  explicit CrashingFlash(const char* rootDir) : flash(rootDir), off(false) {}
+
+  void down() { off = true; }
+  void up() { off = false; }
+  bool isDown() const { return off; }
+
+  bool append(const char* path, const void* data, size_t length) override {
+    return !off && flash.append(path, data, length);
+  }
+  size_t read(const char* path, size_t offset, void* out, size_t length) override {
+    return off ? 0 : flash.read(path, offset, out, length);
+  }
+  size_t size(const char* path) override { return off ? 0 : flash.size(path); }
+  bool exists(const char* path) override { return !off && flash.exists(path); }
+  bool remove(const char* path) override { return !off && flash.remove(path); }
+  bool rename(const char* from, const char* to) override { return !off && flash.rename(from, to); }
+  void list(const char* dir, const std::function<void(const char* path)>& callback) override {
+    if (!off) flash.list(dir, callback);
+  }
+
+private:
+  PosixFlash flash;
+  bool off;
+};
+
+// Таблица workouts с уникальным client_id. Отказы выбираются случайно
+// на каждый запрос; пачка со строкой из poison целиком отвергается 409
+class FakeServer : public UploadPoster {
+public:
+  explicit FakeServer(CrashingFlash& fs) : fs(fs) {}
+
+  int postBatch(const char* body, size_t length, size_t rows,
+                char* response, size_t responseSize) override {
+    snprintf(response, responseSize, "%s", "");
+    posts++;
+    std::vector<std::string> keys = parse(body, length);
+    TEST_ASSERT_EQUAL(rows, keys.size());
+
+    if (schemaMissing) {
+      snprintf(response, responseSize, "%s",
+               "{\"code\":\"PGRST204\",\"message\":\"Could not find the 'splits' column\"}");
+      return 400;
+    }
+    if (faults) {
+      uint32_t roll = random24() % 100;
+      if (roll < 8) {
+        timeouts++;
+        return -11;                 // таймаут до записи
+      }
+      if (roll < 14) {
+        serverErrors++;
+        return 503;
+      }
+      if (roll < 20 && !poisoned(keys)) {
+        commit(keys);
+        lost(keys);
+        timeouts++;
+        return -11;                 // записано, ответ потерян
+      }
+      if (roll < 25 && !poisoned(keys)) {
+        commit(keys);
+        lost(keys);
+        crashes++;
+        fs.down();                  // питание пропало до удаления строк
+        return 201;
+      }
+    }
+    if (poisoned(keys)) {
+      conflicts++;
+      snprintf(response, responseSize, "%s", "{\"code\":\"23505\",\"message\":\"conflict\"}");
+      return 409;
+    }
+    commit(keys);
+    return 201;
+  }
+
+  bool schemaMissing = false;
+  bool faults = false;
+  std::set<std::string> poison;
+  std::set<std::string> table;
+  std::set<std::string> unacknowledged;
+  std::vector<std::string> lastBatch;
+  uint32_t posts = 0;
+  uint32_t timeouts = 0;
+  uint32_t serverErrors = 0;
+  uint32_t crashes = 0;
+  uint32_t conflicts = 0;
+  uint32_t redelivered = 0;
+  uint32_t unexpectedRedelivery = 0;
+
+private:
+  // Тело - JSON-массив строк; ключ каждой - client_id
+  std::vector<std::string> parse(const char* body, size_t length) {
+    std::string text(body, length);
+    TEST_ASSERT_TRUE(length >= 2 && text.front() == '[' && text.back() == ']');
+    std::vector<std::string> keys;
+    static const std::string KEY = "\"client_id\":\"";
+    for (size_t at = text.find(KEY); at != std::string::npos; at = text.find(KEY, at)) {
+      at += KEY.size();
+      keys.push_back(text.substr(at, text.find('"', at) - at));
+    }
+    lastBatch = keys;
+    return keys;
+  }
+
+  bool poisoned(const std::vector<std::string>& keys) const {
+    for (const std::string& key : keys) {
+      if (poison.count(key) != 0) return true;
+    }
+    return false;
+  }
+
+  // on_conflict=client_id + ignore-duplicates: повтор не вставляется
+  void commit(const std::vector<std::string>& keys) {
+    for (const std::string& key : keys) {
+      if (table.insert(key).second) continue;
+      redelivered++;
+      if (unacknowledged.count(key) == 0) unexpectedRedelivery++;
+    }
+  }
+
+  void lost(const std::vector<std::string>& keys) {
+    unacknowledged.insert(keys.begin(), keys.end());
+  }
+
+  CrashingFlash& fs;
+};
+
+static std::string keyOf(uint32_t i) {
+  char key[32];
+  snprintf(key, sizeof(key), "%ld-%u", (long)(START + i * 600), (unsigned)(i % 4));
+  return key;
+}
+
+static void enqueueRow(UploadOutbox& outbox, uint32_t i) {
+  char row[128];
+  int length = snprintf(row, sizeof(row), "{\"client_id\":\"%s\",\"distance\":%u}",
+                        keyOf(i).c_str(), (unsigned)(i * 37));
+  TEST_ASSERT_TRUE(outbox.enqueue(keyOf(i).c_str(), row, (size_t)length));
+}
+
+static std::set<std::string> keysIn(FlashFs& fs, const char* dir) {
+  std::set<std::string> keys;
+  fs.list(dir, [&](const char* path) {
+    std::string name = strrchr(path, '/') + 1;
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0) {
+      keys.insert(name.substr(0, name.size() - 5));
+    }
+  });
+  return keys;
+}
+
+static void testClassifiesResponses() {
+  TEST_ASSERT_TRUE(isSchemaError(400, "{\"code\":\"PGRST204\"}"));
+  TEST_ASSERT_TRUE(isSchemaError(400, "{\"code\":\"42703\",\"message\":\"column x does not exist\"}"));
+  TEST_ASSERT_FALSE(isSchemaError(500, "PGRST204"));
+  TEST_ASSERT_FALSE(isSchemaError(400, "{\"code\":\"23502\"}"));
+  TEST_ASSERT_FALSE(isSchemaError(400, nullptr));
+
+  TEST_ASSERT_FALSE(isPermanentUploadError(400, "{\"code\":\"PGRST204\"}"));
+  TEST_ASSERT_TRUE(isPermanentUploadError(400, "{\"code\":\"23502\"}"));
+  TEST_ASSERT_TRUE(isPermanentUploadError(409, ""));
+  TEST_ASSERT_TRUE(isPermanentUploadError(422, ""));
+  TEST_ASSERT_FALSE(isPermanentUploadError(503, ""));
+  TEST_ASSERT_FALSE(isPermanentUploadError(-11, ""));
+}
+
+// Пачки по batchSize самых старых строк; без колонки строки ждут миграции
+static void testBatchesOldestFirstAndWaitsForMigration() {
+  CrashingFlash fs(root);
+  UploadOutbox outbox(fs, "/outbox");
+  outbox.scan();
+  FakeServer server(fs);
+  OutboxDrain drain(outbox, server, 8);
+  for (uint32_t i = 20; i-- > 0;) enqueueRow(outbox, i);
+
+  server.schemaMissing = true;
+  TEST_ASSERT_EQUAL(OutboxDrain::SCHEMA_ERROR, drain.step());
+  TEST_ASSERT_EQUAL(8, drain.rows());
+  TEST_ASSERT_EQUAL(400, drain.code());
+  TEST_ASSERT_NOT_NULL(strstr(drain.response(), "PGRST204"));
+  TEST_ASSERT_EQUAL(20, outbox.count());
+  TEST_ASSERT_EQUAL(0, drain.quarantined());
+
+  server.schemaMissing = false;
+  size_t expected[] = { 8, 8, 4 };
+  uint32_t next = 0;
+  for (size_t rows : expected) {
+    TEST_ASSERT_EQUAL(OutboxDrain::SENT, drain.step());
+    TEST_ASSERT_EQUAL(rows, drain.rows());
+    for (const std::string& key : server.lastBatch) TEST_ASSERT_EQUAL_STRING(keyOf(next++).c_str(), key.c_str());
+  }
+  TEST_ASSERT_EQUAL(OutboxDrain::EMPTY, drain.step());
+  TEST_ASSERT_EQUAL(0, outbox.count());
+  TEST_ASSERT_EQUAL(20, server.table.size());
+}
+
+// Нечитаемая запись не блокирует очередь: в dead, остальные уходят
+static void testUnreadableRowMovedAside() {
+  CrashingFlash fs(root);
+  UploadOutbox outbox(fs, "/outbox");
+  static char huge[UploadOutbox::MAX_ROW + 1];
+  memset(huge, 'x', sizeof(huge));
+  TEST_ASSERT_TRUE(fs.append("/outbox/1714557000-0.json", huge, sizeof(huge)));
+  outbox.scan();
+  enqueueRow(outbox, 0);
+  FakeServer server(fs);
+  OutboxDrain drain(outbox, server, 8);
+
+  TEST_ASSERT_EQUAL(OutboxDrain::SENT, drain.step());
+  TEST_ASSERT_EQUAL(1, drain.rows());
+  TEST_ASSERT_EQUAL(1, drain.quarantined());
+  TEST_ASSERT_TRUE(fs.exists("/outbox/dead/1714557000-0.json"));
+  TEST_ASSERT_EQUAL(0, outbox.count());
+}
+
+// Сотни строк сквозь все отказы сразу; новые строки ставятся в очередь
+// между попытками, как это делает задача обработки
+static void testNoLossNoDuplicatesUnderFaults() {
+  const uint32_t ROWS = 400;
+  seed = 3;
+  CrashingFlash fs(root);
+  FakeServer server(fs);
+  server.faults = true;
+  for (uint32_t i = 0; i < ROWS; i++) {
+    if (random24() % 100 < 3) server.poison.insert(keyOf(i));
+  }
+
+  std::unique_ptr<UploadOutbox> outbox(new UploadOutbox(fs, "/outbox"));
+  std::unique_ptr<OutboxDrain> drain(new OutboxDrain(*outbox, server, 8));
+  outbox->scan();
+  uint32_t enqueued = 0;
+  uint32_t reboots = 0;
+  uint32_t splits = 0;
+  uint32_t steps = 0;
+  while ((enqueued < ROWS || outbox->count() > 0) && steps < 100000) {
+    for (uint32_t n = random24() % 4; n > 0 && enqueued < ROWS; n--) enqueueRow(*outbox, enqueued++);
+    OutboxDrain::Result result = drain->step();
+    steps++;
+    if (result == OutboxDrain::SPLIT) splits++;
+    if (fs.isDown()) {
+      // Перезагрузка: очередь заново по каталогу
+      fs.up();
+      drain.reset();
+      outbox.reset(new UploadOutbox(fs, "/outbox"));
+      outbox->scan();
+      drain.reset(new OutboxDrain(*outbox, server, 8));
+      reboots++;
+    }
+  }
+
+  TEST_ASSERT_EQUAL(ROWS, enqueued);
+  TEST_ASSERT_EQUAL(0, outbox->count());
+  TEST_ASSERT_EQUAL(0, keysIn(fs, "/outbox").size());
+  TEST_ASSERT_EQUAL(0, server.unexpectedRedelivery);
+
+  std::set<std::string> dead = keysIn(fs, "/outbox/dead");
+  TEST_ASSERT_TRUE(dead == server.poison);
+  for (uint32_t i = 0; i < ROWS; i++) {
+    std::string key = keyOf(i);
+    bool stored = server.table.count(key) != 0;
+    TEST_ASSERT_TRUE_MESSAGE(stored != (server.poison.count(key) != 0), key.c_str());
+  }
+  // Отказы действительно случались
+  TEST_ASSERT_GREATER_THAN(0, server.timeouts);
+  TEST_ASSERT_GREATER_THAN(0, server.serverErrors);
+  TEST_ASSERT_GREATER_THAN(0, server.conflicts);
+  TEST_ASSERT_GREATER_THAN(0, reboots);
+  TEST_ASSERT_GREATER_THAN(0, splits);
+
+  char message[160];
+  snprintf(message, sizeof(message),
+           "%u rows in %u POSTs: %u timeouts, %u 5xx, %u 409, %u crashes, %u redelivered, %u dead",
+           (unsigned)ROWS, (unsigned)server.posts, (unsigned)server.timeouts,
+           (unsigned)server.serverErrors, (unsigned)server.conflicts, (unsigned)server.crashes,
+           (unsigned)server.redelivered, (unsigned)dead.size());
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testClassifiesResponses);
+  RUN_TEST(testBatchesOldestFirstAndWaitsForMigration);
+  RUN_TEST(testUnreadableRowMovedAside);
+  RUN_TEST(testNoLossNoDuplicatesUnderFaults);
+  return UNITY_END();
+}
@@ -0,0 +1,362 @@
+// Выгрузка сэмплов: журнал на 10 000 сэмплов -> SampleBatchWriter ->
+// writeChunkedBody -> приёмник вместо сокета. Рамки chunked разбираются
+// обратно, тело каждой пачки должно быть корректным JSON-массивом и
+// совпадать строка в строку с эталоном, собранным из сэмплов журнала
+// независимо от JsonWriter. Обрыв соединения в любом месте тела
+// (rewind() и повтор пачки) даёт те же байты, что и чистый прогон.
+//
+//   pio test -e native -f test_sample_upload
+
+#include <ctype.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <unity.h>
+#include <vector>
+
+#include "chunked_body.h"
+#include "flash_fs.h"
+#include "sample_batch_writer.h"
+#include "workout_journal.h"
+
+static const time_t START = 1714557600;
+static const uint32_t SAMPLES = 10000;
+static const size_t BATCH = 500;
+static const long OFFSET = 3 * 3600;
+static const char* const KEY = "1714557600-0";
+
+static char root[64];
+static char pending[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+// Повторяемый ГПСЧ (LCG)
+static uint32_t seed = 11;
+
+static uint32_t random24() {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/sample-upload-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Журнал с паузами, остановками и пропусками пульса; возвращает сэмплы,
+// как их прочитает JournalReader
+static std::vector<WorkoutRecord> writeJournal(FlashFs& fs) {
+  WorkoutJournal journal(fs);
+  TEST_ASSERT_TRUE(journal.beginSession(START));
+  time_t t = START;
+  uint32_t distance = 0;
+  for (uint32_t i = 0; i < SAMPLES; i++) {
+    t += i % 97 == 0 ? 5 : 1;
+    WorkoutRecord record = {};
+    record.timestamp = t;
+    record.speed = i % 500 < 20 ? 0.0f : (float)(40 + i % 120) / 10.0f;
+    distance += (uint32_t)(record.speed / 3.6f);
+    record.distance = distance;
+    record.time = (uint16_t)(t - START);
+    record.heartRate = i % 13 == 0 ? 0 : (uint8_t)(90 + i % 90);
+    record.isActive = record.speed > 0.8f;
+    journal.addSample(record);
+  }
+  TEST_ASSERT_TRUE(journal.endSession(t + 1, pending, sizeof(pending)));
+
+  std::vector<WorkoutRecord> records;
+  JournalReader reader(fs, pending);
+  WorkoutRecord record;
+  while (reader.next(record)) records.push_back(record);
+  TEST_ASSERT_EQUAL(SAMPLES, records.size());
+  return records;
+}
+
+// Эталонная строка сэмпла - printf, без JsonWriter
+static std::string expectedRow(const WorkoutRecord& record, uint32_t index) {
+  time_t local = record.timestamp + OFFSET;
+  struct tm parts;
+  gmtime_r(&local, &parts);
+  char when[32];
+  strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S+03:00", &parts);
+  char heart[8];
+  snprintf(heart, sizeof(heart), record.heartRate != 0 ? "%u" : "null", (unsigned)record.heartRate);
+  char row[256];
+  snprintf(row, sizeof(row),
+           "{\"workout_client_id\":\"%s\",\"sample_index\":%u,\"recorded_at\":\"%s\",\"speed\":%.2f,"
+           "\"distance\":%u,\"elapsed_time\":%u,\"is_active\":%s,\"heart_rate\":%s}",
+           KEY, (unsigned)index, when, record.speed, (unsigned)record.distance,
+           (unsigned)record.time, record.isActive ? "true" : "false", heart);
+  return row;
+}
+
+// Минимальный разбор JSON: только проверка, что документ корректен
+static bool skipValue(const std::string& text, size_t& at);
+
+static void skipSpace(const std::string& text, size_t& at) {
+  while (at < text.size() && strchr(" \t\r\n", text[at]) != nullptr) at++;
+}
+
+static bool skipString(const std::string& text, size_t& at) {
+  if (at >= text.size() || text[at] != '"') return false;
+  for (at++; at < text.size(); at++) {
+    if (text[at] == '\\') {
+      at++;
+    } else if (text[at] == '"') {
+      at++;
+      return true;
+    } else if ((unsigned char)text[at] < 0x20) {
+      return false;
+    }
+  }
+  return false;
+}
+
+static bool skipValue(const std::string& text, size_t& at) {
+  skipSpace(text, at);
+  if (at >= text.size()) return false;
+  char c = text[at];
+  if (c == '"') return skipString(text, at);
+  if (c == '{' || c == '[') {
+    char close = c == '{' ? '}' : ']';
+    at++;
+    skipSpace(text, at);
+    if (at < text.size() && text[at] == close) {
+      at++;
+      return true;
+    }
+    for (;;) {
+      if (c == '{') {
+        skipSpace(text, at);
+        if (!skipString(text, at)) return false;
+        skipSpace(text, at);
+        if (at >= text.size() || text[at++] != ':') return false;
+      }
+      if (!skipValue(text, at)) return false;
+      skipSpace(text, at);
+      if (at >= text.size()) return false;
+      if (text[at] == close) {
+        at++;
+        return true;
+      }
+      if (text[at++] != ',') return false;
+    }
+  }
+  for (const char* word : { "true", "false", "null" }) {
+    if (text.compare(at, strlen(word), word) == 0) {
+      at += strlen(word);
+      return true;
+    }
+  }
+  size_t begin = at;
+  if (text[at] == '-') at++;
+  while (at < text.size() && strchr("0123456789.eE+-", text[at]) != nullptr) at++;
+  return at > begin && isdigit((unsigned char)text[at - 1]);
+}
+
+static bool validJson(const std::string& text) {
+  size_t at = 0;
+  if (!skipValue(text, at)) return false;
+  skipSpace(text, at);
+  return at == text.size();
+}
+
+// Разбор Transfer-Encoding: chunked обратно в тело; рамки строгие:
+// размер hex без ведущих нулей, куски не пустые и не больше chunkSize
+struct Decoded {
+  bool ok;
+  std::string body;
+  size_t chunks;
+};
+
+static Decoded decodeChunked(const std::string& wire, size_t chunkSize) {
+  Decoded result = { false, "", 0 };
+  size_t at = 0;
+  for (;;) {
+    size_t line = wire.find("\r\n", at);
+    if (line == std::string::npos || line == at) return result;
+    std::string hex = wire.substr(at, line - at);
+    if (hex.size() > 1 && hex[0] == '0') return result;
+    if (hex.find_first_not_of("0123456789abcdef") != std::string::npos) return result;
+    size_t length = strtoul(hex.c_str(), nullptr, 16);
+    at = line + 2;
+    if (length == 0) {
+      result.ok = wire.compare(at, std::string::npos, "\r\n") == 0;
+      return result;
+    }
+    if (length > chunkSize || at + length + 2 > wire.size()) return result;
+    if (wire.compare(at + length, 2, "\r\n") != 0) return result;
+    result.body.append(wire, at, length);
+    result.chunks++;
+    at += length + 2;
+  }
+}
+
+// Приёмник вместо сокета; обрыв после failAt байт этой попытки
+struct Wire {
+  std::string bytes;
+  long failAt;
+};
+
+static bool sendAll(Wire& wire, const uint8_t* data, size_t length) {
+  if (wire.failAt >= 0 && wire.bytes.size() + length > (size_t)wire.failAt) {
+    wire.bytes.append((const char*)data, wire.failAt - wire.bytes.size());
+    return false;
+  }
+  wire.bytes.append((const char*)data, length);
+  return true;
+}
+
+// Все пачки журнала; failures - сколько попыток оборвать (в случайном
+// месте тела, включая завершающий кусок). Возвращает тела пачек
+static std::vector<std::string> uploadAll(FlashFs& fs, size_t chunkSize, uint32_t failures,
+                                          size_t* chunks, uint32_t* retries) {
+  std::vector<std::string> bodies;
+  std::vector<uint8_t> chunk(chunkSize + CHUNK_FRAMING);
+  JournalReader reader(fs, pending);
+  SampleBatchWriter writer(reader, KEY, OFFSET, BATCH);
+  while (writer.available()) {
+    writer.beginBatch();
+    TEST_ASSERT_EQUAL(bodies.size() * BATCH, writer.batchStart());
+    for (;;) {
+      Wire wire = { "", -1 };
+      // Пачка на проводе около 92 КБ: обрыв где угодно в ней
+      if (failures > 0 && random24() % 2 == 0) wire.failAt = (long)(random24() % 92000);
+      bool produced = false;
+      bool sent = writeChunkedBody([&](uint8_t* buffer, size_t size) { return writer.produce(buffer, size); },
+                                   [&](const uint8_t* data, size_t length) { return sendAll(wire, data, length); },
+                                   chunk.data(), chunkSize, &produced);
+      TEST_ASSERT_TRUE(produced);
+      if (sent) {
+        Decoded decoded = decodeChunked(wire.bytes, chunkSize);
+        TEST_ASSERT_TRUE_MESSAGE(decoded.ok, "chunk framing");
+        if (chunks != nullptr) *chunks += decoded.chunks;
+        bodies.push_back(decoded.body);
+        break;
+      }
+      // Соединение оборвано: пачка заново с начала, как в postStream
+      failures--;
+      if (retries != nullptr) (*retries)++;
+      TEST_ASSERT_TRUE(writer.rewind());
+    }
+  }
+  TEST_ASSERT_EQUAL(SAMPLES, writer.index());
+  return bodies;
+}
+
+static void assertBodies(const std::vector<std::string>& bodies, const std::vector<WorkoutRecord>& records) {
+  TEST_ASSERT_EQUAL((SAMPLES + BATCH - 1) / BATCH, bodies.size());
+  uint32_t index = 0;
+  for (const std::string& body : bodies) {
+    TEST_ASSERT_TRUE_MESSAGE(validJson(body), "batch body is not valid JSON");
+    std::string expected = "[";
+    for (size_t i = 0; i < BATCH && index < records.size(); i++, index++) {
+      std::string row = expectedRow(records[index], index);
+      TEST_ASSERT_LESS_OR_EQUAL(SampleBatchWriter::MAX_ROW_LENGTH, row.size());
+      if (i > 0) expected += ',';
+      expected += row;
+    }
+    expected += ']';
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), body.c_str());
+  }
+  TEST_ASSERT_EQUAL(SAMPLES, index);
+}
+
+static void testTenThousandSamplesRoundTrip() {
+  PosixFlash fs(root);
+  std::vector<WorkoutRecord> records = writeJournal(fs);
+
+  const size_t sizes[] = { 256, 1024, 4096 };
+  for (size_t chunkSize : sizes) {
+    size_t chunks = 0;
+    clock_t started = clock();
+    std::vector<std::string> bodies = uploadAll(fs, chunkSize, 0, &chunks, nullptr);
+    double ms = (clock() - started) * 1000.0 / CLOCKS_PER_SEC;
+    assertBodies(bodies, records);
+
+    size_t bytes = 0;
+    for (const std::string& body : bodies) bytes += body.size();
+    char message[128];
+    snprintf(message, sizeof(message), "chunk %u: %u samples, %u batches, %u chunks, %u KB in %.1f ms",
+             (unsigned)chunkSize, (unsigned)SAMPLES, (unsigned)bodies.size(), (unsigned)chunks,
+             (unsigned)(bytes / 1024), ms);
+    TEST_MESSAGE(message);
+  }
+}
+
+// Обрывы в случайных местах: повторы после rewind() - те же байты
+static void testRetryResendsIdenticalBatches() {
+  PosixFlash fs(root);
+  std::vector<WorkoutRecord> records = writeJournal(fs);
+  std::vector<std::string> clean = uploadAll(fs, 1024, 0, nullptr, nullptr);
+
+  seed = 11;
+  uint32_t retries = 0;
+  std::vector<std::string> retried = uploadAll(fs, 1024, 40, nullptr, &retries);
+  TEST_ASSERT_GREATER_THAN(10, retries);
+  TEST_ASSERT_EQUAL(clean.size(), retried.size());
+  for (size_t i = 0; i < clean.size(); i++) {
+    TEST_ASSERT_TRUE_MESSAGE(clean[i] == retried[i], "retried batch differs");
+  }
+  assertBodies(retried, records);
+
+  char message[64];
+  snprintf(message, sizeof(message), "%u dropped connections, all batches identical", (unsigned)retries);
+  TEST_MESSAGE(message);
+}
+
+// Обрыв ровно на завершающем 0\r\n\r\n: тело уже выдано целиком,
+// rewind() всё равно возвращает к началу пачки
+static void testRewindAfterWholeBody() {
+  PosixFlash fs(root);
+  std::vector<WorkoutRecord> records = writeJournal(fs);
+  std::vector<uint8_t> chunk(1024 + CHUNK_FRAMING);
+  JournalReader reader(fs, pending);
+  SampleBatchWriter writer(reader, KEY, OFFSET, BATCH);
+
+  TEST_ASSERT_TRUE(writer.available());
+  writer.beginBatch();
+  std::string first;
+  bool sent = writeChunkedBody([&](uint8_t* buffer, size_t size) { return writer.produce(buffer, size); },
+                               [&](const uint8_t* data, size_t length) {
+                                 if (length == 5 && memcmp(data, "0\r\n\r\n", 5) == 0) return false;
+                                 first.append((const char*)data, length);
+                                 return true;
+                               },
+                               chunk.data(), 1024);
+  TEST_ASSERT_FALSE(sent);
+  TEST_ASSERT_EQUAL(BATCH, writer.index());
+
+  TEST_ASSERT_TRUE(writer.rewind());
+  TEST_ASSERT_EQUAL(0, writer.index());
+  Wire wire = { "", -1 };
+  TEST_ASSERT_TRUE(writeChunkedBody([&](uint8_t* buffer, size_t size) { return writer.produce(buffer, size); },
+                                    [&](const uint8_t* data, size_t length) { return sendAll(wire, data, length); },
+                                    chunk.data(), 1024));
+  TEST_ASSERT_TRUE(wire.bytes.compare(0, first.size(), first) == 0);
+  Decoded decoded = decodeChunked(wire.bytes, 1024);
+  TEST_ASSERT_TRUE(decoded.ok);
+  TEST_ASSERT_TRUE(validJson(decoded.body));
+
+  // Следующая пачка начинается с сэмпла BATCH
+  TEST_ASSERT_TRUE(writer.available());
+  writer.beginBatch();
+  TEST_ASSERT_EQUAL(BATCH, writer.batchStart());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testTenThousandSamplesRoundTrip);
+  RUN_TEST(testRetryResendsIdenticalBatches);
+  RUN_TEST(testRewindAfterWholeBody);
+  return UNITY_END();
+}
@@ -0,0 +1,220 @@
+// Seqlock и BodyCache под нагрузкой: один писатель (задача обработки) и
+// несколько читателей (обработчики веб-сервера, /ws) в разных потоках.
+// Каждая копия, которую видит читатель, должна быть целой - все слова
+// одной версии - и версии у каждого читателя не должны идти назад.
+//
+//   pio test -e native -f test_seqlock
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#include "body_cache.h"
+#include "seqlock.h"
+
+static const int READERS = 3;
+// Писатель работает заданное время, а не заданное число записей: даже на
+// одном ядре планировщик успевает много раз прервать его посреди записи
+static const std::chrono::milliseconds RUN_TIME(400);
+
+// Крупнее нескольких слов и не кратен 4, как TelemetrySnapshot
+struct Snapshot {
+  uint32_t version;
+  uint32_t words[12];
+  uint16_t tail;
+  char label[10];
+};
+
+static Snapshot makeSnapshot(uint32_t version) {
+  Snapshot snapshot;
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.version = version;
+  for (uint32_t i = 0; i < 12; i++) snapshot.words[i] = version * 2654435761u + i;
+  snapshot.tail = (uint16_t)(version ^ 0xA5A5);
+  snprintf(snapshot.label, sizeof(snapshot.label), "v%u", (unsigned)(version % 100000000));
+  return snapshot;
+}
+
+static bool intact(const Snapshot& snapshot) {
+  Snapshot expected = makeSnapshot(snapshot.version);
+  return memcmp(&expected, &snapshot, sizeof(Snapshot)) == 0;
+}
+
+struct ReaderResult {
+  uint32_t reads = 0;
+  uint32_t torn = 0;
+  uint32_t backwards = 0;
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void testSeqlockNoTornReads() {
+  static Seqlock<Snapshot> lock;
+  lock.write(makeSnapshot(0));
+  std::atomic<bool> done(false);
+  std::atomic<int> started(0);
+  ReaderResult results[READERS];
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < READERS; r++) {
+    readers.emplace_back([&, r]() {
+      ReaderResult& result = results[r];
+      uint32_t last = 0;
+      started.fetch_add(1);
+      while (!done.load(std::memory_order_acquire)) {
+        Snapshot snapshot = lock.read();
+        result.reads++;
+        if (!intact(snapshot)) result.torn++;
+        if (snapshot.version < last) result.backwards++;
+        last = snapshot.version;
+      }
+    });
+  }
+
+  while (started.load() < READERS) std::this_thread::yield();
+  uint32_t writes = 0;
+  auto deadline = std::chrono::steady_clock::now() + RUN_TIME;
+  while (std::chrono::steady_clock::now() < deadline) {
+    lock.write(makeSnapshot(++writes));
+  }
+  done.store(true, std::memory_order_release);
+  for (std::thread& reader : readers) reader.join();
+
+  uint32_t reads = 0;
+  for (const ReaderResult& result : results) {
+    TEST_ASSERT_EQUAL(0, result.torn);
+    TEST_ASSERT_EQUAL(0, result.backwards);
+    TEST_ASSERT_GREATER_THAN(0, result.reads);
+    reads += result.reads;
+  }
+  TEST_ASSERT_EQUAL(writes, lock.version() - 1);
+  TEST_ASSERT_TRUE(intact(lock.read()));
+  TEST_ASSERT_EQUAL(writes, lock.read().version);
+
+  char message[96];
+  snprintf(message, sizeof(message), "seqlock: %u writes, %u reads by %d readers, 0 torn",
+           (unsigned)writes, (unsigned)reads, READERS);
+  TEST_MESSAGE(message);
+}
+
+typedef BodyCache<4, 512> Cache;
+
+// Тело версии v: длина зависит от версии, каждый байт - младший байт версии
+static size_t fillBody(char* data, uint32_t version) {
+  size_t length = 64 + (version * 37) % (Cache::CAPACITY - 64);
+  memset(data, (char)(version & 0xFF), length);
+  return length;
+}
+
+static bool intactBody(const Cache::Body* body) {
+  if (body->length < 64 || body->length > Cache::CAPACITY) return false;
+  if (body->length != 64 + (body->version * 37) % (Cache::CAPACITY - 64)) return false;
+  for (size_t i = 0; i < body->length; i++) {
+    if (body->data[i] != (char)(body->version & 0xFF)) return false;
+  }
+  return true;
+}
+
+static void testBodyCacheNoTornBodies() {
+  static Cache cache;
+  std::atomic<bool> done(false);
+  std::atomic<int> started(0);
+  ReaderResult results[READERS];
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < READERS; r++) {
+    readers.emplace_back([&, r]() {
+      ReaderResult& result = results[r];
+      uint32_t last = 0;
+      started.fetch_add(1);
+      while (!done.load(std::memory_order_acquire)) {
+        const Cache::Body* body = cache.acquire();
+        if (body == nullptr) {
+          std::this_thread::yield();
+          continue;
+        }
+        result.reads++;
+        // Тело держится, как при отправке в медленный сокет: писатель
+        // тем временем публикует новые
+        if (result.reads % 16 == 0) std::this_thread::yield();
+        if (!intactBody(body)) result.torn++;
+        if (body->version < last) result.backwards++;
+        last = body->version;
+        cache.release(body);
+      }
+    });
+  }
+
+  while (started.load() < READERS) std::this_thread::yield();
+  uint32_t updates = 0;
+  uint32_t committed = 0;
+  auto deadline = std::chrono::steady_clock::now() + RUN_TIME;
+  while (std::chrono::steady_clock::now() < deadline) {
+    uint32_t version = ++updates;
+    char* data = cache.begin();
+    if (data != nullptr) {
+      cache.commit(fillBody(data, version), version);
+      committed++;
+    }
+  }
+  done.store(true, std::memory_order_release);
+  for (std::thread& reader : readers) reader.join();
+
+  for (const ReaderResult& result : results) {
+    TEST_ASSERT_EQUAL(0, result.torn);
+    TEST_ASSERT_EQUAL(0, result.backwards);
+    TEST_ASSERT_GREATER_THAN(0, result.reads);
+  }
+  TEST_ASSERT_EQUAL(updates, committed + cache.stale());
+
+  char message[96];
+  snprintf(message, sizeof(message), "body cache: %u updates, %u committed, %u stale, 0 torn",
+           (unsigned)updates, (unsigned)committed, (unsigned)cache.stale());
+  TEST_MESSAGE(message);
+}
+
+// Все слоты заняты читателями: обновление пропускается, читатели
+// продолжают получать последнее опубликованное тело целым
+static void testBodyCacheSkipsWhenAllSlotsHeld() {
+  static Cache cache;
+  const Cache::Body* held[4] = {};
+  uint32_t version = 0;
+  for (int i = 0; i < 4; i++) {
+    char* data = cache.begin();
+    TEST_ASSERT_NOT_NULL(data);
+    version++;
+    cache.commit(fillBody(data, version), version);
+    held[i] = cache.acquire();
+    TEST_ASSERT_EQUAL(version, held[i]->version);
+  }
+
+  TEST_ASSERT_NULL(cache.begin());
+  TEST_ASSERT_EQUAL(1, cache.stale());
+  const Cache::Body* body = cache.acquire();
+  TEST_ASSERT_EQUAL(version, body->version);
+  TEST_ASSERT_TRUE(intactBody(body));
+  cache.release(body);
+
+  // Отпущенный старый слот снова пишется
+  cache.release(held[0]);
+  char* data = cache.begin();
+  TEST_ASSERT_EQUAL_PTR(held[0]->data, data);
+  cache.commit(fillBody(data, version + 1), version + 1);
+  for (int i = 1; i < 4; i++) {
+    TEST_ASSERT_TRUE(intactBody(held[i]));
+    cache.release(held[i]);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testSeqlockNoTornReads);
+  RUN_TEST(testBodyCacheNoTornBodies);
+  RUN_TEST(testBodyCacheSkipsWhenAllSlotsHeld);
+  return UNITY_END();
+}
@@ -0,0 +1,196 @@
+// SessionStore на длинных сессиях: стоимость вставки и ошибка
+// восстановления кривой скорости после прореживания.
+//
+// Сессия 1 Гц с интервалами (разминка, отрезки 14 км/ч, отдых 6 км/ч)
+// и шумом. Скорость между хранимыми точками восстанавливается линейно и
+// сравнивается с каждой исходной записью. Пики должны сохраниться точно,
+// итоговая дистанция - совпасть.
+//
+//   pio test -e native -f test_session_store
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+#include "session_store.h"
+
+static const time_t START = 1714557600;
+// Ёмкость буфера прошивки с PSRAM (SESSION_CAPACITY_PSRAM в main.cpp)
+static const size_t CAPACITY = 4096;
+
+static std::vector<WorkoutRecord> makeSession(uint32_t seconds) {
+  std::vector<WorkoutRecord> records;
+  records.reserve(seconds);
+  uint32_t seed = 12345;
+  float distance = 0;
+  for (uint32_t t = 0; t < seconds; t++) {
+    seed = seed * 1664525u + 1013904223u;
+    float noise = ((int)((seed >> 16) % 21) - 10) / 100.0f;
+    float speed;
+    if (t < 600) {
+      speed = 5.0f + 4.0f * t / 600;
+    } else {
+      speed = ((t - 600) % 360) < 120 ? 14.0f : 6.0f;
+    }
+    speed += noise;
+    distance += speed / 3.6f;
+
+    WorkoutRecord record = {};
+    record.timestamp = START + t;
+    record.speed = roundf(speed * 100.0f) / 100.0f;
+    record.distance = (uint32_t)distance;
+    record.time = (uint16_t)t;
+    record.incline = 10;
+    record.isActive = true;
+    records.push_back(record);
+  }
+  return records;
+}
+
+struct Error {
+  double mean;
+  double max;
+};
+
+// Линейная интерполяция скорости по хранимым точкам в момент каждой записи
+static Error reconstructionError(const SessionStore& store, const std::vector<WorkoutRecord>& records) {
+  std::vector<WorkoutRecord> points;
+  for (const WorkoutRecord& point : store) points.push_back(point);
+  Error error = { 0, 0 };
+  size_t j = 0;
+  for (const WorkoutRecord& record : records) {
+    while (j + 1 < points.size() && points[j + 1].timestamp <= record.timestamp) j++;
+    double estimate = points[j].speed;
+    if (j + 1 < points.size() && points[j + 1].timestamp > points[j].timestamp) {
+      double f = (double)(record.timestamp - points[j].timestamp) /
+                 (double)(points[j + 1].timestamp - points[j].timestamp);
+      estimate += f * (points[j + 1].speed - points[j].speed);
+    }
+    double delta = fabs(estimate - record.speed);
+    error.mean += delta;
+    if (delta > error.max) error.max = delta;
+  }
+  error.mean /= records.size();
+  return error;
+}
+
+static void runSession(uint32_t seconds) {
+  std::vector<WorkoutRecord> records = makeSession(seconds);
+  SessionStore store;
+  TEST_ASSERT_TRUE(store.begin(CAPACITY));
+
+  double slowestNs = 0;
+  auto started = std::chrono::steady_clock::now();
+  for (const WorkoutRecord& record : records) {
+    auto before = std::chrono::steady_clock::now();
+    store.add(record);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - before).count();
+    if (ns > slowestNs) slowestNs = ns;
+  }
+  double totalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+
+  TEST_ASSERT_EQUAL(seconds, store.sampleCount());
+  TEST_ASSERT_LESS_OR_EQUAL(CAPACITY, store.size());
+  TEST_ASSERT_EQUAL(records.back().distance, store.last().distance);
+
+  // Пик скорости переживает прореживание
+  float peak = 0, storedPeak = 0;
+  for (const WorkoutRecord& record : records) peak = fmaxf(peak, record.speed);
+  for (const WorkoutRecord& point : store) storedPeak = fmaxf(storedPeak, point.speed);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, peak, storedPeak);
+
+  // Прореживание min/max сглаживает только фронты отрезков
+  Error error = reconstructionError(store, records);
+  TEST_ASSERT_TRUE(error.mean < 0.5);
+  char message[200];
+  snprintf(message, sizeof(message),
+           "%.1f h: %u points (level %u) in %u bytes, add %.0f ns avg / %.0f ns max, "
+           "speed error %.3f km/h mean / %.2f km/h max",
+           seconds / 3600.0, (unsigned)store.size(), (unsigned)store.level(),
+           (unsigned)store.memoryUsage(), totalNs / seconds, slowestNs, error.mean, error.max);
+  TEST_MESSAGE(message);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Час помещается без прореживания: восстановление точное
+static void testOneHourIsLossless() {
+  std::vector<WorkoutRecord> records = makeSession(3600);
+  SessionStore store;
+  TEST_ASSERT_TRUE(store.begin(CAPACITY));
+  for (const WorkoutRecord& record : records) store.add(record);
+  TEST_ASSERT_EQUAL(0, store.level());
+  TEST_ASSERT_EQUAL(records.size(), store.size());
+
+  size_t i = 0;
+  for (const WorkoutRecord& point : store) {
+    TEST_ASSERT_EQUAL(records[i].timestamp, point.timestamp);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, records[i].speed, point.speed);
+    TEST_ASSERT_EQUAL(records[i].distance, point.distance);
+    i++;
+  }
+}
+
+// Точки по обе стороны от 65535 с (предел uint16 от начала сессии)
+// и на пределе тренировки в сутки сохраняют своё время
+static void testTimestampsPastUint16() {
+  const uint32_t moments[] = { 0, 65534, 65535, 65536, 70000, 86400 };
+  SessionStore store;
+  TEST_ASSERT_TRUE(store.begin(CAPACITY));
+  for (uint32_t t : moments) {
+    WorkoutRecord record = {};
+    record.timestamp = START + t;
+    record.speed = 8.0f;
+    record.distance = t / 2;
+    record.isActive = true;
+    store.add(record);
+  }
+
+  size_t i = 0;
+  for (const WorkoutRecord& point : store) {
+    TEST_ASSERT_EQUAL(START + moments[i], point.timestamp);
+    TEST_ASSERT_EQUAL(moments[i] / 2, point.distance);
+    i++;
+  }
+  TEST_ASSERT_EQUAL(6, i);
+}
+
+// Сутки по 1 Гц: после прореживания каждая точка - исходная запись
+// со своим временем, последние точки лежат за 18,2 ч
+static void testFullDayAfterDecimation() {
+  const uint32_t seconds = 86400;
+  std::vector<WorkoutRecord> records = makeSession(seconds);
+  SessionStore store;
+  TEST_ASSERT_TRUE(store.begin(CAPACITY));
+  for (const WorkoutRecord& record : records) store.add(record);
+  TEST_ASSERT_TRUE(store.level() > 0);
+
+  time_t previous = 0;
+  for (const WorkoutRecord& point : store) {
+    TEST_ASSERT_TRUE(point.timestamp >= START && point.timestamp < START + (time_t)seconds);
+    TEST_ASSERT_TRUE(point.timestamp > previous);
+    const WorkoutRecord& source = records[point.timestamp - START];
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, source.speed, point.speed);
+    TEST_ASSERT_EQUAL(source.distance, point.distance);
+    previous = point.timestamp;
+  }
+  TEST_ASSERT_TRUE(previous > START + 65535);
+}
+
+static void benchmarkTwoHours() { runSession(2 * 3600); }
+static void benchmarkThreeHours() { runSession(3 * 3600); }
+static void benchmarkSixHours() { runSession(6 * 3600); }
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testOneHourIsLossless);
+  RUN_TEST(testTimestampsPastUint16);
+  RUN_TEST(testFullDayAfterDecimation);
+  RUN_TEST(benchmarkTwoHours);
+  RUN_TEST(benchmarkThreeHours);
+  RUN_TEST(benchmarkSixHours);
+  return UNITY_END();
+}
@@ -0,0 +1,163 @@
+// SpscRing под нагрузкой: писатель и читатель в разных потоках, как BLE
+// callback и задача обработки. Проверяется, что читатель получает ровно
+// принятые push() элементы в том же порядке, без разорванных копий,
+// что принятые + dropped() = отправленные и что highWater() не выходит
+// за ёмкость.
+//
+//   pio test -e native -f test_spsc_ring
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#include "frame_queue.h"
+#include "spsc_ring.h"
+
+// Элемент крупнее слова, чтобы разорванная копия была заметна
+struct Item {
+  uint32_t seq;
+  uint32_t payload[7];
+};
+
+static Item makeItem(uint32_t seq) {
+  Item item;
+  item.seq = seq;
+  for (uint32_t i = 0; i < 7; i++) item.payload[i] = seq * 2654435761u + i;
+  return item;
+}
+
+static bool intact(const Item& item) {
+  for (uint32_t i = 0; i < 7; i++) {
+    if (item.payload[i] != item.seq * 2654435761u + i) return false;
+  }
+  return true;
+}
+
+static const size_t RING = 64;
+
+struct Result {
+  std::vector<uint32_t> accepted;
+  std::vector<uint32_t> received;
+  uint32_t torn;
+};
+
+// waitForRoom - писатель ждёт места, кольцо всё время почти полное и
+// индексы многократно переходят через границу; иначе писатель не ждёт,
+// а читатель уступает процессор после каждого элемента, и кольцо переполняется
+static void runPair(SpscRing<Item, RING>& ring, uint32_t total, bool waitForRoom, Result& result) {
+  std::atomic<bool> started(false);
+  std::atomic<bool> done(false);
+  result.torn = 0;
+  result.accepted.reserve(total);
+  result.received.reserve(total);
+
+  std::thread reader([&]() {
+    Item item;
+    started.store(true, std::memory_order_release);
+    for (;;) {
+      bool finished = done.load(std::memory_order_acquire);
+      if (ring.pop(item)) {
+        if (!intact(item)) result.torn++;
+        result.received.push_back(item.seq);
+        if (!waitForRoom) std::this_thread::yield();
+      } else if (finished) {
+        break;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // Писатель стартует, когда читатель уже крутится
+  while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+  for (uint32_t seq = 0; seq < total; seq++) {
+    if (waitForRoom) {
+      while (ring.size() >= RING) std::this_thread::yield();
+    }
+    if (ring.push(makeItem(seq))) result.accepted.push_back(seq);
+  }
+  done.store(true, std::memory_order_release);
+  reader.join();
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void testOrderUnderContention() {
+  static SpscRing<Item, RING> ring;
+  const uint32_t total = 500000;
+  Result result;
+  runPair(ring, total, true, result);
+
+  TEST_ASSERT_EQUAL(0, result.torn);
+  TEST_ASSERT_EQUAL(0, ring.dropped());
+  TEST_ASSERT_EQUAL(total, result.received.size());
+  TEST_ASSERT_TRUE(result.accepted == result.received);
+  TEST_ASSERT_LESS_OR_EQUAL(RING, ring.highWater());
+  TEST_ASSERT_GREATER_THAN(0, ring.highWater());
+  TEST_ASSERT_EQUAL(0, ring.size());
+
+  char message[96];
+  snprintf(message, sizeof(message), "contended: %u items, high water %u of %u",
+           (unsigned)total, (unsigned)ring.highWater(), (unsigned)RING);
+  TEST_MESSAGE(message);
+}
+
+static void testOverflowIsCountedNotCorrupted() {
+  static SpscRing<Item, RING> ring;
+  const uint32_t total = 200000;
+  Result result;
+  runPair(ring, total, false, result);
+
+  TEST_ASSERT_EQUAL(0, result.torn);
+  TEST_ASSERT_TRUE(result.accepted == result.received);
+  TEST_ASSERT_EQUAL(total, result.received.size() + ring.dropped());
+  TEST_ASSERT_GREATER_THAN(0, ring.dropped());
+  TEST_ASSERT_EQUAL(RING, ring.highWater());
+
+  char message[96];
+  snprintf(message, sizeof(message), "slow reader: %u dropped of %u",
+           (unsigned)ring.dropped(), (unsigned)total);
+  TEST_MESSAGE(message);
+}
+
+// Однопоточная проверка границ: ровно N элементов, затем отказ
+static void testCapacityBoundary() {
+  SpscRing<Item, 4> ring;
+  for (uint32_t seq = 0; seq < 4; seq++) TEST_ASSERT_TRUE(ring.push(makeItem(seq)));
+  TEST_ASSERT_FALSE(ring.push(makeItem(4)));
+  TEST_ASSERT_EQUAL(1, ring.dropped());
+  TEST_ASSERT_EQUAL(4, ring.highWater());
+
+  Item item;
+  for (uint32_t seq = 0; seq < 4; seq++) {
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL(seq, item.seq);
+  }
+  TEST_ASSERT_FALSE(ring.pop(item));
+}
+
+static void testFrameQueueCountsOversized() {
+  FrameQueue<8> queue;
+  uint8_t frame[FTMS_MAX_FRAME + 1] = { 0x00, 0x04 };
+  TEST_ASSERT_TRUE(queue.push(frame, FTMS_MAX_FRAME, 1));
+  TEST_ASSERT_FALSE(queue.push(frame, FTMS_MAX_FRAME + 1, 2));
+  TEST_ASSERT_EQUAL(1, queue.dropped());
+
+  RawFrame raw;
+  TEST_ASSERT_TRUE(queue.pop(raw));
+  TEST_ASSERT_EQUAL(FTMS_MAX_FRAME, raw.length);
+  TEST_ASSERT_EQUAL(1, raw.timestampUs);
+  TEST_ASSERT_FALSE(queue.pop(raw));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testOrderUnderContention);
+  RUN_TEST(testOverflowIsCountedNotCorrupted);
+  RUN_TEST(testCapacityBoundary);
+  RUN_TEST(testFrameQueueCountsOversized);
+  return UNITY_END();
+}
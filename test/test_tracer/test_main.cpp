@@ -0,0 +1,325 @@
+// Tracer и TraceStream: дамп /trace - корректный JSON формата Chrome
+// trace_event (проверяется разбором, в том числе когда поток отдаётся
+// мелкими кусками и когда кольцо пишется во время дампа), в кольце
+// остаются последние RING_SIZE событий. Замер в конце печатает цену
+// record() и TRACE_SCOPE рядом с разбором кадра FTMS, который ею обёрнут
+// в WorkoutTracker.
+//
+//   pio test -e native -f test_tracer
+
+#include <atomic>
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+#include "ftms_parser.h"
+#include "tracer.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Минимальный разбор JSON: только проверка, что документ корректен
+static bool skipValue(const std::string& text, size_t& at);
+
+static void skipSpace(const std::string& text, size_t& at) {
+  while (at < text.size() && strchr(" \t\r\n", text[at]) != nullptr) at++;
+}
+
+static bool skipString(const std::string& text, size_t& at) {
+  if (at >= text.size() || text[at] != '"') return false;
+  for (at++; at < text.size(); at++) {
+    if (text[at] == '\\') {
+      at++;
+    } else if (text[at] == '"') {
+      at++;
+      return true;
+    } else if ((unsigned char)text[at] < 0x20) {
+      return false;
+    }
+  }
+  return false;
+}
+
+static bool skipValue(const std::string& text, size_t& at) {
+  skipSpace(text, at);
+  if (at >= text.size()) return false;
+  char c = text[at];
+  if (c == '"') return skipString(text, at);
+  if (c == '{' || c == '[') {
+    char close = c == '{' ? '}' : ']';
+    at++;
+    skipSpace(text, at);
+    if (at < text.size() && text[at] == close) {
+      at++;
+      return true;
+    }
+    for (;;) {
+      if (c == '{') {
+        skipSpace(text, at);
+        if (!skipString(text, at)) return false;
+        skipSpace(text, at);
+        if (at >= text.size() || text[at++] != ':') return false;
+      }
+      if (!skipValue(text, at)) return false;
+      skipSpace(text, at);
+      if (at >= text.size()) return false;
+      if (text[at] == close) {
+        at++;
+        return true;
+      }
+      if (text[at++] != ',') return false;
+    }
+  }
+  for (const char* word : { "true", "false", "null" }) {
+    if (text.compare(at, strlen(word), word) == 0) {
+      at += strlen(word);
+      return true;
+    }
+  }
+  size_t begin = at;
+  if (text[at] == '-') at++;
+  while (at < text.size() && strchr("0123456789.eE+-", text[at]) != nullptr) at++;
+  return at > begin && isdigit((unsigned char)text[at - 1]);
+}
+
+static bool validJson(const std::string& text) {
+  size_t at = 0;
+  if (!skipValue(text, at)) return false;
+  skipSpace(text, at);
+  return at == text.size();
+}
+
+static std::string dump(const Tracer& source, size_t chunk) {
+  TraceStream stream(source);
+  std::string text;
+  std::vector<uint8_t> buffer(chunk);
+  size_t n;
+  while ((n = stream.fill(buffer.data(), chunk)) > 0) text.append((const char*)buffer.data(), n);
+  return text;
+}
+
+struct Parsed {
+  std::string name;
+  char phase;
+  unsigned long long ts;
+  unsigned tid;
+  unsigned core;
+};
+
+// События и имена задач из дампа; false - объект не того вида
+static bool parseEvents(const std::string& text, std::vector<Parsed>& events,
+                        std::vector<std::string>& threads) {
+  const std::string head = "{\"traceEvents\":[";
+  const std::string tail = "],\"displayTimeUnit\":\"ms\"}\n";
+  if (text.compare(0, head.size(), head) != 0) return false;
+  if (text.size() < head.size() + tail.size() ||
+      text.compare(text.size() - tail.size(), tail.size(), tail) != 0) {
+    return false;
+  }
+  for (size_t at = text.find("{\"name\":"); at != std::string::npos; at = text.find("{\"name\":", at + 1)) {
+    const char* object = text.c_str() + at;
+    char name[32];
+    Parsed event;
+    int used = 0;
+    if (sscanf(object, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%31[^\"]\"}}%n",
+               &event.tid, name, &used) == 2 && used > 0) {
+      if (event.tid != threads.size() + 1) return false;
+      threads.push_back(name);
+      at += used - 1;
+      continue;
+    }
+    if (sscanf(object, "{\"name\":\"%31[^\"]\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u}}%n",
+               name, &event.phase, &event.ts, &event.tid, &event.core, &used) != 5 || used == 0) {
+      return false;
+    }
+    if (!threads.empty()) return false;   // имена задач - после событий
+    event.name = name;
+    events.push_back(event);
+    at += used - 1;
+  }
+  return true;
+}
+
+static void testEmptyDump() {
+  static Tracer empty;
+  std::string text = dump(empty, 4096);
+  TEST_ASSERT_EQUAL_STRING("{\"traceEvents\":[],\"displayTimeUnit\":\"ms\"}\n", text.c_str());
+  TEST_ASSERT_TRUE(validJson(text));
+}
+
+// Вложенные участки и мгновенные события: пары B/E сходятся, время не
+// идёт назад, у каждого tid есть имя. Дамп по 7 байт совпадает с дампом
+// одним куском
+static void testDumpIsValidTraceJson() {
+  static Tracer source;
+  const char* names[] = {"ble_notify", "ftms_parse", "state_update", "buffer_append"};
+  for (int i = 0; i < 20; i++) {
+    source.record(names[0], 'B');
+    source.record(names[1], 'B');
+    source.record(names[1], 'E');
+    source.record(names[2], 'B');
+    if (i % 3 == 0) source.record("workout_start", 'i');
+    source.record(names[3], 'B');
+    source.record(names[3], 'E');
+    source.record(names[2], 'E');
+    source.record(names[0], 'E');
+  }
+
+  std::string whole = dump(source, 4096);
+  std::string pieces = dump(source, 7);
+  TEST_ASSERT_EQUAL(whole.size(), pieces.size());
+  TEST_ASSERT_TRUE(whole == pieces);
+  TEST_ASSERT_TRUE_MESSAGE(validJson(whole), "trace dump is not valid JSON");
+
+  std::vector<Parsed> events;
+  std::vector<std::string> threads;
+  TEST_ASSERT_TRUE(parseEvents(whole, events, threads));
+  TEST_ASSERT_EQUAL(Tracer::RING_SIZE < 167 ? Tracer::RING_SIZE : 167, events.size());
+  TEST_ASSERT_EQUAL(1, threads.size());
+  TEST_ASSERT_EQUAL_STRING("host", threads[0].c_str());
+
+  // Стек открытых участков; кольцо могло срезать начало первой пары
+  std::vector<std::string> open;
+  size_t orphanEnds = 0;
+  for (size_t i = 0; i < events.size(); i++) {
+    const Parsed& event = events[i];
+    TEST_ASSERT_EQUAL(1, event.tid);
+    TEST_ASSERT_EQUAL(0, event.core);
+    if (i > 0) TEST_ASSERT_TRUE(event.ts >= events[i - 1].ts);
+    if (event.phase == 'B') {
+      open.push_back(event.name);
+    } else if (event.phase == 'E') {
+      if (open.empty()) {
+        orphanEnds++;
+      } else {
+        TEST_ASSERT_EQUAL_STRING(open.back().c_str(), event.name.c_str());
+        open.pop_back();
+      }
+    } else {
+      TEST_ASSERT_EQUAL('i', event.phase);
+    }
+  }
+  TEST_ASSERT_TRUE(open.empty());
+  TEST_ASSERT_LESS_OR_EQUAL(3, orphanEnds);
+  TEST_ASSERT_EQUAL_STRING("ble_notify", events.back().name.c_str());
+  TEST_ASSERT_EQUAL('E', events.back().phase);
+}
+
+// Переполненное кольцо отдаёт последние RING_SIZE событий по порядку
+static void testRingKeepsNewest() {
+  static Tracer source;
+  static const char* const names[] = {"e0", "e1", "e2", "e3", "e4", "e5", "e6"};
+  const uint32_t total = 3 * Tracer::RING_SIZE + 5;
+  for (uint32_t i = 0; i < total; i++) source.record(names[i % 7], 'i');
+  TEST_ASSERT_EQUAL(total, source.head(0));
+
+  std::string text = dump(source, 300);
+  TEST_ASSERT_TRUE(validJson(text));
+  std::vector<Parsed> events;
+  std::vector<std::string> threads;
+  TEST_ASSERT_TRUE(parseEvents(text, events, threads));
+  TEST_ASSERT_EQUAL(Tracer::RING_SIZE, events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    uint32_t index = total - Tracer::RING_SIZE + (uint32_t)i;
+    TEST_ASSERT_EQUAL_STRING(names[index % 7], events[i].name.c_str());
+  }
+}
+
+// Запись идёт из другого потока, пока поток /trace отдаётся кусками:
+// перезаписанные события пропускаются, документ остаётся целым
+static void testDumpWhileRecording() {
+  static Tracer source;
+  std::atomic<bool> done(false);
+  std::thread writer([&] {
+    while (!done.load(std::memory_order_relaxed)) {
+      source.record("https_request", 'B');
+      source.record("tls_connect", 'B');
+      source.record("tls_connect", 'E');
+      source.record("https_request", 'E');
+    }
+  });
+
+  uint32_t dumps = 0;
+  size_t maxEvents = 0;
+  auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  while (std::chrono::steady_clock::now() < until) {
+    std::string text = dump(source, 61 + dumps % 200);
+    TEST_ASSERT_TRUE_MESSAGE(validJson(text), "trace dump torn by a concurrent writer");
+    std::vector<Parsed> events;
+    std::vector<std::string> threads;
+    TEST_ASSERT_TRUE(parseEvents(text, events, threads));
+    TEST_ASSERT_LESS_OR_EQUAL(Tracer::RING_SIZE, events.size());
+    for (size_t i = 0; i < events.size(); i++) {
+      TEST_ASSERT_TRUE(events[i].name == "https_request" || events[i].name == "tls_connect");
+      TEST_ASSERT_TRUE(events[i].phase == 'B' || events[i].phase == 'E');
+    }
+    if (events.size() > maxEvents) maxEvents = events.size();
+    dumps++;
+  }
+  done = true;
+  writer.join();
+  TEST_ASSERT_GREATER_THAN(0, maxEvents);
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u dumps during %u events recorded", (unsigned)dumps,
+           (unsigned)source.head(0));
+  TEST_MESSAGE(message);
+}
+
+// Цена трассировки: record(), пара TRACE_SCOPE и разбор кадра FTMS с
+// обёрткой и без неё (как ftms_parse в WorkoutTracker)
+static void benchmarkRecord() {
+  const uint32_t rounds = 1000000;
+  const char* names[] = {"a", "b"};
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < rounds; i++) tracer.record(names[i & 1], 'i');
+  double recordNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / rounds;
+
+  started = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < rounds; i++) {
+    TRACE_SCOPE("bench_scope");
+  }
+  double scopeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / rounds;
+
+  // Кадр со скоростью, дистанцией, энергией, пульсом и временем
+  const uint8_t frame[] = {0x84, 0x05, 0xE8, 0x03, 0x10, 0x27, 0x00, 0x2C, 0x01,
+                           0x0A, 0x00, 0x02, 0x8C, 0x00, 0x10, 0x0E};
+  uint32_t checksum = 0;
+  started = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < rounds; i++) {
+    TreadmillData out;
+    if (parseTreadmillData(frame, sizeof(frame), out)) checksum += out.present + i;
+  }
+  double plainNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / rounds;
+
+  started = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < rounds; i++) {
+    TRACE_SCOPE("ftms_parse");
+    TreadmillData out;
+    if (parseTreadmillData(frame, sizeof(frame), out)) checksum += out.present + i;
+  }
+  double tracedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() / rounds;
+  TEST_ASSERT_GREATER_THAN(0, checksum);
+
+  char message[128];
+  snprintf(message, sizeof(message), "record: %.1f ns/event, TRACE_SCOPE: %.1f ns/pair", recordNs, scopeNs);
+  TEST_MESSAGE(message);
+  snprintf(message, sizeof(message), "parseTreadmillData: %.1f ns/frame, traced %.1f ns/frame (checksum %08X)",
+           plainNs, tracedNs, checksum);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testEmptyDump);
+  RUN_TEST(testDumpIsValidTraceJson);
+  RUN_TEST(testRingKeepsNewest);
+  RUN_TEST(testDumpWhileRecording);
+  RUN_TEST(benchmarkRecord);
+  return UNITY_END();
+}
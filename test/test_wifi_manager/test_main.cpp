@@ -0,0 +1,194 @@
+// WifiManager на FakeWifiDriver: таймаут попытки, рост пауз до потолка,
+// быстрый повтор после обрыва рабочей связи и переполнение millis()
+// посреди попытки и паузы. Часы - переменная теста, poll() каждые 10 мс.
+//
+//   pio test -e native -f test_wifi_manager
+
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+#include "wifi_manager.h"
+
+static const uint32_t BASE_MS = 2000;
+static const uint32_t CAP_MS = 60000;
+static const uint32_t CONNECT_MS = 1500;
+static const uint32_t STEP_MS = 10;
+
+static uint32_t now;
+static std::vector<bool> changes;
+
+static void onLink(bool up) {
+  changes.push_back(up);
+}
+
+void setUp() {
+  now = 0;
+  changes.clear();
+}
+
+void tearDown() {}
+
+// Шаги часов по STEP_MS; false - условие не наступило за limitMs
+template <typename Done>
+static bool runUntil(FakeWifiDriver& driver, WifiManager& wifi, uint32_t limitMs, Done done) {
+  for (uint32_t spent = 0; spent <= limitMs; spent += STEP_MS) {
+    driver.step();
+    wifi.poll(now);
+    if (done()) return true;
+    now += STEP_MS;
+  }
+  return false;
+}
+
+static void testConnectsWithoutWaiting() {
+  FakeWifiDriver driver(now, CONNECT_MS, 0);
+  WifiManager wifi(driver, BASE_MS, CAP_MS);
+  driver.attach(wifi);
+  wifi.onLinkChange(onLink);
+
+  wifi.start(now);
+  TEST_ASSERT_EQUAL(LINK_CONNECTING, wifi.state());
+  TEST_ASSERT_EQUAL(1, driver.connects());
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, 5000, [&] { return wifi.isUp(); }));
+  TEST_ASSERT_EQUAL(CONNECT_MS, now);
+  TEST_ASSERT_EQUAL(1, wifi.attempts());
+  TEST_ASSERT_EQUAL(1, driver.timeSyncs());
+  TEST_ASSERT_EQUAL(1, changes.size());
+  TEST_ASSERT_TRUE(changes[0]);
+}
+
+// Точки нет: попытка обрывается ровно по CONNECT_TIMEOUT_MS, дальше пауза
+static void testAttemptTimesOut() {
+  FakeWifiDriver driver(now, CONNECT_MS, 0);
+  WifiManager wifi(driver, BASE_MS, CAP_MS);
+  driver.attach(wifi);
+  driver.setReachable(false);
+
+  wifi.start(now);
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, 60000, [&] { return wifi.state() != LINK_CONNECTING; }));
+  TEST_ASSERT_EQUAL(WifiManager::CONNECT_TIMEOUT_MS, now);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, wifi.state());
+  TEST_ASSERT_EQUAL(1, driver.disconnects());
+
+  uint32_t pausedAt = now;
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, CAP_MS, [&] { return driver.connects() == 2; }));
+  TEST_ASSERT_GREATER_OR_EQUAL(BASE_MS / 2, now - pausedAt);
+  TEST_ASSERT_LESS_OR_EQUAL(BASE_MS + STEP_MS, now - pausedAt);
+  TEST_ASSERT_EQUAL(0, driver.timeSyncs());
+}
+
+// Паузы удваиваются до потолка и дальше его не превышают
+static void testBackoffGrowsToCap() {
+  FakeWifiDriver driver(now, CONNECT_MS, 0);
+  WifiManager wifi(driver, BASE_MS, CAP_MS);
+  driver.attach(wifi);
+  driver.setRejecting(true);
+
+  wifi.start(now);
+  std::vector<uint32_t> pauses;
+  uint32_t pausedAt = 0;
+  WifiLinkState last = wifi.state();
+  for (uint32_t i = 0; i < 3600000 / STEP_MS; i++) {
+    driver.step();
+    wifi.poll(now);
+    WifiLinkState state = wifi.state();
+    if (state == LINK_BACKOFF && last != LINK_BACKOFF) pausedAt = now;
+    if (state == LINK_CONNECTING && last == LINK_BACKOFF) pauses.push_back(now - pausedAt);
+    last = state;
+    now += STEP_MS;
+  }
+
+  // Отказ приходит сразу, таймаут попытки не ждётся
+  TEST_ASSERT_EQUAL(0, driver.timeSyncs());
+  TEST_ASSERT_GREATER_THAN(20, pauses.size());
+  uint32_t window = BASE_MS;
+  for (size_t i = 0; i < pauses.size(); i++) {
+    TEST_ASSERT_GREATER_OR_EQUAL(window / 2, pauses[i]);
+    TEST_ASSERT_LESS_OR_EQUAL(window + STEP_MS, pauses[i]);
+    window = window * 2 > CAP_MS ? CAP_MS : window * 2;
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL(CAP_MS / 2, pauses.back());
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u rejected attempts in 1 h, last pause %u ms",
+           (unsigned)wifi.attempts(), (unsigned)pauses.back());
+  TEST_MESSAGE(message);
+}
+
+// Обрыв рабочей связи: пауза снова с базовой, а не с накопленной
+static void testDropRetriesQuickly() {
+  FakeWifiDriver driver(now, CONNECT_MS, 0);
+  WifiManager wifi(driver, BASE_MS, CAP_MS);
+  driver.attach(wifi);
+  wifi.onLinkChange(onLink);
+
+  // Сначала копим неудачи до потолка
+  driver.setRejecting(true);
+  wifi.start(now);
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, 3600000, [&] { return wifi.attempts() >= 8; }));
+  driver.setRejecting(false);
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, 2 * CAP_MS, [&] { return wifi.isUp(); }));
+
+  driver.drop();
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, 100, [&] { return !wifi.isUp(); }));
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, wifi.state());
+  TEST_ASSERT_EQUAL(1, wifi.drops());
+  uint32_t droppedAt = now;
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, CAP_MS, [&] { return wifi.isUp(); }));
+  TEST_ASSERT_LESS_OR_EQUAL(BASE_MS + CONNECT_MS + STEP_MS, now - droppedAt);
+
+  TEST_ASSERT_EQUAL(3, changes.size());
+  TEST_ASSERT_TRUE(changes[0]);
+  TEST_ASSERT_FALSE(changes[1]);
+  TEST_ASSERT_TRUE(changes[2]);
+  TEST_ASSERT_EQUAL(2, driver.timeSyncs());
+
+  // retryNow() из паузы - попытка сразу
+  driver.drop();
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, 100, [&] { return !wifi.isUp(); }));
+  uint32_t attempts = wifi.attempts();
+  wifi.retryNow(now);
+  TEST_ASSERT_EQUAL(LINK_CONNECTING, wifi.state());
+  TEST_ASSERT_EQUAL(attempts + 1, wifi.attempts());
+}
+
+// millis() переполняется через 49.7 суток: таймаут и пауза, начатые до
+// переполнения, заканчиваются вовремя после него
+static void testMillisWraparound() {
+  now = 0xFFFFFFFFu - 5000;
+  FakeWifiDriver driver(now, CONNECT_MS, 0);
+  WifiManager wifi(driver, BASE_MS, CAP_MS);
+  driver.attach(wifi);
+  driver.setReachable(false);
+
+  uint32_t started = now;
+  wifi.start(now);
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, 60000, [&] { return wifi.state() != LINK_CONNECTING; }));
+  TEST_ASSERT_EQUAL(WifiManager::CONNECT_TIMEOUT_MS, now - started);
+  TEST_ASSERT_LESS_THAN(started, now);
+
+  // Пауза через границу: отказ приходит за 500 мс до переполнения
+  driver.setReachable(true);
+  driver.setRejecting(true);
+  now = 0xFFFFFFFFu - CONNECT_MS - 500;
+  wifi.retryNow(now);
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, CONNECT_MS + 100, [&] { return wifi.state() == LINK_BACKOFF; }));
+  uint32_t pausedAt = now;
+  TEST_ASSERT_GREATER_THAN(0xFFFFFFFFu - 1000, pausedAt);
+  driver.setRejecting(false);
+  TEST_ASSERT_TRUE(runUntil(driver, wifi, CAP_MS, [&] { return wifi.isUp(); }));
+  TEST_ASSERT_LESS_THAN(CAP_MS, now);
+  TEST_ASSERT_LESS_OR_EQUAL(4 * BASE_MS + CONNECT_MS + STEP_MS, now - pausedAt);
+  TEST_ASSERT_GREATER_OR_EQUAL(BASE_MS + CONNECT_MS, now - pausedAt);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testConnectsWithoutWaiting);
+  RUN_TEST(testAttemptTimesOut);
+  RUN_TEST(testBackoffGrowsToCap);
+  RUN_TEST(testDropRetriesQuickly);
+  RUN_TEST(testMillisWraparound);
+  return UNITY_END();
+}
@@ -0,0 +1,346 @@
+// WorkoutExport: CSV, TCX и FIT короткой тренировки сверяются побайтно с
+// эталонами в golden/. FIT к тому же разбирается декодером теста по
+// спецификации (заголовок, размер данных, CRC заголовка и файла, сжатые
+// метки времени) и сверяется с журналом - эталон не может закрепить
+// ошибку кодировщика незамеченной. Длинная тренировка с разрывами
+// проверяет то же без эталона и независимость байтов от размера кусков
+// fill().
+//
+// Эталоны после намеренного изменения формата пересоздаются так:
+//   UPDATE_GOLDEN=1 pio test -e native -f test_workout_export
+//
+//   pio test -e native -f test_workout_export
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#include "flash_fs.h"
+#include "workout_export.h"
+#include "workout_journal.h"
+
+static const time_t START = 1714557600;     // 2024-05-01 10:00:00 UTC
+static const long UTC_OFFSET = 3 * 3600;
+static const uint32_t FIT_EPOCH = 631065600UL;
+
+static char root[64];
+static char pending[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/workout-export-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Разгон без пульса, ходьба, разрыв связи на 45 с, бег. gapEvery > 0 -
+// ещё разрыв на 40 с каждые gapEvery сэмплов
+static std::vector<WorkoutRecord> makeSamples(uint32_t count, uint32_t gapEvery) {
+  std::vector<WorkoutRecord> samples;
+  time_t timestamp = START;
+  uint32_t distance = 0;
+  for (uint32_t t = 0; t < count; t++) {
+    WorkoutRecord record = {};
+    if (t > 0) timestamp += 1;
+    if (t == 20 || (gapEvery > 0 && t % gapEvery == 0 && t > 0)) timestamp += 45;
+    record.speed = t < 2 ? 0.0f : (t < 20 ? 5.5f + t * 0.05f : 10.0f + (t % 7) * 0.25f);
+    distance += (uint32_t)(record.speed / 3.6f + 0.5f);
+    record.timestamp = timestamp;
+    record.distance = distance;
+    record.time = (uint16_t)(timestamp - START);
+    record.heartRate = t < 5 ? 0 : (uint8_t)(100 + t % 60);
+    record.isActive = t >= 2;
+    samples.push_back(record);
+  }
+  return samples;
+}
+
+// Пишет журнал и возвращает сэмплы, как их читает экспорт (скорость в
+// журнале - сотые км/ч)
+static std::vector<WorkoutRecord> writeJournal(FlashFs& fs, const std::vector<WorkoutRecord>& samples) {
+  WorkoutJournal journal(fs);
+  journal.setMaxBytes(16 * 1024 * 1024);
+  TEST_ASSERT_TRUE(journal.beginSession(START));
+  for (const WorkoutRecord& record : samples) journal.addSample(record);
+  TEST_ASSERT_TRUE(journal.endSession(samples.back().timestamp + 5, pending, sizeof(pending)));
+
+  std::vector<WorkoutRecord> stored;
+  JournalReader reader(fs, pending);
+  WorkoutRecord record;
+  while (reader.next(record)) stored.push_back(record);
+  TEST_ASSERT_EQUAL(samples.size(), stored.size());
+  return stored;
+}
+
+static std::string exportJournal(FlashFs& fs, WorkoutExport::Format format, size_t chunk,
+                                 size_t* contentLength = nullptr) {
+  WorkoutExport stream(fs, pending, 0, fs.size(pending), format, UTC_OFFSET);
+  TEST_ASSERT_FALSE(stream.empty());
+  if (contentLength != nullptr) *contentLength = stream.contentLength();
+  std::string out;
+  uint8_t buffer[2048];
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(buffer), chunk);
+  size_t length;
+  while ((length = stream.fill(buffer, chunk)) > 0) out.append((const char*)buffer, length);
+  return out;
+}
+
+// Эталоны лежат рядом с этим файлом; тесты запускаются из корня проекта
+static std::string goldenPath(const char* name) {
+  std::string path = __FILE__;
+  size_t slash = path.rfind('/');
+  return path.substr(0, slash == std::string::npos ? 0 : slash + 1) + "golden/" + name;
+}
+
+static void assertGolden(const char* name, const std::string& actual) {
+  std::string path = goldenPath(name);
+  if (getenv("UPDATE_GOLDEN") != nullptr) {
+    FILE* file = fopen(path.c_str(), "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(actual.data(), 1, actual.size(), file);
+    fclose(file);
+    TEST_MESSAGE(("updated " + path).c_str());
+    return;
+  }
+
+  FILE* file = fopen(path.c_str(), "rb");
+  TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+  std::string expected;
+  char buffer[1024];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) expected.append(buffer, length);
+  fclose(file);
+
+  // Первое расхождение - в сообщении, чтобы не искать его hexdump'ом
+  size_t at = 0;
+  while (at < expected.size() && at < actual.size() && expected[at] == actual[at]) at++;
+  char message[96];
+  snprintf(message, sizeof(message), "%s differs at byte %u (expected %u bytes, got %u)",
+           name, (unsigned)at, (unsigned)expected.size(), (unsigned)actual.size());
+  TEST_ASSERT_TRUE_MESSAGE(expected == actual, message);
+}
+
+// CRC-16/ARC побитно - независимо от табличной реализации кодировщика
+static uint16_t crc16(const uint8_t* data, size_t length) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  }
+  return crc;
+}
+
+static uint32_t getU(const uint8_t* p, size_t size) {
+  uint32_t value = 0;
+  for (size_t i = size; i > 0; i--) value = (value << 8) | p[i - 1];
+  return value;
+}
+
+struct FitRecord {
+  uint32_t timestamp;
+  uint32_t distance;
+  uint16_t speed;
+  uint8_t heartRate;
+};
+
+struct FitFile {
+  std::vector<FitRecord> records;
+  std::vector<uint16_t> messages;    // глобальные номера по порядку
+  uint32_t compressed;
+  uint32_t sessionDistance;
+  uint32_t sessionElapsed;
+};
+
+// Разбор FIT по спецификации: ошибки структуры валят тест
+static FitFile decodeFit(const std::string& file) {
+  struct Field { uint8_t number, size; };
+  struct Definition { bool defined; uint16_t global; std::vector<Field> fields; };
+
+  const uint8_t* data = (const uint8_t*)file.data();
+  TEST_ASSERT_GREATER_OR_EQUAL(16, file.size());
+  TEST_ASSERT_EQUAL(14, data[0]);
+  TEST_ASSERT_EQUAL_MEMORY(".FIT", data + 8, 4);
+  TEST_ASSERT_EQUAL(crc16(data, 12), getU(data + 12, 2));
+  uint32_t dataSize = getU(data + 4, 4);
+  TEST_ASSERT_EQUAL(14 + dataSize + 2, file.size());
+  // CRC по всему файлу вместе с последними двумя байтами - ноль
+  TEST_ASSERT_EQUAL(0, crc16(data, file.size()));
+
+  FitFile fit = {};
+  Definition definitions[16] = {};
+  uint32_t lastTime = 0;
+  size_t at = 14;
+  const size_t end = 14 + dataSize;
+  while (at < end) {
+    uint8_t header = data[at++];
+    if (header & 0x40 && !(header & 0x80)) {
+      TEST_ASSERT_EQUAL_MESSAGE(0, header & 0x20, "developer fields");
+      Definition& definition = definitions[header & 0x0F];
+      TEST_ASSERT_LESS_OR_EQUAL(end, at + 5);
+      TEST_ASSERT_EQUAL_MESSAGE(0, data[at + 1], "big endian");
+      definition.defined = true;
+      definition.global = (uint16_t)getU(data + at + 2, 2);
+      uint8_t count = data[at + 4];
+      at += 5;
+      definition.fields.clear();
+      for (uint8_t i = 0; i < count; i++, at += 3) {
+        definition.fields.push_back({ data[at], data[at + 1] });
+      }
+      continue;
+    }
+
+    uint8_t local;
+    bool hasTime = false;
+    if (header & 0x80) {
+      // Сжатая метка: младшие 5 бит, от предыдущей полной метки вперёд
+      local = (header >> 5) & 0x03;
+      uint8_t offset = header & 0x1F;
+      lastTime += (uint32_t)((offset - (lastTime & 0x1F)) & 0x1F);
+      hasTime = true;
+      fit.compressed++;
+    } else {
+      local = header & 0x0F;
+    }
+    const Definition& definition = definitions[local];
+    TEST_ASSERT_TRUE_MESSAGE(definition.defined, "data message before its definition");
+
+    FitRecord record = {};
+    for (const Field& field : definition.fields) {
+      TEST_ASSERT_LESS_OR_EQUAL(end, at + field.size);
+      uint32_t value = getU(data + at, field.size);
+      at += field.size;
+      if (field.number == 253) {
+        lastTime = value;
+        hasTime = true;
+      }
+      if (definition.global == 20) {
+        if (field.number == 5) record.distance = value;
+        if (field.number == 6) record.speed = (uint16_t)value;
+        if (field.number == 3) record.heartRate = (uint8_t)value;
+      } else if (definition.global == 18) {
+        if (field.number == 9) fit.sessionDistance = value;
+        if (field.number == 7) fit.sessionElapsed = value;
+      }
+    }
+    fit.messages.push_back(definition.global);
+    if (definition.global == 20) {
+      TEST_ASSERT_TRUE_MESSAGE(hasTime, "record without timestamp");
+      record.timestamp = lastTime;
+      fit.records.push_back(record);
+    }
+  }
+  TEST_ASSERT_EQUAL(end, at);
+  return fit;
+}
+
+static uint16_t expectedSpeed(float kmh) {
+  return (uint16_t)(kmh * 1000.0f / 3.6f + 0.5f);
+}
+
+static void assertFitMatchesSamples(const FitFile& fit, const std::vector<WorkoutRecord>& samples) {
+  TEST_ASSERT_EQUAL(samples.size(), fit.records.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    const WorkoutRecord& sample = samples[i];
+    const FitRecord& record = fit.records[i];
+    TEST_ASSERT_EQUAL((uint32_t)sample.timestamp - FIT_EPOCH, record.timestamp);
+    TEST_ASSERT_EQUAL(sample.distance * 100, record.distance);
+    TEST_ASSERT_EQUAL(expectedSpeed(sample.speed), record.speed);
+    TEST_ASSERT_EQUAL(sample.heartRate != 0 ? sample.heartRate : 0xFF, record.heartRate);
+  }
+
+  // file_id, записи, затем lap, session, activity
+  TEST_ASSERT_EQUAL(samples.size() + 4, fit.messages.size());
+  TEST_ASSERT_EQUAL(0, fit.messages.front());
+  TEST_ASSERT_EQUAL(19, fit.messages[fit.messages.size() - 3]);
+  TEST_ASSERT_EQUAL(18, fit.messages[fit.messages.size() - 2]);
+  TEST_ASSERT_EQUAL(34, fit.messages.back());
+  TEST_ASSERT_EQUAL(samples.back().distance * 100, fit.sessionDistance);
+  TEST_ASSERT_EQUAL((samples.back().timestamp + 5 - START) * 1000, fit.sessionElapsed);
+}
+
+static size_t countOf(const std::string& text, const char* needle) {
+  size_t count = 0;
+  for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) count++;
+  return count;
+}
+
+static void testCsvMatchesGolden() {
+  PosixFlash fs(root);
+  writeJournal(fs, makeSamples(40, 0));
+  std::string csv = exportJournal(fs, WorkoutExport::CSV, 1436);
+  TEST_ASSERT_EQUAL(1 + 40, countOf(csv, "\n"));
+  assertGolden("short.csv", csv);
+}
+
+static void testTcxMatchesGolden() {
+  PosixFlash fs(root);
+  writeJournal(fs, makeSamples(40, 0));
+  std::string tcx = exportJournal(fs, WorkoutExport::TCX, 1436);
+  TEST_ASSERT_EQUAL(40, countOf(tcx, "<Trackpoint>"));
+  TEST_ASSERT_EQUAL(35, countOf(tcx, "<HeartRateBpm>"));
+  assertGolden("short.tcx", tcx);
+}
+
+static void testFitMatchesGolden() {
+  PosixFlash fs(root);
+  std::vector<WorkoutRecord> samples = writeJournal(fs, makeSamples(40, 0));
+  size_t contentLength = 0;
+  std::string fit = exportJournal(fs, WorkoutExport::FIT, 1436, &contentLength);
+  TEST_ASSERT_EQUAL(fit.size(), contentLength);
+
+  FitFile decoded = decodeFit(fit);
+  assertFitMatchesSamples(decoded, samples);
+  // Полная метка - у первой точки и после разрыва на 45 с
+  TEST_ASSERT_EQUAL(38, decoded.compressed);
+  assertGolden("short.fit", fit);
+}
+
+// Два часа с разрывами: те же байты при любом размере кусков, FIT
+// разбирается и совпадает с журналом
+static void testLongWorkoutIndependentOfChunkSize() {
+  PosixFlash fs(root);
+  std::vector<WorkoutRecord> samples = writeJournal(fs, makeSamples(7200, 600));
+
+  const WorkoutExport::Format formats[] = { WorkoutExport::CSV, WorkoutExport::TCX, WorkoutExport::FIT };
+  for (WorkoutExport::Format format : formats) {
+    size_t contentLength = 0;
+    std::string whole = exportJournal(fs, format, 1436, &contentLength);
+    TEST_ASSERT_TRUE(whole == exportJournal(fs, format, 7));
+    TEST_ASSERT_TRUE(whole == exportJournal(fs, format, 2048));
+    if (format == WorkoutExport::FIT) {
+      TEST_ASSERT_EQUAL(whole.size(), contentLength);
+      FitFile decoded = decodeFit(whole);
+      assertFitMatchesSamples(decoded, samples);
+      // Полных меток: первая, разрыв на 20-й точке и 11 разрывов по 600
+      TEST_ASSERT_EQUAL(7200 - 13, decoded.compressed);
+
+      char message[96];
+      snprintf(message, sizeof(message), "fit: %u samples in %u bytes, %u compressed timestamps",
+               (unsigned)samples.size(), (unsigned)whole.size(), (unsigned)decoded.compressed);
+      TEST_MESSAGE(message);
+    } else if (format == WorkoutExport::TCX) {
+      TEST_ASSERT_EQUAL(7200, countOf(whole, "<Trackpoint>"));
+    } else {
+      TEST_ASSERT_EQUAL(1 + 7200, countOf(whole, "\n"));
+    }
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testCsvMatchesGolden);
+  RUN_TEST(testTcxMatchesGolden);
+  RUN_TEST(testFitMatchesGolden);
+  RUN_TEST(testLongWorkoutIndependentOfChunkSize);
+  return UNITY_END();
+}
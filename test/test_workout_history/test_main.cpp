@@ -0,0 +1,250 @@
+// WorkoutHistory на тысячах тренировок: постраничный обход курсором,
+// поиск, вставка восстановленных старых тренировок, сдвиг id при старте
+// в одну секунду на разных дорожках, перенос журнала без копирования и
+// вытеснение журналов по бюджету.
+//
+//   pio test -e native -f test_workout_history
+
+#include <chrono>
+#include <ftw.h>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "flash_fs.h"
+#include "workout_history.h"
+
+static const uint32_t FIRST_START = 1714557600;
+static const char* const PENDING = "/journal/pending/next.jnl";
+
+static char root[64];
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return ::remove(path);
+}
+
+void setUp() {
+  snprintf(root, sizeof(root), "/tmp/history-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+}
+
+void tearDown() {
+  nftw(root, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static void writeJournal(FlashFs& fs, size_t length) {
+  static uint8_t bytes[4096];
+  memset(bytes, 0x5A, sizeof(bytes));
+  fs.remove(PENDING);
+  while (length > 0) {
+    size_t part = length < sizeof(bytes) ? length : sizeof(bytes);
+    TEST_ASSERT_TRUE(fs.append(PENDING, bytes, part));
+    length -= part;
+  }
+}
+
+static WorkoutHistory::Entry summary(uint32_t start, uint8_t device) {
+  WorkoutHistory::Entry entry = {};
+  entry.id = start;
+  entry.duration = 1800 + start % 600;
+  entry.distance = start % 10000;
+  entry.maxSpeed = 1200;
+  entry.avgSpeed = 900;
+  entry.samples = 1800;
+  entry.device = device;
+  return entry;
+}
+
+// Все сводки от новых к старым страницами по pageSize
+static std::vector<WorkoutHistory::Entry> walk(WorkoutHistory& history, size_t pageSize, size_t& pages) {
+  std::vector<WorkoutHistory::Entry> all;
+  uint32_t cursor = 0;
+  pages = 0;
+  for (;;) {
+    std::vector<WorkoutHistory::Entry> page;
+    size_t found = history.list(cursor, pageSize, [&](const WorkoutHistory::Entry& entry) {
+      page.push_back(entry);
+    });
+    TEST_ASSERT_EQUAL(page.size(), found);
+    if (found == 0) break;
+    pages++;
+    all.insert(all.end(), page.begin(), page.end());
+    cursor = page.back().id;
+  }
+  return all;
+}
+
+static void testThousandsOfWorkoutsPaginate() {
+  PosixFlash fs(root);
+  // На хосте индекс больше своей доли раздела (FLASH_INDEX_BYTES)
+  WorkoutHistory history(fs, "/history", 2000);
+  history.begin();
+
+  // Тренировки по порядку, каждая десятая - восстановленная старая
+  // (вставка в середину индекса)
+  std::set<uint32_t> expected;
+  const uint32_t total = 3000;
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < total; i++) {
+    uint32_t start = FIRST_START + i * 7200;
+    if (i % 10 == 9) start = FIRST_START + (i - 5) * 7200 + 3600;
+    writeJournal(fs, 2048);
+    TEST_ASSERT_TRUE(history.append(PENDING, summary(start, 0)));
+    TEST_ASSERT_FALSE(fs.exists(PENDING));
+    expected.insert(start);
+    // Индекс держит не больше maxEntries новейших сводок
+    while (expected.size() > history.count()) expected.erase(expected.begin());
+  }
+  double appendMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  TEST_ASSERT_LESS_OR_EQUAL(2000, history.count());
+  TEST_ASSERT_GREATER_THAN(1000, history.count());
+  TEST_ASSERT_EQUAL(expected.size(), history.count());
+
+  size_t pages = 0;
+  started = std::chrono::steady_clock::now();
+  std::vector<WorkoutHistory::Entry> all = walk(history, 50, pages);
+  double walkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+  TEST_ASSERT_EQUAL(expected.size(), all.size());
+  TEST_ASSERT_EQUAL((all.size() + 49) / 50, pages);
+  auto newest = expected.rbegin();
+  for (size_t i = 0; i < all.size(); i++, ++newest) {
+    TEST_ASSERT_EQUAL(*newest, all[i].id);
+    TEST_ASSERT_EQUAL(summary(all[i].id, 0).distance, all[i].distance);
+  }
+
+  // Поиск по каждому id и промах между ними
+  for (size_t i = 0; i < all.size(); i += 7) {
+    WorkoutHistory::Entry found;
+    TEST_ASSERT_TRUE(history.find(all[i].id, found));
+    TEST_ASSERT_EQUAL(all[i].duration, found.duration);
+    TEST_ASSERT_FALSE(history.find(all[i].id + 1, found));
+  }
+
+  // Индекс переживает перезапуск
+  WorkoutHistory reopened(fs, "/history", 2000);
+  reopened.begin();
+  TEST_ASSERT_EQUAL(history.count(), reopened.count());
+
+  char message[128];
+  snprintf(message, sizeof(message), "%u appends in %.0f ms, %u entries in %u pages in %.1f ms",
+           (unsigned)total, appendMs, (unsigned)all.size(), (unsigned)pages, walkMs);
+  TEST_MESSAGE(message);
+}
+
+static void testSameSecondOnTwoTreadmills() {
+  PosixFlash fs(root);
+  WorkoutHistory history(fs, "/history");
+  history.begin();
+
+  writeJournal(fs, 100);
+  TEST_ASSERT_TRUE(history.append(PENDING, summary(FIRST_START, 0)));
+  writeJournal(fs, 200);
+  TEST_ASSERT_TRUE(history.append(PENDING, summary(FIRST_START, 1)));
+  TEST_ASSERT_EQUAL(2, history.count());
+
+  WorkoutHistory::Entry first, second;
+  TEST_ASSERT_TRUE(history.find(FIRST_START, first));
+  TEST_ASSERT_TRUE(history.find(FIRST_START + 1, second));
+  TEST_ASSERT_EQUAL(0, first.device);
+  TEST_ASSERT_EQUAL(1, second.device);
+
+  // Журнал лежит под путём, известным до append()
+  char expected[WorkoutHistory::MAX_PATH];
+  char path[WorkoutHistory::MAX_PATH];
+  history.archivePath(FIRST_START, 1, expected, sizeof(expected));
+  TEST_ASSERT_TRUE(history.samplesPath(second, path, sizeof(path)));
+  TEST_ASSERT_EQUAL_STRING(expected, path);
+  TEST_ASSERT_EQUAL(200, fs.size(path));
+  TEST_ASSERT_EQUAL(0, second.offset);
+  TEST_ASSERT_EQUAL(200, second.length);
+}
+
+// Сбой после записи сводки, до переноса журнала: восстановление
+// повторяет append() и только переносит журнал
+static void testRepeatCompletesInterruptedMove() {
+  PosixFlash fs(root);
+  WorkoutHistory history(fs, "/history");
+  history.begin();
+
+  writeJournal(fs, 300);
+  TEST_ASSERT_TRUE(history.append(PENDING, summary(FIRST_START, 2)));
+  char archived[WorkoutHistory::MAX_PATH];
+  history.archivePath(FIRST_START, 2, archived, sizeof(archived));
+  TEST_ASSERT_TRUE(fs.rename(archived, PENDING));
+
+  WorkoutHistory::Entry entry;
+  char path[WorkoutHistory::MAX_PATH];
+  TEST_ASSERT_TRUE(history.find(FIRST_START, entry));
+  TEST_ASSERT_FALSE(history.samplesPath(entry, path, sizeof(path)));
+
+  TEST_ASSERT_TRUE(history.append(PENDING, summary(FIRST_START, 2)));
+  TEST_ASSERT_EQUAL(1, history.count());
+  TEST_ASSERT_FALSE(fs.exists(PENDING));
+  TEST_ASSERT_TRUE(history.samplesPath(entry, path, sizeof(path)));
+}
+
+static bool retainAll = false;
+
+static bool retainCallback(const char*, void*) {
+  return retainAll;
+}
+
+static void testBudgetEvictsOldestJournals() {
+  // Журналы по блоку: в бюджет помещается fit самых новых; индекс - с
+  // запасом, чтобы вытеснял бюджет, а не число записей
+  const size_t fit = WorkoutHistory::SAMPLE_BUDGET / FLASH_BLOCK_SIZE;
+  PosixFlash fs(root);
+  WorkoutHistory history(fs, "/history", fit + 16);
+  history.setRetention(retainCallback, nullptr);
+  history.begin();
+  retainAll = false;
+
+  const uint32_t total = (uint32_t)fit + 3;
+  for (uint32_t i = 0; i < total; i++) {
+    writeJournal(fs, FLASH_BLOCK_SIZE - 100);
+    TEST_ASSERT_TRUE(history.append(PENDING, summary(FIRST_START + i * 3600, 0)));
+  }
+  TEST_ASSERT_EQUAL(total, history.count());
+  TEST_ASSERT_EQUAL(3, history.evictedJournals());
+
+  // Колбэк list() - под блокировкой архива, проверки после
+  std::vector<WorkoutHistory::Entry> entries;
+  history.list(0, total, [&](const WorkoutHistory::Entry& entry) { entries.push_back(entry); });
+  size_t kept = 0;
+  for (const WorkoutHistory::Entry& entry : entries) {
+    char path[WorkoutHistory::MAX_PATH];
+    bool present = history.samplesPath(entry, path, sizeof(path));
+    // Остаются самые новые
+    TEST_ASSERT_EQUAL(entry.id >= FIRST_START + 3 * 3600, present);
+    if (present) kept++;
+  }
+  TEST_ASSERT_EQUAL(fit, kept);
+
+  // Журнал больше всего бюджета: пока он нужен владельцу, не удаляется
+  retainAll = true;
+  writeJournal(fs, WorkoutHistory::SAMPLE_BUDGET + 1);
+  WorkoutHistory::Entry big = summary(FIRST_START + (total + 100) * 3600, 0);
+  TEST_ASSERT_TRUE(history.append(PENDING, big));
+  TEST_ASSERT_TRUE(history.find(big.id, big));
+  char path[WorkoutHistory::MAX_PATH];
+  TEST_ASSERT_TRUE(history.samplesPath(big, path, sizeof(path)));
+
+  // Отпустили - trim() укладывает архив в бюджет, удаляя и его
+  retainAll = false;
+  history.trim();
+  TEST_ASSERT_FALSE(history.samplesPath(big, path, sizeof(path)));
+  TEST_ASSERT_EQUAL(total + 1, history.count());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testThousandsOfWorkoutsPaginate);
+  RUN_TEST(testSameSecondOnTwoTreadmills);
+  RUN_TEST(testRepeatCompletesInterruptedMove);
+  RUN_TEST(testBudgetEvictsOldestJournals);
+  return UNITY_END();
+}
@@ -0,0 +1,254 @@
+// WorkoutStats против прямого пересчёта по всем записям.
+//
+// Сотни случайных тренировок: смена скорости, остановки, повторы одной
+// секунды, разрывы связи на границе MAX_GAP_S и длиннее, наклон, пульс
+// с пропусками и без ремня вовсе. Итоги считаются в SessionStore - с
+// прореживанием буфера и без - и сверяются с эталоном: время, время
+// движения, средняя скорость, набор высоты, пульс, калории трёх профилей
+// и каждый сохранённый сплит километра и мили. При постоянной скорости
+// все сплиты, включая первый, равны.
+//
+//   pio test -e native -f test_workout_stats
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+#include "calories.h"
+#include "session_store.h"
+#include "workout_stats.h"
+
+static const time_t START = 1714557600;
+static const int RUNS = 400;
+static const UserProfile USERS[] = { { 110, 35, true }, { 60, 28, false }, { 80, 60, true } };
+static const size_t USER_COUNT = sizeof(USERS) / sizeof(USERS[0]);
+
+// Повторяемый ГПСЧ (LCG)
+static uint32_t seed = 7;
+
+static uint32_t random24() {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// Итоги прямым проходом: каждая запись действует до следующей
+struct Reference {
+  double elapsed;
+  double moving;
+  double speedTime;
+  double climb;
+  double heartSum;
+  double heartTime;
+  float maxSpeed;
+  uint8_t maxHeartRate;
+  double calories[USER_COUNT];
+  std::vector<double> km;
+  std::vector<double> mile;
+};
+
+static void crossSplits(std::vector<double>& splits, double& splitStart, double length,
+                        const WorkoutRecord& from, const WorkoutRecord& to, double clock, double span) {
+  for (double boundary = (splits.size() + 1) * length; to.distance >= boundary;
+       boundary = (splits.size() + 1) * length) {
+    double at = clock + span * (boundary - from.distance) / (to.distance - from.distance);
+    splits.push_back(at - splitStart);
+    splitStart = at;
+  }
+}
+
+static Reference reference(const std::vector<WorkoutRecord>& records) {
+  Reference r = {};
+  double clock = 0;
+  double kmStart = 0;
+  double mileStart = 0;
+  // Первый сплит - от дистанции 0: до первой записи её скоростью
+  if (!records.empty() && records[0].distance > 0 && records[0].speed > WorkoutStats::MOVING_SPEED) {
+    double lead = std::min(records[0].distance / (records[0].speed / 3.6), (double)WorkoutStats::MAX_GAP_S);
+    kmStart = -lead;
+    mileStart = -lead;
+  }
+  for (size_t i = 0; i < records.size(); i++) {
+    r.maxSpeed = std::max(r.maxSpeed, records[i].speed);
+    r.maxHeartRate = std::max(r.maxHeartRate, records[i].heartRate);
+    if (i == 0) continue;
+
+    const WorkoutRecord& previous = records[i - 1];
+    const WorkoutRecord& current = records[i];
+    long gap = (long)(current.timestamp - previous.timestamp);
+    double span = gap > 0 && gap <= WorkoutStats::MAX_GAP_S ? gap : 0;
+    r.elapsed += span;
+    if (previous.speed > WorkoutStats::MOVING_SPEED) {
+      r.moving += span;
+      r.speedTime += previous.speed * span;
+    }
+    if (previous.heartRate != 0) {
+      r.heartSum += previous.heartRate * span;
+      r.heartTime += span;
+    }
+    for (size_t u = 0; u < USER_COUNT; u++) {
+      r.calories[u] += caloriesPerMinute(USERS[u], previous.speed, previous.heartRate) * span / 60.0;
+    }
+    if (current.distance > previous.distance && previous.incline > 0) {
+      r.climb += (current.distance - previous.distance) * previous.incline / 1000.0;
+    }
+    crossSplits(r.km, kmStart, 1000.0, previous, current, clock, span);
+    crossSplits(r.mile, mileStart, 1609.344, previous, current, clock, span);
+    clock += span;
+  }
+  return r;
+}
+
+static std::vector<WorkoutRecord> randomWorkout(int run) {
+  std::vector<WorkoutRecord> records;
+  time_t t = START;
+  // Первая запись - уже в пути, как после задержки старта трекера
+  double distance = random24() % 40;
+  float speed = 3;
+  int count = 200 + random24() % 6000;
+  for (int i = 0; i < count; i++) {
+    uint32_t roll = random24() % 1000;
+    // Разрывы (и ровно на границе MAX_GAP_S), повторы секунды, шаг 1-3 с
+    t += roll < 5 ? WorkoutStats::MAX_GAP_S - 1 + random24() % 300 : (roll < 100 ? 0 : 1 + roll % 3);
+    if (random24() % 10 == 0) speed = (random24() % 2000) / 100.0f;
+    if (random24() % 50 == 0) speed = 0;
+    distance += speed / 3.6;
+
+    WorkoutRecord record = {};
+    record.timestamp = t;
+    record.speed = speed;
+    record.distance = (uint32_t)distance;
+    record.incline = (int16_t)((int)(random24() % 300) - 100);
+    record.heartRate = run % 3 == 0 ? 0 : (random24() % 7 == 0 ? 0 : (uint8_t)(60 + random24() % 130));
+    record.isActive = speed > 0.8f;
+    records.push_back(record);
+  }
+  return records;
+}
+
+static bool near(double actual, double expected, double tolerance) {
+  return fabs(actual - expected) <= tolerance * std::max(1.0, fabs(expected));
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void testMatchesBruteForce() {
+  seed = 7;
+  size_t checked = 0;
+  size_t splits = 0;
+  for (int run = 0; run < RUNS; run++) {
+    // Чётные - без прореживания, нечётные - буфер на 64 точки
+    SessionStore store;
+    TEST_ASSERT_TRUE(store.begin(run % 2 ? 64 : 4096));
+    std::vector<WorkoutRecord> records = randomWorkout(run);
+    for (const WorkoutRecord& record : records) store.add(record);
+
+    const WorkoutStats& stats = store.stats();
+    Reference expected = reference(records);
+    char message[48];
+    snprintf(message, sizeof(message), "run %d", run);
+
+    TEST_ASSERT_EQUAL_MESSAGE(records.size(), stats.samples(), message);
+    TEST_ASSERT_EQUAL_MESSAGE(records.back().distance, stats.distance(), message);
+    TEST_ASSERT_TRUE_MESSAGE(expected.maxSpeed == stats.maxSpeed(), message);
+    TEST_ASSERT_EQUAL_MESSAGE(expected.maxHeartRate, stats.maxHeartRate(), message);
+    TEST_ASSERT_EQUAL_MESSAGE((uint32_t)expected.elapsed, stats.elapsedSeconds(), message);
+    TEST_ASSERT_EQUAL_MESSAGE((uint32_t)expected.moving, stats.movingSeconds(), message);
+    double avgSpeed = expected.moving > 0 ? expected.speedTime / expected.moving : 0;
+    TEST_ASSERT_TRUE_MESSAGE(near(stats.avgSpeed(), avgSpeed, 1e-5), message);
+    TEST_ASSERT_TRUE_MESSAGE(near(stats.elevationGain(), expected.climb, 1e-5), message);
+    uint8_t avgHeartRate = expected.heartTime > 0
+      ? (uint8_t)floor(expected.heartSum / expected.heartTime + 0.5) : 0;
+    TEST_ASSERT_EQUAL_MESSAGE(avgHeartRate, stats.avgHeartRate(), message);
+    for (size_t u = 0; u < USER_COUNT; u++) {
+      TEST_ASSERT_TRUE_MESSAGE(near(stats.calories(USERS[u]), expected.calories[u], 1e-4), message);
+    }
+
+    TEST_ASSERT_EQUAL_MESSAGE(expected.km.size(), stats.splitCount(WorkoutStats::KILOMETER), message);
+    TEST_ASSERT_EQUAL_MESSAGE(expected.mile.size(), stats.splitCount(WorkoutStats::MILE), message);
+    TEST_ASSERT_EQUAL_MESSAGE(std::min(expected.km.size(), WorkoutStats::MAX_KM_SPLITS),
+                              stats.storedSplits(WorkoutStats::KILOMETER), message);
+    TEST_ASSERT_EQUAL_MESSAGE(std::min(expected.mile.size(), WorkoutStats::MAX_MILE_SPLITS),
+                              stats.storedSplits(WorkoutStats::MILE), message);
+    for (size_t i = 0; i < stats.storedSplits(WorkoutStats::KILOMETER); i++) {
+      TEST_ASSERT_TRUE_MESSAGE(near(stats.split(WorkoutStats::KILOMETER, i), expected.km[i], 1e-4), message);
+    }
+    for (size_t i = 0; i < stats.storedSplits(WorkoutStats::MILE); i++) {
+      TEST_ASSERT_TRUE_MESSAGE(near(stats.split(WorkoutStats::MILE, i), expected.mile[i], 1e-4), message);
+    }
+    checked += records.size();
+    splits += stats.storedSplits(WorkoutStats::KILOMETER) + stats.storedSplits(WorkoutStats::MILE);
+  }
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u records in %d workouts, %u splits, all match",
+           (unsigned)checked, RUNS, (unsigned)splits);
+  TEST_MESSAGE(message);
+}
+
+// Постоянные 7.2 км/ч (2 м/с), запись раз в секунду; первая - через 5 с
+// после старта, на 10 м. Все сплиты равны, первый тоже
+static void testConstantSpeedEqualSplits() {
+  WorkoutStats stats;
+  const uint32_t FIRST = 5;
+  for (uint32_t t = FIRST; t <= 3 * 3600; t++) {
+    WorkoutRecord record = {};
+    record.timestamp = START + t;
+    record.speed = 7.2f;
+    record.distance = 2 * t;
+    stats.add(record);
+  }
+
+  TEST_ASSERT_EQUAL(21, stats.splitCount(WorkoutStats::KILOMETER));
+  TEST_ASSERT_EQUAL(13, stats.splitCount(WorkoutStats::MILE));
+  for (size_t i = 0; i < stats.storedSplits(WorkoutStats::KILOMETER); i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 500.0f, stats.split(WorkoutStats::KILOMETER, i));
+  }
+  for (size_t i = 0; i < stats.storedSplits(WorkoutStats::MILE); i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 804.672f, stats.split(WorkoutStats::MILE, i));
+  }
+  // Учтённое время - от первой записи, сплиты - от дистанции 0
+  TEST_ASSERT_EQUAL(3 * 3600 - FIRST, stats.elapsedSeconds());
+
+  // Первая запись стоя: отсчитать время до неё не по чему
+  WorkoutStats standing;
+  for (uint32_t t = 0; t <= 600; t++) {
+    WorkoutRecord record = {};
+    record.timestamp = START + t;
+    record.speed = t == 0 ? 0.0f : 7.2f;
+    record.distance = 10 + 2 * t;
+    standing.add(record);
+  }
+  TEST_ASSERT_EQUAL(1, standing.splitCount(WorkoutStats::KILOMETER));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 495.0f, standing.split(WorkoutStats::KILOMETER, 0));
+}
+
+// Пустая тренировка и одна запись: нулевые итоги без деления на ноль
+static void testEmptyAndSingleRecord() {
+  WorkoutStats stats;
+  TEST_ASSERT_EQUAL(0, stats.samples());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.avgSpeed());
+  TEST_ASSERT_EQUAL(0, stats.avgHeartRate());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.calories(USERS[0]));
+
+  WorkoutRecord record = {};
+  record.timestamp = START;
+  record.speed = 10.0f;
+  record.distance = 5;
+  record.heartRate = 140;
+  stats.add(record);
+  TEST_ASSERT_EQUAL(1, stats.samples());
+  TEST_ASSERT_EQUAL(0, stats.elapsedSeconds());
+  TEST_ASSERT_EQUAL(140, stats.maxHeartRate());
+  TEST_ASSERT_EQUAL(0, stats.splitCount(WorkoutStats::KILOMETER));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testMatchesBruteForce);
+  RUN_TEST(testConstantSpeedEqualSplits);
+  RUN_TEST(testEmptyAndSingleRecord);
+  return UNITY_END();
+}